@@ -17,6 +17,29 @@
 // Core types - always available
 #include "LumynLabs/Eventing/EventType.h"
 #include "LumynLabs/Eventing/Event.h"
+#include "LumynLabs/Eventing/EventTrace.h"
+#include "LumynLabs/Eventing/EventRing.h"
+#include "LumynLabs/Eventing/EventCoalescer.h"
+
+// Host link utilities - always available
+#include "LumynLabs/Networking/Cobs.h"
+#include "LumynLabs/Networking/CobsFrameReader.h"
+#include "LumynLabs/Networking/FragmentScheduler.h"
+#include "LumynLabs/Networking/RxSpanRing.h"
+#include "LumynLabs/Networking/StreamSpanRx.h"
+#include "LumynLabs/Networking/TxGather.h"
+#include "LumynLabs/Networking/TxScheduler.h"
+#include "LumynLabs/Networking/UartDmaRx.h"
+#include "LumynLabs/Stream/RttEstimator.h"
+#include "LumynLabs/Stream/SelectiveAck.h"
+#include "LumynLabs/Stream/StreamCredits.h"
+#include "LumynLabs/Util/Crc32.h"
+
+// Storage and update utilities - always available
+#include "LumynLabs/Files/BufferPool.h"
+#include "LumynLabs/Files/FileRequestPipeline.h"
+#include "LumynLabs/System/OtaPatch.h"
+#include "LumynLabs/System/OtaPipeline.h"
 
 // LED APIs - conditional on CX_FEATURE_LED
 #if CX_FEATURE_LED
@@ -29,10 +52,25 @@
 // Module APIs - conditional on CX_FEATURE_MODULES
 #if CX_FEATURE_MODULES
 #include "LumynLabs/Modules/Module.h"
+#include "LumynLabs/Modules/ModuleCommands.h"
 #include "LumynLabs/Modules/ModuleConfig.h"
 #include "LumynLabs/Modules/ModuleError.h"
+#include "LumynLabs/Modules/ModuleFields.h"
 #include "LumynLabs/Modules/ModulePeripherals.h"
+#include "LumynLabs/Modules/ModulePipeline.h"
 #include "LumynLabs/Modules/ModuleRegistration.h"
+#include "LumynLabs/Modules/ModuleSchema.h"
+#include "LumynLabs/Modules/ReportOnChange.h"
+#include "LumynLabs/Bus/BusArbiter.h"
+#include "LumynLabs/Bus/BusUsage.h"
+#include "LumynLabs/Bus/I2cQueue.h"
+#include "LumynLabs/Sensors/AdcDmaSampler.h"
+#include "LumynLabs/Sensors/AdcFilter.h"
+#include "LumynLabs/Sensors/AnalogFilterModule.h"
+#include "LumynLabs/Sensors/Apds9151Module.h"
+#include "LumynLabs/Sensors/EdgeTracker.h"
+#include "LumynLabs/Sensors/PioEdgeCapture.h"
+#include "LumynLabs/Sensors/Vl53l1xRanger.h"
 #endif
 
 /**
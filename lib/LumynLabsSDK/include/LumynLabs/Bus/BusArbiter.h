@@ -0,0 +1,334 @@
+/**
+ * @file BusArbiter.h
+ * @brief Priority arbitration and accounting for blocking buses (SPI, UART)
+ *
+ * Drivers that talk to SPI or UART devices through the Arduino objects
+ * take a BusLease around each access. When the bus is busy, waiters are
+ * granted it by BusPriority, then first come first served, and give up
+ * after their own timeout. A lease held longer than the arbiter's hold
+ * limit cannot be interrupted (the transfer is blocking) but is counted
+ * against the module as a timeout, so the culprit shows up in the usage
+ * table.
+ *
+ * I2C traffic should use I2cQueue instead, which applies the same
+ * priorities and accounting per transaction and can abort stuck ones.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "BusUsage.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Exclusive access to one shared bus
+   *
+   * @code
+   * static LumynLabs::BusArbiter spiBus(2000);   // 2 ms hold limit
+   *
+   * LumynLabs::ModuleError MyModule::readData(Data* out) {
+   *   LumynLabs::BusLease lease(spiBus, getId(), LumynLabs::BusPriority::Normal, 5);
+   *   if (!lease) return LumynLabs::ModuleError::timeout();
+   *   peripherals().getSPI().transfer(...);
+   *   ...
+   * }
+   * @endcode
+   */
+  class BusArbiter
+  {
+  public:
+    /** Most tasks that may wait for the bus at once. */
+    static constexpr size_t kMaxWaiters = 8;
+
+    /** @param holdLimitUs Lease time above which an access counts as a timeout; 0 = none */
+    explicit BusArbiter(uint32_t holdLimitUs = 0) : _holdLimitUs(holdLimitUs) {}
+
+    BusArbiter(const BusArbiter &) = delete;
+    BusArbiter &operator=(const BusArbiter &) = delete;
+
+    /**
+     * @brief Take the bus
+     *
+     * @param moduleId  Module charged for the bus time
+     * @param priority  Ordering among waiters
+     * @param timeoutMs How long to wait; the wait counts as a timeout on expiry
+     * @return true if the caller now owns the bus
+     */
+    bool acquire(uint16_t moduleId, BusPriority priority, uint32_t timeoutMs)
+    {
+      const uint32_t start = nowUs();
+      Waiter self{};
+      self.priority = priority;
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      self.task = xTaskGetCurrentTaskHandle();
+#endif
+
+      {
+        Lock lock(*this);
+        if (!_busy)
+        {
+          grant(moduleId, start, start);
+          return true;
+        }
+        if (!enqueue(self))
+        {
+          _usage.record(moduleId, 0, 0, true, false);
+          return false;
+        }
+      }
+
+      const bool granted = block(self, timeoutMs);
+
+      Lock lock(*this);
+      if (!granted && !self.granted)
+      {
+        remove(self);
+        _usage.record(moduleId, 0, nowUs() - start, true, false);
+        return false;
+      }
+      grant(moduleId, start, nowUs());
+      return true;
+    }
+
+    /** Give the bus to the best waiter, or mark it free. */
+    void release()
+    {
+      const uint32_t now = nowUs();
+      Waiter woken{};
+      bool handedOver = false;
+      {
+        Lock lock(*this);
+        if (!_busy)
+        {
+          return;
+        }
+        const uint32_t held = now - _grantedUs;
+        _usage.record(_owner, held, _waitedUs, _holdLimitUs && held > _holdLimitUs, false);
+
+        Waiter *next = popBest();
+        if (next)
+        {
+          // Ownership passes directly; _busy stays set. The waiter may
+          // return as soon as the lock drops, so wake a copy.
+          next->granted = true;
+          woken.priority = next->priority;
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+          woken.task = next->task;
+#endif
+          handedOver = true;
+        }
+        else
+        {
+          _busy = false;
+        }
+      }
+      if (handedOver)
+      {
+        wake(woken);
+      }
+    }
+
+    /** Record a failed access (for example a bad checksum) against a module. */
+    void recordError(uint16_t moduleId)
+    {
+      Lock lock(*this);
+      _usage.record(moduleId, 0, 0, false, true);
+    }
+
+    /**
+     * @brief Copy per-module bus usage
+     * @return Entries written; size @p out with BusUsageTable::kEntries
+     */
+    size_t usage(BusUsageEntry *out, size_t maxEntries)
+    {
+      Lock lock(*this);
+      return _usage.snapshot(out, maxEntries);
+    }
+
+    void resetUsage()
+    {
+      Lock lock(*this);
+      _usage.reset();
+    }
+
+  private:
+    struct Waiter
+    {
+      BusPriority priority;
+      uint32_t order;
+      volatile bool granted;
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      TaskHandle_t task;
+#endif
+    };
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    struct Lock
+    {
+      explicit Lock(BusArbiter &) { taskENTER_CRITICAL(); }
+      ~Lock() { taskEXIT_CRITICAL(); }
+    };
+
+    static uint32_t nowUs() { return micros(); }
+
+    bool block(Waiter &self, uint32_t timeoutMs)
+    {
+      const TickType_t start = xTaskGetTickCount();
+      const TickType_t limit = pdMS_TO_TICKS(timeoutMs);
+      while (!self.granted)
+      {
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= limit)
+        {
+          return false;
+        }
+        ulTaskNotifyTake(pdTRUE, limit - elapsed);
+      }
+      return true;
+    }
+
+    void wake(const Waiter &w) { xTaskNotifyGive(w.task); }
+#else
+    struct Lock
+    {
+      explicit Lock(BusArbiter &a) : lock(a._mutex) {}
+      std::lock_guard<std::mutex> lock;
+    };
+
+    static uint32_t nowUs()
+    {
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+    }
+
+    bool block(Waiter &self, uint32_t timeoutMs)
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      return _cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return self.granted; });
+    }
+
+    void wake(const Waiter &)
+    {
+      // Lock/unlock orders the notify after the waiter's predicate check.
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+      }
+      _cv.notify_all();
+    }
+#endif
+
+    void grant(uint16_t moduleId, uint32_t requestedUs, uint32_t nowUs)
+    {
+      _busy = true;
+      _owner = moduleId;
+      _grantedUs = nowUs;
+      _waitedUs = nowUs - requestedUs;
+    }
+
+    bool enqueue(Waiter &w)
+    {
+      if (_waiterCount == kMaxWaiters)
+      {
+        return false;
+      }
+      w.order = _nextOrder++;
+      w.granted = false;
+      _waiters[_waiterCount++] = &w;
+      return true;
+    }
+
+    void remove(Waiter &w)
+    {
+      for (size_t i = 0; i < _waiterCount; ++i)
+      {
+        if (_waiters[i] == &w)
+        {
+          _waiters[i] = _waiters[--_waiterCount];
+          return;
+        }
+      }
+    }
+
+    Waiter *popBest()
+    {
+      if (_waiterCount == 0)
+      {
+        return nullptr;
+      }
+      size_t best = 0;
+      for (size_t i = 1; i < _waiterCount; ++i)
+      {
+        const Waiter *w = _waiters[i];
+        const Waiter *b = _waiters[best];
+        if (w->priority < b->priority ||
+            (w->priority == b->priority && static_cast<int32_t>(w->order - b->order) < 0))
+        {
+          best = i;
+        }
+      }
+      Waiter *w = _waiters[best];
+      _waiters[best] = _waiters[--_waiterCount];
+      return w;
+    }
+
+    uint32_t _holdLimitUs;
+    bool _busy = false;
+    uint16_t _owner = kBusNoOwner;
+    uint32_t _grantedUs = 0;
+    uint32_t _waitedUs = 0;
+    Waiter *_waiters[kMaxWaiters] = {};
+    size_t _waiterCount = 0;
+    uint32_t _nextOrder = 0;
+    BusUsageTable _usage;
+#if !(defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED)
+    std::mutex _mutex;
+    std::condition_variable _cv;
+#endif
+  };
+
+  /**
+   * @brief RAII lease on a BusArbiter
+   */
+  class BusLease
+  {
+  public:
+    BusLease(BusArbiter &arbiter, uint16_t moduleId, BusPriority priority, uint32_t timeoutMs)
+        : _arbiter(arbiter), _held(arbiter.acquire(moduleId, priority, timeoutMs)) {}
+
+    ~BusLease()
+    {
+      if (_held)
+      {
+        _arbiter.release();
+      }
+    }
+
+    BusLease(const BusLease &) = delete;
+    BusLease &operator=(const BusLease &) = delete;
+
+    explicit operator bool() const { return _held; }
+
+  private:
+    BusArbiter &_arbiter;
+    bool _held;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,135 @@
+/**
+ * @file BusUsage.h
+ * @brief Per-module bus time accounting
+ *
+ * Shared by I2cQueue and BusArbiter to record, for each module ID, how
+ * long it held the bus, how long it waited for it, and how often its
+ * accesses timed out or failed. The table is not locked itself; each bus
+ * updates it under its own lock.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CX_BUS_USAGE_MAX_MODULES
+#define CX_BUS_USAGE_MAX_MODULES 8
+#endif
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Arbitration priority for shared buses, highest first
+   */
+  enum class BusPriority : uint8_t
+  {
+    High = 0, ///< Latency-critical sensors
+    Normal,
+    Low, ///< Background polling, configuration
+  };
+
+  /** Module ID used for accesses that do not name an owner. */
+  constexpr uint16_t kBusNoOwner = 0xFFFF;
+
+  /**
+   * @brief Counters for one module on one bus (28 bytes, status payload layout)
+   */
+  struct BusUsageEntry
+  {
+    uint16_t moduleId;     ///< Module ID, or kBusNoOwner
+    uint16_t reserved;
+    uint32_t transactions; ///< Accesses completed
+    uint32_t busyUs;       ///< Total time holding the bus
+    uint32_t maxBusyUs;    ///< Longest single access
+    uint32_t waitUs;       ///< Total time waiting for the bus
+    uint32_t timeouts;     ///< Accesses that timed out or overran their limit
+    uint32_t errors;       ///< Accesses that failed otherwise (NAK, bus error)
+  };
+  static_assert(sizeof(BusUsageEntry) == 28, "BusUsageEntry is part of the status format");
+
+  /**
+   * @brief Fixed-size table of BusUsageEntry keyed by module ID
+   *
+   * Holds CX_BUS_USAGE_MAX_MODULES modules. When the table is full, new
+   * modules are folded into the kBusNoOwner entry, which is always kept in
+   * slot 0.
+   */
+  class BusUsageTable
+  {
+  public:
+    /** Entries a snapshot can return, including the shared slot. */
+    static constexpr size_t kEntries = CX_BUS_USAGE_MAX_MODULES + 1;
+
+    BusUsageTable() { reset(); }
+
+    /** Record one finished access. */
+    void record(uint16_t moduleId, uint32_t busyUs, uint32_t waitUs, bool timedOut, bool failed)
+    {
+      BusUsageEntry &e = entryFor(moduleId);
+      ++e.transactions;
+      e.busyUs += busyUs;
+      e.waitUs += waitUs;
+      if (busyUs > e.maxBusyUs)
+      {
+        e.maxBusyUs = busyUs;
+      }
+      e.timeouts += timedOut;
+      e.errors += failed;
+    }
+
+    /**
+     * @brief Copy the used entries
+     * @return Number of entries written to @p out
+     */
+    size_t snapshot(BusUsageEntry *out, size_t maxEntries) const
+    {
+      size_t n = 0;
+      for (size_t i = 0; i < kEntries && n < maxEntries; ++i)
+      {
+        if (i == 0 || _entries[i].moduleId != kBusNoOwner)
+        {
+          out[n++] = _entries[i];
+        }
+      }
+      return n;
+    }
+
+    void reset()
+    {
+      for (auto &e : _entries)
+      {
+        e = BusUsageEntry{kBusNoOwner, 0, 0, 0, 0, 0, 0, 0};
+      }
+    }
+
+  private:
+    BusUsageEntry &entryFor(uint16_t moduleId)
+    {
+      if (moduleId == kBusNoOwner)
+      {
+        return _entries[0];
+      }
+      for (size_t i = 1; i < kEntries; ++i)
+      {
+        if (_entries[i].moduleId == moduleId)
+        {
+          return _entries[i];
+        }
+        if (_entries[i].moduleId == kBusNoOwner)
+        {
+          _entries[i].moduleId = moduleId;
+          return _entries[i];
+        }
+      }
+      return _entries[0];
+    }
+
+    BusUsageEntry _entries[kEntries];
+  };
+
+} // namespace LumynLabs
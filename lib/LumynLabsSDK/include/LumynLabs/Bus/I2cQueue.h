@@ -0,0 +1,844 @@
+/**
+ * @file I2cQueue.h
+ * @brief Queued, non-blocking I2C transactions
+ *
+ * A module describes each bus access as an I2cTransfer (address, bytes to
+ * write, buffer to read into) and submits it. Transfers from all modules
+ * go into one queue and are started back to back by the bus driver as
+ * soon as the previous one completes, without a task switch in between.
+ * The submitter gets a completion callback, or waits on the transfer
+ * itself.
+ *
+ * Pending transfers are ordered by BusPriority, and a transfer that holds
+ * the bus past its timeout is aborted so one stuck or clock-stretching
+ * device cannot stall the others. Bus and wait time are recorded per
+ * module in a BusUsageTable.
+ *
+ * Rp2040I2cDma runs each transfer entirely from DMA: the command words
+ * (data bytes, read requests, RESTART and STOP) are streamed into the I2C
+ * controller's FIFO and received bytes are streamed out, so the CPU is
+ * only involved once per transaction.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "BusUsage.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(ARDUINO_ARCH_RP2040)
+#include <hardware/dma.h>
+#include <hardware/i2c.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#else
+#include <chrono>
+#include <mutex>
+#include <thread>
+#endif
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <FreeRTOS.h>
+#include <task.h>
+#endif
+
+namespace LumynLabs
+{
+
+  enum class I2cStatus : uint8_t
+  {
+    Pending, ///< Queued or on the bus
+    Ok,
+    Nak,     ///< Address or data not acknowledged
+    Timeout, ///< Did not finish in time
+    Error,   ///< Bus error, or the transfer is too large for the driver
+  };
+
+  class I2cQueue;
+
+  /**
+   * @brief One write-then-read transaction
+   *
+   * Owned by the submitter and linked into the queue in place, so it must
+   * stay alive and untouched until done(). Either part may be empty. A
+   * transfer that has to go away early (a timeout in the caller, a
+   * module shutting down) is taken back with I2cQueue::cancel() first;
+   * wait() does that itself when it times out.
+   */
+  struct I2cTransfer
+  {
+    /** Called on completion, possibly from interrupt context; keep it short. */
+    using Callback = void (*)(I2cTransfer &transfer, void *arg);
+
+    uint8_t address = 0;
+    const uint8_t *tx = nullptr;
+    uint16_t txLength = 0;
+    uint8_t *rx = nullptr;
+    uint16_t rxLength = 0;
+    Callback callback = nullptr;
+    void *arg = nullptr;
+    BusPriority priority = BusPriority::Normal;
+    uint16_t owner = kBusNoOwner; ///< Module ID charged for the bus time
+    uint32_t timeoutUs = 0;       ///< Longest time on the bus; 0 = queue default
+
+    I2cTransfer() = default;
+    I2cTransfer(const I2cTransfer &) = delete;
+    I2cTransfer &operator=(const I2cTransfer &) = delete;
+
+    /** Describe a register read: write @p txLength bytes, then read @p rxLength. */
+    I2cTransfer &set(uint8_t addr, const uint8_t *txData, uint16_t txLen, uint8_t *rxData = nullptr,
+                     uint16_t rxLen = 0)
+    {
+      address = addr;
+      tx = txData;
+      txLength = txLen;
+      rx = rxData;
+      rxLength = rxLen;
+      return *this;
+    }
+
+    I2cStatus status() const { return _status.load(std::memory_order_acquire); }
+    bool done() const { return status() != I2cStatus::Pending; }
+
+    /**
+     * @brief Block the calling task until the transfer completes
+     *
+     * If it has not finished in @p timeoutMs it is cancelled, so it is
+     * done() either way when this returns and may go out of scope.
+     *
+     * @return Final status; Timeout if it was cancelled
+     */
+    I2cStatus wait(uint32_t timeoutMs);
+
+  private:
+    friend class I2cQueue;
+
+    std::atomic<I2cStatus> _status{I2cStatus::Ok};
+    I2cQueue *_queue = nullptr; ///< Queue of the last submit, for wait()
+    I2cTransfer *_next = nullptr;
+    uint32_t _submitUs = 0;
+    uint32_t _startUs = 0;
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    TaskHandle_t _waiter = nullptr;
+#endif
+  };
+
+  /**
+   * @brief Executes transfers on the wire
+   *
+   * start() begins a transfer; the driver reports the outcome through
+   * I2cQueue::complete() with the same transfer, normally from interrupt
+   * context. Completing from inside start() (invalid transfers, simulated
+   * buses) is allowed. A completion for a transfer that is no longer
+   * active (already timed out) is ignored.
+   */
+  class I2cBusDriver
+  {
+  public:
+    virtual ~I2cBusDriver() = default;
+    virtual void start(I2cTransfer &transfer, I2cQueue &queue) = 0;
+
+    /**
+     * @brief Stop the transfer in progress after a timeout or a cancel
+     *
+     * Called with the queue locked, so it must not wait on the bus. The
+     * driver must not report the aborted transfer through complete()
+     * afterwards, and must be done with its buffers when this returns.
+     */
+    virtual void abort() {}
+  };
+
+  /**
+   * @brief Queue counters
+   */
+  struct I2cQueueStats
+  {
+    uint32_t transfers; ///< Transfers completed
+    uint32_t bytes;     ///< Bytes written plus bytes read
+    uint32_t naks;      ///< Transfers that ended in I2cStatus::Nak
+    uint32_t timeouts;  ///< Transfers aborted by poll() or cancel()
+    uint32_t errors;    ///< Transfers that ended in I2cStatus::Error
+    uint32_t busyUs;    ///< Time with a transfer on the bus
+  };
+
+  /**
+   * @brief FIFO of pending transfers for one bus
+   *
+   * submit() may be called from any task; complete() is called by the
+   * driver. Transfers run in priority order, and in submission order
+   * within a priority. Call poll() periodically (every few milliseconds)
+   * to enforce timeouts.
+   *
+   * @code
+   * static LumynLabs::Rp2040I2cDma<> i2cDriver;
+   * static LumynLabs::I2cQueue i2c(i2cDriver);
+   * i2cDriver.begin(i2c0);                  // after Wire.begin() set pins and clock
+   *
+   * // inside readData(): both reads go out back to back
+   * LumynLabs::I2cTransfer a, b;
+   * a.set(0x29, regA, 2, bufA, 17);
+   * a.owner = getId();
+   * b.set(0x52, regB, 1, bufB, 15);
+   * b.owner = getId();
+   * i2c.submit(a);
+   * i2c.submit(b);
+   * // Wait on both: a transfer that times out is cancelled by wait(), so
+   * // neither is left on the bus when a and b go out of scope.
+   * const LumynLabs::I2cStatus statusA = a.wait(5);
+   * const LumynLabs::I2cStatus statusB = b.wait(5);
+   * if (statusA != LumynLabs::I2cStatus::Ok || statusB != LumynLabs::I2cStatus::Ok) ...
+   * @endcode
+   */
+  class I2cQueue
+  {
+  public:
+    explicit I2cQueue(I2cBusDriver &driver) : _driver(driver)
+    {
+#if defined(ARDUINO_ARCH_RP2040)
+      _lock = spin_lock_instance(spin_lock_claim_unused(true));
+#endif
+    }
+
+    I2cQueue(const I2cQueue &) = delete;
+    I2cQueue &operator=(const I2cQueue &) = delete;
+
+    /**
+     * @brief Queue a transfer
+     * @return false if @p transfer is still pending from an earlier submit
+     */
+    bool submit(I2cTransfer &transfer)
+    {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      // Submits from an interrupt (chained transfers, GPIO handlers) have
+      // no task to wake.
+      TaskHandle_t waiter = (__get_current_exception() == 0 && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+                                ? xTaskGetCurrentTaskHandle()
+                                : nullptr;
+#endif
+
+      I2cTransfer *first = nullptr;
+      {
+        // Checked under the lock so two submits of the same transfer
+        // cannot both link it.
+        Guard guard(*this);
+        if (!transfer.done())
+        {
+          return false;
+        }
+        transfer._next = nullptr;
+        transfer._queue = this;
+        transfer._submitUs = nowUs();
+        transfer._status.store(I2cStatus::Pending, std::memory_order_relaxed);
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+        transfer._waiter = waiter;
+#endif
+        insert(transfer);
+        if (!_active)
+        {
+          first = popHead();
+          activate(first);
+        }
+      }
+      if (first)
+      {
+        begin(*first);
+      }
+      return true;
+    }
+
+    /**
+     * @brief Report the outcome of @p transfer and start the next
+     *
+     * Called by the driver only. Ignored unless @p transfer is the active
+     * one, so a completion that races a timeout in poll() is dropped.
+     */
+    void complete(I2cTransfer &transfer, I2cStatus status)
+    {
+      I2cTransfer *finished = &transfer;
+      I2cTransfer *next;
+      const uint32_t now = nowUs();
+      {
+        Guard guard(*this);
+        if (_active != finished)
+        {
+          return;
+        }
+        next = popHead();
+        activate(next);
+
+        const uint32_t busy = now - finished->_startUs;
+        ++_stats.transfers;
+        _stats.bytes += finished->txLength + finished->rxLength;
+        _stats.busyUs += busy;
+        _stats.naks += status == I2cStatus::Nak;
+        _stats.timeouts += status == I2cStatus::Timeout;
+        _stats.errors += status == I2cStatus::Error;
+        _usage.record(finished->owner, busy, finished->_startUs - finished->_submitUs,
+                      status == I2cStatus::Timeout, status == I2cStatus::Nak || status == I2cStatus::Error);
+      }
+
+      // Start the next transfer before running callbacks so the bus
+      // stays busy while they execute.
+      if (next)
+      {
+        begin(*next);
+      }
+      finish(*finished, status);
+    }
+
+    /**
+     * @brief Abort the active transfer if it has exceeded its timeout
+     * @return true if a transfer was aborted
+     */
+    bool poll()
+    {
+      I2cTransfer *active;
+      {
+        Guard guard(*this);
+        active = _active;
+        // A transfer whose start() has not returned yet is left alone:
+        // aborting it would race the driver still setting it up.
+        if (!active || active == _starting)
+        {
+          return false;
+        }
+        const uint32_t limit = active->timeoutUs ? active->timeoutUs : _defaultTimeoutUs;
+        if (nowUs() - active->_startUs < limit)
+        {
+          return false;
+        }
+        _driver.abort();
+      }
+      complete(*active, I2cStatus::Timeout);
+      return true;
+    }
+
+    /**
+     * @brief Take back a transfer before it completes
+     *
+     * A queued transfer is unlinked; one on the bus is aborted through the
+     * driver. Either way it finishes with I2cStatus::Timeout (callback and
+     * waiter included) before this returns, and the driver no longer
+     * touches its buffers. Does nothing if it is already done(). Call from
+     * a task, not from interrupt context.
+     */
+    void cancel(I2cTransfer &transfer)
+    {
+      bool onBus;
+      for (;;)
+      {
+        {
+          Guard guard(*this);
+          if (transfer.done())
+          {
+            return;
+          }
+          onBus = _active == &transfer;
+          if (!onBus)
+          {
+            unlink(transfer);
+            break;
+          }
+          // As for a timeout in poll(), except while start() is still
+          // setting the transfer up; wait for it to return.
+          if (_starting != &transfer)
+          {
+            _driver.abort();
+            break;
+          }
+        }
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+        vTaskDelay(1);
+#elif defined(ARDUINO_ARCH_RP2040)
+        tight_loop_contents();
+#else
+        std::this_thread::yield();
+#endif
+      }
+      if (onBus)
+      {
+        complete(transfer, I2cStatus::Timeout);
+      }
+      else
+      {
+        finish(transfer, I2cStatus::Timeout);
+      }
+    }
+
+    /** Timeout for transfers that leave timeoutUs at 0 (default 10 ms). */
+    void setDefaultTimeout(uint32_t timeoutUs) { _defaultTimeoutUs = timeoutUs; }
+
+    bool idle() const { return _active == nullptr; }
+
+    I2cQueueStats stats()
+    {
+      Guard guard(*this);
+      return _stats;
+    }
+
+    /**
+     * @brief Copy per-module bus usage
+     * @return Entries written; size @p out with BusUsageTable::kEntries
+     */
+    size_t usage(BusUsageEntry *out, size_t maxEntries)
+    {
+      Guard guard(*this);
+      return _usage.snapshot(out, maxEntries);
+    }
+
+    void resetUsage()
+    {
+      Guard guard(*this);
+      _usage.reset();
+      _stats = {};
+    }
+
+    /** Monotonic microsecond clock used for accounting. */
+    static uint32_t nowUs()
+    {
+#if defined(ARDUINO_ARCH_RP2040)
+      return time_us_32();
+#else
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+#endif
+    }
+
+  private:
+#if defined(ARDUINO_ARCH_RP2040)
+    // Taken from tasks and from the driver's IRQ, on either core.
+    struct Guard
+    {
+      explicit Guard(I2cQueue &q) : queue(q) { saved = spin_lock_blocking(queue._lock); }
+      ~Guard() { spin_unlock(queue._lock, saved); }
+      I2cQueue &queue;
+      uint32_t saved;
+    };
+    spin_lock_t *_lock = nullptr;
+#else
+    struct Guard
+    {
+      explicit Guard(I2cQueue &q) : lock(q._mutex) {}
+      std::lock_guard<std::mutex> lock;
+    };
+    std::mutex _mutex;
+#endif
+
+    // Keep the list sorted by priority, FIFO within a priority.
+    void insert(I2cTransfer &transfer)
+    {
+      if (!_head || transfer.priority < _head->priority)
+      {
+        transfer._next = _head;
+        _head = &transfer;
+        if (!_tail)
+        {
+          _tail = &transfer;
+        }
+        return;
+      }
+      if (_tail->priority <= transfer.priority)
+      {
+        _tail->_next = &transfer;
+        _tail = &transfer;
+        return;
+      }
+      I2cTransfer *at = _head;
+      while (at->_next && at->_next->priority <= transfer.priority)
+      {
+        at = at->_next;
+      }
+      transfer._next = at->_next;
+      at->_next = &transfer;
+    }
+
+    // Remove a transfer that is still waiting in the list.
+    void unlink(I2cTransfer &transfer)
+    {
+      I2cTransfer *prev = nullptr;
+      for (I2cTransfer *at = _head; at; prev = at, at = at->_next)
+      {
+        if (at != &transfer)
+        {
+          continue;
+        }
+        (prev ? prev->_next : _head) = at->_next;
+        if (_tail == at)
+        {
+          _tail = prev;
+        }
+        at->_next = nullptr;
+        return;
+      }
+    }
+
+    I2cTransfer *popHead()
+    {
+      I2cTransfer *t = _head;
+      if (t)
+      {
+        _head = t->_next;
+        if (!_head)
+        {
+          _tail = nullptr;
+        }
+        t->_next = nullptr;
+      }
+      return t;
+    }
+
+    // Called under the lock whenever a transfer takes the bus, so poll()
+    // never sees an active transfer with a stale start time.
+    void activate(I2cTransfer *transfer)
+    {
+      _active = transfer;
+      _starting = transfer;
+      if (transfer)
+      {
+        transfer->_startUs = nowUs();
+      }
+    }
+
+    void begin(I2cTransfer &transfer)
+    {
+      _driver.start(transfer, *this);
+      Guard guard(*this);
+      if (_starting == &transfer)
+      {
+        _starting = nullptr;
+      }
+    }
+
+    static void finish(I2cTransfer &transfer, I2cStatus status)
+    {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      TaskHandle_t waiter = transfer._waiter;
+#endif
+      I2cTransfer::Callback cb = transfer.callback;
+      void *arg = transfer.arg;
+      transfer._status.store(status, std::memory_order_release);
+      if (cb)
+      {
+        cb(transfer, arg);
+      }
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      if (waiter)
+      {
+        if (__get_current_exception() != 0)
+        {
+          BaseType_t woken = pdFALSE;
+          vTaskNotifyGiveFromISR(waiter, &woken);
+          portYIELD_FROM_ISR(woken);
+        }
+        else
+        {
+          xTaskNotifyGive(waiter);
+        }
+      }
+#endif
+    }
+
+    I2cBusDriver &_driver;
+    I2cTransfer *_head = nullptr;
+    I2cTransfer *_tail = nullptr;
+    I2cTransfer *volatile _active = nullptr;
+    I2cTransfer *_starting = nullptr; ///< Active transfer whose start() is still running
+    uint32_t _defaultTimeoutUs = 10000;
+    I2cQueueStats _stats{};
+    BusUsageTable _usage;
+  };
+
+  inline I2cStatus I2cTransfer::wait(uint32_t timeoutMs)
+  {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t limit = pdMS_TO_TICKS(timeoutMs) + 1;
+    while (!done())
+    {
+      const TickType_t elapsed = xTaskGetTickCount() - start;
+      if (elapsed >= limit)
+      {
+        _queue->cancel(*this);
+        break;
+      }
+      ulTaskNotifyTake(pdTRUE, limit - elapsed);
+    }
+#else
+    const uint32_t start = I2cQueue::nowUs();
+    while (!done())
+    {
+      if (I2cQueue::nowUs() - start >= timeoutMs * 1000u)
+      {
+        _queue->cancel(*this);
+        break;
+      }
+#if !defined(ARDUINO_ARCH_RP2040)
+      std::this_thread::yield();
+#endif
+    }
+#endif
+    return status();
+  }
+
+#if defined(ARDUINO_ARCH_RP2040)
+  /**
+   * @brief DMA-driven I2C master for the RP2040
+   *
+   * Takes over an I2C block whose pins and clock are already configured
+   * (for example by Wire.begin()); do not use Wire on that bus afterwards.
+   *
+   * @tparam MaxBytes Largest txLength + rxLength of a single transfer
+   */
+  template <size_t MaxBytes = 64>
+  class Rp2040I2cDma : public I2cBusDriver
+  {
+  public:
+    Rp2040I2cDma() = default;
+    Rp2040I2cDma(const Rp2040I2cDma &) = delete;
+    Rp2040I2cDma &operator=(const Rp2040I2cDma &) = delete;
+
+    /** @return false if no DMA channels are free or the block is in use */
+    bool begin(i2c_inst_t *i2c)
+    {
+      const uint index = i2c_hw_index(i2c);
+      if (instances()[index] != nullptr)
+      {
+        return false;
+      }
+      const int tx = dma_claim_unused_channel(false);
+      const int rx = dma_claim_unused_channel(false);
+      if (tx < 0 || rx < 0)
+      {
+        if (tx >= 0)
+        {
+          dma_channel_unclaim(static_cast<uint>(tx));
+        }
+        if (rx >= 0)
+        {
+          dma_channel_unclaim(static_cast<uint>(rx));
+        }
+        return false;
+      }
+      _i2c = i2c;
+      _tx = static_cast<uint>(tx);
+      _rx = static_cast<uint>(rx);
+      instances()[index] = this;
+
+      i2c_hw_t *hw = i2c_get_hw(i2c);
+      hw->intr_mask = 0;
+      hw->dma_tdlr = 4;
+      hw->dma_rdlr = 0;
+      hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+      const uint irq = index == 0 ? I2C0_IRQ : I2C1_IRQ;
+      irq_add_shared_handler(irq, index == 0 ? &Rp2040I2cDma::irq0 : &Rp2040I2cDma::irq1,
+                             PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+      irq_set_enabled(irq, true);
+      return true;
+    }
+
+    void end()
+    {
+      if (!_i2c)
+      {
+        return;
+      }
+      const uint index = i2c_hw_index(_i2c);
+      const uint irq = index == 0 ? I2C0_IRQ : I2C1_IRQ;
+      i2c_hw_t *hw = i2c_get_hw(_i2c);
+      hw->intr_mask = 0;
+      hw->dma_cr = 0;
+      irq_remove_handler(irq, index == 0 ? &Rp2040I2cDma::irq0 : &Rp2040I2cDma::irq1);
+      dma_channel_abort(_tx);
+      dma_channel_abort(_rx);
+      dma_channel_unclaim(_tx);
+      dma_channel_unclaim(_rx);
+      instances()[index] = nullptr;
+      _i2c = nullptr;
+    }
+
+    void start(I2cTransfer &t, I2cQueue &queue) override
+    {
+      if (!_i2c || t.txLength + t.rxLength == 0 || t.txLength + t.rxLength > MaxBytes)
+      {
+        queue.complete(t, I2cStatus::Error);
+        return;
+      }
+      _transfer = &t;
+      _queue = &queue;
+      _rxLength = t.rxLength;
+
+      // Build the command stream: data bytes, then one read command per
+      // byte, with RESTART at the direction change and STOP on the last.
+      size_t n = 0;
+      for (uint16_t i = 0; i < t.txLength; ++i)
+      {
+        _cmd[n++] = t.tx[i];
+      }
+      for (uint16_t i = 0; i < t.rxLength; ++i)
+      {
+        _cmd[n++] = I2C_IC_DATA_CMD_CMD_BITS | (i == 0 && t.txLength ? I2C_IC_DATA_CMD_RESTART_BITS : 0);
+      }
+      _cmd[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+      // This runs from the IRQ when transfers are chained, so it must not
+      // wait on the bus. An idle block disables within a few cycles; one
+      // that stays enabled is still held from an earlier abort, and the
+      // transfer fails rather than wait for the device to let go.
+      i2c_hw_t *hw = i2c_get_hw(_i2c);
+      hw->enable = 0;
+      for (uint32_t i = 0; i < kSettleSpins && (hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS); ++i)
+      {
+        tight_loop_contents();
+      }
+      if (hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS)
+      {
+        _queue = nullptr;
+        queue.complete(t, I2cStatus::Error);
+        return;
+      }
+      hw->tar = t.address;
+      hw->enable = 1;
+
+      (void)hw->clr_intr;
+      hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+      if (t.rxLength)
+      {
+        dma_channel_config rc = dma_channel_get_default_config(_rx);
+        channel_config_set_transfer_data_size(&rc, DMA_SIZE_8);
+        channel_config_set_read_increment(&rc, false);
+        channel_config_set_write_increment(&rc, true);
+        channel_config_set_dreq(&rc, i2c_get_dreq(_i2c, false));
+        dma_channel_configure(_rx, &rc, t.rx, &hw->data_cmd, t.rxLength, true);
+      }
+
+      dma_channel_config tc = dma_channel_get_default_config(_tx);
+      channel_config_set_transfer_data_size(&tc, DMA_SIZE_32);
+      channel_config_set_read_increment(&tc, true);
+      channel_config_set_write_increment(&tc, false);
+      channel_config_set_dreq(&tc, i2c_get_dreq(_i2c, true));
+      dma_channel_configure(_tx, &tc, &hw->data_cmd, _cmd, n, true);
+    }
+
+    void abort() override
+    {
+      _queue = nullptr;
+      if (!_i2c)
+      {
+        return;
+      }
+      i2c_hw_t *hw = i2c_get_hw(_i2c);
+      hw->intr_mask = 0;
+      dma_channel_abort(_tx);
+      dma_channel_abort(_rx);
+
+      // ABORT issues a STOP and flushes the FIFO. This runs with the queue
+      // lock held and interrupts masked, so only give it a few microseconds;
+      // if it has not finished (a byte still on the wire, or a device
+      // holding SCL low) disable the block instead. start() fails
+      // transfers until the disable has taken effect.
+      hw_set_bits(&hw->enable, I2C_IC_ENABLE_ABORT_BITS);
+      for (uint32_t i = 0; i < kSettleSpins && (hw->enable & I2C_IC_ENABLE_ABORT_BITS); ++i)
+      {
+        tight_loop_contents();
+      }
+      if (hw->enable & I2C_IC_ENABLE_ABORT_BITS)
+      {
+        hw->enable = 0;
+      }
+      (void)hw->clr_intr;
+    }
+
+  private:
+    // Register polls; each is a few cycles, so this is a few microseconds
+    // at 125 MHz. Only ever spent with the queue locked or in the IRQ.
+    static constexpr uint32_t kSettleSpins = 256;
+
+    static Rp2040I2cDma **instances()
+    {
+      static Rp2040I2cDma *table[NUM_I2CS] = {};
+      return table;
+    }
+
+    static void irq0() { service(0); }
+    static void irq1() { service(1); }
+
+    static void service(uint index)
+    {
+      Rp2040I2cDma *self = instances()[index];
+      if (!self || !self->_i2c)
+      {
+        return;
+      }
+      i2c_hw_t *hw = i2c_get_hw(self->_i2c);
+      const uint32_t stat = hw->intr_stat;
+      if (!(stat & (I2C_IC_INTR_STAT_R_TX_ABRT_BITS | I2C_IC_INTR_STAT_R_STOP_DET_BITS)))
+      {
+        return;
+      }
+
+      I2cStatus status = I2cStatus::Ok;
+      if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+      {
+        const uint32_t source = hw->tx_abrt_source;
+        dma_channel_abort(self->_tx);
+        dma_channel_abort(self->_rx);
+        (void)hw->clr_tx_abrt;
+        constexpr uint32_t kNoAck = I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS |
+                                    I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS;
+        status = (source & kNoAck) ? I2cStatus::Nak : I2cStatus::Error;
+      }
+      else if (self->_rxLength && dma_channel_is_busy(self->_rx))
+      {
+        status = self->drainRx(hw);
+      }
+      (void)hw->clr_stop_det;
+      hw->intr_mask = 0;
+
+      I2cQueue *queue = self->_queue;
+      I2cTransfer *transfer = self->_transfer;
+      self->_queue = nullptr;
+      if (queue)
+      {
+        queue->complete(*transfer, status);
+      }
+    }
+
+    // STOP is detected once the last byte is in the RX FIFO, but the
+    // channel may not have moved it yet. Stop the channel and copy the
+    // rest by hand instead of waiting for it in the IRQ.
+    I2cStatus drainRx(i2c_hw_t *hw)
+    {
+      dma_channel_abort(_rx);
+      dma_channel_hw_t *ch = dma_channel_hw_addr(_rx);
+      uint8_t *to = reinterpret_cast<uint8_t *>(ch->write_addr);
+      for (uint32_t left = ch->transfer_count; left > 0; --left)
+      {
+        if (hw->rxflr == 0)
+        {
+          return I2cStatus::Error;
+        }
+        *to++ = static_cast<uint8_t>(hw->data_cmd);
+      }
+      return I2cStatus::Ok;
+    }
+
+    i2c_inst_t *_i2c = nullptr;
+    uint _tx = 0;
+    uint _rx = 0;
+    uint16_t _rxLength = 0;
+    I2cQueue *volatile _queue = nullptr;
+    I2cTransfer *_transfer = nullptr;
+    uint32_t _cmd[MaxBytes];
+  };
+#endif
+
+} // namespace LumynLabs
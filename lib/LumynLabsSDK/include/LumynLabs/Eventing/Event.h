@@ -59,6 +59,17 @@ namespace LumynLabs
     void *param; ///< User parameter
   };
 
+  /**
+   * @brief Module event data
+   *
+   * For EventType::Module; identifies the module that has new data or
+   * changed status.
+   */
+  struct ModuleEventData
+  {
+    uint16_t moduleId; ///< ID assigned to the module at creation
+  };
+
   /**
    * @brief Heartbeat event data
    */
@@ -82,6 +93,7 @@ namespace LumynLabs
     ConnectionType connectionType;
     CustomEventData custom;
     PinInterruptData pinInterrupt;
+    ModuleEventData module;
     HeartBeatData heartBeat;
   };
 
@@ -136,4 +148,18 @@ namespace LumynLabs
     return evt;
   }
 
+  /**
+   * @brief Create a module event
+   *
+   * @param moduleId ID of the module the event is about
+   * @return Event configured as module event
+   */
+  inline Event createModuleEvent(uint16_t moduleId)
+  {
+    Event evt;
+    evt.type = EventType::Module;
+    evt.data.module.moduleId = moduleId;
+    return evt;
+  }
+
 } // namespace LumynLabs
@@ -0,0 +1,356 @@
+/**
+ * @file EventCoalescer.h
+ * @brief Per-event-type coalescing windows and token-bucket rate limits
+ *
+ * Use one EventCoalescer per subscriber or per host link to keep chatty
+ * event sources (pin interrupts, heartbeats, module events) from flooding
+ * a slow consumer. Repeated events are merged into one that carries the
+ * latest data and the number of events it stands for.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Event.h"
+#include "EventType.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Coalescing and rate-limit policy for one event type
+   */
+  struct EventRateLimit
+  {
+    uint16_t windowMs = 0;   ///< Minimum spacing between emitted events of one source (0 = none)
+    uint16_t ratePerSec = 0; ///< Sustained emit rate for the type (0 = unlimited)
+    uint8_t burst = 1;       ///< Token bucket depth
+  };
+
+  /**
+   * @brief An event that may stand for several merged occurrences
+   */
+  struct CoalescedEvent
+  {
+    Event event;      ///< Most recent occurrence
+    uint16_t count;   ///< Number of occurrences merged (saturates at 0xFFFF)
+    uint32_t firstMs; ///< Time of the first merged occurrence
+  };
+
+  /**
+   * @brief Source key used to keep distinct sources of one type apart
+   *
+   * Pin interrupts are keyed by pin, module events by module ID and custom
+   * events by their user type, so a chattering input does not swallow
+   * edges from a different pin and one busy module does not swallow
+   * another module's updates.
+   */
+  inline uint16_t eventSourceKey(const Event &event)
+  {
+    switch (event.type)
+    {
+    case EventType::PinInterrupt:
+      return event.data.pinInterrupt.pin;
+    case EventType::Module:
+      return event.data.module.moduleId;
+    case EventType::Custom:
+      return event.data.custom.type;
+    default:
+      return 0;
+    }
+  }
+
+  /**
+   * @brief Merges and paces events according to per-type rules
+   *
+   * Event types without a rule pass straight through with a count of 1.
+   * For a ruled type, the first event of a quiet source is emitted
+   * immediately when a token is available; everything after that is merged
+   * until both the window has elapsed and the bucket has a token, at which
+   * point poll() emits the merged event. If the pending table is full,
+   * events fall back to plain rate limiting and any that exceed it are
+   * counted by droppedCount().
+   *
+   * Not thread-safe; own one instance per consumer task.
+   *
+   * @tparam MaxRules   Number of event types that can carry a rule
+   * @tparam MaxPending Number of (type, source) pairs tracked at once
+   *
+   * @code
+   * LumynLabs::EventCoalescer<> uartLimiter;
+   * uartLimiter.setRule(LumynLabs::EventType::PinInterrupt, {20, 50, 5});
+   *
+   * LumynLabs::CoalescedEvent out;
+   * if (uartLimiter.offer(evt, millis(), out)) send(out);
+   * while (uartLimiter.poll(millis(), out)) send(out);
+   * @endcode
+   */
+  template <size_t MaxRules = 4, size_t MaxPending = 8>
+  class EventCoalescer
+  {
+  public:
+    /**
+     * @brief Set or replace the rule for an event type
+     * @return false if the rule table is full
+     */
+    bool setRule(EventType type, const EventRateLimit &limit)
+    {
+      Rule *rule = findRule(type);
+      if (!rule)
+      {
+        if (_ruleCount >= MaxRules)
+        {
+          return false;
+        }
+        rule = &_rules[_ruleCount++];
+        rule->type = type;
+      }
+      rule->limit = limit;
+      rule->milliTokens = static_cast<uint32_t>(limit.burst) * 1000u;
+      rule->refillMs = 0;
+      rule->primed = false;
+      return true;
+    }
+
+    /** Remove the rule for an event type; its pending merges are discarded. */
+    void clearRule(EventType type)
+    {
+      for (uint8_t i = 0; i < _ruleCount; ++i)
+      {
+        if (_rules[i].type == type)
+        {
+          for (auto &entry : _entries)
+          {
+            if (entry.state != EntryState::Free && entry.rule == i)
+            {
+              entry.state = EntryState::Free;
+            }
+            else if (entry.state != EntryState::Free && entry.rule == _ruleCount - 1)
+            {
+              entry.rule = i;
+            }
+          }
+          _rules[i] = _rules[--_ruleCount];
+          return;
+        }
+      }
+    }
+
+    /**
+     * @brief Offer a new event
+     *
+     * @param event Incoming event
+     * @param nowMs Current time in milliseconds
+     * @param out   Filled when the event should be sent right away
+     * @return true if @p out holds an event to send now
+     */
+    bool offer(const Event &event, uint32_t nowMs, CoalescedEvent &out)
+    {
+      Rule *rule = findRule(event.type);
+      if (!rule)
+      {
+        out = {event, 1, nowMs};
+        return true;
+      }
+
+      refill(*rule, nowMs);
+      const uint16_t key = eventSourceKey(event);
+      Entry *entry = findEntry(*rule, key, nowMs);
+
+      if (!entry)
+      {
+        // Table full: degrade to plain rate limiting rather than losing data.
+        if (takeToken(*rule))
+        {
+          out = {event, 1, nowMs};
+          return true;
+        }
+        ++_dropped;
+        return false;
+      }
+
+      if (entry->state == EntryState::Pending)
+      {
+        entry->pending.event = event;
+        if (entry->pending.count != 0xFFFF)
+        {
+          ++entry->pending.count;
+        }
+        return false;
+      }
+
+      const bool windowOpen = entry->state == EntryState::Free ||
+                              nowMs - entry->lastEmitMs >= rule->limit.windowMs;
+      entry->rule = static_cast<uint8_t>(rule - _rules);
+      entry->key = key;
+
+      if (windowOpen && takeToken(*rule))
+      {
+        entry->state = EntryState::Quiet;
+        entry->lastEmitMs = nowMs;
+        out = {event, 1, nowMs};
+        return true;
+      }
+
+      entry->state = EntryState::Pending;
+      entry->pending = {event, 1, nowMs};
+      return false;
+    }
+
+    /**
+     * @brief Emit one merged event whose window and token are both due
+     * @return true if @p out holds an event to send; call again until false
+     */
+    bool poll(uint32_t nowMs, CoalescedEvent &out)
+    {
+      for (auto &entry : _entries)
+      {
+        if (entry.state != EntryState::Pending)
+        {
+          continue;
+        }
+        Rule &rule = _rules[entry.rule];
+        refill(rule, nowMs);
+        if (nowMs - entry.lastEmitMs < rule.limit.windowMs || !takeToken(rule))
+        {
+          continue;
+        }
+        out = entry.pending;
+        entry.state = EntryState::Quiet;
+        entry.lastEmitMs = nowMs;
+        return true;
+      }
+      return false;
+    }
+
+    /** True while any merged event is waiting to be emitted. */
+    bool hasPending() const
+    {
+      for (const auto &entry : _entries)
+      {
+        if (entry.state == EntryState::Pending)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /** Events discarded because the table was full and the bucket empty. */
+    uint32_t droppedCount() const { return _dropped; }
+
+  private:
+    enum class EntryState : uint8_t
+    {
+      Free,
+      Quiet,   ///< Recently emitted; window still tracked
+      Pending, ///< Holding a merged event
+    };
+
+    struct Rule
+    {
+      EventType type;
+      EventRateLimit limit;
+      uint32_t milliTokens;
+      uint32_t refillMs;
+      bool primed;
+    };
+
+    struct Entry
+    {
+      EntryState state = EntryState::Free;
+      uint8_t rule = 0;
+      uint16_t key = 0;
+      uint32_t lastEmitMs = 0;
+      CoalescedEvent pending{};
+    };
+
+    Rule *findRule(EventType type)
+    {
+      for (uint8_t i = 0; i < _ruleCount; ++i)
+      {
+        if (_rules[i].type == type)
+        {
+          return &_rules[i];
+        }
+      }
+      return nullptr;
+    }
+
+    Entry *findEntry(const Rule &rule, uint16_t key, uint32_t nowMs)
+    {
+      const uint8_t ruleIndex = static_cast<uint8_t>(&rule - _rules);
+      Entry *reusable = nullptr;
+      for (auto &entry : _entries)
+      {
+        if (entry.state != EntryState::Free && entry.rule == ruleIndex && entry.key == key)
+        {
+          return &entry;
+        }
+        if (reusable)
+        {
+          continue;
+        }
+        if (entry.state == EntryState::Free)
+        {
+          reusable = &entry;
+        }
+        else if (entry.state == EntryState::Quiet &&
+                 nowMs - entry.lastEmitMs >= _rules[entry.rule].limit.windowMs)
+        {
+          reusable = &entry;
+        }
+      }
+      if (reusable)
+      {
+        reusable->state = EntryState::Free;
+      }
+      return reusable;
+    }
+
+    static void refill(Rule &rule, uint32_t nowMs)
+    {
+      if (rule.limit.ratePerSec == 0)
+      {
+        return;
+      }
+      if (!rule.primed)
+      {
+        rule.refillMs = nowMs;
+        rule.primed = true;
+        return;
+      }
+      const uint32_t cap = static_cast<uint32_t>(rule.limit.burst) * 1000u;
+      const uint32_t elapsed = nowMs - rule.refillMs;
+      rule.refillMs = nowMs;
+      // Clamp before multiplying so long idle gaps cannot overflow.
+      const uint32_t gain = (elapsed >= 65536u ? cap : elapsed * rule.limit.ratePerSec);
+      rule.milliTokens = (cap - rule.milliTokens <= gain) ? cap : rule.milliTokens + gain;
+    }
+
+    static bool takeToken(Rule &rule)
+    {
+      if (rule.limit.ratePerSec == 0)
+      {
+        return true;
+      }
+      if (rule.milliTokens < 1000u)
+      {
+        return false;
+      }
+      rule.milliTokens -= 1000u;
+      return true;
+    }
+
+    Rule _rules[MaxRules] = {};
+    uint8_t _ruleCount = 0;
+    Entry _entries[MaxPending];
+    uint32_t _dropped = 0;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,307 @@
+/**
+ * @file EventRing.h
+ * @brief Lock-free broadcast event ring for custom firmware
+ *
+ * One event log is written once per publish; every subscriber keeps only a
+ * read cursor and a filter mask. Publishing never touches the RTOS kernel,
+ * so it is safe from tasks on either core and from interrupt handlers.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Event.h"
+#include "EventTrace.h"
+#include "EventType.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Check whether an event type passes a subscription mask
+   *
+   * EventType::BeginInitialization has no bit of its own, so it matches
+   * any non-empty mask.
+   */
+  constexpr bool eventMatchesMask(EventType type, uint32_t mask)
+  {
+    const uint32_t bit = static_cast<uint32_t>(type);
+    return bit == 0 ? mask != 0 : (mask & bit) != 0;
+  }
+
+  /**
+   * @brief Result of polling a subscriber
+   */
+  enum class EventPollResult : uint8_t
+  {
+    Empty,   ///< No matching event pending
+    Event,   ///< An event was copied out
+    Overrun, ///< Subscriber fell behind; cursor was resynchronized
+  };
+
+  /**
+   * @brief Broadcast ring of events with per-subscriber cursors
+   *
+   * Publishing claims a sequence number, copies the event into its slot and
+   * stamps the slot. The cost is O(1) regardless of how many subscribers are
+   * attached. Events that no attached subscriber is interested in are
+   * dropped before a slot is claimed.
+   *
+   * A subscriber that falls more than @p Capacity events behind does not
+   * block publishers: it loses the oldest events and is told how many via
+   * Subscriber::overruns().
+   *
+   * @tparam Capacity Number of slots, must be a power of two. Size it for
+   *                  the longest burst a subscriber may sleep through.
+   *
+   * @code
+   * static LumynLabs::EventRing<64> ring;
+   *
+   * // Producer (task or ISR)
+   * ring.publish(LumynLabs::createCustomEvent(1));
+   *
+   * // Consumer task
+   * LumynLabs::EventRing<64>::Subscriber sub(ring,
+   *     LumynLabs::combineEvents({LumynLabs::EventType::Custom}));
+   * LumynLabs::Event evt;
+   * while (sub.poll(evt) != LumynLabs::EventPollResult::Empty) { ... }
+   * @endcode
+   */
+  template <size_t Capacity>
+  class EventRing
+  {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "EventRing capacity must be a power of two");
+    static_assert(Capacity <= (1u << 28), "EventRing capacity too large");
+
+  public:
+    class Subscriber;
+
+    EventRing() = default;
+
+    EventRing(const EventRing &) = delete;
+    EventRing &operator=(const EventRing &) = delete;
+
+    /**
+     * @brief Publish an event to every interested subscriber
+     *
+     * Lock-free and wait-free for the caller; safe from tasks and ISRs.
+     *
+     * @return false if no subscriber wanted this event type
+     */
+    bool publish(const Event &event)
+    {
+      if (!eventMatchesMask(event.type, _interest.load(std::memory_order_relaxed)))
+      {
+        _filtered.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      const uint32_t seq = _head.fetch_add(1, std::memory_order_relaxed);
+      traceEvent(EventTraceStage::Publish, _traceId, seq, event.type);
+      Slot &slot = _slots[seq & kIndexMask];
+
+      slot.stamp.store((seq << 1) | 1u, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      slot.event = event;
+      slot.stamp.store(seq << 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * @brief ISR entry point; identical to publish(), no kernel calls
+     */
+    bool publishFromISR(const Event &event) { return publish(event); }
+
+    /** Union of all attached subscribers' masks. */
+    uint32_t interestMask() const { return _interest.load(std::memory_order_relaxed); }
+
+    /** Total events written into the ring. */
+    uint32_t publishedCount() const { return _head.load(std::memory_order_relaxed); }
+
+    /** Events dropped because no subscriber wanted them. */
+    uint32_t filteredCount() const { return _filtered.load(std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    /** Id that tells this ring's sequence numbers apart in event traces. */
+    uint8_t traceId() const { return _traceId; }
+
+  private:
+    static constexpr uint32_t kIndexMask = Capacity - 1;
+
+    struct Slot
+    {
+      std::atomic<uint32_t> stamp{1}; ///< (seq << 1) when complete, odd while writing
+      Event event;
+    };
+
+    // Subscriptions change from task context only and are not expected to
+    // race each other; publish() reads the combined mask lock-free.
+    void addInterest(uint32_t mask)
+    {
+      for (uint8_t bit = 0; bit < 32; ++bit)
+      {
+        if (mask & (1u << bit))
+        {
+          ++_bitRefs[bit];
+        }
+      }
+      _interest.fetch_or(mask, std::memory_order_relaxed);
+    }
+
+    void removeInterest(uint32_t mask)
+    {
+      uint32_t cleared = 0;
+      for (uint8_t bit = 0; bit < 32; ++bit)
+      {
+        if ((mask & (1u << bit)) && _bitRefs[bit] > 0 && --_bitRefs[bit] == 0)
+        {
+          cleared |= 1u << bit;
+        }
+      }
+      _interest.fetch_and(~cleared, std::memory_order_relaxed);
+    }
+
+    Slot _slots[Capacity];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _interest{0};
+    std::atomic<uint32_t> _filtered{0};
+    uint16_t _bitRefs[32] = {};
+    const uint8_t _traceId = nextEventTraceRingId();
+  };
+
+  /**
+   * @brief Read cursor and filter mask for one consumer of an EventRing
+   *
+   * A subscriber must be polled from a single task. It starts at the
+   * current end of the ring, so it only sees events published after it
+   * was constructed.
+   */
+  template <size_t Capacity>
+  class EventRing<Capacity>::Subscriber
+  {
+  public:
+    Subscriber(EventRing &ring, uint32_t mask)
+        : _ring(ring), _mask(mask),
+          _cursor(ring._head.load(std::memory_order_acquire))
+    {
+      _ring.addInterest(_mask);
+    }
+
+    ~Subscriber() { _ring.removeInterest(_mask); }
+
+    Subscriber(const Subscriber &) = delete;
+    Subscriber &operator=(const Subscriber &) = delete;
+
+    /**
+     * @brief Copy out the next event matching this subscriber's mask
+     *
+     * Non-matching events are skipped. On EventPollResult::Overrun the
+     * cursor has been moved to the oldest event still in the ring; call
+     * poll() again to continue.
+     */
+    EventPollResult poll(Event &out)
+    {
+      for (;;)
+      {
+        const uint32_t head = _ring._head.load(std::memory_order_acquire);
+        if (head == _cursor)
+        {
+          return EventPollResult::Empty;
+        }
+
+        if (head - _cursor > Capacity)
+        {
+          resync(head);
+          return EventPollResult::Overrun;
+        }
+
+        const Slot &slot = _ring._slots[_cursor & kIndexMask];
+        const uint32_t want = _cursor << 1;
+        const uint32_t before = slot.stamp.load(std::memory_order_acquire);
+        const int32_t ahead = static_cast<int32_t>(before - want);
+
+        if (ahead < 0 || ahead == 1)
+        {
+          // Claimed by a publisher that has not finished writing yet.
+          return EventPollResult::Empty;
+        }
+        if (ahead != 0)
+        {
+          resync(_ring._head.load(std::memory_order_acquire));
+          return EventPollResult::Overrun;
+        }
+
+        Event copy = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.stamp.load(std::memory_order_relaxed) != before)
+        {
+          resync(_ring._head.load(std::memory_order_acquire));
+          return EventPollResult::Overrun;
+        }
+
+        const uint32_t seq = _cursor++;
+        if (eventMatchesMask(copy.type, _mask))
+        {
+          traceEvent(EventTraceStage::Dequeue, _ring._traceId, seq, copy.type);
+          _lastSequence = seq;
+          out = copy;
+          return EventPollResult::Event;
+        }
+      }
+    }
+
+    /** Change the subscription mask; takes effect for the next publish. */
+    void setMask(uint32_t mask)
+    {
+      _ring.addInterest(mask);
+      _ring.removeInterest(_mask);
+      _mask = mask;
+    }
+
+    uint32_t mask() const { return _mask; }
+
+    /** Number of events published but not yet polled (before filtering). */
+    uint32_t pending() const
+    {
+      const uint32_t behind = _ring._head.load(std::memory_order_acquire) - _cursor;
+      return behind > Capacity ? Capacity : behind;
+    }
+
+    /** Total events lost because this subscriber fell behind. */
+    uint32_t overruns() const { return _overruns; }
+
+    /**
+     * @brief Ring sequence number of the last event returned by poll()
+     *
+     * Pass it to traceEvent(), with traceId(), when the event is forwarded
+     * to a host link.
+     */
+    uint32_t lastSequence() const { return _lastSequence; }
+
+    /** Trace id of the ring this subscriber reads. */
+    uint8_t traceId() const { return _ring._traceId; }
+
+  private:
+    void resync(uint32_t head)
+    {
+      const uint32_t oldest = head - Capacity;
+      _overruns += oldest - _cursor;
+      _cursor = oldest;
+    }
+
+    EventRing &_ring;
+    uint32_t _mask;
+    uint32_t _cursor;
+    uint32_t _overruns = 0;
+    uint32_t _lastSequence = 0;
+  };
+
+} // namespace LumynLabs
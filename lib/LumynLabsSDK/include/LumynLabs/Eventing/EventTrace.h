@@ -0,0 +1,308 @@
+/**
+ * @file EventTrace.h
+ * @brief Optional timestamped event latency tracing
+ *
+ * When built with -D CX_EVENT_TRACE=1, every event passing through an
+ * EventRing is stamped at publish and at dequeue. Code that forwards
+ * events to the host adds the transmit stamp with
+ * traceEvent(EventTraceStage::Transmit, ...). The fixed-size trace buffer
+ * can be serialized with EventTracer::snapshot() and decoded by
+ * tools/event_trace.py into per-type latency histograms and a Chrome trace.
+ *
+ * Stamps use the RP2040's 1 MHz system timer rather than the per-core
+ * cycle counters, so a publish on one core and a dequeue on the other can
+ * be subtracted. Records carry the ring's trace id as well as its sequence
+ * number, because sequence numbers are only unique within one ring.
+ *
+ * With CX_EVENT_TRACE unset or 0, traceEvent() compiles to nothing.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "EventType.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifndef CX_EVENT_TRACE
+#define CX_EVENT_TRACE 0
+#endif
+
+#ifndef CX_EVENT_TRACE_DEPTH
+#define CX_EVENT_TRACE_DEPTH 256
+#endif
+
+#if CX_EVENT_TRACE
+#if defined(ARDUINO_ARCH_RP2040)
+#include <Arduino.h>
+#include <hardware/timer.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Point in an event's life at which a stamp is taken
+   */
+  enum class EventTraceStage : uint8_t
+  {
+    Publish = 0,  ///< Written into the event ring
+    Dequeue = 1,  ///< Polled by a subscriber
+    Transmit = 2, ///< Handed to a host link
+  };
+
+  /**
+   * @brief One trace record as serialized (12 bytes, little endian)
+   */
+  struct EventTraceRecord
+  {
+    uint32_t ticks;    ///< Shared clock at the stamp, see EventTraceHeader::clockHz
+    uint32_t sequence; ///< EventRing sequence number, ties stages together
+    uint8_t typeBit;   ///< 0 for BeginInitialization, else bit index + 1
+    uint8_t ring;      ///< Trace id of the EventRing the sequence belongs to
+    uint8_t stage;     ///< EventTraceStage
+    uint8_t core;      ///< CPU core that took the stamp
+  };
+  static_assert(sizeof(EventTraceRecord) == 12, "EventTraceRecord layout is part of the dump format");
+
+  /**
+   * @brief Header that precedes the records in a snapshot
+   */
+  struct EventTraceHeader
+  {
+    uint32_t magic;       ///< kEventTraceMagic
+    uint16_t version;     ///< Dump format version
+    uint16_t recordSize;  ///< sizeof(EventTraceRecord)
+    uint32_t clockHz;     ///< Tick frequency of EventTraceRecord::ticks
+    uint32_t recordCount; ///< Records that follow, oldest first
+    uint32_t totalStamps; ///< Stamps taken since reset, including overwritten ones
+  };
+  static_assert(sizeof(EventTraceHeader) == 20, "EventTraceHeader layout is part of the dump format");
+
+  constexpr uint32_t kEventTraceMagic = 0x52545843; // "CXTR"
+  constexpr uint16_t kEventTraceVersion = 2;
+
+  /**
+   * @brief Map an event type to the compact index stored in trace records
+   */
+  constexpr uint8_t eventTypeBit(EventType type)
+  {
+    uint32_t value = static_cast<uint32_t>(type);
+    uint8_t bit = 0;
+    while (value != 0)
+    {
+      value >>= 1;
+      ++bit;
+    }
+    return bit;
+  }
+
+  /**
+   * @brief Hand out a trace id for a new EventRing
+   *
+   * Ids start at 1 and wrap after 255 rings.
+   */
+  inline uint8_t nextEventTraceRingId()
+  {
+    static std::atomic<uint8_t> next{0};
+    uint8_t id = static_cast<uint8_t>(next.fetch_add(1, std::memory_order_relaxed) + 1);
+    return id == 0 ? nextEventTraceRingId() : id;
+  }
+
+  /**
+   * @brief Fixed-size, lock-free trace buffer
+   *
+   * Stamps may be taken from any task, either core or an ISR. The buffer
+   * keeps the most recent @p Depth stamps. Each slot is a small seqlock,
+   * so snapshot() can run while stamps are being taken and simply leaves
+   * out a record that is half written or overwritten during the copy.
+   *
+   * @tparam Depth Number of records kept, must be a power of two
+   */
+  template <size_t Depth>
+  class BasicEventTracer
+  {
+    static_assert(Depth >= 2 && (Depth & (Depth - 1)) == 0,
+                  "Trace depth must be a power of two");
+
+  public:
+    /** Record one stamp. */
+    void stamp(EventTraceStage stage, uint8_t ring, uint32_t sequence, EventType type)
+    {
+      if (!_enabled.load(std::memory_order_relaxed))
+      {
+        return;
+      }
+      const uint32_t index = _next.fetch_add(1, std::memory_order_relaxed);
+      Slot &slot = _slots[index & (Depth - 1)];
+      // Odd while writing; index * 2 + 2 once complete (never 0, the empty value).
+      slot.commit.store(index * 2 + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      slot.ticks.store(clockTicks(), std::memory_order_relaxed);
+      slot.sequence.store(sequence, std::memory_order_relaxed);
+      slot.packed.store(static_cast<uint32_t>(eventTypeBit(type)) | static_cast<uint32_t>(ring) << 8 |
+                            static_cast<uint32_t>(stage) << 16 | static_cast<uint32_t>(currentCore()) << 24,
+                        std::memory_order_relaxed);
+      slot.commit.store(index * 2 + 2, std::memory_order_release);
+    }
+
+    /** Pause or resume stamping. */
+    void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    /** Discard all recorded stamps; call while no stamps are being taken. */
+    void reset()
+    {
+      for (Slot &slot : _slots)
+      {
+        slot.commit.store(0, std::memory_order_relaxed);
+      }
+      _next.store(0, std::memory_order_release);
+    }
+
+    /** Bytes needed for a full snapshot. */
+    static constexpr size_t snapshotSize()
+    {
+      return sizeof(EventTraceHeader) + Depth * sizeof(EventTraceRecord);
+    }
+
+    /**
+     * @brief Serialize the buffer, oldest record first
+     *
+     * Safe while other tasks, cores or ISRs keep stamping. Records that
+     * are being written or were overwritten during the copy are left out,
+     * so recordCount may be lower than the number of slots.
+     *
+     * @param out      Destination buffer
+     * @param capacity Size of @p out; records that do not fit are dropped
+     *                 from the oldest end
+     * @return Bytes written, or 0 if @p capacity cannot hold the header
+     */
+    size_t snapshot(uint8_t *out, size_t capacity)
+    {
+      if (capacity < sizeof(EventTraceHeader))
+      {
+        return 0;
+      }
+
+      const uint32_t total = _next.load(std::memory_order_acquire);
+      uint32_t count = total < Depth ? total : Depth;
+      const size_t room = (capacity - sizeof(EventTraceHeader)) / sizeof(EventTraceRecord);
+      if (count > room)
+      {
+        count = static_cast<uint32_t>(room);
+      }
+
+      uint8_t *cursor = out + sizeof(EventTraceHeader);
+      uint32_t written = 0;
+      for (uint32_t index = total - count; index != total; ++index)
+      {
+        const Slot &slot = _slots[index & (Depth - 1)];
+        const uint32_t want = index * 2 + 2;
+        if (slot.commit.load(std::memory_order_acquire) != want)
+        {
+          continue;
+        }
+        const uint32_t packed = slot.packed.load(std::memory_order_relaxed);
+        const EventTraceRecord rec{slot.ticks.load(std::memory_order_relaxed),
+                                   slot.sequence.load(std::memory_order_relaxed),
+                                   static_cast<uint8_t>(packed),
+                                   static_cast<uint8_t>(packed >> 8),
+                                   static_cast<uint8_t>(packed >> 16),
+                                   static_cast<uint8_t>(packed >> 24)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.commit.load(std::memory_order_relaxed) != want)
+        {
+          continue;
+        }
+        std::memcpy(cursor, &rec, sizeof(rec));
+        cursor += sizeof(rec);
+        ++written;
+      }
+
+      const EventTraceHeader header{kEventTraceMagic, kEventTraceVersion,
+                                    sizeof(EventTraceRecord), clockHz(), written, total};
+      std::memcpy(out, &header, sizeof(header));
+      return static_cast<size_t>(cursor - out);
+    }
+
+    static uint32_t clockHz()
+    {
+#if CX_EVENT_TRACE && defined(ARDUINO_ARCH_RP2040)
+      return 1000000u;
+#else
+      return 1000000000u;
+#endif
+    }
+
+  private:
+    static uint32_t clockTicks()
+    {
+#if CX_EVENT_TRACE && defined(ARDUINO_ARCH_RP2040)
+      // One timer shared by both cores, unlike the cycle counters.
+      return time_us_32();
+#elif CX_EVENT_TRACE
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+#else
+      return 0;
+#endif
+    }
+
+    static uint8_t currentCore()
+    {
+#if CX_EVENT_TRACE && defined(ARDUINO_ARCH_RP2040)
+      return static_cast<uint8_t>(get_core_num());
+#else
+      return 0;
+#endif
+    }
+
+    struct Slot
+    {
+      std::atomic<uint32_t> commit{0};
+      std::atomic<uint32_t> ticks{0};
+      std::atomic<uint32_t> sequence{0};
+      std::atomic<uint32_t> packed{0}; ///< typeBit | ring << 8 | stage << 16 | core << 24
+    };
+
+    Slot _slots[Depth];
+    std::atomic<uint32_t> _next{0};
+    std::atomic<bool> _enabled{true};
+  };
+
+  using EventTracer = BasicEventTracer<CX_EVENT_TRACE_DEPTH>;
+
+#if CX_EVENT_TRACE
+  /** Process-wide tracer used by EventRing and traceEvent(). */
+  inline EventTracer &eventTracer()
+  {
+    static EventTracer tracer;
+    return tracer;
+  }
+#endif
+
+  /**
+   * @brief Take a trace stamp; a no-op unless CX_EVENT_TRACE is enabled
+   */
+  inline void traceEvent(EventTraceStage stage, uint8_t ring, uint32_t sequence, EventType type)
+  {
+#if CX_EVENT_TRACE
+    eventTracer().stamp(stage, ring, sequence, type);
+#else
+    (void)stage;
+    (void)ring;
+    (void)sequence;
+    (void)type;
+#endif
+  }
+
+} // namespace LumynLabs
@@ -0,0 +1,477 @@
+/**
+ * @file BufferPool.h
+ * @brief Fixed-block buffer pool with size classes and usage telemetry
+ *
+ * Blocks come in three size classes (256 B, 1 KB, 4 KB), each carved out
+ * of its own static array. A request is served from the smallest class
+ * that fits, or from a larger class if that one is exhausted. Release
+ * finds the owning class by address range and the block by division, so
+ * it is O(1) and needs no header in front of the buffer. A pointer that is
+ * not the start of a block handed out by this pool (an interior pointer,
+ * a double release) is rejected and counted instead of corrupting the
+ * free lists.
+ *
+ * When nothing fits, acquire() can wait for a release up to a timeout
+ * instead of failing. Per-class high-water marks, failures and wait times
+ * are kept so the pool can be sized from real usage.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <task.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace LumynLabs
+{
+
+  constexpr size_t kBufferClassCount = 3;
+  constexpr uint16_t kBufferClassSizes[kBufferClassCount] = {256, 1024, 4096};
+
+  /**
+   * @brief Per-class counters, laid out for direct use as a status payload
+   */
+  struct BufferClassStats
+  {
+    uint16_t blockSize;   ///< Bytes per block
+    uint16_t blocks;      ///< Blocks in the class
+    uint16_t inUse;       ///< Blocks currently handed out
+    uint16_t highWater;   ///< Most blocks ever in use at once
+    uint32_t acquires;    ///< Successful acquisitions from this class
+    uint32_t spills;      ///< Of those, requests that wanted a smaller class
+    uint32_t failures;    ///< Requests for this class that got nothing
+    uint32_t waits;       ///< Requests for this class that had to wait
+    uint32_t maxWaitUs;   ///< Longest wait
+    uint32_t totalWaitUs; ///< Sum of all waits
+  };
+
+  /**
+   * @brief Status block for all classes
+   */
+  struct BufferPoolStatus
+  {
+    BufferClassStats classes[kBufferClassCount];
+    uint32_t invalidReleases; ///< release() calls rejected since the last reset
+  };
+
+  /**
+   * @brief Three-class block pool
+   *
+   * Thread-safe; release() may also be called from a task other than the
+   * one that acquired the block. Every release wakes every waiter, and each
+   * waiter retries for its own class. On FreeRTOS a waiting acquire()
+   * sleeps on the calling task's notification value, as FileFuture::wait()
+   * does.
+   *
+   * @tparam SmallBlocks  256-byte blocks
+   * @tparam MediumBlocks 1 KB blocks
+   * @tparam LargeBlocks  4 KB blocks
+   *
+   * @code
+   * static LumynLabs::BufferPool<16, 8, 2> pool;
+   *
+   * uint8_t* buf = pool.acquire(600, 20);  // 1 KB block, waits up to 20 ms
+   * if (buf) { ...; pool.release(buf); }
+   *
+   * LumynLabs::BufferPoolStatus st;
+   * pool.status(st);                        // return from a status request
+   * @endcode
+   */
+  template <size_t SmallBlocks = 8, size_t MediumBlocks = 4, size_t LargeBlocks = 2>
+  class BufferPool
+  {
+    static_assert(SmallBlocks > 0 && MediumBlocks > 0 && LargeBlocks > 0, "Every class needs a block");
+    static_assert(SmallBlocks < 0xFFFF && MediumBlocks < 0xFFFF && LargeBlocks < 0xFFFF,
+                  "Too many blocks in a class");
+
+  public:
+    BufferPool()
+    {
+      initClass(0, _small[0], SmallBlocks, _smallFree, _smallUsed);
+      initClass(1, _medium[0], MediumBlocks, _mediumFree, _mediumUsed);
+      initClass(2, _large[0], LargeBlocks, _largeFree, _largeUsed);
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      _lock = xSemaphoreCreateMutexStatic(&_lockStorage);
+#endif
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /** Largest request that can be served. */
+    static constexpr size_t maxBlockSize() { return kBufferClassSizes[kBufferClassCount - 1]; }
+
+    /**
+     * @brief Get a block of at least @p bytes
+     *
+     * @param bytes     Requested size
+     * @param timeoutMs How long to wait for a release if nothing fits; 0
+     *                  returns immediately. Capped at kMaxTimeoutMs.
+     * @return Block pointer, or nullptr on timeout or if @p bytes is too big
+     */
+    uint8_t *acquire(size_t bytes, uint32_t timeoutMs = 0)
+    {
+      const int wanted = classFor(bytes);
+      if (wanted < 0)
+      {
+        return nullptr;
+      }
+
+      uint32_t epoch = releaseEpoch();
+      uint8_t *block = tryAcquire(wanted);
+      if (block || timeoutMs == 0)
+      {
+        if (!block)
+        {
+          countFailure(wanted);
+        }
+        return block;
+      }
+
+      const uint32_t start = nowUs();
+      const uint32_t limitUs = (timeoutMs < kMaxTimeoutMs ? timeoutMs : kMaxTimeoutMs) * 1000u;
+      for (;;)
+      {
+        const uint32_t elapsed = nowUs() - start;
+        if (elapsed >= limitUs || !waitForRelease(epoch, limitUs - elapsed))
+        {
+          countFailure(wanted);
+          return nullptr;
+        }
+        epoch = releaseEpoch();
+        block = tryAcquire(wanted);
+        if (block)
+        {
+          countWait(wanted, nowUs() - start);
+          return block;
+        }
+      }
+    }
+
+    /**
+     * @brief Return a block obtained from acquire(); null is ignored
+     *
+     * @return false, and the pool is left unchanged, if @p ptr is not the
+     *         start of a block that is currently handed out
+     */
+    bool release(void *ptr)
+    {
+      if (!ptr)
+      {
+        return true;
+      }
+      const uint8_t *p = static_cast<const uint8_t *>(ptr);
+      for (size_t cls = 0; cls < kBufferClassCount; ++cls)
+      {
+        Class &c = _classes[cls];
+        if (p < c.base || p >= c.base + c.stats.blocks * static_cast<size_t>(c.stats.blockSize))
+        {
+          continue;
+        }
+        const size_t offset = static_cast<size_t>(p - c.base);
+        const uint16_t index = static_cast<uint16_t>(offset / c.stats.blockSize);
+        const uint32_t bit = 1u << (index % 32);
+        {
+          Guard guard(*this);
+          if (offset % c.stats.blockSize != 0 || !(c.used[index / 32] & bit))
+          {
+            ++_invalidReleases;
+            return false;
+          }
+          c.used[index / 32] &= ~bit;
+          c.freeList[c.freeCount++] = index;
+          --c.stats.inUse;
+        }
+        signalRelease();
+        return true;
+      }
+      Guard guard(*this);
+      ++_invalidReleases;
+      return false;
+    }
+
+    /** True if @p ptr points into this pool. */
+    bool owns(const void *ptr) const
+    {
+      const uint8_t *p = static_cast<const uint8_t *>(ptr);
+      for (const auto &c : _classes)
+      {
+        if (p >= c.base && p < c.base + c.stats.blocks * static_cast<size_t>(c.stats.blockSize))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /** Copy the counters of every class. */
+    void status(BufferPoolStatus &out)
+    {
+      Guard guard(*this);
+      for (size_t i = 0; i < kBufferClassCount; ++i)
+      {
+        out.classes[i] = _classes[i].stats;
+      }
+      out.invalidReleases = _invalidReleases;
+    }
+
+    /** Reset high-water marks, failure and wait counters. */
+    void resetStats()
+    {
+      Guard guard(*this);
+      for (auto &c : _classes)
+      {
+        c.stats.highWater = c.stats.inUse;
+        c.stats.acquires = 0;
+        c.stats.spills = 0;
+        c.stats.failures = 0;
+        c.stats.waits = 0;
+        c.stats.maxWaitUs = 0;
+        c.stats.totalWaitUs = 0;
+      }
+      _invalidReleases = 0;
+    }
+
+    /** Longest acquire() wait; the microsecond clock wraps after ~71 minutes. */
+    static constexpr uint32_t kMaxTimeoutMs = UINT32_MAX / 1000u;
+
+  private:
+    struct Class
+    {
+      uint8_t *base = nullptr;
+      uint16_t *freeList = nullptr;
+      uint32_t *used = nullptr; ///< One bit per block handed out
+      uint16_t freeCount = 0;
+      BufferClassStats stats{};
+    };
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    struct Guard
+    {
+      explicit Guard(BufferPool &p) : pool(p) { xSemaphoreTake(pool._lock, portMAX_DELAY); }
+      ~Guard() { xSemaphoreGive(pool._lock); }
+      BufferPool &pool;
+    };
+
+    static uint32_t nowUs() { return micros(); }
+
+    uint32_t releaseEpoch()
+    {
+      Guard guard(*this);
+      return _releaseCount;
+    }
+
+    // Sleep until the release count moves past @p epoch. A release between
+    // reading the epoch and registering is caught by the check under the
+    // guard; one after registering leaves a pending notification.
+    bool waitForRelease(uint32_t epoch, uint32_t timeoutUs)
+    {
+      const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+      size_t at = kMaxWaiters;
+      {
+        Guard guard(*this);
+        if (_releaseCount != epoch)
+        {
+          return true;
+        }
+        for (size_t i = 0; i < kMaxWaiters; ++i)
+        {
+          if (!_waiters[i])
+          {
+            _waiters[i] = self;
+            at = i;
+            break;
+          }
+        }
+      }
+
+      const TickType_t start = xTaskGetTickCount();
+      const TickType_t limit = pdMS_TO_TICKS(timeoutUs / 1000 + (timeoutUs % 1000 != 0));
+      bool released = false;
+      for (;;)
+      {
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= (limit ? limit : 1))
+        {
+          break;
+        }
+        // Every waiter slot taken: poll once per tick instead.
+        ulTaskNotifyTake(pdTRUE, at == kMaxWaiters ? 1 : (limit ? limit : 1) - elapsed);
+        Guard guard(*this);
+        if (_releaseCount != epoch)
+        {
+          released = true;
+          break;
+        }
+      }
+
+      if (at != kMaxWaiters)
+      {
+        Guard guard(*this);
+        _waiters[at] = nullptr;
+      }
+      return released;
+    }
+
+    // Wake every waiter; each retries for its own class, so a release
+    // that only fits one class cannot strand a waiter of another.
+    void signalRelease()
+    {
+      Guard guard(*this);
+      ++_releaseCount;
+      for (TaskHandle_t waiter : _waiters)
+      {
+        if (waiter)
+        {
+          xTaskNotifyGive(waiter);
+        }
+      }
+    }
+#else
+    struct Guard
+    {
+      explicit Guard(BufferPool &p) : lock(p._mutex) {}
+      std::lock_guard<std::mutex> lock;
+    };
+
+    static uint32_t nowUs()
+    {
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+    }
+
+    uint32_t releaseEpoch()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _releaseCount;
+    }
+
+    bool waitForRelease(uint32_t epoch, uint32_t timeoutUs)
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      return _releasedCv.wait_for(lock, std::chrono::microseconds(timeoutUs),
+                                  [&] { return _releaseCount != epoch; });
+    }
+
+    void signalRelease()
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_releaseCount;
+      }
+      _releasedCv.notify_all();
+    }
+#endif
+
+    static int classFor(size_t bytes)
+    {
+      for (size_t i = 0; i < kBufferClassCount; ++i)
+      {
+        if (bytes <= kBufferClassSizes[i])
+        {
+          return static_cast<int>(i);
+        }
+      }
+      return -1;
+    }
+
+    void initClass(size_t cls, uint8_t *base, size_t blocks, uint16_t *freeList, uint32_t *used)
+    {
+      Class &c = _classes[cls];
+      c.base = base;
+      c.freeList = freeList;
+      c.used = used;
+      c.freeCount = static_cast<uint16_t>(blocks);
+      c.stats.blockSize = kBufferClassSizes[cls];
+      c.stats.blocks = static_cast<uint16_t>(blocks);
+      for (size_t i = 0; i < blocks; ++i)
+      {
+        freeList[i] = static_cast<uint16_t>(blocks - 1 - i);
+      }
+    }
+
+    uint8_t *tryAcquire(int wanted)
+    {
+      Guard guard(*this);
+      for (size_t cls = static_cast<size_t>(wanted); cls < kBufferClassCount; ++cls)
+      {
+        Class &c = _classes[cls];
+        if (c.freeCount == 0)
+        {
+          continue;
+        }
+        const uint16_t index = c.freeList[--c.freeCount];
+        c.used[index / 32] |= 1u << (index % 32);
+        ++c.stats.acquires;
+        if (cls != static_cast<size_t>(wanted))
+        {
+          ++c.stats.spills;
+        }
+        if (++c.stats.inUse > c.stats.highWater)
+        {
+          c.stats.highWater = c.stats.inUse;
+        }
+        return c.base + static_cast<size_t>(index) * c.stats.blockSize;
+      }
+      return nullptr;
+    }
+
+    void countFailure(int cls)
+    {
+      Guard guard(*this);
+      ++_classes[cls].stats.failures;
+    }
+
+    void countWait(int cls, uint32_t waitedUs)
+    {
+      Guard guard(*this);
+      BufferClassStats &s = _classes[cls].stats;
+      ++s.waits;
+      s.totalWaitUs += waitedUs;
+      if (waitedUs > s.maxWaitUs)
+      {
+        s.maxWaitUs = waitedUs;
+      }
+    }
+
+    alignas(4) uint8_t _small[SmallBlocks][256];
+    alignas(4) uint8_t _medium[MediumBlocks][1024];
+    alignas(4) uint8_t _large[LargeBlocks][4096];
+    uint16_t _smallFree[SmallBlocks];
+    uint16_t _mediumFree[MediumBlocks];
+    uint16_t _largeFree[LargeBlocks];
+    uint32_t _smallUsed[(SmallBlocks + 31) / 32] = {};
+    uint32_t _mediumUsed[(MediumBlocks + 31) / 32] = {};
+    uint32_t _largeUsed[(LargeBlocks + 31) / 32] = {};
+    Class _classes[kBufferClassCount];
+    uint32_t _invalidReleases = 0;
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    static constexpr size_t kMaxWaiters = 8;
+
+    StaticSemaphore_t _lockStorage;
+    SemaphoreHandle_t _lock = nullptr;
+    TaskHandle_t _waiters[kMaxWaiters] = {};
+    uint32_t _releaseCount = 0;
+#else
+    std::mutex _mutex;
+    std::condition_variable _releasedCv;
+    uint32_t _releaseCount = 0;
+#endif
+  };
+
+} // namespace LumynLabs
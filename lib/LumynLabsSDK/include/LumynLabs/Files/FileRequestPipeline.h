@@ -0,0 +1,700 @@
+/**
+ * @file FileRequestPipeline.h
+ * @brief Non-blocking file requests with separate read and write lanes
+ *
+ * Callers submit reads and writes and get either a completion callback or
+ * a FileFuture back immediately; a single worker performs them against a
+ * FileBackend. Reads and writes sit in separate lanes and the read lane
+ * goes first, but only for a bounded number of reads in a row: while a
+ * write is waiting, one write chunk is done after every readBurst reads,
+ * so a steady read load cannot starve writes. Writes are carried out one
+ * chunk at a time, so an asset read waits for at most one chunk of a
+ * large write, never for the whole file. The one exception is a read of a
+ * path with an earlier write still pending: it is held until that write
+ * completes, so it never returns data older than a write submitted
+ * before it.
+ *
+ * Queued reads of the same file are served back to back with a single
+ * open. Reads among them that touch or overlap, and together span at most
+ * kMergeBytes, are merged into one backend read and copied out, which
+ * removes most of the per-request cost on LittleFS and SD.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <FreeRTOS.h>
+#include <task.h>
+#else
+#include <chrono>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace LumynLabs
+{
+
+  enum class FileMode : uint8_t
+  {
+    Read,
+    Write,  ///< Create or truncate
+    Append, ///< Create or append
+  };
+
+  /**
+   * @brief Storage the pipeline runs against (LittleFS, SD, ...)
+   *
+   * Only the pipeline's worker calls into the backend, so implementations
+   * need no locking of their own. At most two files are open at once: the
+   * write in progress and the file being read.
+   */
+  class FileBackend
+  {
+  public:
+    virtual ~FileBackend() = default;
+
+    /** @return Opaque handle, or nullptr on failure */
+    virtual void *open(const char *path, FileMode mode) = 0;
+
+    /** @return Bytes read, or a negative error */
+    virtual int32_t read(void *file, uint32_t offset, uint8_t *dst, uint32_t length) = 0;
+
+    /** Write at the current end of file. @return Bytes written, or a negative error */
+    virtual int32_t write(void *file, const uint8_t *src, uint32_t length) = 0;
+
+    virtual void close(void *file) = 0;
+  };
+
+  /**
+   * @brief Pipeline counters
+   */
+  struct FilePipelineStats
+  {
+    uint32_t reads;          ///< Read requests completed
+    uint32_t readsCoalesced; ///< Reads served from an already open file
+    uint32_t readsMerged;    ///< Reads answered from another read's backend call
+    uint32_t writes;         ///< Write requests completed
+    uint32_t writeChunks;    ///< Backend write calls
+    uint32_t rejected;       ///< Submissions refused because every slot was busy
+    uint32_t errors;         ///< Requests completed with an error
+  };
+
+  template <size_t Depth>
+  class FileRequestPipeline;
+
+  /**
+   * @brief Handle to a submitted request
+   *
+   * Move-only; releasing or destroying it returns the slot to the pipeline
+   * once the request is done (a request cannot be withdrawn while queued).
+   */
+  template <size_t Depth>
+  class FileFuture
+  {
+  public:
+    FileFuture() = default;
+    FileFuture(const FileFuture &) = delete;
+    FileFuture &operator=(const FileFuture &) = delete;
+    FileFuture(FileFuture &&other) noexcept : _pipeline(other._pipeline), _slot(other._slot)
+    {
+      other._pipeline = nullptr;
+    }
+    FileFuture &operator=(FileFuture &&other) noexcept
+    {
+      if (this != &other)
+      {
+        release();
+        _pipeline = other._pipeline;
+        _slot = other._slot;
+        other._pipeline = nullptr;
+      }
+      return *this;
+    }
+    ~FileFuture() { release(); }
+
+    /** False if the submission was rejected. */
+    bool valid() const { return _pipeline != nullptr; }
+
+    bool ready() const { return _pipeline && _pipeline->isDone(_slot); }
+
+    /** Bytes transferred, or a negative error. Only meaningful once ready(). */
+    int32_t result() const { return _pipeline ? _pipeline->resultOf(_slot) : -1; }
+
+    /**
+     * @brief Block the calling task until the request completes
+     * @return true if it completed within @p timeoutMs
+     */
+    bool wait(uint32_t timeoutMs)
+    {
+      return _pipeline && _pipeline->waitFor(_slot, timeoutMs);
+    }
+
+    /** Give up the handle; the slot is freed once the request is done. */
+    void release()
+    {
+      if (_pipeline)
+      {
+        _pipeline->detach(_slot);
+        _pipeline = nullptr;
+      }
+    }
+
+  private:
+    friend class FileRequestPipeline<Depth>;
+    FileFuture(FileRequestPipeline<Depth> *pipeline, uint8_t slot) : _pipeline(pipeline), _slot(slot) {}
+
+    FileRequestPipeline<Depth> *_pipeline = nullptr;
+    uint8_t _slot = 0;
+  };
+
+  /**
+   * @brief Two-lane file request queue with a single worker
+   *
+   * @tparam Depth Requests that may be outstanding at once
+   *
+   * @code
+   * static LumynLabs::FileRequestPipeline<8> files;
+   *
+   * // worker task
+   * void fileTask(void*) { files.runWorker(littleFsBackend); }
+   *
+   * // asset load, never queued behind a log write
+   * auto f = files.read("/bitmaps/logo.bin", 0, buf, sizeof(buf));
+   * if (f.wait(50) && f.result() > 0) ...
+   *
+   * // fire-and-forget write with completion callback
+   * files.write("/log.txt", line, len, LumynLabs::FileMode::Append, onSaved, nullptr);
+   * @endcode
+   */
+  template <size_t Depth = 8>
+  class FileRequestPipeline
+  {
+    static_assert(Depth > 0 && Depth <= 64, "Depth out of range");
+
+  public:
+    using Future = FileFuture<Depth>;
+
+    /** Called on the worker when a request finishes; @p result as Future::result(). */
+    using Callback = void (*)(int32_t result, void *arg);
+
+    static constexpr size_t kMaxPath = 64;
+
+    /** Largest span of adjacent reads merged into one backend read. */
+    static constexpr uint32_t kMergeBytes = 512;
+
+    /**
+     * @param writeChunk Largest single backend write; bounds how long a
+     *                   read can be held up by a write in progress
+     * @param readBurst  Reads served in a row while a write is waiting,
+     *                   before one write chunk is done
+     */
+    explicit FileRequestPipeline(uint32_t writeChunk = 4096, uint8_t readBurst = 8)
+        : _writeChunk(writeChunk ? writeChunk : 1), _readBurst(readBurst ? readBurst : 1) {}
+
+    /** Queue a read of @p length bytes at @p offset into @p dst. */
+    Future read(const char *path, uint32_t offset, uint8_t *dst, uint32_t length)
+    {
+      return makeFuture(submit(path, FileMode::Read, offset, dst, length, nullptr, nullptr));
+    }
+
+    /** Queue a read and get @p cb instead of a future. @return false if rejected */
+    bool read(const char *path, uint32_t offset, uint8_t *dst, uint32_t length, Callback cb, void *arg)
+    {
+      return submit(path, FileMode::Read, offset, dst, length, cb, arg) != kNoSlot;
+    }
+
+    /**
+     * @brief Queue a write; @p src must stay valid until completion
+     * @param mode FileMode::Write or FileMode::Append
+     */
+    Future write(const char *path, const uint8_t *src, uint32_t length, FileMode mode = FileMode::Write)
+    {
+      return makeFuture(submit(path, mode, 0, const_cast<uint8_t *>(src), length, nullptr, nullptr));
+    }
+
+    bool write(const char *path, const uint8_t *src, uint32_t length, FileMode mode, Callback cb, void *arg)
+    {
+      return submit(path, mode, 0, const_cast<uint8_t *>(src), length, cb, arg) != kNoSlot;
+    }
+
+    /**
+     * @brief Do one unit of work: a batch of reads of one file, or one write chunk
+     *
+     * Reads held behind an earlier write to the same path are skipped
+     * until that write has completed. After readBurst reads in a row with
+     * a write waiting, the next call does a write chunk instead.
+     *
+     * @return false if there was nothing to do
+     */
+    bool service(FileBackend &backend)
+    {
+      uint8_t slot;
+      if (readsAllowed() && popRead(nullptr, slot))
+      {
+        serveReads(backend, slot);
+        return true;
+      }
+      _readStreak = 0;
+
+      if (_activeWrite == kNoSlot)
+      {
+        if (!popLane(_writeLane, slot))
+        {
+          return false;
+        }
+        _activeWrite = slot;
+        _writeFile = backend.open(_slots[slot].path, _slots[slot].mode);
+        _slots[slot].result = 0;
+        if (!_writeFile)
+        {
+          finishWrite(backend, -1);
+          return true;
+        }
+      }
+
+      Slot &s = _slots[_activeWrite];
+      const uint32_t done = static_cast<uint32_t>(s.result);
+      uint32_t n = s.length - done;
+      if (n > _writeChunk)
+      {
+        n = _writeChunk;
+      }
+      const int32_t written = n ? backend.write(_writeFile, s.buffer + done, n) : 0;
+      ++_stats.writeChunks;
+      if (written < 0 || (n && written == 0))
+      {
+        finishWrite(backend, written < 0 ? written : -1);
+      }
+      else
+      {
+        s.result += written;
+        if (static_cast<uint32_t>(s.result) >= s.length)
+        {
+          finishWrite(backend, s.result);
+        }
+      }
+      return true;
+    }
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    /** Worker task body: services requests forever, sleeping when idle. */
+    [[noreturn]] void runWorker(FileBackend &backend)
+    {
+      _worker = xTaskGetCurrentTaskHandle();
+      for (;;)
+      {
+        if (!service(backend))
+        {
+          ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+      }
+    }
+#endif
+
+    const FilePipelineStats &stats() const { return _stats; }
+
+  private:
+    friend class FileFuture<Depth>;
+
+    static constexpr uint8_t kNoSlot = 0xFF;
+
+    enum SlotState : uint8_t
+    {
+      Free,
+      Queued,
+      Done,
+    };
+
+    struct Slot
+    {
+      std::atomic<uint8_t> state{Free};
+      std::atomic<bool> detached{false};
+      FileMode mode = FileMode::Read;
+      uint32_t order = 0; ///< Submission order, for read-after-write
+      uint32_t offset = 0;
+      uint8_t *buffer = nullptr;
+      uint32_t length = 0;
+      int32_t result = 0;
+      Callback callback = nullptr;
+      void *arg = nullptr;
+      char path[kMaxPath] = {};
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      TaskHandle_t waiter = nullptr;
+#endif
+    };
+
+    struct Lane
+    {
+      uint8_t items[Depth] = {};
+      size_t head = 0;
+      size_t count = 0;
+    };
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    struct Guard
+    {
+      explicit Guard(FileRequestPipeline &) { taskENTER_CRITICAL(); }
+      ~Guard() { taskEXIT_CRITICAL(); }
+    };
+#else
+    struct Guard
+    {
+      explicit Guard(FileRequestPipeline &p) : lock(p._mutex) {}
+      std::lock_guard<std::mutex> lock;
+    };
+#endif
+
+    Future makeFuture(uint8_t slot) { return slot == kNoSlot ? Future() : Future(this, slot); }
+
+    uint8_t submit(const char *path, FileMode mode, uint32_t offset, uint8_t *buffer, uint32_t length,
+                   Callback cb, void *arg)
+    {
+      if (!path || std::strlen(path) >= kMaxPath)
+      {
+        return kNoSlot;
+      }
+
+      uint8_t slot = kNoSlot;
+      {
+        Guard guard(*this);
+        for (size_t i = 0; i < Depth; ++i)
+        {
+          if (_slots[i].state.load(std::memory_order_relaxed) == Free)
+          {
+            slot = static_cast<uint8_t>(i);
+            break;
+          }
+        }
+        if (slot == kNoSlot)
+        {
+          ++_stats.rejected;
+          return kNoSlot;
+        }
+
+        Slot &s = _slots[slot];
+        std::strcpy(s.path, path);
+        s.mode = mode;
+        s.order = _submitOrder++;
+        s.offset = offset;
+        s.buffer = buffer;
+        s.length = length;
+        s.result = 0;
+        s.callback = cb;
+        s.arg = arg;
+        // Callback-only requests have no future to release them.
+        s.detached.store(cb != nullptr, std::memory_order_relaxed);
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+        s.waiter = nullptr;
+#endif
+        s.state.store(Queued, std::memory_order_release);
+
+        Lane &lane = mode == FileMode::Read ? _readLane : _writeLane;
+        lane.items[(lane.head + lane.count) % Depth] = slot;
+        ++lane.count;
+      }
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      if (_worker)
+      {
+        xTaskNotifyGive(_worker);
+      }
+#endif
+      return slot;
+    }
+
+    bool popLane(Lane &lane, uint8_t &slot)
+    {
+      Guard guard(*this);
+      if (lane.count == 0)
+      {
+        return false;
+      }
+      slot = lane.items[lane.head];
+      lane.head = (lane.head + 1) % Depth;
+      --lane.count;
+      return true;
+    }
+
+    static bool sameFile(const Slot &a, const Slot &b) { return std::strcmp(a.path, b.path) == 0; }
+
+    // True if a write to the same path was submitted before @p read and
+    // has not completed. Called with the guard held.
+    bool heldByWrite(const Slot &read) const
+    {
+      const auto earlier = [&](uint8_t write)
+      {
+        const Slot &w = _slots[write];
+        return static_cast<int32_t>(w.order - read.order) < 0 && sameFile(w, read);
+      };
+      if (_activeWrite != kNoSlot && earlier(_activeWrite))
+      {
+        return true;
+      }
+      for (size_t i = 0; i < _writeLane.count; ++i)
+      {
+        if (earlier(_writeLane.items[(_writeLane.head + i) % Depth]))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Reads may go first unless readBurst of them have run in a row while
+    // a write was waiting.
+    bool readsAllowed()
+    {
+      if (_readStreak < _readBurst)
+      {
+        return true;
+      }
+      Guard guard(*this);
+      return _activeWrite == kNoSlot && _writeLane.count == 0;
+    }
+
+    // Take the oldest read that is not held by a write, limited to
+    // @p path when given.
+    bool popRead(const char *path, uint8_t &slot)
+    {
+      return takeRead([&](const Slot &s)
+                      { return !path || std::strcmp(s.path, path) == 0; },
+                      slot);
+    }
+
+    // Take a read of @p path that touches or overlaps [lo, hi) and keeps
+    // the merged span within kMergeBytes.
+    bool popAdjacentRead(const char *path, uint32_t lo, uint32_t hi, uint8_t &slot)
+    {
+      return takeRead([&](const Slot &s)
+                      {
+                        const uint64_t end = uint64_t{s.offset} + s.length;
+                        const uint32_t from = s.offset < lo ? s.offset : lo;
+                        const uint64_t to = end > hi ? end : hi;
+                        return std::strcmp(s.path, path) == 0 && s.offset <= hi && end >= lo &&
+                               to - from <= kMergeBytes;
+                      },
+                      slot);
+    }
+
+    template <typename Match>
+    bool takeRead(Match &&match, uint8_t &slot)
+    {
+      Guard guard(*this);
+      for (size_t i = 0; i < _readLane.count; ++i)
+      {
+        const uint8_t candidate = _readLane.items[(_readLane.head + i) % Depth];
+        const Slot &s = _slots[candidate];
+        if (!match(s) || heldByWrite(s))
+        {
+          continue;
+        }
+        // Close the gap, keeping the others in order.
+        for (size_t j = i; j + 1 < _readLane.count; ++j)
+        {
+          _readLane.items[(_readLane.head + j) % Depth] = _readLane.items[(_readLane.head + j + 1) % Depth];
+        }
+        --_readLane.count;
+        slot = candidate;
+        return true;
+      }
+      return false;
+    }
+
+    // Serve the read in @p first, then every other ready read of the same
+    // path while the file is open, as long as readsAllowed().
+    void serveReads(FileBackend &backend, uint8_t first)
+    {
+      // The slot may be reused as soon as it completes; keep its path.
+      char path[kMaxPath];
+      std::strcpy(path, _slots[first].path);
+      void *file = backend.open(path, FileMode::Read);
+      serveGroup(backend, file, path, first);
+
+      uint8_t next;
+      while (file && readsAllowed() && popRead(path, next))
+      {
+        ++_stats.readsCoalesced;
+        serveGroup(backend, file, path, next);
+      }
+
+      if (file)
+      {
+        backend.close(file);
+      }
+    }
+
+    // Serve @p first together with any queued reads it can be merged with.
+    void serveGroup(FileBackend &backend, void *file, const char *path, uint8_t first)
+    {
+      uint8_t group[Depth];
+      size_t count = 1;
+      group[0] = first;
+      uint32_t lo = _slots[first].offset;
+      uint32_t hi = lo + _slots[first].length;
+      uint8_t next;
+      while (file && hi - lo <= kMergeBytes && popAdjacentRead(path, lo, hi, next))
+      {
+        const Slot &s = _slots[next];
+        lo = s.offset < lo ? s.offset : lo;
+        hi = s.offset + s.length > hi ? s.offset + s.length : hi;
+        group[count++] = next;
+      }
+
+      if (count == 1)
+      {
+        Slot &s = _slots[first];
+        const int32_t result = file ? backend.read(file, s.offset, s.buffer, s.length) : -1;
+        ++_stats.reads;
+        ++_readStreak;
+        complete(first, result);
+        return;
+      }
+
+      const int32_t got = backend.read(file, lo, _mergeBuffer, hi - lo);
+      for (size_t i = 0; i < count; ++i)
+      {
+        Slot &s = _slots[group[i]];
+        int32_t result = got;
+        if (got >= 0)
+        {
+          // Same short-read result as a read of its own at end of file.
+          const uint32_t skip = s.offset - lo;
+          const uint32_t have = static_cast<uint32_t>(got) > skip ? static_cast<uint32_t>(got) - skip : 0;
+          result = static_cast<int32_t>(have < s.length ? have : s.length);
+          std::memcpy(s.buffer, _mergeBuffer + skip, static_cast<size_t>(result));
+        }
+        ++_stats.reads;
+        ++_readStreak;
+        complete(group[i], result);
+      }
+      _stats.readsMerged += static_cast<uint32_t>(count - 1);
+    }
+
+    void finishWrite(FileBackend &backend, int32_t result)
+    {
+      if (_writeFile)
+      {
+        backend.close(_writeFile);
+        _writeFile = nullptr;
+      }
+      ++_stats.writes;
+      const uint8_t slot = _activeWrite;
+      _activeWrite = kNoSlot;
+      complete(slot, result);
+    }
+
+    void complete(uint8_t slot, int32_t result)
+    {
+      Slot &s = _slots[slot];
+      s.result = result;
+      if (result < 0)
+      {
+        ++_stats.errors;
+      }
+      if (s.callback)
+      {
+        s.callback(result, s.arg);
+      }
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      TaskHandle_t waiter;
+#endif
+      {
+        Guard guard(*this);
+        s.state.store(s.detached.load(std::memory_order_relaxed) ? Free : Done, std::memory_order_release);
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+        waiter = s.waiter;
+#endif
+      }
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      if (waiter)
+      {
+        xTaskNotifyGive(waiter);
+      }
+#endif
+    }
+
+    bool isDone(uint8_t slot) const { return _slots[slot].state.load(std::memory_order_acquire) == Done; }
+
+    int32_t resultOf(uint8_t slot) const { return _slots[slot].result; }
+
+    void detach(uint8_t slot)
+    {
+      Guard guard(*this);
+      Slot &s = _slots[slot];
+      if (s.state.load(std::memory_order_relaxed) == Done)
+      {
+        s.state.store(Free, std::memory_order_release);
+      }
+      else
+      {
+        s.detached.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    bool waitFor(uint8_t slot, uint32_t timeoutMs)
+    {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      {
+        Guard guard(*this);
+        if (isDone(slot))
+        {
+          return true;
+        }
+        _slots[slot].waiter = xTaskGetCurrentTaskHandle();
+      }
+      const TickType_t start = xTaskGetTickCount();
+      const TickType_t limit = pdMS_TO_TICKS(timeoutMs);
+      while (!isDone(slot))
+      {
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= limit)
+        {
+          break;
+        }
+        ulTaskNotifyTake(pdTRUE, limit - elapsed);
+      }
+      Guard guard(*this);
+      _slots[slot].waiter = nullptr;
+      return isDone(slot);
+#else
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+      while (!isDone(slot))
+      {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+      return true;
+#endif
+    }
+
+    Slot _slots[Depth];
+    Lane _readLane;
+    Lane _writeLane;
+    uint8_t _activeWrite = kNoSlot;
+    uint32_t _submitOrder = 0;
+    void *_writeFile = nullptr;
+    uint32_t _writeChunk;
+    uint8_t _readBurst;
+    uint32_t _readStreak = 0;
+    FilePipelineStats _stats{};
+    uint8_t _mergeBuffer[kMergeBytes];
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    TaskHandle_t _worker = nullptr;
+#else
+    std::mutex _mutex;
+#endif
+  };
+
+} // namespace LumynLabs
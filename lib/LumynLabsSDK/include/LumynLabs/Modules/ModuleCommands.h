@@ -0,0 +1,385 @@
+/**
+ * @file ModuleCommands.h
+ * @brief Typed binary command channel for custom modules
+ *
+ * handleReceivedJson() parses a JSON document for every host command, and
+ * handleReceivedData() only accepts a payload the size of the module's
+ * reading type. For high-rate actuation (setpoints at 100 Hz and up) the
+ * JSON round trip dominates the CPU time. A CommandModule instead declares
+ * its commands as small trivially copyable structs, each with its own id,
+ * and gets one typed handleCommand() overload per command. Frames are
+ * dispatched by id with a single memcpy; no JSON is parsed or built.
+ *
+ * Command frame (host to module):
+ *   kCommandTag, command id, sequence, sizeof(Cmd) payload bytes
+ *   (none for a command struct without fields)
+ * Reply frame (module to host):
+ *   kReplyTag, command id, sequence, CommandStatus, reply payload bytes
+ *
+ * Commands, replies and readings share the module's binary channel, so
+ * they are told apart by length, not by their first byte: a frame of
+ * exactly sizeof(T) bytes is always a reading, in both directions. A
+ * command whose frame would be sizeof(T) long does not compile, and a
+ * reply that would be gets one zero byte of padding.
+ *
+ * Sequence 0 means "no reply wanted", for fire-and-forget setpoints.
+ * Replies are queued and delivered by the next poll of the module, in
+ * place of that poll's reading: every reply costs the host one reading,
+ * so a module that must not miss readings should send its setpoints with
+ * sequence 0.
+ *
+ * @code
+ * struct SetSpeed {
+ *   static constexpr uint8_t kCommandId = 1;
+ *   float rpm;
+ * };
+ * struct GetStatus {
+ *   static constexpr uint8_t kCommandId = 2;
+ * };
+ * struct Status {
+ *   float rpm;
+ *   uint32_t faults;
+ * };
+ *
+ * class Motor : public LumynLabs::CommandModule<MotorData, SetSpeed, GetStatus> {
+ * public:
+ *   using CommandModule::CommandModule;
+ *   LumynLabs::CommandStatus handleCommand(const SetSpeed &cmd, LumynLabs::CommandReply &) override;
+ *   LumynLabs::CommandStatus handleCommand(const GetStatus &, LumynLabs::CommandReply &reply) override
+ *   {
+ *     reply.set(Status{_rpm, _faults});
+ *     return LumynLabs::CommandStatus::Ok;
+ *   }
+ *   ...
+ * };
+ *
+ * LumynLabs::registerCommandModule<MotorData, Motor>("MOTOR");
+ * @endcode
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "ModuleRegistration.h"
+
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <FreeRTOS.h>
+#include <task.h>
+#else
+#include <mutex>
+#endif
+
+namespace LumynLabs
+{
+
+  /** Outcome of a command, sent back in its reply frame. */
+  enum class CommandStatus : uint8_t
+  {
+    Ok = 0,
+    UnknownCommand, ///< No command with this id
+    BadLength,      ///< Payload size does not match the command type
+    Rejected,       ///< Handler refused the command (out of range, wrong state...)
+  };
+
+  /**
+   * @brief Reply frame under construction
+   *
+   * Handlers attach a payload with set(); the header is filled in by the
+   * dispatcher.
+   */
+  class CommandReply
+  {
+  public:
+    static constexpr uint8_t kReplyTag = 0xC4;
+    static constexpr size_t kHeaderSize = 4;
+    static constexpr size_t kMaxPayload = 28;
+    static constexpr size_t kMaxFrame = kHeaderSize + kMaxPayload;
+
+    template <typename R>
+    void set(const R &payload)
+    {
+      static_assert(std::is_trivially_copyable_v<R>, "Reply payloads are sent as raw bytes");
+      static_assert(sizeof(R) <= kMaxPayload, "Reply payload too large");
+      std::memcpy(_frame + kHeaderSize, &payload, sizeof(R));
+      _payloadSize = sizeof(R);
+    }
+
+    void setBytes(const uint8_t *data, size_t length)
+    {
+      _payloadSize = static_cast<uint8_t>(length < kMaxPayload ? length : kMaxPayload);
+      std::memcpy(_frame + kHeaderSize, data, _payloadSize);
+    }
+
+    const uint8_t *frame() const { return _frame; }
+    size_t frameSize() const { return kHeaderSize + _payloadSize; }
+
+    /// @internal Filled in by the dispatcher.
+    void _sdk_setHeader(uint8_t id, uint8_t sequence, CommandStatus status)
+    {
+      _frame[0] = kReplyTag;
+      _frame[1] = id;
+      _frame[2] = sequence;
+      _frame[3] = static_cast<uint8_t>(status);
+    }
+
+    /// @internal Drop the payload, e.g. when the command failed.
+    void _sdk_clearPayload() { _payloadSize = 0; }
+
+  private:
+    uint8_t _frame[kMaxFrame] = {};
+    uint8_t _payloadSize = 0;
+  };
+
+  /**
+   * @brief Handler for one command type; CommandModule derives from one per command
+   */
+  template <typename Cmd>
+  class CommandHandler
+  {
+    static_assert(std::is_trivially_copyable_v<Cmd>, "Commands are received as raw bytes");
+    static_assert(requires { Cmd::kCommandId; }, "Commands need a static constexpr uint8_t kCommandId");
+
+  public:
+    virtual ~CommandHandler() = default;
+
+    /** Run @p cmd; attach a reply payload to @p reply if the command has one. */
+    virtual CommandStatus handleCommand(const Cmd &cmd, CommandReply &reply) = 0;
+  };
+
+  namespace internal
+  {
+    /** Payload bytes of a command; a command without fields is sent with none. */
+    template <typename Cmd>
+    constexpr size_t commandPayloadSize()
+    {
+      return std::is_empty_v<Cmd> ? 0 : sizeof(Cmd);
+    }
+
+    template <typename... Cmds>
+    constexpr bool uniqueCommandIds()
+    {
+      constexpr uint8_t ids[] = {static_cast<uint8_t>(Cmds::kCommandId)...};
+      for (size_t i = 0; i < sizeof...(Cmds); ++i)
+      {
+        for (size_t j = i + 1; j < sizeof...(Cmds); ++j)
+        {
+          if (ids[i] == ids[j])
+          {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+  } // namespace internal
+
+  /**
+   * @brief Module with typed binary commands
+   *
+   * @tparam T    Reading type, as for Module<T>
+   * @tparam Cmds Command types, each trivially copyable with a unique
+   *              `static constexpr uint8_t kCommandId`
+   */
+  template <typename T, typename... Cmds>
+  class CommandModule : public Module<T>, public CommandHandler<Cmds>...
+  {
+    static_assert(sizeof...(Cmds) > 0, "CommandModule needs at least one command type");
+    static_assert(internal::uniqueCommandIds<Cmds...>(), "Command ids must be unique within a module");
+
+  public:
+    static constexpr uint8_t kCommandTag = 0xC3;
+    static constexpr size_t kHeaderSize = 3;
+
+    static_assert(((kHeaderSize + internal::commandPayloadSize<Cmds>() != sizeof(T)) && ...),
+                  "A command frame must not be sizeof(T) long; that length is reserved for readings");
+
+    explicit CommandModule(const ModuleConfig &config) : Module<T>(config) {}
+
+    using CommandHandler<Cmds>::handleCommand...;
+
+    /**
+     * @brief True if @p frame is a command frame
+     *
+     * A frame of sizeof(T) bytes is a reading for handleReceivedData(),
+     * whatever its first byte.
+     */
+    static bool isCommandFrame(const uint8_t *frame, size_t length)
+    {
+      return length != sizeof(T) && length >= kHeaderSize && frame[0] == kCommandTag;
+    }
+
+    /**
+     * @brief Decode and run one command frame
+     *
+     * @param reply Receives the reply frame
+     * @return false if @p frame is not a command frame
+     */
+    bool dispatchCommand(const uint8_t *frame, size_t length, CommandReply &reply)
+    {
+      if (!isCommandFrame(frame, length))
+      {
+        return false;
+      }
+      const uint8_t id = frame[1];
+      const uint8_t *payload = frame + kHeaderSize;
+      const size_t payloadLength = length - kHeaderSize;
+      CommandStatus status = CommandStatus::UnknownCommand;
+      ((Cmds::kCommandId == id && (status = runCommand<Cmds>(payload, payloadLength, reply), true)) || ...);
+      if (status != CommandStatus::Ok)
+      {
+        reply._sdk_clearPayload();
+      }
+      reply._sdk_setHeader(id, frame[2], status);
+      return true;
+    }
+
+  private:
+    template <typename Cmd>
+    CommandStatus runCommand(const uint8_t *payload, size_t length, CommandReply &reply)
+    {
+      constexpr size_t kSize = internal::commandPayloadSize<Cmd>();
+      if (length != kSize)
+      {
+        return CommandStatus::BadLength;
+      }
+      Cmd cmd{};
+      std::memcpy(static_cast<void *>(&cmd), payload, kSize);
+      return static_cast<CommandHandler<Cmd> &>(*this).handleCommand(cmd, reply);
+    }
+  };
+
+  namespace internal
+  {
+    /**
+     * @brief A CommandModule with its queue of replies waiting for a poll
+     */
+    template <typename T, typename UserModule>
+    struct CommandingModule
+    {
+      static constexpr size_t kQueueDepth = 4;
+
+      explicit CommandingModule(const ModuleConfig &config) : module(config) {}
+
+      bool interceptBinary(const uint8_t *data, size_t length, bool &result)
+      {
+        if (!UserModule::isCommandFrame(data, length))
+        {
+          return false;
+        }
+        const bool wantsReply = data[2] != 0;
+        if (wantsReply && !reserveReply())
+        {
+          // The host is not polling; refuse rather than drop a reply.
+          result = false;
+          return true;
+        }
+        CommandReply reply;
+        module.dispatchCommand(data, length, reply);
+        result = reply.frame()[3] == static_cast<uint8_t>(CommandStatus::Ok);
+        if (wantsReply)
+        {
+          Lock lock(*this);
+          --_reserved;
+          _replies[_tail % kQueueDepth] = reply;
+          ++_tail;
+        }
+        return true;
+      }
+
+      /** Deliver a queued reply instead of a reading. */
+      bool beforeRead(std::vector<uint8_t> &out)
+      {
+        Lock lock(*this);
+        if (_head == _tail)
+        {
+          return false;
+        }
+        const CommandReply &reply = _replies[_head % kQueueDepth];
+        out.assign(reply.frame(), reply.frame() + reply.frameSize());
+        if (out.size() == sizeof(T))
+        {
+          // That length is a reading's.
+          out.push_back(0);
+        }
+        ++_head;
+        return true;
+      }
+
+      void afterRead(std::vector<uint8_t> &) {}
+
+      bool interceptJson(ArduinoJson::JsonVariantConst, bool &) { return false; }
+
+      UserModule module;
+
+    private:
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+      struct Lock
+      {
+        explicit Lock(CommandingModule &) { taskENTER_CRITICAL(); }
+        ~Lock() { taskEXIT_CRITICAL(); }
+      };
+#else
+      struct Lock
+      {
+        explicit Lock(CommandingModule &m) : lock(m._mutex) {}
+        std::lock_guard<std::mutex> lock;
+      };
+      std::mutex _mutex;
+#endif
+
+      /**
+       * Claim a queue slot before the command runs, so that concurrent
+       * commands cannot queue more replies than there are slots.
+       */
+      bool reserveReply()
+      {
+        Lock lock(*this);
+        if (_tail - _head + _reserved == kQueueDepth)
+        {
+          return false;
+        }
+        ++_reserved;
+        return true;
+      }
+
+      CommandReply _replies[kQueueDepth];
+      size_t _head = 0;
+      size_t _tail = 0;
+      size_t _reserved = 0; ///< Slots claimed by commands still running
+    };
+  } // namespace internal
+
+  /**
+   * @brief Register a CommandModule so that binary command frames reach it
+   *
+   * Same as registerModule(). In addition, binary data from the host that
+   * starts with CommandModule::kCommandTag and is not sizeof(T) long is
+   * dispatched to the module's handleCommand() overloads. A reply is
+   * queued when the command's sequence is non-zero, and the next poll
+   * sends it instead of a reading. JSON and reading-sized binary data
+   * still reach handleReceivedJson() and handleReceivedData().
+   *
+   * This owns the module's registration, so a CommandModule cannot also
+   * go through registerPipelineModule(), registerPackedModule() or
+   * registerReportOnChangeModule(): its readings are sent raw, every
+   * poll. Readings are told from replies by length, which a pipeline or
+   * packed encoding would change.
+   */
+  template <typename T, typename UserModule>
+  void registerCommandModule(const std::string &typeIdentifier)
+  {
+    internal::registerWrappedModule<T, internal::CommandingModule<T, UserModule>>(typeIdentifier);
+  }
+
+} // namespace LumynLabs
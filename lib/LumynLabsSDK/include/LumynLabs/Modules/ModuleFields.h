@@ -0,0 +1,241 @@
+/**
+ * @file ModuleFields.h
+ * @brief Compile-time field descriptors for module payload types
+ *
+ * A payload type T can describe its fields by specializing ModuleFields<T>
+ * with a constexpr array built from LUMYN_FIELD(). The SDK uses the
+ * description to compare payloads field by field (see ReportOnChange.h),
+ * to publish a schema and to pack readings compactly (see ModuleSchema.h)
+ * instead of treating T as opaque bytes.
+ *
+ * @code
+ * struct MySensorData {
+ *   float temperature;
+ *   float humidity;
+ *   uint32_t counter;
+ * };
+ *
+ * template <>
+ * struct LumynLabs::ModuleFields<MySensorData> {
+ *   static constexpr LumynLabs::FieldDescriptor fields[] = {
+ *       LUMYN_FIELD(MySensorData, temperature, 0.05f),
+ *       LUMYN_FIELD(MySensorData, humidity, 0.5f),
+ *       LUMYN_FIELD(MySensorData, counter, 0),
+ *   };
+ * };
+ * @endcode
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace LumynLabs
+{
+
+  /** Element type of a described field. */
+  enum class FieldType : uint8_t
+  {
+    Bool = 0,
+    I8,
+    U8,
+    I16,
+    U16,
+    I32,
+    U32,
+    F32,
+  };
+
+  /** Size in bytes of one element of @p type. */
+  constexpr size_t fieldTypeSize(FieldType type)
+  {
+    switch (type)
+    {
+    case FieldType::Bool:
+    case FieldType::I8:
+    case FieldType::U8:
+      return 1;
+    case FieldType::I16:
+    case FieldType::U16:
+      return 2;
+    default:
+      return 4;
+    }
+  }
+
+  /**
+   * @brief One field (or fixed-size array) of a payload
+   */
+  struct FieldDescriptor
+  {
+    const char *name;
+    uint16_t offset;   ///< Byte offset in the payload
+    FieldType type;    ///< Element type
+    uint8_t count;     ///< Elements; 1 for scalars
+    float tolerance;   ///< Change that counts as news; 0 = any change
+    uint8_t bits = 0;  ///< Packed width; 0 = natural (1 for Bool, 16 for scaled F32)
+    float scale = 0;   ///< F32 only: packed as round(value * scale); 0 = raw float
+  };
+
+  /**
+   * @brief Field list of a payload type; specialize per type
+   *
+   * A specialization provides `static constexpr FieldDescriptor fields[]`.
+   */
+  template <typename T>
+  struct ModuleFields
+  {
+  };
+
+  /** True when ModuleFields<T> has been specialized. */
+  template <typename T>
+  constexpr bool hasModuleFields = requires { ModuleFields<T>::fields; };
+
+  /** The descriptors of T, empty when T is not described. */
+  template <typename T>
+  constexpr std::span<const FieldDescriptor> moduleFields()
+  {
+    if constexpr (hasModuleFields<T>)
+    {
+      return std::span<const FieldDescriptor>(ModuleFields<T>::fields);
+    }
+    else
+    {
+      return {};
+    }
+  }
+
+  /** Bits one element of @p f takes in the packed encoding (see ModuleSchema.h). */
+  constexpr uint8_t packedFieldBits(const FieldDescriptor &f)
+  {
+    if (f.type == FieldType::Bool)
+    {
+      return 1;
+    }
+    const uint8_t natural = static_cast<uint8_t>(fieldTypeSize(f.type) * 8);
+    if (f.type == FieldType::F32)
+    {
+      return f.scale > 0 ? (f.bits ? f.bits : 16) : natural;
+    }
+    return f.bits && f.bits < natural ? f.bits : natural;
+  }
+
+  /** True when every field of T lies inside sizeof(T). */
+  template <typename T>
+  constexpr bool moduleFieldsFit()
+  {
+    for (const FieldDescriptor &f : moduleFields<T>())
+    {
+      if (f.count == 0 || f.offset + fieldTypeSize(f.type) * f.count > sizeof(T) || f.bits > 32 ||
+          (f.scale != 0 && f.type != FieldType::F32))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  namespace internal
+  {
+    template <typename V>
+    constexpr FieldType fieldTypeOf()
+    {
+      using E = std::remove_cv_t<V>;
+      if constexpr (std::is_same_v<E, bool>)
+        return FieldType::Bool;
+      else if constexpr (std::is_enum_v<E>)
+        return fieldTypeOf<std::underlying_type_t<E>>();
+      else if constexpr (std::is_same_v<E, float>)
+        return FieldType::F32;
+      else
+      {
+        static_assert(std::is_integral_v<E> && sizeof(E) <= 4, "Unsupported payload field type");
+        if constexpr (sizeof(E) == 1)
+          return std::is_signed_v<E> ? FieldType::I8 : FieldType::U8;
+        else if constexpr (sizeof(E) == 2)
+          return std::is_signed_v<E> ? FieldType::I16 : FieldType::U16;
+        else
+          return std::is_signed_v<E> ? FieldType::I32 : FieldType::U32;
+      }
+    }
+
+    template <typename V>
+    constexpr FieldDescriptor makeField(const char *name, size_t offset, float tolerance)
+    {
+      static_assert(std::extent_v<V> <= 255, "Payload arrays are limited to 255 elements");
+      return FieldDescriptor{name, static_cast<uint16_t>(offset), fieldTypeOf<std::remove_all_extents_t<V>>(),
+                             static_cast<uint8_t>(std::is_array_v<V> ? std::extent_v<V> : 1), tolerance};
+    }
+
+    template <typename V>
+    constexpr FieldDescriptor makePackedField(const char *name, size_t offset, float tolerance, uint8_t bits,
+                                              float scale)
+    {
+      FieldDescriptor f = makeField<V>(name, offset, tolerance);
+      f.bits = bits;
+      f.scale = scale;
+      return f;
+    }
+
+    template <typename V>
+    inline V loadElement(const uint8_t *p)
+    {
+      V v;
+      std::memcpy(&v, p, sizeof(V));
+      return v;
+    }
+
+    /** Integer elements as int64 (F32 is handled separately). */
+    inline int64_t integerElement(const uint8_t *p, FieldType type)
+    {
+      switch (type)
+      {
+      case FieldType::Bool:
+        return *p != 0;
+      case FieldType::I8:
+        return loadElement<int8_t>(p);
+      case FieldType::U8:
+        return *p;
+      case FieldType::I16:
+        return loadElement<int16_t>(p);
+      case FieldType::U16:
+        return loadElement<uint16_t>(p);
+      case FieldType::I32:
+        return loadElement<int32_t>(p);
+      case FieldType::U32:
+        return loadElement<uint32_t>(p);
+      default:
+        return 0;
+      }
+    }
+  } // namespace internal
+
+} // namespace LumynLabs
+
+/**
+ * @brief Describe member @p member of payload @p Type
+ *
+ * @p tolerance is in the field's own units: a change larger than it is
+ * reported; 0 reports any change.
+ */
+#define LUMYN_FIELD(Type, member, tolerance) \
+  ::LumynLabs::internal::makeField<decltype(Type::member)>(#member, offsetof(Type, member), (tolerance))
+
+/**
+ * @brief Describe member @p member with a compact packed encoding
+ *
+ * Integers keep their low @p bits bits (signed ones sign-extended on
+ * decode, values saturated on encode). A float with @p scale > 0 is sent
+ * as the signed @p bits-bit integer round(value * scale), for example
+ * bits 12 and scale 100 for 0.01 resolution over +-20.47.
+ */
+#define LUMYN_FIELD_PACKED(Type, member, tolerance, bits, scale)                                          \
+  ::LumynLabs::internal::makePackedField<decltype(Type::member)>(#member, offsetof(Type, member), (tolerance), \
+                                                                 (bits), (scale))
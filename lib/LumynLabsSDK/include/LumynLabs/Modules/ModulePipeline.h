@@ -0,0 +1,731 @@
+/**
+ * @file ModulePipeline.h
+ * @brief Declarative derived-signal stages between a module's read and transmit
+ *
+ * A ModulePipeline takes up to four numeric fields of a module's payload
+ * and passes each through a short chain of integer stages: decimate,
+ * filter, scale, delta, threshold, count and on-change. The result is
+ * written back into the payload, either over the source field or into a
+ * spare one. Stages that hold back a value (decimate, delta before its
+ * second sample, on-change inside its deadband) stop their chain. When
+ * every chain is held, the frame is not sent at all.
+ *
+ * The chains are described in JSON and can be replaced at run time, so
+ * one module type can report velocity in one deployment and a debounced
+ * count in another without new firmware:
+ *
+ * @code
+ * {"pipeline": [
+ *   {"offset": 0, "type": "u16", "target": 4, "targetType": "i32",
+ *    "stages": [{"op": "filter", "shift": 2},
+ *               {"op": "delta", "perSecond": true},
+ *               {"op": "onChange", "deadband": 20}]}
+ * ]}
+ * @endcode
+ *
+ * Running a pipeline allocates nothing and uses no floating point except
+ * to read or write "f32" fields (scaled by "fieldScale").
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "ModuleRegistration.h"
+
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+#include <Arduino.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#else
+#include <chrono>
+#include <mutex>
+#endif
+
+namespace LumynLabs
+{
+
+  /** Storage type of a payload field a pipeline reads or writes. */
+  enum class PipelineFieldType : uint8_t
+  {
+    I8,
+    U8,
+    I16,
+    U16,
+    I32,
+    U32,
+    F32, ///< Converted to and from integer by PipelineChannel::fieldScale
+  };
+
+  enum class PipelineStageType : uint8_t
+  {
+    Decimate,  ///< Mean of every `a` samples, one output per block
+    Filter,    ///< First-order IIR, y += (x - y) / 2^a
+    Scale,     ///< x * a / b
+    Delta,     ///< x - previous; per second when a != 0
+    Threshold, ///< 1 once x >= a, back to 0 when x < a - b
+    Count,     ///< Number of 0 -> non-zero transitions of x
+    OnChange,  ///< Pass only when x differs from the last output by more than a
+  };
+
+  struct PipelineStage
+  {
+    PipelineStageType type = PipelineStageType::Filter;
+    int32_t a = 0;
+    int32_t b = 0;
+  };
+
+  /**
+   * @brief One field and its stage chain
+   */
+  struct PipelineChannel
+  {
+    static constexpr size_t kMaxStages = 6;
+
+    uint16_t offset = 0;                                    ///< Source field byte offset in the payload
+    PipelineFieldType type = PipelineFieldType::I32;        ///< Source field type
+    uint16_t targetOffset = 0;                              ///< Where the output goes; may equal offset
+    PipelineFieldType targetType = PipelineFieldType::I32;  ///< Output field type (saturated)
+    int32_t fieldScale = 1;                                 ///< F32 fields: integer = value * fieldScale
+    uint8_t stageCount = 0;
+    PipelineStage stages[kMaxStages];
+  };
+
+  /**
+   * @brief Per-module stage chains
+   *
+   * configure() and run() may be called from different tasks; run() is
+   * called from one task at a time (the module's read path).
+   */
+  class ModulePipeline
+  {
+  public:
+    static constexpr size_t kMaxChannels = 4;
+
+    ModulePipeline() = default;
+    ModulePipeline(const ModulePipeline &) = delete;
+    ModulePipeline &operator=(const ModulePipeline &) = delete;
+
+    /**
+     * @brief Replace the chains
+     *
+     * @param payloadSize Size of the module payload; fields must fit inside
+     * @return false (and no change) if a channel is out of range
+     */
+    bool setChannels(const PipelineChannel *channels, size_t count, size_t payloadSize)
+    {
+      if (count > kMaxChannels)
+      {
+        return false;
+      }
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (!fits(channels[i].offset, channels[i].type, payloadSize) ||
+            !fits(channels[i].targetOffset, channels[i].targetType, payloadSize) ||
+            channels[i].stageCount > PipelineChannel::kMaxStages)
+        {
+          return false;
+        }
+      }
+      Lock lock(*this);
+      for (size_t i = 0; i < count; ++i)
+      {
+        _channels[i] = channels[i];
+        _state[i] = ChannelState{};
+      }
+      _count = count;
+      _sent = 0;
+      _held = 0;
+      ++_generation;
+      return true;
+    }
+
+    /**
+     * @brief Replace the chains from a JSON array (see the file comment)
+     *
+     * Keys per channel: offset, type, target (default offset), targetType
+     * (default type), fieldScale, stages. Stage keys: op plus
+     * n (decimate), shift (filter), mul/div (scale), perSecond (delta),
+     * level/hysteresis (threshold), deadband (onChange).
+     *
+     * @return false (and no change) on an unknown name or out-of-range field
+     */
+    bool configure(ArduinoJson::JsonArrayConst json, size_t payloadSize)
+    {
+      PipelineChannel channels[kMaxChannels];
+      size_t count = 0;
+      for (ArduinoJson::JsonVariantConst entry : json)
+      {
+        if (count == kMaxChannels || !parseChannel(entry, channels[count]))
+        {
+          return false;
+        }
+        ++count;
+      }
+      return setChannels(channels, count, payloadSize);
+    }
+
+    /** Remove all chains; run() then passes every frame unchanged. */
+    void clear()
+    {
+      Lock lock(*this);
+      _count = 0;
+      ++_generation;
+    }
+
+    size_t channelCount() const { return _count; }
+
+    /**
+     * @brief Run the chains over one payload, in place
+     *
+     * @return true if the frame should be sent: some chain produced a
+     *         value, or there are no chains
+     */
+    bool run(uint8_t *payload, size_t size, uint32_t nowUs)
+    {
+      // Each chain and its state are copied out under the lock and run
+      // outside it, so the lock (a critical section under FreeRTOS) covers
+      // the copies and not the stage math.
+      uint32_t generation;
+      size_t count;
+      {
+        Lock lock(*this);
+        if (_count == 0)
+        {
+          ++_sent;
+          return true;
+        }
+        generation = _generation;
+        count = _count;
+      }
+      bool emitted = false;
+      for (size_t i = 0; i < count; ++i)
+      {
+        PipelineChannel c;
+        ChannelState s;
+        {
+          Lock lock(*this);
+          if (_generation != generation)
+          {
+            return emitted; // chains replaced mid-frame; the new ones start clean
+          }
+          c = _channels[i];
+          s = _state[i];
+        }
+        if (!fits(c.offset, c.type, size) || !fits(c.targetOffset, c.targetType, size))
+        {
+          continue;
+        }
+        int64_t x = load(payload + c.offset, c.type, c.fieldScale);
+        bool pass = true;
+        for (uint8_t k = 0; k < c.stageCount && pass; ++k)
+        {
+          pass = step(c.stages[k], s.stages[k], x, nowUs);
+        }
+        if (pass)
+        {
+          s.output = x;
+          s.hasOutput = true;
+          emitted = true;
+        }
+        // A held chain reports its last output, so the frame stays
+        // consistent whichever chain triggered it.
+        store(payload + c.targetOffset, c.targetType, c.fieldScale, s.hasOutput ? s.output : 0);
+
+        Lock lock(*this);
+        if (_generation != generation)
+        {
+          return emitted;
+        }
+        _state[i] = s;
+      }
+      Lock lock(*this);
+      if (_generation == generation)
+      {
+        ++(emitted ? _sent : _held);
+      }
+      return emitted;
+    }
+
+    /** Frames run() let through since the chains were last set. */
+    uint32_t sent() const { return _sent; }
+
+    /** Frames run() held back since the chains were last set. */
+    uint32_t held() const { return _held; }
+
+  private:
+    struct StageState
+    {
+      int64_t acc = 0;
+      int64_t prev = 0;
+      uint32_t prevUs = 0;
+      uint32_t count = 0;
+      bool primed = false;
+      bool level = false;
+    };
+
+    struct ChannelState
+    {
+      StageState stages[PipelineChannel::kMaxStages];
+      int64_t output = 0;
+      bool hasOutput = false;
+    };
+
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    struct Lock
+    {
+      explicit Lock(ModulePipeline &) { taskENTER_CRITICAL(); }
+      ~Lock() { taskEXIT_CRITICAL(); }
+    };
+#else
+    struct Lock
+    {
+      explicit Lock(ModulePipeline &p) : lock(p._mutex) {}
+      std::lock_guard<std::mutex> lock;
+    };
+#endif
+
+    static size_t fieldSize(PipelineFieldType type)
+    {
+      switch (type)
+      {
+      case PipelineFieldType::I8:
+      case PipelineFieldType::U8:
+        return 1;
+      case PipelineFieldType::I16:
+      case PipelineFieldType::U16:
+        return 2;
+      default:
+        return 4;
+      }
+    }
+
+    static bool fits(uint16_t offset, PipelineFieldType type, size_t size)
+    {
+      return static_cast<size_t>(offset) + fieldSize(type) <= size;
+    }
+
+    template <typename V>
+    static V get(const uint8_t *p)
+    {
+      V v;
+      std::memcpy(&v, p, sizeof(V));
+      return v;
+    }
+
+    template <typename V>
+    static void put(uint8_t *p, int64_t x)
+    {
+      const int64_t lo = static_cast<int64_t>(std::numeric_limits<V>::min());
+      const int64_t hi = static_cast<int64_t>(std::numeric_limits<V>::max());
+      const V v = static_cast<V>(x < lo ? lo : (x > hi ? hi : x));
+      std::memcpy(p, &v, sizeof(V));
+    }
+
+    static int64_t load(const uint8_t *p, PipelineFieldType type, int32_t scale)
+    {
+      switch (type)
+      {
+      case PipelineFieldType::I8:
+        return get<int8_t>(p);
+      case PipelineFieldType::U8:
+        return get<uint8_t>(p);
+      case PipelineFieldType::I16:
+        return get<int16_t>(p);
+      case PipelineFieldType::U16:
+        return get<uint16_t>(p);
+      case PipelineFieldType::I32:
+        return get<int32_t>(p);
+      case PipelineFieldType::U32:
+        return get<uint32_t>(p);
+      case PipelineFieldType::F32:
+      {
+        const float f = get<float>(p) * static_cast<float>(scale);
+        if (!(f > -2147483648.0f))
+        {
+          return INT32_MIN;
+        }
+        return f < 2147483648.0f ? static_cast<int64_t>(f < 0 ? f - 0.5f : f + 0.5f) : INT32_MAX;
+      }
+      }
+      return 0;
+    }
+
+    static void store(uint8_t *p, PipelineFieldType type, int32_t scale, int64_t x)
+    {
+      switch (type)
+      {
+      case PipelineFieldType::I8:
+        put<int8_t>(p, x);
+        break;
+      case PipelineFieldType::U8:
+        put<uint8_t>(p, x);
+        break;
+      case PipelineFieldType::I16:
+        put<int16_t>(p, x);
+        break;
+      case PipelineFieldType::U16:
+        put<uint16_t>(p, x);
+        break;
+      case PipelineFieldType::I32:
+        put<int32_t>(p, x);
+        break;
+      case PipelineFieldType::U32:
+        put<uint32_t>(p, x);
+        break;
+      case PipelineFieldType::F32:
+      {
+        const float f = static_cast<float>(x) / static_cast<float>(scale ? scale : 1);
+        std::memcpy(p, &f, sizeof(f));
+        break;
+      }
+      }
+    }
+
+    static int64_t divRound(int64_t num, int64_t den)
+    {
+      if (den < 0)
+      {
+        num = -num;
+        den = -den;
+      }
+      return num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den);
+    }
+
+    // Applies one stage to x in place; false holds the chain.
+    static bool step(const PipelineStage &stage, StageState &s, int64_t &x, uint32_t nowUs)
+    {
+      switch (stage.type)
+      {
+      case PipelineStageType::Decimate:
+      {
+        const uint32_t n = stage.a > 1 ? static_cast<uint32_t>(stage.a) : 1;
+        s.acc += x;
+        if (++s.count < n)
+        {
+          return false;
+        }
+        x = divRound(s.acc, n);
+        s.acc = 0;
+        s.count = 0;
+        return true;
+      }
+      case PipelineStageType::Filter:
+      {
+        // State in Q8; the first sample seeds it.
+        const int64_t target = x * 256;
+        s.acc = s.primed ? s.acc + ((target - s.acc) >> (stage.a > 0 ? (stage.a < 16 ? stage.a : 16) : 0)) : target;
+        s.primed = true;
+        x = divRound(s.acc, 256);
+        return true;
+      }
+      case PipelineStageType::Scale:
+        x = stage.b ? divRound(x * stage.a, stage.b) : x * stage.a;
+        return true;
+      case PipelineStageType::Delta:
+      {
+        const int64_t prev = s.prev;
+        const uint32_t prevUs = s.prevUs;
+        const bool primed = s.primed;
+        s.prev = x;
+        s.prevUs = nowUs;
+        s.primed = true;
+        if (!primed)
+        {
+          return false;
+        }
+        if (stage.a)
+        {
+          const uint32_t dt = nowUs - prevUs;
+          if (dt == 0)
+          {
+            return false;
+          }
+          x = divRound((x - prev) * 1000000, dt);
+        }
+        else
+        {
+          x -= prev;
+        }
+        return true;
+      }
+      case PipelineStageType::Threshold:
+        if (!s.level && x >= stage.a)
+        {
+          s.level = true;
+        }
+        else if (s.level && x < static_cast<int64_t>(stage.a) - stage.b)
+        {
+          s.level = false;
+        }
+        x = s.level ? 1 : 0;
+        return true;
+      case PipelineStageType::Count:
+      {
+        const bool high = x != 0;
+        if (high && !s.level)
+        {
+          ++s.count;
+        }
+        s.level = high;
+        x = s.count;
+        return true;
+      }
+      case PipelineStageType::OnChange:
+      {
+        const int64_t diff = x > s.prev ? x - s.prev : s.prev - x;
+        if (s.primed && diff <= stage.a)
+        {
+          return false;
+        }
+        s.prev = x;
+        s.primed = true;
+        return true;
+      }
+      }
+      return true;
+    }
+
+    static bool parseType(ArduinoJson::JsonVariantConst json, PipelineFieldType &out)
+    {
+      static constexpr const char *kNames[] = {"i8", "u8", "i16", "u16", "i32", "u32", "f32"};
+      const char *name = json.as<const char *>();
+      if (!name)
+      {
+        return false;
+      }
+      for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i)
+      {
+        if (std::strcmp(name, kNames[i]) == 0)
+        {
+          out = static_cast<PipelineFieldType>(i);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static bool parseStage(ArduinoJson::JsonVariantConst json, PipelineStage &out)
+    {
+      const char *op = json["op"].as<const char *>();
+      if (!op)
+      {
+        return false;
+      }
+      if (std::strcmp(op, "decimate") == 0)
+      {
+        out = {PipelineStageType::Decimate, json["n"] | 1, 0};
+      }
+      else if (std::strcmp(op, "filter") == 0)
+      {
+        out = {PipelineStageType::Filter, json["shift"] | 2, 0};
+      }
+      else if (std::strcmp(op, "scale") == 0)
+      {
+        out = {PipelineStageType::Scale, json["mul"] | 1, json["div"] | 1};
+      }
+      else if (std::strcmp(op, "delta") == 0)
+      {
+        out = {PipelineStageType::Delta, (json["perSecond"] | false) ? 1 : 0, 0};
+      }
+      else if (std::strcmp(op, "threshold") == 0)
+      {
+        out = {PipelineStageType::Threshold, json["level"] | 0, json["hysteresis"] | 0};
+      }
+      else if (std::strcmp(op, "count") == 0)
+      {
+        out = {PipelineStageType::Count, 0, 0};
+      }
+      else if (std::strcmp(op, "onChange") == 0)
+      {
+        out = {PipelineStageType::OnChange, json["deadband"] | 0, 0};
+      }
+      else
+      {
+        return false;
+      }
+      return true;
+    }
+
+    static bool parseChannel(ArduinoJson::JsonVariantConst json, PipelineChannel &out)
+    {
+      out = PipelineChannel{};
+      out.offset = json["offset"] | 0;
+      if (!parseType(json["type"], out.type))
+      {
+        return false;
+      }
+      out.targetOffset = json["target"] | out.offset;
+      out.targetType = out.type;
+      if (!json["targetType"].isNull() && !parseType(json["targetType"], out.targetType))
+      {
+        return false;
+      }
+      out.fieldScale = json["fieldScale"] | 1;
+      for (ArduinoJson::JsonVariantConst stage : json["stages"].as<ArduinoJson::JsonArrayConst>())
+      {
+        if (out.stageCount == PipelineChannel::kMaxStages || !parseStage(stage, out.stages[out.stageCount]))
+        {
+          return false;
+        }
+        ++out.stageCount;
+      }
+      return true;
+    }
+
+    PipelineChannel _channels[kMaxChannels];
+    ChannelState _state[kMaxChannels];
+    size_t _count = 0;
+    uint32_t _sent = 0;
+    uint32_t _held = 0;
+    uint32_t _generation = 0; ///< Bumped whenever the chains are replaced
+#if !(defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED)
+    std::mutex _mutex;
+#endif
+  };
+
+  namespace internal
+  {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    inline uint32_t pipelineNowUs() { return micros(); }
+#else
+    inline uint32_t pipelineNowUs()
+    {
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+    }
+#endif
+
+    /** Runs @p pipeline over a serialized reading; clears it when held. */
+    inline void runPipeline(ModulePipeline &pipeline, std::vector<uint8_t> &out)
+    {
+      if (!pipeline.run(out.data(), out.size(), pipelineNowUs()))
+      {
+        out.clear();
+      }
+    }
+
+    /** Handles {"pipeline": [...]}; false if @p json is not for the pipeline. */
+    inline bool interceptPipelineJson(ModulePipeline &pipeline, ArduinoJson::JsonVariantConst json,
+                                      size_t payloadSize, bool &result)
+    {
+      ArduinoJson::JsonVariantConst chains = json["pipeline"];
+      if (!chains.is<ArduinoJson::JsonArrayConst>())
+      {
+        return false;
+      }
+      result = pipeline.configure(chains.as<ArduinoJson::JsonArrayConst>(), payloadSize);
+      return true;
+    }
+
+    /** Applies the optional initial chains given at registration. */
+    inline void configurePipeline(ModulePipeline &pipeline, const char *pipelineJson, size_t payloadSize)
+    {
+      if (!pipelineJson)
+      {
+        return;
+      }
+      ArduinoJson::JsonDocument doc;
+      if (!deserializeJson(doc, pipelineJson))
+      {
+        pipeline.configure(doc["pipeline"].as<ArduinoJson::JsonArrayConst>(), payloadSize);
+      }
+    }
+
+    /** A user module and its pipeline, created together by registerPipelineModule(). */
+    template <typename T, typename UserModule>
+    struct PipelinedModule
+    {
+      explicit PipelinedModule(const ModuleConfig &config) : module(config) {}
+
+      void afterRead(std::vector<uint8_t> &out)
+      {
+        if (!announced)
+        {
+          announced = announceEncoding<T>(module, packed);
+        }
+        runPipeline(pipeline, out);
+        if (packed)
+        {
+          packReading<T>(out);
+        }
+      }
+
+      bool interceptJson(ArduinoJson::JsonVariantConst json, bool &result)
+      {
+        return interceptPipelineJson(pipeline, json, sizeof(T), result) ||
+               interceptEncodingJson<T>(packed, json, result);
+      }
+
+      UserModule module;
+      ModulePipeline pipeline;
+      bool packed = false;    ///< Send PackedCodec<T> frames instead of raw T
+      bool announced = false; ///< Encoding pushed to the host since boot
+    };
+  } // namespace internal
+
+  /**
+   * @brief Register a custom module type whose readings pass through a ModulePipeline
+   *
+   * Same as registerModule(), except that every reading runs through the
+   * module's pipeline before it is handed to the system, and a frame the
+   * pipeline holds back is reported as "no data" for that poll: an empty
+   * reading with an OK status, for which nothing is transmitted and a
+   * host data request gets no reply (see registerWrappedModule()). The
+   * host sets or replaces the chains by pushing {"pipeline": [...]} to
+   * the module; other JSON still reaches handleReceivedJson().
+   *
+   * @code
+   * LumynLabs::registerPipelineModule<RangeData, RangeModule>(
+   *     "RANGE_VELOCITY",
+   *     R"({"pipeline":[{"offset":0,"type":"u16","target":4,"targetType":"i32",
+   *        "stages":[{"op":"delta","perSecond":true},{"op":"onChange","deadband":50}]}]})");
+   * @endcode
+   *
+   * @param pipelineJson Optional chains to start with, in the push format;
+   *                     parsed once per module instance
+   */
+  template <typename T, typename UserModule>
+  void registerPipelineModule(const std::string &typeIdentifier, const char *pipelineJson = nullptr)
+  {
+    using Holder = internal::PipelinedModule<T, UserModule>;
+    internal::registerWrappedModule<T, Holder>(typeIdentifier, [pipelineJson](Holder &holder)
+                                               { internal::configurePipeline(holder.pipeline, pipelineJson, sizeof(T)); });
+  }
+
+  /**
+   * @brief Register a custom module type that sends packed readings
+   *
+   * Same as registerPipelineModule(), but readings leave the device as
+   * PackedCodec<T> frames (see ModuleSchema.h) from the start. The host
+   * decodes them with the schema it fetches with {"schema": true}, and can
+   * switch between {"encoding": "packed"} and {"encoding": "raw"}.
+   *
+   * @code
+   * LumynLabs::registerPackedModule<ImuData, ImuModule>("IMU_PACKED");
+   * @endcode
+   */
+  template <typename T, typename UserModule>
+  void registerPackedModule(const std::string &typeIdentifier, const char *pipelineJson = nullptr)
+  {
+    static_assert(hasModuleFields<T>, "registerPackedModule needs a ModuleFields<T> specialization");
+    using Holder = internal::PipelinedModule<T, UserModule>;
+    internal::registerWrappedModule<T, Holder>(typeIdentifier, [pipelineJson](Holder &holder)
+                                               {
+                                                 holder.packed = true;
+                                                 internal::configurePipeline(holder.pipeline, pipelineJson, sizeof(T));
+                                               });
+  }
+
+} // namespace LumynLabs
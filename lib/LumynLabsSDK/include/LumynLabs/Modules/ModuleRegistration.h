@@ -14,6 +14,7 @@
 #include <string>
 
 #include "Module.h"
+#include "ModuleSchema.h"
 
 namespace LumynLabs {
 
@@ -62,6 +63,11 @@ void registerModuleOps(const std::string& typeIdentifier, SdkModuleOps ops);
 /**
  * @brief Register a custom module type with the system.
  *
+ * If T has a ModuleFields<T> description, its schema is recorded (see
+ * ModuleSchema.h). With @p answerSchemaRequests set, the host can also
+ * fetch it by pushing {"schema": true}; otherwise all JSON reaches
+ * handleReceivedJson() untouched.
+ *
  * @code
  * LumynLabs::registerModule<MySensorData, MySensor>("MY_SENSOR");
  * @endcode
@@ -69,9 +75,11 @@ void registerModuleOps(const std::string& typeIdentifier, SdkModuleOps ops);
  * @tparam T       Packed data structure for this module's readings.
  * @tparam UserModule  Your module class (must inherit from Module<T>).
  * @param typeIdentifier  Unique string identifier matching the device config.
+ * @param answerSchemaRequests  Reply to {"schema": true} instead of passing it on.
  */
 template <typename T, typename UserModule>
-void registerModule(const std::string& typeIdentifier) {
+void registerModule(const std::string& typeIdentifier,
+                    bool answerSchemaRequests = false) {
   static_assert(std::is_base_of<Module<T>, UserModule>::value,
                 "UserModule must inherit from LumynLabs::Module<T>");
 
@@ -95,8 +103,14 @@ void registerModule(const std::string& typeIdentifier) {
     return err;
   };
 
-  ops.handleJson = [](void* p, ArduinoJson::JsonVariantConst json) -> bool {
-    return static_cast<UserModule*>(p)->handleReceivedJson(json);
+  ops.handleJson = [typeIdentifier, answerSchemaRequests](
+                       void* p, ArduinoJson::JsonVariantConst json) -> bool {
+    UserModule* module = static_cast<UserModule*>(p);
+    bool result = false;
+    if (answerSchemaRequests &&
+        internal::interceptSchemaJson<T>(*module, typeIdentifier, json, result))
+      return result;
+    return module->handleReceivedJson(json);
   };
 
   ops.handleBinary = [](void* p, const uint8_t* data, size_t len) -> bool {
@@ -118,7 +132,115 @@ void registerModule(const std::string& typeIdentifier) {
 
   ops.destroy = [](void* p) { delete static_cast<UserModule*>(p); };
 
+  internal::addModuleSchema<T>(typeIdentifier);
   internal::registerModuleOps(typeIdentifier, std::move(ops));
 }
 
+namespace internal {
+
+/**
+ * @brief Register a module type whose instances live inside a wrapper.
+ *
+ * Used by the registration helpers that add processing between a
+ * module and the system (pipelines, report-on-change). Holder must:
+ *  - be constructible from a ModuleConfig,
+ *  - expose the user module as a `module` member,
+ *  - provide `void afterRead(std::vector<uint8_t>&)`, which may rewrite
+ *    the serialized reading (e.g. pack it) or clear it to skip this poll,
+ *  - provide `bool interceptJson(ArduinoJson::JsonVariantConst, bool&)`,
+ *    which returns true (and the result) when the JSON was meant for it.
+ *
+ * Wrapped modules always answer {"schema": true}: the helpers that use
+ * this already own JSON keys of their own, and a packed encoding is
+ * useless to a host without the schema.
+ *
+ * It may also provide:
+ *  - `bool beforeRead(std::vector<uint8_t>&)`, which returns true when it
+ *    filled in this poll's data itself (readData() is then not called),
+ *  - `bool interceptBinary(const uint8_t*, size_t, bool&)`, the binary
+ *    counterpart of interceptJson().
+ *
+ * An empty reading with an OK status means "no data": the module task
+ * transmits a reading only when it is non-empty, and a host request for
+ * the module's data is left unanswered (the system logs "No data
+ * available from module N"). Only a non-OK status counts as a read error.
+ *
+ * @param setup Optional, called once on every new Holder.
+ */
+template <typename T, typename Holder>
+void registerWrappedModule(const std::string& typeIdentifier,
+                           std::function<void(Holder&)> setup = nullptr) {
+  static_assert(std::is_base_of<Module<T>, decltype(Holder::module)>::value,
+                "Holder::module must inherit from LumynLabs::Module<T>");
+
+  SdkModuleOps ops;
+
+  ops.create = [setup](const ModuleConfig& config) -> void* {
+    Holder* holder = new Holder(config);
+    if (setup) setup(*holder);
+    return static_cast<void*>(holder);
+  };
+
+  ops.init = [](void* p) -> ModuleError {
+    return static_cast<Holder*>(p)->module.initModule();
+  };
+
+  ops.read = [](void* p, std::vector<uint8_t>& out) -> ModuleError {
+    Holder* holder = static_cast<Holder*>(p);
+    if constexpr (requires { holder->beforeRead(out); }) {
+      if (holder->beforeRead(out)) return ModuleError::ok();
+    }
+    // Zeroed so padding bytes compare and encode deterministically.
+    T data{};
+    ModuleError err = holder->module.readData(&data);
+    if (err.isOk()) {
+      out.resize(sizeof(T));
+      std::memcpy(out.data(), &data, sizeof(T));
+      holder->afterRead(out);
+    }
+    return err;
+  };
+
+  ops.handleJson = [typeIdentifier](void* p,
+                                    ArduinoJson::JsonVariantConst json) -> bool {
+    Holder* holder = static_cast<Holder*>(p);
+    bool result = false;
+    if (interceptSchemaJson<T>(holder->module, typeIdentifier, json, result))
+      return result;
+    if (holder->interceptJson(json, result)) return result;
+    return holder->module.handleReceivedJson(json);
+  };
+
+  ops.handleBinary = [](void* p, const uint8_t* data, size_t len) -> bool {
+    Holder* holder = static_cast<Holder*>(p);
+    if constexpr (requires(bool& r) { holder->interceptBinary(data, len, r); }) {
+      bool result = false;
+      if (holder->interceptBinary(data, len, result)) return result;
+    }
+    if (len != sizeof(T)) return false;
+    T typed;
+    std::memcpy(&typed, data, sizeof(T));
+    return holder->module.handleReceivedData(typed);
+  };
+
+  ops.setPushJsonFn =
+      [](void* p, std::function<bool(ArduinoJson::JsonVariantConst)> fn) {
+        static_cast<Module<T>&>(static_cast<Holder*>(p)->module)
+            ._sdk_setPushJsonFn(std::move(fn));
+      };
+
+  ops.setPeripherals = [](void* p, TwoWire& wire, arduino::HardwareSPI& spi,
+                          SerialUART& uart) {
+    static_cast<Module<T>&>(static_cast<Holder*>(p)->module)
+        ._sdk_setPeripherals(wire, spi, uart);
+  };
+
+  ops.destroy = [](void* p) { delete static_cast<Holder*>(p); };
+
+  addModuleSchema<T>(typeIdentifier);
+  registerModuleOps(typeIdentifier, std::move(ops));
+}
+
+}  // namespace internal
+
 }  // namespace LumynLabs
@@ -0,0 +1,548 @@
+/**
+ * @file ModuleSchema.h
+ * @brief Payload schemas built at compile time, and a packed wire encoding
+ *
+ * For a payload type described with ModuleFields<T> (see ModuleFields.h),
+ * ModuleSchema<T> is a constexpr byte blob listing every field: name,
+ * offset, type, array length and packed width. Registration records it,
+ * the host can fetch it, and tools/module_schema.py turns it into a
+ * decoder, so the host no longer hand-maintains a copy of T.
+ *
+ * With a schema the host can also decode PackedCodec<T> frames. Those
+ * bit-pack bools, truncate integers to their declared width and send
+ * scaled floats as small fixed-point integers.
+ *
+ * Schema blob, little endian:
+ *   "LS", version (1), field count, payload size (u16), packed bytes (u16)
+ *   per field: type, count, offset (u16), bits, flags, scale (f32),
+ *              name length, name
+ *
+ * Packed frame: kPackedTag, low 16 bits of the schema CRC-32, then the
+ * fields in order as an LSB-first bit stream, zero-padded to a byte.
+ *
+ * Raw frames carry no header, so the host cannot tell the two apart from
+ * the bytes alone. Modules that can switch encoding push
+ * {"encoding": "packed" | "raw", "hash": ...} before their first reading
+ * after every boot, and the host decodes by the last announcement.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Util/Crc32.h"
+#include "Module.h"
+#include "ModuleFields.h"
+
+#include <ArduinoJson.h>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Compile-time schema of payload type T
+   */
+  template <typename T>
+  struct ModuleSchema
+  {
+    static_assert(hasModuleFields<T>, "ModuleSchema needs a ModuleFields<T> specialization");
+    static_assert(moduleFieldsFit<T>(), "ModuleFields<T> describes bytes outside T");
+    static_assert(moduleFields<T>().size() <= 255, "Too many payload fields");
+
+    static constexpr uint8_t kVersion = 1;
+    static constexpr size_t kHeaderSize = 8;
+    static constexpr size_t kFieldHeaderSize = 11;
+    static constexpr uint8_t kFlagScaled = 0x01;
+
+    /** Total packed bits of one reading. */
+    static constexpr size_t packedBits()
+    {
+      size_t bits = 0;
+      for (const FieldDescriptor &f : moduleFields<T>())
+      {
+        bits += static_cast<size_t>(packedFieldBits(f)) * f.count;
+      }
+      return bits;
+    }
+
+    /** Packed reading size, without the frame header. */
+    static constexpr size_t kPackedBytes = (packedBits() + 7) / 8;
+
+    static constexpr size_t blobSize()
+    {
+      size_t size = kHeaderSize;
+      for (const FieldDescriptor &f : moduleFields<T>())
+      {
+        size += kFieldHeaderSize + std::char_traits<char>::length(f.name);
+      }
+      return size;
+    }
+
+    static constexpr std::array<uint8_t, blobSize()> build()
+    {
+      std::array<uint8_t, blobSize()> blob{};
+      size_t at = 0;
+      auto put8 = [&](uint32_t v) { blob[at++] = static_cast<uint8_t>(v); };
+      auto put16 = [&](uint32_t v)
+      {
+        put8(v);
+        put8(v >> 8);
+      };
+      constexpr auto fields = moduleFields<T>();
+      put8('L');
+      put8('S');
+      put8(kVersion);
+      put8(fields.size());
+      put16(sizeof(T));
+      put16(kPackedBytes);
+      for (const FieldDescriptor &f : fields)
+      {
+        const size_t nameLength = std::char_traits<char>::length(f.name);
+        const uint32_t scale = std::bit_cast<uint32_t>(f.scale);
+        put8(static_cast<uint8_t>(f.type));
+        put8(f.count);
+        put16(f.offset);
+        put8(packedFieldBits(f));
+        put8(f.type == FieldType::F32 && f.scale > 0 ? kFlagScaled : 0);
+        put16(scale);
+        put16(scale >> 16);
+        put8(nameLength);
+        for (size_t i = 0; i < nameLength; ++i)
+        {
+          put8(static_cast<uint8_t>(f.name[i]));
+        }
+      }
+      return blob;
+    }
+
+    static constexpr std::array<uint8_t, blobSize()> kBlob = build();
+
+    static constexpr uint32_t computeHash()
+    {
+      uint32_t state = Crc32::kInit;
+      for (uint8_t b : kBlob)
+      {
+        const char c = static_cast<char>(b);
+        state = Crc32::updateBitwise(state, &c, 1);
+      }
+      return Crc32::finalize(state);
+    }
+
+    /** CRC-32 of the blob; packed frames carry its low 16 bits. */
+    static constexpr uint32_t kHash = computeHash();
+  };
+
+  /**
+   * @brief Packed encoding of payload type T
+   */
+  template <typename T>
+  class PackedCodec
+  {
+    using Schema = ModuleSchema<T>;
+
+  public:
+    /**
+     * First byte of every packed frame. A raw reading may start with the
+     * same byte, so the host tells packed and raw frames apart by the
+     * announced encoding and the frame length, not by this tag.
+     */
+    static constexpr uint8_t kPackedTag = 0xB7;
+    static constexpr size_t kHeaderSize = 3;
+    static constexpr size_t kFrameSize = kHeaderSize + Schema::kPackedBytes;
+
+    /** Encode @p payload (sizeof(T) bytes) into @p out (kFrameSize bytes). */
+    static void encode(const uint8_t *payload, uint8_t *out)
+    {
+      out[0] = kPackedTag;
+      out[1] = static_cast<uint8_t>(Schema::kHash);
+      out[2] = static_cast<uint8_t>(Schema::kHash >> 8);
+      BitWriter writer(out + kHeaderSize);
+      for (const FieldDescriptor &f : moduleFields<T>())
+      {
+        const uint8_t bits = packedFieldBits(f);
+        for (size_t i = 0; i < f.count; ++i)
+        {
+          writer.put(packElement(payload + f.offset + i * fieldTypeSize(f.type), f, bits), bits);
+        }
+      }
+    }
+
+    static void encode(const T &sample, uint8_t *out) { encode(reinterpret_cast<const uint8_t *>(&sample), out); }
+
+    /**
+     * @brief Decode a packed frame into @p out
+     *
+     * Bytes of T outside the described fields are left as they were.
+     *
+     * @return false if the frame is too short or from another schema
+     */
+    static bool decode(const uint8_t *frame, size_t length, T &out)
+    {
+      if (length < kFrameSize || frame[0] != kPackedTag || frame[1] != static_cast<uint8_t>(Schema::kHash) ||
+          frame[2] != static_cast<uint8_t>(Schema::kHash >> 8))
+      {
+        return false;
+      }
+      uint8_t *payload = reinterpret_cast<uint8_t *>(&out);
+      BitReader reader(frame + kHeaderSize);
+      for (const FieldDescriptor &f : moduleFields<T>())
+      {
+        const uint8_t bits = packedFieldBits(f);
+        for (size_t i = 0; i < f.count; ++i)
+        {
+          unpackElement(reader.get(bits), payload + f.offset + i * fieldTypeSize(f.type), f, bits);
+        }
+      }
+      return true;
+    }
+
+  private:
+    class BitWriter
+    {
+    public:
+      explicit BitWriter(uint8_t *out) : _out(out) { std::memset(out, 0, Schema::kPackedBytes); }
+
+      void put(uint32_t value, uint8_t bits)
+      {
+        for (uint8_t i = 0; i < bits; ++i, ++_bit)
+        {
+          if (value & (1u << i))
+          {
+            _out[_bit / 8] |= static_cast<uint8_t>(1u << (_bit % 8));
+          }
+        }
+      }
+
+    private:
+      uint8_t *_out;
+      size_t _bit = 0;
+    };
+
+    class BitReader
+    {
+    public:
+      explicit BitReader(const uint8_t *in) : _in(in) {}
+
+      uint32_t get(uint8_t bits)
+      {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bits; ++i, ++_bit)
+        {
+          if (_in[_bit / 8] & (1u << (_bit % 8)))
+          {
+            value |= 1u << i;
+          }
+        }
+        return value;
+      }
+
+    private:
+      const uint8_t *_in;
+      size_t _bit = 0;
+    };
+
+    static constexpr uint32_t mask(uint8_t bits) { return bits >= 32 ? 0xFFFFFFFFu : (1u << bits) - 1; }
+
+    static bool isSigned(FieldType type)
+    {
+      return type == FieldType::I8 || type == FieldType::I16 || type == FieldType::I32;
+    }
+
+    static int64_t saturate(int64_t v, uint8_t bits, bool isSignedField)
+    {
+      const int64_t hi = isSignedField ? (int64_t{1} << (bits - 1)) - 1 : (int64_t{1} << bits) - 1;
+      const int64_t lo = isSignedField ? -(int64_t{1} << (bits - 1)) : 0;
+      return v < lo ? lo : (v > hi ? hi : v);
+    }
+
+    static uint32_t packElement(const uint8_t *p, const FieldDescriptor &f, uint8_t bits)
+    {
+      if (f.type == FieldType::F32)
+      {
+        if (f.scale <= 0)
+        {
+          return internal::loadElement<uint32_t>(p);
+        }
+        const float scaled = internal::loadElement<float>(p) * f.scale;
+        // NaN packs as 0.
+        const int64_t limit = int64_t{1} << (bits - 1);
+        const int64_t v = !(scaled == scaled)           ? 0
+                          : scaled >= static_cast<float>(limit) ? limit - 1
+                          : scaled <= -static_cast<float>(limit)
+                              ? -limit
+                              : static_cast<int64_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+        return static_cast<uint32_t>(saturate(v, bits, true)) & mask(bits);
+      }
+      const int64_t v = internal::integerElement(p, f.type);
+      return static_cast<uint32_t>(saturate(v, bits, isSigned(f.type))) & mask(bits);
+    }
+
+    static void unpackElement(uint32_t raw, uint8_t *p, const FieldDescriptor &f, uint8_t bits)
+    {
+      int64_t v = raw;
+      const bool signExtend = isSigned(f.type) || (f.type == FieldType::F32 && f.scale > 0);
+      if (signExtend && bits < 32 && (raw & (1u << (bits - 1))))
+      {
+        v -= int64_t{1} << bits;
+      }
+      else if (signExtend && bits == 32)
+      {
+        v = static_cast<int32_t>(raw);
+      }
+      switch (f.type)
+      {
+      case FieldType::Bool:
+      case FieldType::I8:
+      case FieldType::U8:
+        *p = static_cast<uint8_t>(v);
+        break;
+      case FieldType::I16:
+      case FieldType::U16:
+      {
+        const uint16_t u = static_cast<uint16_t>(v);
+        std::memcpy(p, &u, sizeof(u));
+        break;
+      }
+      case FieldType::I32:
+      case FieldType::U32:
+      {
+        const uint32_t u = static_cast<uint32_t>(v);
+        std::memcpy(p, &u, sizeof(u));
+        break;
+      }
+      case FieldType::F32:
+      {
+        const float value = f.scale > 0 ? static_cast<float>(v) / f.scale : std::bit_cast<float>(raw);
+        std::memcpy(p, &value, sizeof(value));
+        break;
+      }
+      }
+    }
+  };
+
+  /**
+   * @brief Schemas recorded at module registration, by type identifier
+   */
+  class SchemaRegistry
+  {
+  public:
+    static constexpr size_t kMaxSchemas = 16;
+
+    struct Entry
+    {
+      std::string typeIdentifier;
+      const uint8_t *blob = nullptr;
+      size_t size = 0;
+      uint32_t hash = 0;
+    };
+
+    /** Record T's schema under @p typeIdentifier; later calls replace it. */
+    template <typename T>
+    static bool add(const std::string &typeIdentifier)
+    {
+      Entry entry{typeIdentifier, ModuleSchema<T>::kBlob.data(), ModuleSchema<T>::kBlob.size(), ModuleSchema<T>::kHash};
+      for (size_t i = 0; i < count(); ++i)
+      {
+        if (entries()[i].typeIdentifier == typeIdentifier)
+        {
+          entries()[i] = std::move(entry);
+          return true;
+        }
+      }
+      if (count() == kMaxSchemas)
+      {
+        return false;
+      }
+      entries()[count()++] = std::move(entry);
+      return true;
+    }
+
+    static const Entry *find(const std::string &typeIdentifier)
+    {
+      for (size_t i = 0; i < count(); ++i)
+      {
+        if (entries()[i].typeIdentifier == typeIdentifier)
+        {
+          return &entries()[i];
+        }
+      }
+      return nullptr;
+    }
+
+    static size_t size() { return count(); }
+    static const Entry &at(size_t i) { return entries()[i]; }
+
+    /**
+     * @brief Fill @p out with a schema reply
+     *
+     * {"schema": {"type", "hash", "payloadSize", "packedSize", "blob" (hex),
+     *  "fields": [{"name", "type", "offset", "count", "bits", "scale"}]}}
+     */
+    template <typename T>
+    static void toJson(const std::string &typeIdentifier, ArduinoJson::JsonDocument &out)
+    {
+      static constexpr const char *kTypeNames[] = {"bool", "i8", "u8", "i16", "u16", "i32", "u32", "f32"};
+      static constexpr char kHex[] = "0123456789abcdef";
+      using Schema = ModuleSchema<T>;
+
+      ArduinoJson::JsonObject schema = out["schema"].to<ArduinoJson::JsonObject>();
+      schema["type"] = typeIdentifier;
+      schema["hash"] = Schema::kHash;
+      schema["payloadSize"] = sizeof(T);
+      schema["packedSize"] = PackedCodec<T>::kFrameSize;
+      std::string hex;
+      hex.reserve(Schema::kBlob.size() * 2);
+      for (uint8_t b : Schema::kBlob)
+      {
+        hex.push_back(kHex[b >> 4]);
+        hex.push_back(kHex[b & 0x0F]);
+      }
+      schema["blob"] = hex;
+      ArduinoJson::JsonArray fields = schema["fields"].to<ArduinoJson::JsonArray>();
+      for (const FieldDescriptor &f : moduleFields<T>())
+      {
+        ArduinoJson::JsonObject field = fields.add<ArduinoJson::JsonObject>();
+        field["name"] = f.name;
+        field["type"] = kTypeNames[static_cast<uint8_t>(f.type)];
+        field["offset"] = f.offset;
+        field["count"] = f.count;
+        field["bits"] = packedFieldBits(f);
+        field["scale"] = f.scale;
+      }
+    }
+
+  private:
+    static Entry *entries()
+    {
+      static Entry table[kMaxSchemas];
+      return table;
+    }
+
+    static size_t &count()
+    {
+      static size_t n = 0;
+      return n;
+    }
+  };
+
+  namespace internal
+  {
+    /** Record T's schema if T is described; called by the registration helpers. */
+    template <typename T>
+    void addModuleSchema(const std::string &typeIdentifier)
+    {
+      if constexpr (hasModuleFields<T>)
+      {
+        SchemaRegistry::add<T>(typeIdentifier);
+      }
+    }
+
+    /**
+     * @brief Answer {"schema": true} for a module of payload type T
+     *
+     * Any other value under "schema" is not a request and is left to the
+     * module.
+     *
+     * @return false if @p json is not a schema request or T is not described
+     */
+    template <typename T>
+    bool interceptSchemaJson(Module<T> &module, const std::string &typeIdentifier,
+                             ArduinoJson::JsonVariantConst json, bool &result)
+    {
+      if constexpr (hasModuleFields<T>)
+      {
+        ArduinoJson::JsonVariantConst request = json["schema"];
+        if (!request.is<bool>() || !request.as<bool>())
+        {
+          return false;
+        }
+        ArduinoJson::JsonDocument reply;
+        SchemaRegistry::toJson<T>(typeIdentifier, reply);
+        result = module.pushJsonToHost(reply.template as<ArduinoJson::JsonVariantConst>());
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    /**
+     * @brief Handle {"encoding": "packed" | "raw"} for payload type T
+     * @return false if @p json does not select an encoding or T is not described
+     */
+    template <typename T>
+    bool interceptEncodingJson(bool &packed, ArduinoJson::JsonVariantConst json, bool &result)
+    {
+      if constexpr (hasModuleFields<T>)
+      {
+        const char *encoding = json["encoding"] | static_cast<const char *>(nullptr);
+        if (!encoding)
+        {
+          return false;
+        }
+        result = std::strcmp(encoding, "packed") == 0 || std::strcmp(encoding, "raw") == 0;
+        if (result)
+        {
+          packed = encoding[0] == 'p';
+        }
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    /**
+     * @brief Tell the host which encoding readings of T use
+     *
+     * Pushes {"encoding": "packed" | "raw", "hash": schema CRC-32}. The
+     * holders call it before their first reading after boot, so a host
+     * that selected an encoding before the device restarted notices the
+     * reset to the registered default.
+     *
+     * @return true once pushed, or if T is not described (nothing to announce)
+     */
+    template <typename T>
+    bool announceEncoding(Module<T> &module, bool packed)
+    {
+      if constexpr (hasModuleFields<T>)
+      {
+        ArduinoJson::JsonDocument doc;
+        doc["encoding"] = packed ? "packed" : "raw";
+        doc["hash"] = ModuleSchema<T>::kHash;
+        return module.pushJsonToHost(doc.template as<ArduinoJson::JsonVariantConst>());
+      }
+      else
+      {
+        return true;
+      }
+    }
+
+    /** Replace a serialized reading of T with its packed frame. */
+    template <typename T>
+    void packReading(std::vector<uint8_t> &out)
+    {
+      if constexpr (hasModuleFields<T>)
+      {
+        if (out.size() != sizeof(T))
+        {
+          return;
+        }
+        uint8_t frame[PackedCodec<T>::kFrameSize];
+        PackedCodec<T>::encode(out.data(), frame);
+        out.assign(frame, frame + sizeof(frame));
+      }
+    }
+  } // namespace internal
+
+} // namespace LumynLabs
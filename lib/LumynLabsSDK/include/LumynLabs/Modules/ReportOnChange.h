@@ -0,0 +1,254 @@
+/**
+ * @file ReportOnChange.h
+ * @brief Deadband / report-on-change policy for module telemetry
+ *
+ * Most sensors are static most of the time, yet every poll is normally
+ * sent. ReportOnChange compares each reading with the last one that was
+ * actually sent and lets it through only when a field has moved by more
+ * than its tolerance, or when the module has been silent for the
+ * keepalive interval. Comparing against the last sent reading, not the
+ * previous poll, means a slow drift is still reported once it adds up.
+ *
+ * Tolerances come from the payload's ModuleFields<T> description (see
+ * ModuleFields.h). Bytes of an undescribed T are compared exactly.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "ModuleFields.h"
+#include "ModulePipeline.h"
+#include "ModuleRegistration.h"
+
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief When an unchanged reading is sent anyway
+   */
+  struct ReportPolicy
+  {
+    uint32_t maxSilenceMs = 1000; ///< Keepalive: send at least this often; 0 = never
+    uint32_t minIntervalMs = 0;   ///< Rate limit: changes closer than this wait for the next poll
+  };
+
+  /**
+   * @brief Report-on-change gate for payload type T
+   *
+   * Not thread-safe; the SDK calls it from the module's read path only,
+   * and setPolicy() takes effect on the next reading.
+   */
+  template <typename T>
+  class ReportOnChange
+  {
+    static_assert(moduleFieldsFit<T>(), "ModuleFields<T> describes bytes outside T");
+
+  public:
+    explicit ReportOnChange(const ReportPolicy &policy = {}) : _policy(policy) {}
+
+    void setPolicy(const ReportPolicy &policy) { _policy = policy; }
+    const ReportPolicy &policy() const { return _policy; }
+
+    /** Forget the last sent reading; the next one is always sent. */
+    void reset() { _haveLast = false; }
+
+    /**
+     * @brief Decide whether to send @p payload (sizeof(T) bytes)
+     *
+     * When it returns true, @p payload becomes the new reference.
+     */
+    bool shouldSend(const uint8_t *payload, uint32_t nowMs)
+    {
+      const uint32_t since = nowMs - _lastSentMs;
+      bool send = !_haveLast;
+      if (!send && _policy.maxSilenceMs && since >= _policy.maxSilenceMs)
+      {
+        send = true;
+      }
+      else if (!send && since >= _policy.minIntervalMs && changed(_last, payload))
+      {
+        send = true;
+      }
+      if (!send)
+      {
+        ++_suppressed;
+        return false;
+      }
+      std::memcpy(_last, payload, sizeof(T));
+      _haveLast = true;
+      _lastSentMs = nowMs;
+      ++_sent;
+      return true;
+    }
+
+    bool shouldSend(const T &sample, uint32_t nowMs)
+    {
+      return shouldSend(reinterpret_cast<const uint8_t *>(&sample), nowMs);
+    }
+
+    uint32_t sent() const { return _sent; }
+    uint32_t suppressed() const { return _suppressed; }
+
+    /** True when @p b differs from @p a by more than the field tolerances. */
+    static bool changed(const uint8_t *a, const uint8_t *b)
+    {
+      constexpr auto fields = moduleFields<T>();
+      if constexpr (fields.empty())
+      {
+        return std::memcmp(a, b, sizeof(T)) != 0;
+      }
+      else
+      {
+        for (const FieldDescriptor &f : fields)
+        {
+          const size_t size = fieldTypeSize(f.type);
+          for (size_t i = 0; i < f.count; ++i)
+          {
+            const size_t at = f.offset + i * size;
+            if (elementChanged(a + at, b + at, f))
+            {
+              return true;
+            }
+          }
+        }
+        return false;
+      }
+    }
+
+  private:
+    static bool elementChanged(const uint8_t *a, const uint8_t *b, const FieldDescriptor &f)
+    {
+      if (f.type == FieldType::F32)
+      {
+        const float x = internal::loadElement<float>(a);
+        const float y = internal::loadElement<float>(b);
+        if (x != x || y != y)
+        {
+          // NaN: report a change of bit pattern (NaN appearing or going).
+          return std::memcmp(a, b, sizeof(float)) != 0;
+        }
+        const float d = x > y ? x - y : y - x;
+        return f.tolerance > 0 ? d > f.tolerance : d != 0;
+      }
+      const int64_t x = internal::integerElement(a, f.type);
+      const int64_t y = internal::integerElement(b, f.type);
+      const int64_t d = x > y ? x - y : y - x;
+      return d > static_cast<int64_t>(f.tolerance);
+    }
+
+    ReportPolicy _policy;
+    uint8_t _last[sizeof(T)] = {};
+    bool _haveLast = false;
+    uint32_t _lastSentMs = 0;
+    uint32_t _sent = 0;
+    uint32_t _suppressed = 0;
+  };
+
+  namespace internal
+  {
+#if defined(CX_FREERTOS_ENABLED) && CX_FREERTOS_ENABLED
+    inline uint32_t reportNowMs() { return millis(); }
+#else
+    inline uint32_t reportNowMs()
+    {
+      return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+    }
+#endif
+
+    /** A user module with its pipeline and report-on-change gate. */
+    template <typename T, typename UserModule>
+    struct ReportingModule
+    {
+      explicit ReportingModule(const ModuleConfig &config) : module(config) {}
+
+      // An emptied reading is "no data" to the system: nothing is sent.
+      void afterRead(std::vector<uint8_t> &out)
+      {
+        if (!announced)
+        {
+          announced = announceEncoding<T>(module, packed);
+        }
+        runPipeline(pipeline, out);
+        if (!out.empty() && !gate.shouldSend(out.data(), reportNowMs()))
+        {
+          out.clear();
+        }
+        if (packed)
+        {
+          packReading<T>(out);
+        }
+      }
+
+      bool interceptJson(ArduinoJson::JsonVariantConst json, bool &result)
+      {
+        if (interceptPipelineJson(pipeline, json, sizeof(T), result))
+        {
+          gate.reset();
+          return true;
+        }
+        if (interceptEncodingJson<T>(packed, json, result))
+        {
+          return true;
+        }
+        ArduinoJson::JsonVariantConst report = json["report"];
+        if (report.isNull())
+        {
+          return false;
+        }
+        ReportPolicy policy = gate.policy();
+        policy.maxSilenceMs = report["maxSilenceMs"] | policy.maxSilenceMs;
+        policy.minIntervalMs = report["minIntervalMs"] | policy.minIntervalMs;
+        gate.setPolicy(policy);
+        result = true;
+        return true;
+      }
+
+      UserModule module;
+      ModulePipeline pipeline;
+      ReportOnChange<T> gate;
+      bool packed = false;    ///< Send PackedCodec<T> frames instead of raw T
+      bool announced = false; ///< Encoding pushed to the host since boot
+    };
+  } // namespace internal
+
+  /**
+   * @brief Register a custom module type that only reports meaningful changes
+   *
+   * Same as registerPipelineModule(), with a ReportOnChange gate after the
+   * pipeline. A poll whose reading is within tolerance of the last one
+   * sent is reported as "no data" until @p policy's keepalive expires:
+   * an empty reading with an OK status, which the system does not
+   * transmit (see registerWrappedModule()). The same applies to a data
+   * request from the host, which gets no reply while nothing has changed,
+   * so hosts should keep the last reading they received rather than poll.
+   * The host can adjust the policy by pushing
+   * {"report": {"maxSilenceMs": 5000, "minIntervalMs": 50}}.
+   *
+   * @code
+   * LumynLabs::registerReportOnChangeModule<MySensorData, MySensor>("MY_SENSOR", {5000, 0});
+   * @endcode
+   */
+  template <typename T, typename UserModule>
+  void registerReportOnChangeModule(const std::string &typeIdentifier, const ReportPolicy &policy = {},
+                                    const char *pipelineJson = nullptr)
+  {
+    using Holder = internal::ReportingModule<T, UserModule>;
+    internal::registerWrappedModule<T, Holder>(typeIdentifier, [policy, pipelineJson](Holder &holder)
+                                               {
+                                                 holder.gate.setPolicy(policy);
+                                                 internal::configurePipeline(holder.pipeline, pipelineJson, sizeof(T));
+                                               });
+  }
+
+} // namespace LumynLabs
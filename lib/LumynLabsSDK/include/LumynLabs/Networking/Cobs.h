@@ -0,0 +1,296 @@
+/**
+ * @file Cobs.h
+ * @brief In-place Consistent Overhead Byte Stuffing (COBS) codec
+ *
+ * Frames are encoded inside the buffer that already holds the payload:
+ * reserve Cobs::maxOverhead() bytes in front of the payload when building
+ * it and the encoded frame is produced in the same storage, with no
+ * second buffer and no extra copy. Bytes are handled one at a time;
+ * only long runs of non-zero bytes are scanned a 32-bit word at a time.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LumynLabs
+{
+
+  namespace Cobs
+  {
+
+    /** Longest run of non-zero bytes one code byte can describe. */
+    constexpr size_t kMaxBlock = 254;
+
+    /** Frame delimiter appended after an encoded frame. */
+    constexpr uint8_t kDelimiter = 0x00;
+
+    /** Worst-case bytes added by encoding @p length payload bytes. */
+    constexpr size_t maxOverhead(size_t length) { return length / kMaxBlock + 1; }
+
+    /** Worst-case encoded size, excluding the trailing delimiter. */
+    constexpr size_t maxEncodedSize(size_t length) { return length + maxOverhead(length); }
+
+    namespace detail
+    {
+      constexpr uint32_t kLowBits = 0x01010101u;
+      constexpr uint32_t kHighBits = 0x80808080u;
+
+      /**
+       * Runs shorter than this are scanned and copied a byte at a time.
+       * Zero-heavy payloads (sparse sensor blocks, dark LED pixels) are
+       * mostly short runs, where the word scan and memmove call cost more
+       * than they save.
+       */
+      constexpr size_t kShortRun = 16;
+
+      /** Non-zero if any byte of @p word is zero. */
+      constexpr uint32_t hasZeroByte(uint32_t word) { return (word - kLowBits) & ~word & kHighBits; }
+
+      /**
+       * @brief Offset of the first zero byte in [data, data + length)
+       * @return @p length if there is none
+       */
+      inline size_t findZero(const uint8_t *data, size_t length)
+      {
+        size_t i = 0;
+
+        // Cortex-M0+ faults on unaligned word loads; walk to a boundary first.
+        while (i < length && (reinterpret_cast<uintptr_t>(data + i) & 3u) != 0)
+        {
+          if (data[i] == 0)
+          {
+            return i;
+          }
+          ++i;
+        }
+
+        while (i + 4 <= length)
+        {
+          uint32_t word;
+          std::memcpy(&word, __builtin_assume_aligned(data + i, 4), sizeof(word));
+          if (hasZeroByte(word))
+          {
+            break;
+          }
+          i += 4;
+        }
+
+        while (i < length && data[i] != 0)
+        {
+          ++i;
+        }
+        return i;
+      }
+
+      /**
+       * @brief Copy exactly @p length bytes that must all be non-zero
+       * @return false if a zero byte was found
+       */
+      inline bool copyNonZero(uint8_t *dst, const uint8_t *src, size_t length)
+      {
+        size_t run = 0;
+        const size_t head = length < kShortRun ? length : kShortRun;
+        while (run < head && src[run] != 0)
+        {
+          dst[run] = src[run];
+          ++run;
+        }
+        if (run < head || run == length)
+        {
+          return run == length;
+        }
+        const size_t rest = findZero(src + run, length - run);
+        std::memmove(dst + run, src + run, rest);
+        return run + rest == length;
+      }
+
+      /**
+       * @brief Byte-loop encoder shared by encode() and encodeInPlace()
+       *
+       * Bytes are copied one at a time. Once a run reaches kShortRun
+       * non-zero bytes, the rest of it is located with the word scan and
+       * moved with one memmove; only long runs take that path, so
+       * zero-heavy payloads run at byte-loop speed. @p out may overlap
+       * @p in if it lies at least one byte before it.
+       */
+      inline size_t encodeBytes(const uint8_t *in, size_t length, uint8_t *out)
+      {
+        size_t code = 0;
+        size_t write = 1;
+        size_t run = 0;
+        size_t read = 0;
+
+        while (read < length)
+        {
+          const uint8_t byte = in[read++];
+          if (byte == 0)
+          {
+            out[code] = static_cast<uint8_t>(run + 1);
+            code = write++;
+            run = 0;
+            continue;
+          }
+          out[write++] = byte;
+          if (++run != kShortRun)
+          {
+            continue;
+          }
+
+          // Long run: scan and move the rest of the block a word at a time.
+          const size_t remaining = length - read;
+          const size_t room = kMaxBlock - run;
+          const size_t rest = findZero(in + read, remaining < room ? remaining : room);
+          std::memmove(out + write, in + read, rest);
+          write += rest;
+          read += rest;
+          run += rest;
+          if (run == kMaxBlock)
+          {
+            out[code] = static_cast<uint8_t>(kMaxBlock + 1);
+            if (read == length)
+            {
+              // No empty block after a full one at the end.
+              return write;
+            }
+            code = write++;
+            run = 0;
+          }
+        }
+        out[code] = static_cast<uint8_t>(run + 1);
+        return write;
+      }
+    } // namespace detail
+
+    /**
+     * @brief Encode a payload in place
+     *
+     * The payload must start @p reserve bytes into @p buffer. The encoded
+     * frame is written from @p buffer[0]; the payload region is consumed.
+     * Data moves only towards the front of the buffer, so the write
+     * position never overtakes the unread payload.
+     *
+     * @param buffer  Start of the frame storage
+     * @param reserve Bytes reserved before the payload, at least maxOverhead(length)
+     * @param length  Payload length
+     * @return Encoded length (without delimiter), or 0 if @p reserve is too small
+     */
+    inline size_t encodeInPlace(uint8_t *buffer, size_t reserve, size_t length)
+    {
+      if (reserve < maxOverhead(length))
+      {
+        return 0;
+      }
+
+      return detail::encodeBytes(buffer + reserve, length, buffer);
+    }
+
+    /**
+     * @brief Encode into a separate buffer
+     *
+     * @param in     Payload
+     * @param length Payload length
+     * @param out    Destination, at least maxEncodedSize(length) bytes
+     * @return Encoded length (without delimiter)
+     */
+    inline size_t encode(const uint8_t *in, size_t length, uint8_t *out)
+    {
+      return detail::encodeBytes(in, length, out);
+    }
+
+    /**
+     * @brief Decode a frame in place
+     *
+     * The decoded payload is written from @p buffer[0]. A trailing
+     * delimiter, if present, is ignored.
+     *
+     * @param buffer Encoded frame
+     * @param length Encoded length
+     * @return Decoded length, or 0 if the frame is empty or malformed
+     */
+    inline size_t decodeInPlace(uint8_t *buffer, size_t length)
+    {
+      if (length > 0 && buffer[length - 1] == kDelimiter)
+      {
+        --length;
+      }
+
+      size_t read = 0;
+      size_t write = 0;
+
+      while (read < length)
+      {
+        const uint8_t code = buffer[read];
+        if (code == 0)
+        {
+          return 0;
+        }
+
+        const size_t run = code - 1u;
+        if (read + 1 + run > length)
+        {
+          return 0;
+        }
+        if (!detail::copyNonZero(buffer + write, buffer + read + 1, run))
+        {
+          return 0;
+        }
+        write += run;
+        read += 1 + run;
+
+        if (code != kMaxBlock + 1 && read < length)
+        {
+          buffer[write++] = 0;
+        }
+      }
+      return write;
+    }
+
+    /**
+     * @brief Fixed frame storage with the encode overhead reserved up front
+     *
+     * Build the payload through payload(), then call encode() to turn the
+     * storage into a delimited wire frame without copying.
+     *
+     * @tparam MaxPayload Largest payload the frame must hold
+     */
+    template <size_t MaxPayload>
+    class Frame
+    {
+    public:
+      static constexpr size_t kReserve = maxOverhead(MaxPayload);
+
+      /** Writable payload area, MaxPayload bytes long. */
+      uint8_t *payload() { return _storage + kReserve; }
+      static constexpr size_t payloadCapacity() { return MaxPayload; }
+
+      /**
+       * @brief Encode the first @p length payload bytes and append the delimiter
+       * @return Wire frame length including the delimiter, or 0 if too long
+       */
+      size_t encode(size_t length)
+      {
+        if (length > MaxPayload)
+        {
+          return 0;
+        }
+        const size_t encoded = encodeInPlace(_storage, kReserve, length);
+        _storage[encoded] = kDelimiter;
+        return encoded + 1;
+      }
+
+      /** Start of the encoded frame after encode(). */
+      const uint8_t *wire() const { return _storage; }
+
+    private:
+      uint8_t _storage[kReserve + MaxPayload + 1];
+    };
+
+  } // namespace Cobs
+
+} // namespace LumynLabs
@@ -0,0 +1,143 @@
+/**
+ * @file CobsFrameReader.h
+ * @brief Span-oriented COBS frame reassembly for receive paths
+ *
+ * Feeds contiguous receive spans (for example from UartDmaRx or
+ * StreamSpanRx) and hands back decoded frames. Each span is scanned for
+ * delimiters a word at a time and copied in bulk, instead of being
+ * processed one byte at a time.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Cobs.h"
+#include "RxSpanRing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Reassembles and decodes COBS frames from receive spans
+   *
+   * @tparam MaxFrame Largest encoded frame accepted; longer frames are
+   *                  discarded up to the next delimiter and counted.
+   *
+   * @code
+   * LumynLabs::CobsFrameReader<600> reader;
+   * LumynLabs::RxSpan spans[2];
+   * size_t n = ring.peek(spans);
+   * for (size_t i = 0; i < n; ++i) {
+   *   reader.feed(spans[i], [](const uint8_t* frame, size_t len) { ... });
+   *   ring.consume(spans[i].length);
+   * }
+   * @endcode
+   */
+  template <size_t MaxFrame>
+  class CobsFrameReader
+  {
+  public:
+    /**
+     * @brief Consume one span, invoking @p onFrame for each complete frame
+     *
+     * @p onFrame is called as onFrame(const uint8_t* data, size_t length)
+     * with a pointer that is only valid for the duration of the call.
+     */
+    template <typename OnFrame>
+    void feed(const RxSpan &span, OnFrame &&onFrame)
+    {
+      const uint8_t *data = span.data;
+      size_t remaining = span.length;
+
+      while (remaining > 0)
+      {
+        const size_t run = Cobs::detail::findZero(data, remaining);
+        append(data, run);
+
+        if (run == remaining)
+        {
+          return;
+        }
+
+        // Delimiter found: close the frame and skip past it.
+        finishFrame(onFrame);
+        data += run + 1;
+        remaining -= run + 1;
+      }
+    }
+
+    /** Drop any partially received frame. */
+    void reset()
+    {
+      _length = 0;
+      _discarding = false;
+    }
+
+    uint32_t frameCount() const { return _frames; }
+
+    /** Valid frames with an empty payload; these are not passed to onFrame. */
+    uint32_t emptyCount() const { return _empty; }
+
+    uint32_t oversizeCount() const { return _oversize; }
+    uint32_t malformedCount() const { return _malformed; }
+
+  private:
+    void append(const uint8_t *data, size_t length)
+    {
+      if (_discarding || length == 0)
+      {
+        return;
+      }
+      if (_length + length > MaxFrame)
+      {
+        _discarding = true;
+        return;
+      }
+      std::memcpy(_frame + _length, data, length);
+      _length += length;
+    }
+
+    template <typename OnFrame>
+    void finishFrame(OnFrame &onFrame)
+    {
+      if (_discarding)
+      {
+        ++_oversize;
+      }
+      else if (_length == 1 && _frame[0] == 1)
+      {
+        // 01 00 is the only encoding of an empty payload.
+        ++_empty;
+      }
+      else if (_length > 0)
+      {
+        const size_t decoded = Cobs::decodeInPlace(_frame, _length);
+        if (decoded > 0)
+        {
+          ++_frames;
+          onFrame(static_cast<const uint8_t *>(_frame), decoded);
+        }
+        else
+        {
+          ++_malformed;
+        }
+      }
+      reset();
+    }
+
+    uint8_t _frame[MaxFrame];
+    size_t _length = 0;
+    bool _discarding = false;
+    uint32_t _frames = 0;
+    uint32_t _empty = 0;
+    uint32_t _oversize = 0;
+    uint32_t _malformed = 0;
+  };
+
+} // namespace LumynLabs
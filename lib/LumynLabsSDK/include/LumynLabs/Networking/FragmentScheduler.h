@@ -0,0 +1,443 @@
+/**
+ * @file FragmentScheduler.h
+ * @brief Interleaved, windowed fragmentation of concurrent transmissions
+ *
+ * Several transmissions can be in flight on one link at once. Each is cut
+ * into MTU-sized fragments tagged with a small header, and fragments are
+ * chosen by TxClass in strict priority order, so a short command is never queued behind the
+ * remainder of a large upload: it waits at most one fragment.
+ *
+ * FragmentAssembler on the receiving side follows each transmission by
+ * its ID and hands fragments back in order. A cancelled transmission is
+ * closed with an abort fragment so the receiver frees its slot.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "TxGather.h"
+#include "TxScheduler.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Header carried by every fragment (8 bytes, little endian)
+   */
+  struct FragmentHeader
+  {
+    static constexpr uint8_t kFirst = 0x01;
+    static constexpr uint8_t kLast = 0x02;
+    static constexpr uint8_t kAbort = 0x04; ///< Sender cancelled; no payload
+
+    uint8_t id;         ///< Transmission ID, unique among those in flight
+    uint8_t flags;      ///< kFirst / kLast / kAbort
+    uint16_t index;     ///< Fragment number within the transmission, wraps at 65536
+    uint32_t totalSize; ///< Full transmission length
+  };
+  static_assert(sizeof(FragmentHeader) == 8, "FragmentHeader is part of the wire format");
+
+  /**
+   * @brief Sender-side scheduler for concurrent transmissions
+   *
+   * Not thread-safe; drive it from the link's transmit task.
+   *
+   * @tparam MaxInFlight Transmissions that may be in progress at once
+   *
+   * @code
+   * LumynLabs::FragmentScheduler<4> sched(maxMTU - sizeof(LumynLabs::FragmentHeader));
+   * sched.submit(config, configLen, LumynLabs::TxClass::Bulk);
+   * sched.submit(&ledCmd, sizeof(ledCmd), LumynLabs::TxClass::Events);
+   *
+   * LumynLabs::FragmentHeader hdr;
+   * LumynLabs::TxSegment slice;
+   * while (sched.next(hdr, slice)) {
+   *   LumynLabs::TxGather<2> frame;
+   *   frame.add(&hdr, sizeof(hdr));
+   *   frame.add(slice.data, slice.length);
+   *   LumynLabs::encodeGather(frame, Serial1);
+   * }
+   * @endcode
+   */
+  template <size_t MaxInFlight = 4>
+  class FragmentScheduler
+  {
+    static_assert(MaxInFlight > 0 && MaxInFlight <= 255, "MaxInFlight out of range");
+
+  public:
+    /** Called once a transmission's last fragment has been handed out. */
+    using CompleteCallback = void (*)(uint8_t id, void *arg);
+
+    /**
+     * @param fragmentPayload Payload bytes per fragment (link MTU minus headers)
+     * @param window          Max unacknowledged fragments on the link; 0 = no limit
+     */
+    explicit FragmentScheduler(uint16_t fragmentPayload, uint16_t window = 0)
+        : _fragmentPayload(fragmentPayload ? fragmentPayload : 1), _window(window) {}
+
+    /**
+     * @brief Queue a transmission
+     *
+     * @p data must stay valid until the completion callback runs or the
+     * transmission is cancelled. IDs still in flight (including one whose
+     * abort fragment has not gone out yet) are never handed out again.
+     *
+     * @param id Receives the transmission ID
+     * @return false if all in-flight slots are busy
+     */
+    bool submit(const void *data, uint32_t length, TxClass priority, uint8_t *id = nullptr)
+    {
+      for (size_t i = 0; i < MaxInFlight; ++i)
+      {
+        Slot &slot = _slots[i];
+        if (slot.active)
+        {
+          continue;
+        }
+        // A free slot means at most MaxInFlight - 1 IDs are taken, so this
+        // finds one within MaxInFlight steps.
+        while (idInUse(_nextId))
+        {
+          _nextId = static_cast<uint8_t>(_nextId + 1);
+        }
+        slot.active = true;
+        slot.aborting = false;
+        slot.data = static_cast<const uint8_t *>(data);
+        slot.length = length;
+        slot.offset = 0;
+        slot.index = 0;
+        slot.priority = priority;
+        slot.id = _nextId;
+        slot.order = _submitOrder++;
+        _nextId = static_cast<uint8_t>(_nextId + 1);
+        if (id)
+        {
+          *id = slot.id;
+        }
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * @brief Produce the next fragment to put on the wire
+     *
+     * @param header  Filled with the fragment header
+     * @param payload Slice of the submitted buffer, referenced in place
+     * @return false if nothing is queued or the window is full
+     */
+    bool next(FragmentHeader &header, TxSegment &payload)
+    {
+      if (_window != 0 && _outstanding >= _window)
+      {
+        return false;
+      }
+
+      Slot *slot = pick();
+      if (!slot)
+      {
+        return false;
+      }
+
+      if (slot->aborting)
+      {
+        header = {slot->id, FragmentHeader::kAbort, slot->index, slot->length};
+        payload = {nullptr, 0};
+        slot->active = false;
+        ++_outstanding;
+        _lastServed[static_cast<size_t>(slot->priority)] = slot->order;
+        return true;
+      }
+
+      const uint32_t remaining = slot->length - slot->offset;
+      const uint32_t chunk = remaining < _fragmentPayload ? remaining : _fragmentPayload;
+
+      header.id = slot->id;
+      // Keyed off the byte offset: index is 16 bits and wraps on long
+      // transmissions.
+      header.flags = (slot->offset == 0 ? FragmentHeader::kFirst : 0) |
+                     (chunk == remaining ? FragmentHeader::kLast : 0);
+      header.index = slot->index;
+      header.totalSize = slot->length;
+      payload = {slot->data + slot->offset, chunk};
+
+      slot->offset += chunk;
+      ++slot->index;
+      ++_outstanding;
+      _lastServed[static_cast<size_t>(slot->priority)] = slot->order;
+
+      if (header.flags & FragmentHeader::kLast)
+      {
+        slot->active = false;
+        if (_onComplete)
+        {
+          _onComplete(slot->id, _completeArg);
+        }
+      }
+      return true;
+    }
+
+    /** Return window credit for @p fragments acknowledged by the receiver. */
+    void acknowledge(uint16_t fragments)
+    {
+      _outstanding = fragments >= _outstanding ? 0 : _outstanding - fragments;
+    }
+
+    /**
+     * @brief Drop a transmission that has not finished sending
+     *
+     * Its buffer is no longer referenced once this returns. If fragments
+     * of it were already sent, the next fragment picked for it is an
+     * abort fragment (FragmentHeader::kAbort, no payload) that frees the
+     * receiver's slot; the ID stays reserved until then.
+     */
+    bool cancel(uint8_t id)
+    {
+      for (auto &slot : _slots)
+      {
+        if (slot.active && !slot.aborting && slot.id == id)
+        {
+          slot.data = nullptr;
+          if (slot.offset == 0)
+          {
+            // Nothing sent yet, so the receiver has nothing to free.
+            slot.active = false;
+          }
+          else
+          {
+            slot.aborting = true;
+          }
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void onComplete(CompleteCallback cb, void *arg = nullptr)
+    {
+      _onComplete = cb;
+      _completeArg = arg;
+    }
+
+    void setWindow(uint16_t window) { _window = window; }
+
+    size_t inFlight() const
+    {
+      size_t n = 0;
+      for (const auto &slot : _slots)
+      {
+        n += slot.active;
+      }
+      return n;
+    }
+
+    uint16_t outstanding() const { return _outstanding; }
+
+  private:
+    struct Slot
+    {
+      bool active = false;
+      bool aborting = false;
+      const uint8_t *data = nullptr;
+      uint32_t length = 0;
+      uint32_t offset = 0;
+      uint16_t index = 0;
+      TxClass priority = TxClass::Telemetry;
+      uint8_t id = 0;
+      uint32_t order = 0;
+    };
+
+    bool idInUse(uint8_t id) const
+    {
+      for (const auto &slot : _slots)
+      {
+        if (slot.active && slot.id == id)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Strict priority between classes; round-robin by submit order within one.
+    Slot *pick()
+    {
+      for (size_t cls = 0; cls < kTxClassCount; ++cls)
+      {
+        Slot *after = nullptr;
+        Slot *first = nullptr;
+        for (auto &slot : _slots)
+        {
+          if (!slot.active || static_cast<size_t>(slot.priority) != cls)
+          {
+            continue;
+          }
+          if (!first || static_cast<int32_t>(slot.order - first->order) < 0)
+          {
+            first = &slot;
+          }
+          if (static_cast<int32_t>(slot.order - _lastServed[cls]) > 0 &&
+              (!after || static_cast<int32_t>(slot.order - after->order) < 0))
+          {
+            after = &slot;
+          }
+        }
+        if (after || first)
+        {
+          return after ? after : first;
+        }
+      }
+      return nullptr;
+    }
+
+    Slot _slots[MaxInFlight];
+    uint32_t _lastServed[kTxClassCount] = {};
+    uint32_t _submitOrder = 1;
+    uint16_t _fragmentPayload;
+    uint16_t _window;
+    uint16_t _outstanding = 0;
+    uint8_t _nextId = 0;
+    CompleteCallback _onComplete = nullptr;
+    void *_completeArg = nullptr;
+  };
+
+  /**
+   * @brief Receiver-side tracking of interleaved transmissions
+   *
+   * Fragments of one transmission must arrive in order (true for a single
+   * serial link); fragments of different transmissions may interleave.
+   * A gap, an unexpected first fragment or an abort fragment ends that
+   * transmission and frees its slot.
+   *
+   * @tparam MaxInFlight Transmissions tracked at once
+   */
+  template <size_t MaxInFlight = 4>
+  class FragmentAssembler
+  {
+  public:
+    enum class Result : uint8_t
+    {
+      Accepted, ///< In-order fragment; @p offset tells where it belongs
+      Complete, ///< Last fragment of the transmission
+      Dropped,  ///< Out of order, unknown ID or no free slot
+      Aborted,  ///< The sender cancelled the transmission; discard what was received
+    };
+
+    /**
+     * @brief Validate a fragment and report its offset in the transmission
+     *
+     * @param header       Fragment header
+     * @param payloadSize  Payload bytes in this fragment
+     * @param offset       Receives the byte offset of this fragment
+     */
+    Result accept(const FragmentHeader &header, uint32_t payloadSize, uint32_t &offset)
+    {
+      Track *track = find(header.id);
+
+      if (header.flags & FragmentHeader::kAbort)
+      {
+        if (!track)
+        {
+          return Result::Dropped;
+        }
+        track->active = false;
+        ++_aborted;
+        return Result::Aborted;
+      }
+
+      if (header.flags & FragmentHeader::kFirst)
+      {
+        if (!track)
+        {
+          track = allocate();
+        }
+        if (!track || header.index != 0)
+        {
+          ++_dropped;
+          return Result::Dropped;
+        }
+        *track = {true, header.id, 0, 0, header.totalSize};
+      }
+      else if (!track || header.index != track->nextIndex)
+      {
+        if (track)
+        {
+          track->active = false;
+        }
+        ++_dropped;
+        return Result::Dropped;
+      }
+
+      if (track->received + payloadSize > track->totalSize)
+      {
+        track->active = false;
+        ++_dropped;
+        return Result::Dropped;
+      }
+
+      offset = track->received;
+      track->received += payloadSize;
+      ++track->nextIndex;
+
+      if (header.flags & FragmentHeader::kLast)
+      {
+        const bool whole = track->received == track->totalSize;
+        track->active = false;
+        if (!whole)
+        {
+          ++_dropped;
+          return Result::Dropped;
+        }
+        return Result::Complete;
+      }
+      return Result::Accepted;
+    }
+
+    uint32_t droppedCount() const { return _dropped; }
+    uint32_t abortedCount() const { return _aborted; }
+
+  private:
+    struct Track
+    {
+      bool active;
+      uint8_t id;
+      uint16_t nextIndex;
+      uint32_t received;
+      uint32_t totalSize;
+    };
+
+    Track *find(uint8_t id)
+    {
+      for (auto &t : _tracks)
+      {
+        if (t.active && t.id == id)
+        {
+          return &t;
+        }
+      }
+      return nullptr;
+    }
+
+    Track *allocate()
+    {
+      for (auto &t : _tracks)
+      {
+        if (!t.active)
+        {
+          return &t;
+        }
+      }
+      return nullptr;
+    }
+
+    Track _tracks[MaxInFlight] = {};
+    uint32_t _dropped = 0;
+    uint32_t _aborted = 0;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,146 @@
+/**
+ * @file RxSpanRing.h
+ * @brief Receive ring consumed as contiguous spans instead of single bytes
+ *
+ * The producer (normally a DMA channel, see UartDmaRx.h) writes into the
+ * ring storage and reports how many bytes it has written in total. The
+ * consumer takes whatever is available as at most two contiguous spans
+ * (two only when the data wraps the end of the ring) and releases them
+ * with consume(). There is no per-byte push/pop and no per-byte wakeup.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief A contiguous run of received bytes
+   */
+  struct RxSpan
+  {
+    const uint8_t *data;
+    size_t length;
+  };
+
+  /**
+   * @brief Ring memory, aligned to its own size
+   *
+   * The alignment lets an RP2040 DMA channel wrap its write address in
+   * hardware. It is kept out of RxSpanRing and the classes that embed one
+   * so their own size is not rounded up to it: declare it static, next to
+   * its user.
+   */
+  template <size_t Size>
+  struct RxRingStorage
+  {
+    alignas(Size) uint8_t bytes[Size];
+  };
+
+  /**
+   * @brief Single-producer, single-consumer ring read in spans
+   *
+   * @tparam Size Ring size in bytes, a power of two from 256 to 32768
+   */
+  template <size_t Size>
+  class RxSpanRing
+  {
+    static_assert((Size & (Size - 1)) == 0 && Size >= 256 && Size <= 32768,
+                  "RxSpanRing size must be a power of two between 256 and 32768");
+
+  public:
+    explicit RxSpanRing(RxRingStorage<Size> &storage) : _buffer(storage.bytes) {}
+    RxSpanRing(const RxSpanRing &) = delete;
+    RxSpanRing &operator=(const RxSpanRing &) = delete;
+
+    /** Raw storage for the producer. */
+    uint8_t *storage() { return _buffer; }
+
+    static constexpr size_t size() { return Size; }
+
+    /** log2(Size), as needed by the DMA ring configuration. */
+    static constexpr uint8_t sizeBits()
+    {
+      uint8_t bits = 0;
+      while ((size_t{1} << bits) < Size)
+      {
+        ++bits;
+      }
+      return bits;
+    }
+
+    /**
+     * @brief Producer side: report the running total of bytes written
+     *
+     * The total wraps at 2^32; only differences are meaningful.
+     */
+    void publish(uint32_t totalWritten) { _written.store(totalWritten, std::memory_order_release); }
+
+    /**
+     * @brief Consumer side: get the unread data as up to two spans
+     *
+     * If the producer has lapped the consumer, the lost bytes are counted
+     * in overrunBytes() and reading resumes at the oldest intact byte.
+     *
+     * @param spans Receives the spans, oldest first
+     * @return Number of spans filled (0, 1 or 2)
+     */
+    size_t peek(RxSpan (&spans)[2])
+    {
+      const uint32_t written = _written.load(std::memory_order_acquire);
+      uint32_t pending = written - _read;
+
+      // Treat a completely full ring as lapped: the byte at the read index
+      // may already be in the process of being overwritten.
+      if (pending >= Size)
+      {
+        const uint32_t keep = Size / 2;
+        _overrunBytes += pending - keep;
+        _read = written - keep;
+        pending = keep;
+      }
+
+      if (pending == 0)
+      {
+        return 0;
+      }
+
+      const size_t start = _read & (Size - 1);
+      const size_t first = (Size - start) < pending ? (Size - start) : pending;
+      spans[0] = {_buffer + start, first};
+      if (first == pending)
+      {
+        return 1;
+      }
+      spans[1] = {_buffer, pending - first};
+      return 2;
+    }
+
+    /** Consumer side: release @p count bytes returned by peek(). */
+    void consume(size_t count) { _read += static_cast<uint32_t>(count); }
+
+    /** Bytes available to read right now. */
+    size_t available() const
+    {
+      const uint32_t pending = _written.load(std::memory_order_acquire) - _read;
+      return pending > Size ? Size : pending;
+    }
+
+    /** Bytes lost because the consumer fell more than a ring behind. */
+    uint32_t overrunBytes() const { return _overrunBytes; }
+
+  private:
+    uint8_t *_buffer;
+    std::atomic<uint32_t> _written{0};
+    uint32_t _read = 0;
+    uint32_t _overrunBytes = 0;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,101 @@
+/**
+ * @file StreamSpanRx.h
+ * @brief Span-based receive path for stream ports such as USB CDC
+ *
+ * USB has no DMA channel that can be pointed at a ring: TinyUSB already
+ * holds received packets in its own FIFO. StreamSpanRx drains that FIFO
+ * with bulk read(buffer, length) calls straight into the free part of an
+ * RxSpanRing, so the consumer sees the same spans as with UartDmaRx and
+ * can feed them to a CobsFrameReader. A poll costs one or two read()
+ * calls however many bytes have arrived, instead of one call per byte.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "RxSpanRing.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Fills an RxSpanRing from a stream port in bulk
+   *
+   * The ring is never overrun. When it is full, poll() leaves the data in
+   * the port, and USB flow control holds the host off until there is room.
+   * poll(), peek() and consume() must be called from the same task.
+   *
+   * @tparam RingSize Ring size in bytes (power of two, 256..32768)
+   * @tparam Port     Anything with int available() and
+   *                  size_t read(uint8_t *buffer, size_t length), such as
+   *                  the TinyUSB Serial (Adafruit_USBD_CDC)
+   *
+   * @code
+   * static LumynLabs::RxRingStorage<4096> usbRing;
+   * static LumynLabs::StreamSpanRx<4096, Adafruit_USBD_CDC> usbRx(usbRing, Serial);
+   *
+   * // Receive task
+   * usbRx.poll();
+   * LumynLabs::RxSpan spans[2];
+   * size_t n = usbRx.peek(spans);
+   * ...
+   * usbRx.consume(bytesUsed);
+   * @endcode
+   */
+  template <size_t RingSize, typename Port>
+  class StreamSpanRx
+  {
+  public:
+    StreamSpanRx(RxRingStorage<RingSize> &storage, Port &port) : _ring(storage), _port(port) {}
+    StreamSpanRx(const StreamSpanRx &) = delete;
+    StreamSpanRx &operator=(const StreamSpanRx &) = delete;
+
+    /**
+     * @brief Move everything the port holds into the ring, as far as it fits
+     * @return Bytes added to the ring
+     */
+    size_t poll()
+    {
+      size_t added = 0;
+      for (;;)
+      {
+        const int ready = _port.available();
+        // One byte stays free: RxSpanRing treats a full ring as lapped.
+        const size_t room = RingSize - 1 - _ring.available();
+        if (ready <= 0 || room == 0)
+        {
+          return added;
+        }
+        const size_t start = _written & (RingSize - 1);
+        size_t want = RingSize - start < room ? RingSize - start : room;
+        want = static_cast<size_t>(ready) < want ? static_cast<size_t>(ready) : want;
+        const size_t got = _port.read(_ring.storage() + start, want);
+        if (got == 0)
+        {
+          return added;
+        }
+        _written += static_cast<uint32_t>(got);
+        _ring.publish(_written);
+        added += got;
+      }
+    }
+
+    /** Get the unread data as up to two contiguous spans. */
+    size_t peek(RxSpan (&spans)[2]) { return _ring.peek(spans); }
+
+    void consume(size_t count) { _ring.consume(count); }
+
+    size_t available() const { return _ring.available(); }
+
+  private:
+    RxSpanRing<RingSize> _ring;
+    Port &_port;
+    uint32_t _written = 0;
+  };
+
+} // namespace LumynLabs
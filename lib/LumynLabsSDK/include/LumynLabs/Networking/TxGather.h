@@ -0,0 +1,298 @@
+/**
+ * @file TxGather.h
+ * @brief Scatter/gather transmit path with streaming COBS encoding
+ *
+ * A frame is described as a short list of segments (header, payload slice,
+ * trailer) that stay where they already live. The encoder scans ahead for
+ * zero bytes across segment boundaries and writes each long run straight
+ * from its segment to the output, so no layer assembles the frame in an
+ * intermediate buffer. Short runs are batched with their code bytes in a
+ * small stack buffer, and TxGatherStats counts those copies per layer.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "Cobs.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LumynLabs
+{
+
+  /** Runs at least this long are written straight from their segment. */
+  constexpr size_t kTxDirectRun = 32;
+
+  /** Stack buffer for code bytes, short runs and the delimiter. */
+  constexpr size_t kTxStageSize = 64;
+
+  /**
+   * @brief One piece of an outgoing frame, referenced in place
+   */
+  struct TxSegment
+  {
+    const uint8_t *data;
+    size_t length;
+  };
+
+  /**
+   * @brief Fixed-capacity segment list for one frame
+   *
+   * @tparam MaxSegments Maximum number of segments
+   */
+  template <size_t MaxSegments = 4>
+  class TxGather
+  {
+  public:
+    /**
+     * @brief Append a segment; empty segments are ignored
+     * @return false if the list is full
+     */
+    bool add(const void *data, size_t length)
+    {
+      if (length == 0)
+      {
+        return true;
+      }
+      if (_count >= MaxSegments)
+      {
+        return false;
+      }
+      _segments[_count++] = {static_cast<const uint8_t *>(data), length};
+      return true;
+    }
+
+    void clear() { _count = 0; }
+
+    const TxSegment *segments() const { return _segments; }
+    size_t count() const { return _count; }
+
+    /** Total unencoded length of all segments. */
+    size_t length() const
+    {
+      size_t total = 0;
+      for (size_t i = 0; i < _count; ++i)
+      {
+        total += _segments[i].length;
+      }
+      return total;
+    }
+
+  private:
+    TxSegment _segments[MaxSegments] = {};
+    size_t _count = 0;
+  };
+
+  /** Layers of the transmit path that may copy frame bytes. */
+  enum class TxLayer : uint8_t
+  {
+    Build,   ///< Assembling the frame from its parts (TxGather itself never copies)
+    Encoder, ///< encodeGather() staging short runs
+    Sink,    ///< Adapter or driver buffering, reported by the caller
+    Count,
+  };
+
+  /**
+   * @brief Counters for the gather transmit path
+   *
+   * Long runs go from the caller's segments straight to the sink. Short
+   * runs are staged together with their code bytes so each sink write
+   * carries more than a byte or two; those copies are counted under
+   * TxLayer::Encoder. Layers outside encodeGather() report their own
+   * copies with noteCopy(), so the counters cover the whole path.
+   * wireBytes - payloadBytes is the framing overhead.
+   */
+  struct TxGatherStats
+  {
+    uint32_t frames = 0;       ///< Frames encoded
+    uint32_t payloadBytes = 0; ///< Segment bytes read
+    uint32_t wireBytes = 0;    ///< Bytes handed to the sink, including delimiters
+    uint32_t sinkWrites = 0;   ///< Calls made to the sink
+    uint32_t copies[static_cast<size_t>(TxLayer::Count)] = {};      ///< Copy operations per layer
+    uint32_t copiedBytes[static_cast<size_t>(TxLayer::Count)] = {}; ///< Bytes copied per layer
+
+    void noteCopy(TxLayer layer, size_t bytes)
+    {
+      ++copies[static_cast<size_t>(layer)];
+      copiedBytes[static_cast<size_t>(layer)] += static_cast<uint32_t>(bytes);
+    }
+  };
+
+  /**
+   * @brief COBS-encode a segment list directly into a sink
+   *
+   * @p sink must provide write(const uint8_t*, size_t), as Arduino's
+   * Print/Stream classes do. Runs of kTxDirectRun bytes or more are handed
+   * to it as slices of the original segments. Shorter runs, code bytes and
+   * the delimiter are gathered in a small stack buffer and written
+   * together.
+   *
+   * @param segments Segment list
+   * @param count    Number of segments
+   * @param sink     Output
+   * @param stats    Optional counters to update
+   * @param delimit  Append the frame delimiter
+   * @return Bytes written to the sink
+   */
+  template <typename Sink>
+  size_t encodeGather(const TxSegment *segments, size_t count, Sink &sink,
+                      TxGatherStats *stats = nullptr, bool delimit = true)
+  {
+    struct Cursor
+    {
+      size_t segment;
+      size_t offset;
+    };
+
+    const auto skipEmpty = [&](Cursor &c)
+    {
+      while (c.segment < count && c.offset == segments[c.segment].length)
+      {
+        ++c.segment;
+        c.offset = 0;
+      }
+    };
+
+    size_t written = 0;
+    uint32_t writes = 0;
+    size_t payload = 0;
+    uint32_t copies = 0;
+    size_t copied = 0;
+    uint8_t stage[kTxStageSize];
+    size_t staged = 0;
+    Cursor cursor{0, 0};
+    skipEmpty(cursor);
+
+    const auto flush = [&]
+    {
+      if (staged > 0)
+      {
+        sink.write(stage, staged);
+        ++writes;
+        written += staged;
+        staged = 0;
+      }
+    };
+
+    // Walk @p run bytes from the cursor, one piece per segment.
+    const auto forEachPiece = [&](size_t run, auto &&emit)
+    {
+      while (run > 0)
+      {
+        const TxSegment &seg = segments[cursor.segment];
+        const size_t avail = seg.length - cursor.offset;
+        const size_t piece = avail < run ? avail : run;
+        emit(seg.data + cursor.offset, piece);
+        cursor.offset += piece;
+        run -= piece;
+        skipEmpty(cursor);
+      }
+    };
+
+    for (;;)
+    {
+      // Measure the next run across segment boundaries.
+      Cursor scan = cursor;
+      size_t run = 0;
+      bool hitZero = false;
+      while (run < Cobs::kMaxBlock && scan.segment < count)
+      {
+        const TxSegment &seg = segments[scan.segment];
+        const size_t avail = seg.length - scan.offset;
+        const size_t want = avail < Cobs::kMaxBlock - run ? avail : Cobs::kMaxBlock - run;
+        const size_t z = Cobs::detail::findZero(seg.data + scan.offset, want);
+        run += z;
+        scan.offset += z;
+        if (z < want)
+        {
+          hitZero = true;
+          break;
+        }
+        skipEmpty(scan);
+      }
+
+      if (run < kTxDirectRun)
+      {
+        // Short run: stage it behind its code byte.
+        if (staged + 1 + run > kTxStageSize)
+        {
+          flush();
+        }
+        stage[staged++] = static_cast<uint8_t>(run + 1);
+        forEachPiece(run, [&](const uint8_t *data, size_t length)
+                     {
+                       std::memcpy(stage + staged, data, length);
+                       staged += length;
+                       ++copies;
+                       copied += length;
+                     });
+      }
+      else
+      {
+        // Long run: the code byte rides with whatever is staged, then the
+        // run goes straight from the caller's memory.
+        if (staged == kTxStageSize)
+        {
+          flush();
+        }
+        stage[staged++] = static_cast<uint8_t>(run + 1);
+        flush();
+        forEachPiece(run, [&](const uint8_t *data, size_t length)
+                     {
+                       sink.write(data, length);
+                       ++writes;
+                       written += length;
+                     });
+      }
+      payload += run;
+
+      if (hitZero)
+      {
+        ++cursor.offset;
+        ++payload;
+        skipEmpty(cursor);
+        continue;
+      }
+      if (cursor.segment >= count)
+      {
+        break;
+      }
+    }
+
+    if (delimit)
+    {
+      if (staged == kTxStageSize)
+      {
+        flush();
+      }
+      stage[staged++] = Cobs::kDelimiter;
+    }
+    flush();
+
+    if (stats)
+    {
+      ++stats->frames;
+      stats->payloadBytes += static_cast<uint32_t>(payload);
+      stats->wireBytes += static_cast<uint32_t>(written);
+      stats->sinkWrites += writes;
+      stats->copies[static_cast<size_t>(TxLayer::Encoder)] += copies;
+      stats->copiedBytes[static_cast<size_t>(TxLayer::Encoder)] += static_cast<uint32_t>(copied);
+    }
+    return written;
+  }
+
+  /**
+   * @brief Convenience overload for a TxGather list
+   */
+  template <size_t MaxSegments, typename Sink>
+  size_t encodeGather(const TxGather<MaxSegments> &gather, Sink &sink,
+                      TxGatherStats *stats = nullptr, bool delimit = true)
+  {
+    return encodeGather(gather.segments(), gather.count(), sink, stats, delimit);
+  }
+
+} // namespace LumynLabs
@@ -0,0 +1,342 @@
+/**
+ * @file TxScheduler.h
+ * @brief Multi-class transmit queue with deficit round-robin
+ *
+ * Separates outgoing traffic into classes (realtime events, module
+ * telemetry, responses, bulk files), each with its own queue depth and
+ * drop policy. Dequeuing uses deficit round-robin weighted by bytes, so a
+ * long run of file chunks cannot delay events and telemetry by more than
+ * one quantum. Per-class backlog and queueing latency are tracked and can
+ * be copied out as a fixed-layout status block.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Traffic classes, highest priority first
+   *
+   * Shared by TxScheduler and FragmentScheduler.
+   */
+  enum class TxClass : uint8_t
+  {
+    Events = 0, ///< Realtime events and commands (pin interrupts, heartbeats, LED commands)
+    Telemetry,  ///< Module data
+    Responses,  ///< Replies to host requests
+    Bulk,       ///< File and asset transfers
+  };
+
+  constexpr size_t kTxClassCount = 4;
+
+  /**
+   * @brief What to do when a class queue is full
+   */
+  enum class TxDropPolicy : uint8_t
+  {
+    RejectNewest, ///< Refuse the new item (caller keeps ownership)
+    DropOldest,   ///< Evict the oldest queued item to make room
+  };
+
+  /**
+   * @brief Per-class configuration
+   */
+  struct TxClassConfig
+  {
+    uint16_t quantumBytes = 512; ///< Bytes credited per round
+    TxDropPolicy dropPolicy = TxDropPolicy::RejectNewest;
+  };
+
+  /**
+   * @brief Per-class counters, laid out for direct use as a status payload
+   */
+  struct TxClassStats
+  {
+    uint32_t enqueued;      ///< Items accepted
+    uint32_t sent;          ///< Items dequeued for transmission
+    uint32_t dropped;       ///< Items rejected or evicted
+    uint16_t backlog;       ///< Items currently queued
+    uint16_t maxBacklog;    ///< High-water mark of backlog
+    uint32_t backlogBytes;  ///< Bytes currently queued
+    uint32_t lastLatencyUs; ///< Queueing delay of the most recent item
+    uint32_t maxLatencyUs;  ///< Worst queueing delay seen
+    uint32_t avgLatencyUs;  ///< Exponential moving average (1/8 weight)
+  };
+
+  /**
+   * @brief Status block for all classes
+   */
+  struct TxSchedulerStatus
+  {
+    TxClassStats classes[kTxClassCount];
+  };
+
+  /**
+   * @brief Bounded multi-class transmit scheduler
+   *
+   * Items are stored by value; use a pointer or handle type for large
+   * payloads. The scheduler is not internally locked: guard enqueue() and
+   * dequeue() with the caller's lock if several tasks submit.
+   *
+   * @tparam Item           Queued item type (copyable)
+   * @tparam EventsDepth    Queue depth of TxClass::Events
+   * @tparam TelemetryDepth Queue depth of TxClass::Telemetry
+   * @tparam ResponsesDepth Queue depth of TxClass::Responses
+   * @tparam BulkDepth      Queue depth of TxClass::Bulk
+   *
+   * @code
+   * LumynLabs::TxScheduler<Transmission*, 32, 16, 8, 4> sched;
+   * sched.configure(LumynLabs::TxClass::Bulk, {256, LumynLabs::TxDropPolicy::RejectNewest});
+   * sched.configure(LumynLabs::TxClass::Events, {1024, LumynLabs::TxDropPolicy::DropOldest});
+   *
+   * sched.enqueue(LumynLabs::TxClass::Events, tx, tx->size(), micros());
+   * Transmission* next;
+   * while (sched.dequeue(next, micros())) send(next);
+   * @endcode
+   */
+  template <typename Item, size_t EventsDepth = 8, size_t TelemetryDepth = 8, size_t ResponsesDepth = 8,
+            size_t BulkDepth = 8>
+  class TxScheduler
+  {
+    static constexpr size_t kDepths[kTxClassCount] = {EventsDepth, TelemetryDepth, ResponsesDepth, BulkDepth};
+
+    static constexpr bool depthsInRange()
+    {
+      for (size_t depth : kDepths)
+      {
+        if (depth == 0 || depth > 0xFFFF)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+    static_assert(depthsInRange(), "Queue depths must be 1..65535");
+
+  public:
+    /** Queue depth of @p cls. */
+    static constexpr size_t depth(TxClass cls) { return kDepths[index(cls)]; }
+
+    /** Change a class's quantum and drop policy. */
+    void configure(TxClass cls, const TxClassConfig &config)
+    {
+      Queue &q = _queues[index(cls)];
+      q.config = config;
+      if (q.config.quantumBytes == 0)
+      {
+        q.config.quantumBytes = 1;
+      }
+    }
+
+    /**
+     * @brief Queue an item
+     *
+     * @param cls      Traffic class
+     * @param item     Item to queue
+     * @param bytes    Wire size used for fair sharing
+     * @param nowUs    Current time in microseconds
+     * @param evicted  Receives the evicted item under DropOldest; the caller
+     *                 owns it again and must release it
+     * @param didEvict Set to true when @p evicted was filled
+     * @return false if the item was rejected
+     */
+    bool enqueue(TxClass cls, const Item &item, uint32_t bytes, uint32_t nowUs,
+                 Item *evicted = nullptr, bool *didEvict = nullptr)
+    {
+      Queue &q = _queues[index(cls)];
+      const size_t depth = kDepths[index(cls)];
+      if (didEvict)
+      {
+        *didEvict = false;
+      }
+
+      if (q.count == depth)
+      {
+        ++q.stats.dropped;
+        if (q.config.dropPolicy == TxDropPolicy::RejectNewest)
+        {
+          return false;
+        }
+        Entry &oldest = entry(index(cls), q.head);
+        if (evicted)
+        {
+          *evicted = oldest.item;
+        }
+        if (didEvict)
+        {
+          *didEvict = true;
+        }
+        q.stats.backlogBytes -= oldest.bytes;
+        q.head = (q.head + 1) % depth;
+        --q.count;
+      }
+
+      Entry &slot = entry(index(cls), (q.head + q.count) % depth);
+      slot.item = item;
+      slot.bytes = bytes;
+      slot.enqueuedUs = nowUs;
+      ++q.count;
+
+      ++q.stats.enqueued;
+      q.stats.backlog = static_cast<uint16_t>(q.count);
+      q.stats.backlogBytes += bytes;
+      if (q.stats.backlog > q.stats.maxBacklog)
+      {
+        q.stats.maxBacklog = q.stats.backlog;
+      }
+      return true;
+    }
+
+    /**
+     * @brief Take the next item to transmit
+     * @return false if every queue is empty
+     */
+    bool dequeue(Item &out, uint32_t nowUs, TxClass *cls = nullptr)
+    {
+      if (empty())
+      {
+        return false;
+      }
+
+      for (;;)
+      {
+        Queue &q = _queues[_current];
+        if (q.count == 0)
+        {
+          q.deficit = 0;
+          advance();
+          continue;
+        }
+        if (_freshVisit)
+        {
+          q.deficit += q.config.quantumBytes;
+          _freshVisit = false;
+        }
+
+        const Entry &head = entry(_current, q.head);
+        if (head.bytes > q.deficit)
+        {
+          advance();
+          continue;
+        }
+
+        q.deficit -= head.bytes;
+        out = head.item;
+        if (cls)
+        {
+          *cls = static_cast<TxClass>(_current);
+        }
+        recordSent(q, head, nowUs);
+        q.head = (q.head + 1) % kDepths[_current];
+        --q.count;
+        q.stats.backlog = static_cast<uint16_t>(q.count);
+        if (q.count == 0)
+        {
+          q.deficit = 0;
+          advance();
+        }
+        return true;
+      }
+    }
+
+    bool empty() const
+    {
+      for (const auto &q : _queues)
+      {
+        if (q.count)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    const TxClassStats &stats(TxClass cls) const { return _queues[index(cls)].stats; }
+
+    /** Copy all class counters into a status block. */
+    void status(TxSchedulerStatus &out) const
+    {
+      for (size_t i = 0; i < kTxClassCount; ++i)
+      {
+        out.classes[i] = _queues[i].stats;
+      }
+    }
+
+    /** Reset high-water marks and latency maxima. */
+    void resetPeaks()
+    {
+      for (auto &q : _queues)
+      {
+        q.stats.maxBacklog = q.stats.backlog;
+        q.stats.maxLatencyUs = 0;
+      }
+    }
+
+  private:
+    struct Entry
+    {
+      Item item{};
+      uint32_t bytes = 0;
+      uint32_t enqueuedUs = 0;
+    };
+
+    // All classes share one entry array; class i owns kDepths[i] entries
+    // starting at offset(i).
+    struct Queue
+    {
+      size_t head = 0;
+      size_t count = 0;
+      uint32_t deficit = 0;
+      TxClassConfig config;
+      TxClassStats stats{};
+    };
+
+    static constexpr size_t index(TxClass cls) { return static_cast<size_t>(cls); }
+
+    static constexpr size_t offset(size_t cls)
+    {
+      size_t at = 0;
+      for (size_t i = 0; i < cls; ++i)
+      {
+        at += kDepths[i];
+      }
+      return at;
+    }
+
+    Entry &entry(size_t cls, size_t slot) { return _entries[offset(cls) + slot]; }
+
+    void advance()
+    {
+      _current = (_current + 1) % kTxClassCount;
+      _freshVisit = true;
+    }
+
+    static void recordSent(Queue &q, const Entry &entry, uint32_t nowUs)
+    {
+      const uint32_t latency = nowUs - entry.enqueuedUs;
+      ++q.stats.sent;
+      q.stats.backlogBytes -= entry.bytes;
+      q.stats.lastLatencyUs = latency;
+      if (latency > q.stats.maxLatencyUs)
+      {
+        q.stats.maxLatencyUs = latency;
+      }
+      q.stats.avgLatencyUs = q.stats.sent == 1
+                                 ? latency
+                                 : q.stats.avgLatencyUs - (q.stats.avgLatencyUs >> 3) + (latency >> 3);
+    }
+
+    Entry _entries[EventsDepth + TelemetryDepth + ResponsesDepth + BulkDepth];
+    Queue _queues[kTxClassCount];
+    size_t _current = 0;
+    bool _freshVisit = true;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,278 @@
+/**
+ * @file UartDmaRx.h
+ * @brief DMA-fed UART receive path for the RP2040
+ *
+ * A DMA channel copies every received byte from the UART data register
+ * into an RxSpanRing, wrapping in hardware, so the CPU is not involved per
+ * byte. The consumer drains the ring as spans, typically into a
+ * CobsFrameReader.
+ *
+ * The UART receive-timeout interrupt cannot detect an idle line here: it
+ * only fires while bytes sit in the RX FIFO, and the DMA empties the FIFO
+ * as soon as a byte arrives. Instead a repeating timer samples the DMA
+ * write position and reports the line idle once data has arrived and the
+ * position has then stayed put for a whole period. A partial frame is so
+ * flushed between one and two periods after its last byte.
+ *
+ * This takes ownership of the UART: do not also call begin() on the
+ * matching SerialUART instance.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "RxSpanRing.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/uart.h>
+#include <pico/time.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief UART receiver that fills an RxSpanRing by DMA
+   *
+   * @tparam RingSize Ring size in bytes (power of two, 256..32768)
+   *
+   * @code
+   * static LumynLabs::RxRingStorage<4096> rxRing;
+   * static LumynLabs::UartDmaRx<4096> rx(rxRing);
+   * rx.begin(uart1, 1000000, 4, 5, [](void*) { ... notify task ... });
+   *
+   * // Consumer task
+   * LumynLabs::RxSpan spans[2];
+   * size_t n = rx.peek(spans);
+   * ...
+   * rx.consume(bytesUsed);
+   * @endcode
+   */
+  template <size_t RingSize>
+  class UartDmaRx
+  {
+  public:
+    /** Called from timer interrupt context when the line goes idle. */
+    using IdleCallback = void (*)(void *arg);
+
+    explicit UartDmaRx(RxRingStorage<RingSize> &storage) : _ring(storage) {}
+    UartDmaRx(const UartDmaRx &) = delete;
+    UartDmaRx &operator=(const UartDmaRx &) = delete;
+
+    /** Shortest idle-poll period, to bound the timer IRQ rate at high baud rates. */
+    static constexpr uint32_t kMinIdlePeriodUs = 100;
+
+    /**
+     * @brief Configure the UART, start the DMA channel and the idle poll
+     *
+     * @param uart      uart0 or uart1
+     * @param baud      Baud rate
+     * @param txPin     TX GPIO
+     * @param rxPin     RX GPIO
+     * @param onIdle    Optional ISR callback, run when the line goes idle
+     * @param arg       Passed to @p onIdle
+     * @param idleChars Quiet time, in character times, that counts as idle
+     *                  (never below kMinIdlePeriodUs)
+     * @return false if no DMA channel or timer is free, or the UART is
+     *         already in use
+     */
+    bool begin(uart_inst_t *uart, uint32_t baud, uint8_t txPin, uint8_t rxPin,
+               IdleCallback onIdle = nullptr, void *arg = nullptr, uint32_t idleChars = 4)
+    {
+      const uint index = uart_get_index(uart);
+      if (instances()[index] != nullptr)
+      {
+        return false;
+      }
+
+      const int channel = dma_claim_unused_channel(false);
+      if (channel < 0)
+      {
+        return false;
+      }
+
+      const bool firstInstance = activeCount() == 0;
+      _uart = uart;
+      _channel = static_cast<uint>(channel);
+      _onIdle = onIdle;
+      _idleArg = arg;
+      _base = 0;
+      _lastPosition = 0;
+      _pendingIdle = false;
+      instances()[index] = this;
+
+      uart_init(uart, baud);
+      gpio_set_function(txPin, GPIO_FUNC_UART);
+      gpio_set_function(rxPin, GPIO_FUNC_UART);
+      uart_set_fifo_enabled(uart, true);
+
+      dma_channel_config config = dma_channel_get_default_config(_channel);
+      channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+      channel_config_set_read_increment(&config, false);
+      channel_config_set_write_increment(&config, true);
+      channel_config_set_ring(&config, true, RxSpanRing<RingSize>::sizeBits());
+      channel_config_set_dreq(&config, uart_get_dreq(uart, false));
+
+      // The transfer count only bounds how long the channel runs before
+      // the completion IRQ re-arms it (hours at 2 Mbaud).
+      dma_channel_set_irq1_enabled(_channel, true);
+      if (firstInstance)
+      {
+        irq_add_shared_handler(DMA_IRQ_1, &UartDmaRx::dmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+      }
+      dma_channel_configure(_channel, &config, _ring.storage(), &uart_get_hw(uart)->dr, kTransferCount, true);
+
+      uart_get_hw(uart)->dmacr = UART_UARTDMACR_RXDMAE_BITS;
+
+      if (onIdle)
+      {
+        // 10 bit times per character (8N1).
+        const uint64_t periodUs = static_cast<uint64_t>(idleChars) * 10u * 1000000u / baud;
+        const int64_t delayUs = periodUs > kMinIdlePeriodUs ? static_cast<int64_t>(periodUs) : kMinIdlePeriodUs;
+        // A negative delay keeps the period fixed regardless of callback time.
+        if (!add_repeating_timer_us(-delayUs, &UartDmaRx::idlePoll, this, &_idleTimer))
+        {
+          end();
+          return false;
+        }
+        _timerActive = true;
+      }
+      return true;
+    }
+
+    /** Stop reception and release the DMA channel and IRQs. */
+    void end()
+    {
+      if (!_uart)
+      {
+        return;
+      }
+      if (_timerActive)
+      {
+        cancel_repeating_timer(&_idleTimer);
+        _timerActive = false;
+      }
+      const uint index = uart_get_index(_uart);
+      uart_get_hw(_uart)->dmacr = 0;
+
+      dma_channel_set_irq1_enabled(_channel, false);
+      dma_channel_abort(_channel);
+      dma_channel_unclaim(_channel);
+      instances()[index] = nullptr;
+      _uart = nullptr;
+      if (activeCount() == 0)
+      {
+        irq_remove_handler(DMA_IRQ_1, &UartDmaRx::dmaIrq);
+      }
+    }
+
+    /**
+     * @brief Get received data as up to two contiguous spans
+     *
+     * Always samples the live DMA position, so everything received so far
+     * is visible whether or not the idle callback has run yet.
+     */
+    size_t peek(RxSpan (&spans)[2])
+    {
+      _ring.publish(bytesWritten());
+      return _ring.peek(spans);
+    }
+
+    void consume(size_t count) { _ring.consume(count); }
+
+    size_t available()
+    {
+      _ring.publish(bytesWritten());
+      return _ring.available();
+    }
+
+    uint32_t overrunBytes() const { return _ring.overrunBytes(); }
+
+  private:
+    static constexpr uint32_t kTransferCount = 0xFFFFFFFFu;
+
+    static UartDmaRx **instances()
+    {
+      static UartDmaRx *table[NUM_UARTS] = {};
+      return table;
+    }
+
+    static uint activeCount()
+    {
+      uint count = 0;
+      for (uint i = 0; i < NUM_UARTS; ++i)
+      {
+        count += instances()[i] != nullptr;
+      }
+      return count;
+    }
+
+    uint32_t bytesWritten() const
+    {
+      uint32_t base;
+      uint32_t remaining;
+      do
+      {
+        base = _base;
+        remaining = dma_channel_hw_addr(_channel)->transfer_count;
+      } while (base != _base);
+      return base + (kTransferCount - remaining);
+    }
+
+    static void dmaIrq()
+    {
+      for (uint i = 0; i < NUM_UARTS; ++i)
+      {
+        UartDmaRx *self = instances()[i];
+        if (self && dma_channel_get_irq1_status(self->_channel))
+        {
+          dma_channel_acknowledge_irq1(self->_channel);
+          self->_base = self->_base + kTransferCount;
+          // The write address register keeps its wrapped position.
+          dma_channel_set_trans_count(self->_channel, kTransferCount, true);
+        }
+      }
+    }
+
+    static bool idlePoll(repeating_timer_t *timer)
+    {
+      UartDmaRx *self = static_cast<UartDmaRx *>(timer->user_data);
+      const uint32_t position = self->bytesWritten();
+      if (position != self->_lastPosition)
+      {
+        // Still receiving; report idle once a full period passes quietly.
+        self->_lastPosition = position;
+        self->_pendingIdle = true;
+      }
+      else if (self->_pendingIdle)
+      {
+        self->_pendingIdle = false;
+        self->_onIdle(self->_idleArg);
+      }
+      return true;
+    }
+
+    RxSpanRing<RingSize> _ring;
+    uart_inst_t *_uart = nullptr;
+    uint _channel = 0;
+    volatile uint32_t _base = 0;
+    IdleCallback _onIdle = nullptr;
+    void *_idleArg = nullptr;
+    repeating_timer_t _idleTimer = {};
+    bool _timerActive = false;
+    uint32_t _lastPosition = 0;
+    bool _pendingIdle = false;
+  };
+
+} // namespace LumynLabs
+
+#endif // ARDUINO_ARCH_RP2040
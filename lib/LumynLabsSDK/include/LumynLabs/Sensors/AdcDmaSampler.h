@@ -0,0 +1,248 @@
+/**
+ * @file AdcDmaSampler.h
+ * @brief Free-running round-robin ADC capture by DMA for the RP2040
+ *
+ * The ADC runs continuously at a fixed conversion rate, cycling through
+ * the inputs an AdcChannelBank needs. A DMA channel copies every
+ * conversion from the ADC FIFO into an RxSpanRing, and poll() feeds the
+ * new samples to the bank in one batch. No analogRead() blocks for the
+ * ~2 us conversion, and the CPU only runs the filters.
+ *
+ * This takes ownership of the ADC: do not call analogRead() while it runs.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Networking/RxSpanRing.h"
+#include "AdcFilter.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Round-robin ADC sampler feeding an AdcChannelBank
+   *
+   * @tparam RingBytes Capture ring size (power of two, 256..32768); each
+   *                   conversion takes 2 bytes
+   *
+   * @code
+   * static LumynLabs::AdcChannelBank<2> bank;
+   * static LumynLabs::RxRingStorage<4096> adcRing;
+   * static LumynLabs::AdcDmaSampler<> adc(adcRing);
+   * const LumynLabs::AdcChannelConfig channels[] = {
+   *     {0, uint8_t(LumynLabs::AdcFilterType::MovingAverage), 8, 16},
+   *     {1, uint8_t(LumynLabs::AdcFilterType::Median), 5, 8},
+   * };
+   * bank.configure(channels, 2);
+   * adc.begin(bank, 20000);             // 10 kS/s per input
+   *
+   * // in readData()
+   * adc.poll(bank);
+   * out->value = bank.value(0);
+   * @endcode
+   */
+  template <size_t RingBytes = 4096>
+  class AdcDmaSampler
+  {
+  public:
+    /** Fastest conversion rate of the RP2040 ADC. */
+    static constexpr uint32_t kMaxRateHz = 500000;
+
+    /** Conversions the ring holds before poll() starts losing them. */
+    static constexpr uint32_t kRingSamples = RingBytes / sizeof(uint16_t);
+
+    explicit AdcDmaSampler(RxRingStorage<RingBytes> &storage) : _ring(storage) {}
+    ~AdcDmaSampler() { end(); }
+    AdcDmaSampler(const AdcDmaSampler &) = delete;
+    AdcDmaSampler &operator=(const AdcDmaSampler &) = delete;
+
+    /**
+     * @brief Start converting the bank's inputs
+     *
+     * @param bank   Configured channel bank; its input set is fixed until end()
+     * @param rateHz Total conversions per second, shared by all inputs
+     * @return false if the ADC is already in use, the bank has no inputs
+     *         or no DMA channel is free
+     */
+    template <size_t N>
+    bool begin(AdcChannelBank<N> &bank, uint32_t rateHz)
+    {
+      if (!beginMask(bank.inputMask(), bank.firstInput(), rateHz))
+      {
+        return false;
+      }
+      bank.resync();
+      return true;
+    }
+
+    /** Stop the ADC and release the DMA channel. */
+    void end()
+    {
+      if (instance() != this)
+      {
+        return;
+      }
+      adc_run(false);
+      dma_channel_set_irq1_enabled(_channel, false);
+      dma_channel_abort(_channel);
+      dma_channel_unclaim(_channel);
+      adc_fifo_drain();
+      adc_set_round_robin(0);
+      irq_remove_handler(DMA_IRQ_1, &AdcDmaSampler::dmaIrq);
+      instance() = nullptr;
+    }
+
+    /**
+     * @brief Feed every conversion captured since the last poll to @p bank
+     *
+     * Conversions lost to a ring overrun are skipped in the round robin,
+     * so channels stay aligned.
+     */
+    template <size_t N>
+    void poll(AdcChannelBank<N> &bank)
+    {
+      _ring.publish(bytesWritten());
+      RxSpan spans[2];
+      const size_t count = _ring.peek(spans);
+      const uint32_t overrun = _ring.overrunBytes();
+      if (overrun != _seenOverrun)
+      {
+        bank.skip((overrun - _seenOverrun) / sizeof(uint16_t));
+        _seenOverrun = overrun;
+      }
+      size_t consumed = 0;
+      for (size_t i = 0; i < count; ++i)
+      {
+        const size_t n = spans[i].length / sizeof(uint16_t);
+        bank.push(reinterpret_cast<const uint16_t *>(spans[i].data), n);
+        consumed += n * sizeof(uint16_t);
+      }
+      _ring.consume(consumed);
+      _samples += consumed / sizeof(uint16_t);
+    }
+
+    /** Conversions delivered to the bank. */
+    uint32_t samples() const { return _samples; }
+
+    /** Conversions lost because poll() fell a full ring behind. */
+    uint32_t overrunSamples() const { return _ring.overrunBytes() / sizeof(uint16_t); }
+
+    /**
+     * @brief Highest rate at which polls every @p pollIntervalMs never overrun
+     *
+     * Leaves half the ring as margin for a late poll. Returns kMaxRateHz
+     * for 0 (no fixed interval).
+     */
+    static constexpr uint32_t maxRateForPoll(uint32_t pollIntervalMs)
+    {
+      if (pollIntervalMs == 0)
+      {
+        return kMaxRateHz;
+      }
+      const uint32_t rate = kRingSamples * 1000u / (2 * pollIntervalMs);
+      return rate < kMaxRateHz ? rate : kMaxRateHz;
+    }
+
+  private:
+    static constexpr uint32_t kTransferCount = 0xFFFFFFFFu;
+    static constexpr uint8_t kTempInput = 4;
+    static constexpr uint kFirstAdcGpio = 26;
+
+    static AdcDmaSampler *&instance()
+    {
+      static AdcDmaSampler *self = nullptr;
+      return self;
+    }
+
+    bool beginMask(uint8_t mask, uint8_t first, uint32_t rateHz)
+    {
+      if (instance() || mask == 0 || rateHz == 0)
+      {
+        return false;
+      }
+      const int channel = dma_claim_unused_channel(false);
+      if (channel < 0)
+      {
+        return false;
+      }
+      _channel = static_cast<uint>(channel);
+      _base = 0;
+      instance() = this;
+
+      adc_init();
+      for (uint8_t input = 0; input < kTempInput; ++input)
+      {
+        if (mask & (1u << input))
+        {
+          adc_gpio_init(kFirstAdcGpio + input);
+        }
+      }
+      adc_set_temp_sensor_enabled((mask & (1u << kTempInput)) != 0);
+      adc_select_input(first);
+      adc_set_round_robin(mask);
+      // One 12-bit sample per FIFO entry, no error bit, DREQ at one entry.
+      adc_fifo_setup(true, true, 1, false, false);
+      // A conversion takes 96 ADC clocks (48 MHz); the divider spaces them.
+      const uint32_t rate = rateHz > kMaxRateHz ? kMaxRateHz : rateHz;
+      adc_set_clkdiv(static_cast<float>(48000000u / rate) - 1.0f);
+
+      dma_channel_config dma = dma_channel_get_default_config(_channel);
+      channel_config_set_transfer_data_size(&dma, DMA_SIZE_16);
+      channel_config_set_read_increment(&dma, false);
+      channel_config_set_write_increment(&dma, true);
+      channel_config_set_ring(&dma, true, RxSpanRing<RingBytes>::sizeBits());
+      channel_config_set_dreq(&dma, DREQ_ADC);
+      dma_channel_set_irq1_enabled(_channel, true);
+      irq_add_shared_handler(DMA_IRQ_1, &AdcDmaSampler::dmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+      irq_set_enabled(DMA_IRQ_1, true);
+      adc_fifo_drain();
+      dma_channel_configure(_channel, &dma, _ring.storage(), &adc_hw->fifo, kTransferCount, true);
+      adc_run(true);
+      return true;
+    }
+
+    uint32_t bytesWritten() const
+    {
+      uint32_t base;
+      uint32_t remaining;
+      do
+      {
+        base = _base;
+        remaining = dma_channel_hw_addr(_channel)->transfer_count;
+      } while (base != _base);
+      return (base + (kTransferCount - remaining)) * sizeof(uint16_t);
+    }
+
+    static void dmaIrq()
+    {
+      AdcDmaSampler *self = instance();
+      if (self && dma_channel_get_irq1_status(self->_channel))
+      {
+        dma_channel_acknowledge_irq1(self->_channel);
+        self->_base += kTransferCount;
+        dma_channel_set_trans_count(self->_channel, kTransferCount, true);
+      }
+    }
+
+    RxSpanRing<RingBytes> _ring;
+    uint _channel = 0;
+    volatile uint32_t _base = 0;
+    uint32_t _seenOverrun = 0;
+    uint32_t _samples = 0;
+  };
+
+} // namespace LumynLabs
+
+#endif // ARDUINO_ARCH_RP2040
@@ -0,0 +1,299 @@
+/**
+ * @file AdcFilter.h
+ * @brief Per-channel decimation and smoothing for a round-robin ADC stream
+ *
+ * The RP2040 ADC converts its enabled inputs in turn, so a free-running
+ * capture is one interleaved stream of 12-bit samples. AdcChannelBank
+ * splits that stream by input, averages each channel over a decimation
+ * block and runs the result through the channel's filter: moving
+ * average, first-order IIR or median-of-N. Averaging many conversions
+ * per output adds resolution, so values are kept in Q4 (12-bit counts
+ * times 16, 0..65520).
+ *
+ * The code is portable; see AdcDmaSampler.h for the RP2040 capture.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /** AdcChannelConfig::filter */
+  enum class AdcFilterType : uint8_t
+  {
+    None = 0,          ///< Decimated block average only
+    MovingAverage = 1, ///< Mean of the last `length` blocks (1..32)
+    Iir = 2,           ///< y += (x - y) / 2^length, length 1..12
+    Median = 3,        ///< Median of the last `length` blocks (odd, 1..9)
+  };
+
+  /**
+   * @brief One filtered channel (4 bytes, custom config layout)
+   */
+  struct AdcChannelConfig
+  {
+    uint8_t input = kUnused;   ///< ADC input 0..3 (GPIO26..29) or 4 (temperature)
+    uint8_t filter = 0;        ///< AdcFilterType
+    uint8_t length = 1;        ///< Window, or IIR shift
+    uint8_t decimation = 1;    ///< Conversions averaged per filter input, 1..255
+
+    static constexpr uint8_t kUnused = 0xFF;
+  };
+  static_assert(sizeof(AdcChannelConfig) == 4, "AdcChannelConfig is part of the custom config layout");
+
+  /**
+   * @brief Decimator plus one filter stage
+   */
+  class AdcFilter
+  {
+  public:
+    static constexpr uint8_t kMaxWindow = 32;
+    static constexpr uint8_t kMaxMedian = 9;
+    static constexpr uint8_t kMaxIirShift = 12;
+
+    /** Apply a channel config; out-of-range lengths are clamped. Resets state. */
+    void configure(const AdcChannelConfig &config)
+    {
+      _type = config.filter <= static_cast<uint8_t>(AdcFilterType::Median) ? static_cast<AdcFilterType>(config.filter)
+                                                                           : AdcFilterType::None;
+      _decimation = config.decimation ? config.decimation : 1;
+      uint8_t length = config.length ? config.length : 1;
+      switch (_type)
+      {
+      case AdcFilterType::MovingAverage:
+        length = length > kMaxWindow ? kMaxWindow : length;
+        break;
+      case AdcFilterType::Iir:
+        length = length > kMaxIirShift ? kMaxIirShift : length;
+        break;
+      case AdcFilterType::Median:
+        length = length > kMaxMedian ? kMaxMedian : length;
+        length |= 1;
+        break;
+      default:
+        length = 1;
+        break;
+      }
+      _length = length;
+      reset();
+    }
+
+    void reset()
+    {
+      _blockSum = 0;
+      _blockCount = 0;
+      _fill = 0;
+      _head = 0;
+      _windowSum = 0;
+      _iir = 0;
+      _value = 0;
+      _outputs = 0;
+    }
+
+    /**
+     * @brief Add one raw 12-bit conversion
+     * @return true when it completed a block and value() changed
+     */
+    bool push(uint16_t raw)
+    {
+      _blockSum += raw & 0x0FFF;
+      if (++_blockCount < _decimation)
+      {
+        return false;
+      }
+      const uint16_t block = static_cast<uint16_t>((_blockSum * 16 + _decimation / 2) / _decimation);
+      _blockSum = 0;
+      _blockCount = 0;
+      _value = filter(block);
+      ++_outputs;
+      return true;
+    }
+
+    /** Latest output in Q4 counts (0..65520). */
+    uint16_t value() const { return _value; }
+
+    /** Filter outputs since configure(). */
+    uint32_t outputs() const { return _outputs; }
+
+  private:
+    uint16_t filter(uint16_t x)
+    {
+      switch (_type)
+      {
+      case AdcFilterType::MovingAverage:
+      {
+        if (_fill == _length)
+        {
+          _windowSum -= _window[_head];
+        }
+        else
+        {
+          ++_fill;
+        }
+        _window[_head] = x;
+        _windowSum += x;
+        _head = static_cast<uint8_t>((_head + 1) % _length);
+        return static_cast<uint16_t>((_windowSum + _fill / 2) / _fill);
+      }
+      case AdcFilterType::Iir:
+      {
+        // State in Q8 of the Q4 value; seeded with the first input so the
+        // output does not ramp up from zero.
+        const int32_t target = static_cast<int32_t>(x) << 8;
+        if (_outputs == 0)
+        {
+          _iir = target;
+        }
+        else
+        {
+          _iir += (target - _iir) >> _length;
+        }
+        return static_cast<uint16_t>((_iir + 128) >> 8);
+      }
+      case AdcFilterType::Median:
+      {
+        _window[_head] = x;
+        _head = static_cast<uint8_t>((_head + 1) % _length);
+        if (_fill < _length)
+        {
+          ++_fill;
+        }
+        uint16_t sorted[kMaxMedian];
+        for (uint8_t i = 0; i < _fill; ++i)
+        {
+          uint16_t v = _window[i];
+          uint8_t j = i;
+          for (; j > 0 && sorted[j - 1] > v; --j)
+          {
+            sorted[j] = sorted[j - 1];
+          }
+          sorted[j] = v;
+        }
+        return sorted[_fill / 2];
+      }
+      default:
+        return x;
+      }
+    }
+
+    AdcFilterType _type = AdcFilterType::None;
+    uint8_t _length = 1;
+    uint8_t _decimation = 1;
+    uint8_t _blockCount = 0;
+    uint8_t _fill = 0;
+    uint8_t _head = 0;
+    uint16_t _value = 0;
+    uint32_t _blockSum = 0;
+    uint32_t _windowSum = 0;
+    int32_t _iir = 0;
+    uint32_t _outputs = 0;
+    uint16_t _window[kMaxWindow] = {};
+  };
+
+  /**
+   * @brief Demultiplexes a round-robin stream into filtered channels
+   *
+   * Several channels may use the same input with different filters.
+   *
+   * @tparam MaxChannels Filtered channels
+   */
+  template <size_t MaxChannels = 4>
+  class AdcChannelBank
+  {
+  public:
+    /** ADC inputs on the RP2040: GPIO26..29 and the temperature sensor. */
+    static constexpr uint8_t kInputs = 5;
+
+    /** Set up the channels; entries with input kUnused are disabled. */
+    void configure(const AdcChannelConfig *configs, size_t count)
+    {
+      _inputMask = 0;
+      for (size_t i = 0; i < MaxChannels; ++i)
+      {
+        const bool used = i < count && configs[i].input < kInputs;
+        _channelInput[i] = used ? configs[i].input : AdcChannelConfig::kUnused;
+        if (used)
+        {
+          _filters[i].configure(configs[i]);
+          _inputMask |= static_cast<uint8_t>(1u << configs[i].input);
+        }
+      }
+      _orderLength = 0;
+      for (uint8_t input = 0; input < kInputs; ++input)
+      {
+        if (_inputMask & (1u << input))
+        {
+          _order[_orderLength++] = input;
+        }
+      }
+      _phase = 0;
+    }
+
+    /** Inputs the ADC must convert, bit n = input n. */
+    uint8_t inputMask() const { return _inputMask; }
+
+    /** Lowest enabled input; the round robin must start there. */
+    uint8_t firstInput() const { return _orderLength ? _order[0] : 0; }
+
+    /**
+     * @brief Feed conversions in capture order
+     *
+     * The first sample after configure() or resync() belongs to
+     * firstInput().
+     */
+    void push(const uint16_t *samples, size_t count)
+    {
+      if (_orderLength == 0)
+      {
+        return;
+      }
+      for (size_t s = 0; s < count; ++s)
+      {
+        const uint8_t input = _order[_phase];
+        for (size_t i = 0; i < MaxChannels; ++i)
+        {
+          if (_channelInput[i] == input)
+          {
+            _filters[i].push(samples[s]);
+          }
+        }
+        _phase = static_cast<uint8_t>(_phase + 1 == _orderLength ? 0 : _phase + 1);
+      }
+    }
+
+    /** Skip conversions that were lost, keeping the round robin aligned. */
+    void skip(size_t count)
+    {
+      if (_orderLength)
+      {
+        _phase = static_cast<uint8_t>((_phase + count % _orderLength) % _orderLength);
+      }
+    }
+
+    /** Restart the round robin at firstInput(). */
+    void resync() { _phase = 0; }
+
+    /** Latest Q4 value of channel @p i, 0 if unused. */
+    uint16_t value(size_t i) const { return i < MaxChannels ? _filters[i].value() : 0; }
+
+    /** Filter outputs of channel @p i since configure(). */
+    uint32_t outputs(size_t i) const { return i < MaxChannels ? _filters[i].outputs() : 0; }
+
+    bool enabled(size_t i) const { return i < MaxChannels && _channelInput[i] != AdcChannelConfig::kUnused; }
+
+  private:
+    AdcFilter _filters[MaxChannels];
+    uint8_t _channelInput[MaxChannels] = {};
+    uint8_t _order[kInputs] = {};
+    uint8_t _orderLength = 0;
+    uint8_t _phase = 0;
+    uint8_t _inputMask = 0;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,215 @@
+/**
+ * @file AnalogFilterModule.h
+ * @brief Oversampled, DMA-fed analog input module with per-channel filters
+ *
+ * Up to four analog channels share one free-running ADC capture (see
+ * AdcDmaSampler.h). Each channel averages a block of conversions and
+ * smooths the result with its own filter (see AdcFilter.h), configured
+ * from the module's custom config. readData() hands the captured batch
+ * to the filters and returns their latest outputs; it never waits for a
+ * conversion.
+ *
+ * The capture ring must hold everything converted between two polls. The
+ * conversion rate is lowered at init when the polling interval would
+ * overflow it, and lost conversions are flagged in every reading.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Modules/Module.h"
+#include "../Modules/ModuleRegistration.h"
+#include "AdcDmaSampler.h"
+#include "AdcFilter.h"
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace LumynLabs
+{
+
+  /** Channels of an AnalogFilterModule. */
+  static constexpr size_t kAnalogFilterChannels = 4;
+
+  /**
+   * Capture ring of an AnalogFilterModule: 2048 conversions, 51 ms at the
+   * default 40 kS/s. The rate is lowered for longer polling intervals.
+   */
+  static constexpr size_t kAnalogFilterRingBytes = 4096;
+
+  /** AnalogFilterData::flags */
+  enum AnalogFilterFlags : uint8_t
+  {
+    kAnalogFilterOverrun = 0x01,     ///< Conversions were lost since the last reading
+    kAnalogFilterRateLimited = 0x02, ///< sampleRateHz was lowered to fit the polling interval
+  };
+
+  /**
+   * @brief Module payload (28 bytes)
+   */
+  struct AnalogFilterData
+  {
+    uint16_t value[kAnalogFilterChannels];     ///< Filtered Q4 counts (12-bit counts x 16), 0 if unused
+    uint16_t millivolts[kAnalogFilterChannels]; ///< value scaled to the 3.3 V reference
+    uint32_t samples;                           ///< Conversions captured since init
+    uint32_t overruns;                          ///< Conversions lost to a late poll
+    uint8_t updated;                            ///< Bit n: channel n produced a new output since the last read
+    uint8_t flags;                              ///< AnalogFilterFlags
+    uint8_t reserved[2];
+  };
+  static_assert(sizeof(AnalogFilterData) == 28, "AnalogFilterData is part of the module data format");
+
+  /**
+   * @brief Settings, read from ModuleConfig::customConfig (20 bytes)
+   *
+   * Without a custom config, channel 0 reads ADC input 0 with a 16x
+   * oversampled moving average of 8.
+   */
+  struct AnalogFilterOptions
+  {
+    uint32_t sampleRateHz = 40000; ///< Total conversions per second, all inputs together
+    AdcChannelConfig channels[kAnalogFilterChannels] = {
+        {0, static_cast<uint8_t>(AdcFilterType::MovingAverage), 8, 16}, {}, {}, {}};
+  };
+  static_assert(sizeof(AnalogFilterOptions) == 20, "AnalogFilterOptions is the custom config layout");
+
+  /**
+   * @brief Analog input module
+   *
+   * Only one instance can run, since it owns the ADC.
+   *
+   * @code
+   * LumynLabs::registerAnalogFilterModule();        // type "AIO_FILTERED"
+   * @endcode
+   */
+  class AnalogFilterModule : public Module<AnalogFilterData>
+  {
+  public:
+    using Sampler = AdcDmaSampler<kAnalogFilterRingBytes>;
+
+    explicit AnalogFilterModule(const ModuleConfig &config)
+        : Module(config), _options(parseConfig(config)), _sampler(ringStorage())
+    {
+      // Leave room for two polling intervals of conversions in the ring.
+      const uint32_t limit = Sampler::maxRateForPoll(config.pollingRateMs);
+      if (_options.sampleRateHz > limit)
+      {
+        _options.sampleRateHz = limit;
+        _rateLimited = true;
+      }
+    }
+
+    /** Conversions per second actually used, after any limit for the polling interval. */
+    uint32_t sampleRateHz() const { return _options.sampleRateHz; }
+
+    /**
+     * @brief Options from a module config
+     *
+     * A custom config shorter than AnalogFilterOptions leaves the defaults
+     * in place; filter lengths are clamped by AdcFilter.
+     */
+    static AnalogFilterOptions parseConfig(const ModuleConfig &config)
+    {
+      AnalogFilterOptions options;
+      if (config.customConfig && config.customConfigSize >= sizeof(AnalogFilterOptions))
+      {
+        std::memcpy(&options, config.customConfig, sizeof(AnalogFilterOptions));
+      }
+      if (options.sampleRateHz == 0 || options.sampleRateHz > Sampler::kMaxRateHz)
+      {
+        options.sampleRateHz = Sampler::kMaxRateHz;
+      }
+      return options;
+    }
+
+    ModuleError initModule() override
+    {
+      _bank.configure(_options.channels, kAnalogFilterChannels);
+      if (_bank.inputMask() == 0)
+      {
+        return ModuleError::error(ModuleErrorType::InvalidConfig);
+      }
+      if (!_sampler.begin(_bank, _options.sampleRateHz))
+      {
+        return ModuleError::error(ModuleErrorType::NotInitialized);
+      }
+      return ModuleError::ok();
+    }
+
+    ModuleError readData(AnalogFilterData *dataOut) override
+    {
+      _sampler.poll(_bank);
+
+      AnalogFilterData data{};
+      for (size_t i = 0; i < kAnalogFilterChannels; ++i)
+      {
+        if (!_bank.enabled(i))
+        {
+          continue;
+        }
+        data.value[i] = _bank.value(i);
+        data.millivolts[i] = static_cast<uint16_t>((static_cast<uint32_t>(data.value[i]) * kReferenceMv + kFullScale / 2) /
+                                                   kFullScale);
+        const uint32_t outputs = _bank.outputs(i);
+        if (outputs != _lastOutputs[i])
+        {
+          data.updated |= static_cast<uint8_t>(1u << i);
+          _lastOutputs[i] = outputs;
+        }
+      }
+      data.samples = _sampler.samples();
+      data.overruns = _sampler.overrunSamples();
+      if (data.overruns != _lastOverruns)
+      {
+        data.flags |= kAnalogFilterOverrun;
+        _lastOverruns = data.overruns;
+      }
+      if (_rateLimited)
+      {
+        data.flags |= kAnalogFilterRateLimited;
+      }
+      *dataOut = data;
+      return ModuleError::ok();
+    }
+
+  private:
+    static constexpr uint32_t kReferenceMv = 3300;
+    static constexpr uint32_t kFullScale = 4095 * 16;
+
+    // Static rather than a member, so the heap-allocated module is not
+    // aligned to the ring. One ring is enough: only one instance can own
+    // the ADC.
+    static RxRingStorage<kAnalogFilterRingBytes> &ringStorage()
+    {
+      static RxRingStorage<kAnalogFilterRingBytes> storage;
+      return storage;
+    }
+
+    AnalogFilterOptions _options;
+    AdcChannelBank<kAnalogFilterChannels> _bank;
+    Sampler _sampler;
+    uint32_t _lastOutputs[kAnalogFilterChannels] = {};
+    uint32_t _lastOverruns = 0;
+    bool _rateLimited = false;
+  };
+
+  /**
+   * @brief Register AnalogFilterModule with the system
+   *
+   * The built-in analog input module keeps its one-read-per-poll
+   * behaviour; use this type identifier in the device config to select
+   * the filtered module.
+   */
+  inline void registerAnalogFilterModule(const std::string &typeIdentifier = "AIO_FILTERED")
+  {
+    registerModule<AnalogFilterData, AnalogFilterModule>(typeIdentifier);
+  }
+
+} // namespace LumynLabs
+
+#endif // ARDUINO_ARCH_RP2040
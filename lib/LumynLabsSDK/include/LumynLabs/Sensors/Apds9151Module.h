@@ -0,0 +1,377 @@
+/**
+ * @file Apds9151Module.h
+ * @brief Ready-made APDS-9151 color and proximity module with burst reads
+ *
+ * One sample is a single I2C transaction: MAIN_STATUS through LS_DATA_RED_2
+ * (0x07..0x15, 15 bytes), decoded in place. Reading MAIN_STATUS in the
+ * same burst tells which half of the sample is new and releases the INT
+ * pin. Lux and correlated color temperature are computed in fixed point.
+ *
+ * When the INT pin is wired, the sensor itself decides when a sample is
+ * worth reading. The light sensor interrupts in variance mode, when a
+ * channel moves by more than a set number of counts. The proximity sensor
+ * interrupts when it leaves a window that is re-centered on every new
+ * value. Until INT asserts, polls report no data and do not touch the
+ * bus, so the host is not sent the same sample again.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Modules/Module.h"
+#include "../Modules/ModuleRegistration.h"
+
+#include <APDS9151.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace LumynLabs
+{
+
+  /** Apds9151Data::flags */
+  enum Apds9151Flags : uint8_t
+  {
+    kApds9151ProximityOverflow = 0x01, ///< PS_DATA_1 overflow bit
+    kApds9151ProximityNew = 0x02,      ///< Proximity updated by this sample
+    kApds9151LightNew = 0x04,          ///< Color channels updated by this sample
+    kApds9151ProximityEvent = 0x08,    ///< Proximity left its threshold window
+    kApds9151LightEvent = 0x10,        ///< Light changed by more than the variance threshold
+  };
+
+  /**
+   * @brief Module payload (28 bytes)
+   */
+  struct Apds9151Data
+  {
+    uint32_t red;       ///< 20-bit raw counts
+    uint32_t green;     ///< 20-bit raw counts
+    uint32_t blue;      ///< 20-bit raw counts
+    uint32_t ir;        ///< 20-bit raw counts
+    uint32_t luxMilli;  ///< Illuminance in thousandths of a lux
+    uint16_t cctKelvin; ///< Correlated color temperature, 0 if undefined
+    uint16_t proximity; ///< 11-bit proximity counts
+    uint8_t flags;      ///< Apds9151Flags
+    uint8_t reserved[3];
+  };
+  static_assert(sizeof(Apds9151Data) == 28, "Apds9151Data is part of the module data format");
+
+  /**
+   * @brief Settings, read from ModuleConfig::customConfig when present
+   *
+   * A custom config shorter than this struct leaves the defaults in place.
+   */
+  struct Apds9151Options
+  {
+    uint8_t lsGain = 0x01;       ///< APDS9151::Gain (3x)
+    uint8_t lsResolution = 0x10; ///< APDS9151::Resolution (18 bit)
+    uint8_t lsRate = 0x02;       ///< APDS9151::MeasurementRate (100 ms)
+    uint8_t ledCurrent = 0x03;   ///< APDS9151::LEDCurrent (100 mA)
+    uint8_t psPulses = lumyn::sensors::APDS9151::DEFAULT_PS_PULSES;
+    uint8_t psResolution = 0x18; ///< APDS9151::Resolution (11 bit)
+    uint8_t psRate = 0x01;       ///< APDS9151::MeasurementRate (50 ms)
+    uint8_t intPin = 0xFF;       ///< INT (active low); 0xFF reads on every poll
+    uint16_t psDeadband = 16;    ///< Proximity counts either side of the last value
+    uint8_t lsVariance = 3;      ///< LS_THRES_VAR: interrupt on a change of 8 << code counts
+    uint8_t persist = 0x11;      ///< INT_PST: LS persistence (high nibble), PS (low nibble)
+  };
+  static_assert(sizeof(Apds9151Options) == 12, "Apds9151Options is the custom config layout");
+
+  /**
+   * @brief APDS-9151 module
+   *
+   * @code
+   * LumynLabs::registerApds9151Module();            // type "APDS9151_BURST"
+   * @endcode
+   */
+  class Apds9151Module : public Module<Apds9151Data>
+  {
+  public:
+    using APDS9151Driver = lumyn::sensors::APDS9151;
+
+    /** First register and length of the sample burst. */
+    static constexpr uint8_t kBurstRegister = static_cast<uint8_t>(APDS9151Driver::Register::MAIN_STATUS);
+    static constexpr uint8_t kBurstLength = 15;
+
+    explicit Apds9151Module(const ModuleConfig &config) : Module(config)
+    {
+      if (config.customConfig && config.customConfigSize >= sizeof(Apds9151Options))
+      {
+        std::memcpy(&_options, config.customConfig, sizeof(Apds9151Options));
+      }
+    }
+
+    ModuleError initModule() override
+    {
+      TwoWire &wire = peripherals().getI2C();
+      if (!_driver.begin(wire))
+      {
+        return ModuleError::error(ModuleErrorType::NotInitialized);
+      }
+      _driver.setLSGain(static_cast<APDS9151Driver::Gain>(_options.lsGain));
+      _driver.setLSMeasurementRate(static_cast<APDS9151Driver::Resolution>(_options.lsResolution),
+                                   static_cast<APDS9151Driver::MeasurementRate>(_options.lsRate));
+      _driver.setLEDCurrent(static_cast<APDS9151Driver::LEDCurrent>(_options.ledCurrent));
+      _driver.setPSPulses(_options.psPulses);
+      _driver.setPSMeasurementRate(static_cast<APDS9151Driver::Resolution>(_options.psResolution),
+                                   static_cast<APDS9151Driver::MeasurementRate>(_options.psRate));
+      _gain = gainFactor(_options.lsGain);
+
+      if (_options.intPin != 0xFF)
+      {
+        // Green channel, variance mode, both interrupts enabled.
+        const uint8_t intCfg = kLsIntSelGreen | kLsVarMode | kLsIntEn | kPsIntEn;
+        if (!writeRegisters(APDS9151Driver::Register::INT_PST, &_options.persist, 1) ||
+            !writeRegisters(APDS9151Driver::Register::LS_THRES_VAR, &_options.lsVariance, 1) ||
+            !setProximityWindow(0) ||
+            !writeRegisters(APDS9151Driver::Register::INT_CFG, &intCfg, 1))
+        {
+          return ModuleError::error(ModuleErrorType::CommunicationFail);
+        }
+        pinMode(_options.intPin, INPUT_PULLUP);
+      }
+      _driver.enable();
+      return ModuleError::ok();
+    }
+
+    /**
+     * @brief Whether a poll has anything to read
+     *
+     * False only while INT is wired, deasserted, and a sample has already
+     * been read. registerApds9151Module() skips readData() and reports no
+     * data for this poll then.
+     */
+    bool sampleWaiting() const
+    {
+      return _options.intPin == 0xFF || !_haveSample || digitalRead(_options.intPin) == LOW;
+    }
+
+    /** Read and decode one sample; always goes to the bus. */
+    ModuleError readData(Apds9151Data *dataOut) override
+    {
+      uint8_t block[kBurstLength];
+      if (!readBurst(block))
+      {
+        return ModuleError::error(ModuleErrorType::CommunicationFail);
+      }
+      decode(block, _gain, _last);
+      _haveSample = true;
+
+      if ((_last.flags & kApds9151ProximityNew) && _options.intPin != 0xFF)
+      {
+        setProximityWindow(_last.proximity);
+      }
+      *dataOut = _last;
+      return ModuleError::ok();
+    }
+
+    /**
+     * @brief Decode a MAIN_STATUS..LS_DATA_RED_2 burst
+     *
+     * Channels whose data-ready bit is clear keep their previous value in
+     * @p out, so the same struct can be passed for every sample.
+     *
+     * @param gain Light sensor gain factor (1, 3, 6, 9 or 18)
+     */
+    static void decode(const uint8_t *block, uint8_t gain, Apds9151Data &out)
+    {
+      const uint8_t status = block[0];
+      uint8_t flags = out.flags & kApds9151ProximityOverflow;
+
+      if (status & static_cast<uint8_t>(APDS9151Driver::Status::PS_DATA_READY))
+      {
+        out.proximity = static_cast<uint16_t>(block[1] | ((block[2] & kPsDataMask) << 8));
+        flags = (block[2] & kPsOverflowBit) ? kApds9151ProximityOverflow : 0;
+        flags |= kApds9151ProximityNew;
+      }
+      if (status & static_cast<uint8_t>(APDS9151Driver::Status::LS_DATA_READY))
+      {
+        out.ir = le20(block + 3);
+        out.green = le20(block + 6);
+        out.blue = le20(block + 9);
+        out.red = le20(block + 12);
+        out.luxMilli = luxMilli(out.green, gain);
+        out.cctKelvin = cctKelvin(out.red, out.green, out.blue);
+        flags |= kApds9151LightNew;
+      }
+      if (status & static_cast<uint8_t>(APDS9151Driver::Status::PS_INT))
+      {
+        flags |= kApds9151ProximityEvent;
+      }
+      if (status & static_cast<uint8_t>(APDS9151Driver::Status::LS_INT))
+      {
+        flags |= kApds9151LightEvent;
+      }
+      out.flags = flags;
+    }
+
+    /** Illuminance from the green channel, same scale as APDS9151::getIlluminance(). */
+    static uint32_t luxMilli(uint32_t green, uint8_t gain)
+    {
+      return green * 10u / (gain ? gain : 1u);
+    }
+
+    /**
+     * @brief Correlated color temperature (McCamy) in integer arithmetic
+     *
+     * Same RGB-to-XYZ matrix and polynomial as
+     * APDS9151::getColorTemperature(); agrees with it to within 25 K
+     * between 1500 K and 20000 K.
+     *
+     * @return Kelvin, or 0 when the chromaticity is undefined
+     */
+    static uint16_t cctKelvin(uint32_t red, uint32_t green, uint32_t blue)
+    {
+      // Matrix in Q16. Near the pole of McCamy's n a coarser matrix is off
+      // by hundreds of kelvin, so keep full precision in 64 bits.
+      const int64_t r = red, g = green, b = blue;
+      const int64_t x = -9360 * r + 101531 * g - 62679 * b;
+      const int64_t y = -21277 * r + 103440 * g - 47966 * b;
+      const int64_t z = -44697 * r + 50511 * g + 36918 * b;
+      const int64_t sum = x + y + z;
+      if (sum <= 0)
+      {
+        return 0;
+      }
+
+      // n = (xc - 0.3320) / (0.1858 - yc), with xc = x / sum, yc = y / sum
+      int64_t num = x * 10000 - 3320 * sum;
+      int64_t den = 1858 * sum - y * 10000;
+      while (num > (int64_t(1) << 46) || num < -(int64_t(1) << 46))
+      {
+        num /= 2;
+        den /= 2;
+      }
+      if (den == 0)
+      {
+        return 0;
+      }
+      int64_t n = num * 65536 / den; // Q16
+      if (n < -8 * 65536 || n > 8 * 65536)
+      {
+        return 0;
+      }
+
+      // 449 n^3 + 3525 n^2 + 6823.3 n + 5520.33, Horner in Q16
+      int64_t acc = int64_t(449) << 16;
+      acc = ((acc * n) >> 16) + (int64_t(3525) << 16);
+      acc = ((acc * n) >> 16) + int64_t(682330) * 65536 / 100;
+      acc = ((acc * n) >> 16) + int64_t(552033) * 65536 / 100;
+      const int64_t kelvin = (acc + 32768) >> 16;
+      if (kelvin <= 0)
+      {
+        return 0;
+      }
+      return kelvin > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(kelvin);
+    }
+
+    /** Gain factor for an APDS9151::Gain value. */
+    static uint8_t gainFactor(uint8_t gainCode)
+    {
+      static constexpr uint8_t kFactors[] = {1, 3, 6, 9, 18};
+      return gainCode < sizeof(kFactors) ? kFactors[gainCode] : 1;
+    }
+
+  private:
+    static constexpr uint8_t kPsIntEn = 0x01;
+    static constexpr uint8_t kLsIntEn = 0x04;
+    static constexpr uint8_t kLsVarMode = 0x08;
+    static constexpr uint8_t kLsIntSelGreen = 0x10;
+    static constexpr uint8_t kPsDataMask = 0x07;
+    static constexpr uint8_t kPsOverflowBit = 0x08;
+    static constexpr uint16_t kPsMax = APDS9151Driver::PS_MAX_VALUE;
+
+    static uint32_t le20(const uint8_t *p)
+    {
+      return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+             (static_cast<uint32_t>(p[2] & 0x0F) << 16);
+    }
+
+    bool readBurst(uint8_t *block)
+    {
+      TwoWire &wire = peripherals().getI2C();
+      wire.beginTransmission(APDS9151Driver::DEFAULT_ADDRESS);
+      wire.write(kBurstRegister);
+      if (wire.endTransmission(false) != 0)
+      {
+        return false;
+      }
+      if (wire.requestFrom(APDS9151Driver::DEFAULT_ADDRESS, static_cast<size_t>(kBurstLength)) != kBurstLength)
+      {
+        return false;
+      }
+      return wire.readBytes(block, kBurstLength) == kBurstLength;
+    }
+
+    bool writeRegisters(APDS9151Driver::Register reg, const uint8_t *data, size_t len)
+    {
+      TwoWire &wire = peripherals().getI2C();
+      wire.beginTransmission(APDS9151Driver::DEFAULT_ADDRESS);
+      wire.write(static_cast<uint8_t>(reg));
+      wire.write(data, len);
+      return wire.endTransmission() == 0;
+    }
+
+    // PS_THRES_UP_0..PS_THRES_LOW_1 in one write.
+    bool setProximityWindow(uint16_t center)
+    {
+      const uint16_t band = _options.psDeadband;
+      const uint16_t up = center + band > kPsMax ? kPsMax : static_cast<uint16_t>(center + band);
+      const uint16_t low = center > band ? static_cast<uint16_t>(center - band) : 0;
+      const uint8_t thresholds[4] = {
+          static_cast<uint8_t>(up), static_cast<uint8_t>(up >> 8),
+          static_cast<uint8_t>(low), static_cast<uint8_t>(low >> 8),
+      };
+      return writeRegisters(APDS9151Driver::Register::PS_THRES_UP_0, thresholds, sizeof(thresholds));
+    }
+
+    Apds9151Options _options;
+    APDS9151Driver _driver;
+    uint8_t _gain = 3;
+    bool _haveSample = false;
+    Apds9151Data _last{};
+  };
+
+  namespace internal
+  {
+    /** Apds9151Module behind a gate that skips polls while INT is deasserted. */
+    struct Apds9151Holder
+    {
+      explicit Apds9151Holder(const ModuleConfig &config) : module(config) {}
+
+      bool beforeRead(std::vector<uint8_t> &out)
+      {
+        if (module.sampleWaiting())
+        {
+          return false;
+        }
+        out.clear(); // no data this poll
+        return true;
+      }
+
+      void afterRead(std::vector<uint8_t> &) {}
+      bool interceptJson(ArduinoJson::JsonVariantConst, bool &) { return false; }
+
+      Apds9151Module module;
+    };
+  } // namespace internal
+
+  /**
+   * @brief Register Apds9151Module with the system
+   *
+   * The built-in "APDS9151" type keeps its own per-channel driver; use this
+   * type identifier in the device config to select the burst-read module.
+   * Registering Apds9151Module through another helper (pipelines,
+   * report-on-change) loses the INT gate, and every poll reads the bus.
+   */
+  inline void registerApds9151Module(const std::string &typeIdentifier = "APDS9151_BURST")
+  {
+    internal::registerWrappedModule<Apds9151Data, internal::Apds9151Holder>(typeIdentifier);
+  }
+
+} // namespace LumynLabs
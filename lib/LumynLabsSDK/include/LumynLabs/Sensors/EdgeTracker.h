@@ -0,0 +1,206 @@
+/**
+ * @file EdgeTracker.h
+ * @brief Debounce and timing of timestamped digital edges
+ *
+ * Consumes raw edges that already carry an exact time (see
+ * PioEdgeCapture.h). Debouncing happens after the fact: an edge is
+ * accepted once the pin has held its new level for the debounce time, and
+ * it is dated to the first transition of the burst, not to the moment it
+ * was accepted. No task has to sleep through the bounce.
+ *
+ * For each pin the tracker keeps the level, the rising-edge period, the
+ * high time, and frequency and RPM derived from them.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Per-pin settings
+   */
+  struct EdgePinConfig
+  {
+    uint32_t debounceUs = 0;    ///< Time a new level must hold; 0 accepts every edge
+    uint16_t pulsesPerRev = 1;  ///< Rising edges per revolution, for rpm
+    uint32_t staleUs = 1000000; ///< Report 0 Hz when no rising edge for this long
+  };
+
+  /**
+   * @brief Per-pin measurements (32 bytes, status payload layout)
+   */
+  struct EdgePinStats
+  {
+    uint8_t level;             ///< Debounced level
+    uint8_t reserved;
+    uint16_t pulsesPerRev;
+    uint32_t edges;            ///< Accepted edges
+    uint32_t bounces;          ///< Raw edges rejected by the debounce
+    uint32_t lastEdgeUs;       ///< Time of the last accepted edge
+    uint32_t periodUs;         ///< Rising edge to rising edge, 0 until two rises or when stale
+    uint32_t highUs;           ///< Last rising-to-falling time
+    uint32_t frequencyMilliHz; ///< 1e9 / periodUs
+    uint32_t rpmMilli;         ///< 60e9 / (periodUs * pulsesPerRev)
+  };
+  static_assert(sizeof(EdgePinStats) == 32, "EdgePinStats is part of the status format");
+
+  /**
+   * @brief Debounce and period tracking for up to @p MaxPins pins
+   *
+   * Not thread-safe; feed it from the one task that drains the capture.
+   *
+   * @tparam MaxPins Tracked pins; pin indices are 0..MaxPins-1
+   */
+  template <size_t MaxPins = 8>
+  class EdgeTracker
+  {
+  public:
+    /** Set a pin's options and its level at startup. */
+    void configure(size_t pin, const EdgePinConfig &config, bool level, uint32_t nowUs)
+    {
+      if (pin >= MaxPins)
+      {
+        return;
+      }
+      Pin &p = _pins[pin];
+      p = Pin{};
+      p.config = config;
+      p.stable = level;
+      p.raw = level;
+      p.lastRawUs = nowUs;
+    }
+
+    /**
+     * @brief Report a raw edge
+     *
+     * Edges of one pin must arrive in time order.
+     */
+    void onEdge(size_t pin, bool level, uint32_t atUs)
+    {
+      if (pin >= MaxPins)
+      {
+        return;
+      }
+      Pin &p = _pins[pin];
+      if (level == p.raw)
+      {
+        return;
+      }
+      settle(p, atUs);
+      if (p.pending)
+      {
+        ++p.bounces;
+      }
+      else
+      {
+        p.pending = true;
+        p.pendingUs = atUs;
+      }
+      p.raw = level;
+      p.lastRawUs = atUs;
+    }
+
+    /** Accept pending edges whose debounce time has passed by @p nowUs. */
+    void update(uint32_t nowUs)
+    {
+      for (auto &p : _pins)
+      {
+        settle(p, nowUs);
+      }
+    }
+
+    /** Debounced level of @p pin. */
+    bool level(size_t pin) const { return pin < MaxPins && _pins[pin].stable; }
+
+    /** Copy the measurements of @p pin as of @p nowUs. */
+    EdgePinStats stats(size_t pin, uint32_t nowUs) const
+    {
+      EdgePinStats s{};
+      if (pin >= MaxPins)
+      {
+        return s;
+      }
+      const Pin &p = _pins[pin];
+      s.level = p.stable;
+      s.pulsesPerRev = p.config.pulsesPerRev;
+      s.edges = p.edges;
+      s.bounces = p.bounces;
+      s.lastEdgeUs = p.lastEdgeUs;
+      s.highUs = p.highUs;
+
+      // A signal that stopped would keep its last period forever otherwise.
+      if (p.periodUs && nowUs - p.lastRiseUs <= p.config.staleUs)
+      {
+        s.periodUs = p.periodUs;
+        s.frequencyMilliHz = static_cast<uint32_t>(1000000000ull / p.periodUs);
+        const uint64_t perRev = static_cast<uint64_t>(p.periodUs) * (p.config.pulsesPerRev ? p.config.pulsesPerRev : 1);
+        s.rpmMilli = static_cast<uint32_t>(60000000000ull / perRev);
+      }
+      return s;
+    }
+
+  private:
+    struct Pin
+    {
+      EdgePinConfig config;
+      bool stable = false;
+      bool raw = false;
+      bool pending = false;
+      bool hadRise = false;
+      uint32_t pendingUs = 0;
+      uint32_t lastRawUs = 0;
+      uint32_t lastEdgeUs = 0;
+      uint32_t lastRiseUs = 0;
+      uint32_t periodUs = 0;
+      uint32_t highUs = 0;
+      uint32_t edges = 0;
+      uint32_t bounces = 0;
+    };
+
+    void settle(Pin &p, uint32_t nowUs)
+    {
+      if (!p.pending || static_cast<int32_t>(nowUs - p.lastRawUs) < static_cast<int32_t>(p.config.debounceUs))
+      {
+        return;
+      }
+      p.pending = false;
+      if (p.raw == p.stable)
+      {
+        // The burst ended where it started: a glitch, not an edge.
+        ++p.bounces;
+        return;
+      }
+      accept(p, p.raw, p.pendingUs);
+    }
+
+    void accept(Pin &p, bool level, uint32_t atUs)
+    {
+      p.stable = level;
+      ++p.edges;
+      p.lastEdgeUs = atUs;
+      if (level)
+      {
+        if (p.hadRise)
+        {
+          p.periodUs = atUs - p.lastRiseUs;
+        }
+        p.hadRise = true;
+        p.lastRiseUs = atUs;
+      }
+      else if (p.hadRise)
+      {
+        p.highUs = atUs - p.lastRiseUs;
+      }
+    }
+
+    Pin _pins[MaxPins];
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,450 @@
+/**
+ * @file PioEdgeCapture.h
+ * @brief Microsecond edge timestamps for DIO pins, captured by PIO into a DMA ring
+ *
+ * A PIO state machine samples a group of consecutive GPIOs once per
+ * microsecond and counts the samples. Whenever the group's state changes
+ * it pushes one word: the new pin states in the top bits and the sample
+ * count in the rest. A DMA channel copies the words into an RxSpanRing.
+ * The CPU is not involved per edge, and an edge is dated to the sample
+ * where it happened, not to when a task got round to looking.
+ *
+ * poll() drains the ring and hands every edge, with its absolute time,
+ * to an EdgeTracker. The tracker debounces and measures period,
+ * frequency and RPM per pin. One poll per module replaces a debounce or
+ * detection task per sensor.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Networking/RxSpanRing.h"
+#include "EdgeTracker.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Turns capture words into per-pin edges with absolute times
+   *
+   * Word layout for a group of N pins: bits 31..32-N hold the pin states
+   * (first pin in the lowest of them); bits 31-N..0 hold the low bits of
+   * a down-counter that starts at all ones and steps once per
+   * microsecond. The counter wraps every 2^(32-N) us (16.7 s for 8
+   * pins), so words must be decoded within that time of being captured.
+   */
+  class EdgeWordDecoder
+  {
+  public:
+    /** Largest group one state machine can capture. */
+    static constexpr uint8_t kMaxPins = 8;
+
+    /**
+     * @param pinCount Pins in the group, 1..kMaxPins
+     * @param startUs  Microsecond clock reading when the counter started
+     */
+    void begin(uint8_t pinCount, uint64_t startUs)
+    {
+      _pinCount = pinCount;
+      _countBits = static_cast<uint8_t>(32 - pinCount);
+      _countMask = (uint32_t{1} << _countBits) - 1;
+      _startUs = startUs;
+      _haveState = false;
+      _state = 0;
+    }
+
+    uint8_t pinCount() const { return _pinCount; }
+
+    /**
+     * @brief Decode one word
+     *
+     * @param word  Captured word
+     * @param nowUs Current reading of the same microsecond clock; anchors
+     *              the counter's wraps
+     * @param sink  Called as sink(pinIndex, level, timeUs) for every pin
+     *              that changed, where timeUs is the low 32 bits of the
+     *              clock at the edge
+     */
+    template <typename Sink>
+    void decode(uint32_t word, uint64_t nowUs, Sink &&sink)
+    {
+      const uint32_t state = word >> _countBits;
+      const uint32_t count = (_countMask - (word & _countMask)) & _countMask;
+
+      // The latest sample number not after now (plus slack for the start
+      // offset) that has these low bits.
+      const uint64_t base = (nowUs - _startUs) + kSlackUs;
+      const uint64_t sample = base - ((base - count) & _countMask);
+      const uint32_t atUs = static_cast<uint32_t>(_startUs + sample);
+
+      // The first word is the group's state at start; it reports no edges.
+      const uint32_t changed = _haveState ? (state ^ _state) : 0;
+      _state = state;
+      _haveState = true;
+      for (uint8_t pin = 0; pin < _pinCount; ++pin)
+      {
+        if (changed & (1u << pin))
+        {
+          sink(pin, ((state >> pin) & 1u) != 0, atUs);
+        }
+      }
+    }
+
+    /** Pin states from the newest word. */
+    uint32_t state() const { return _state; }
+    bool hasState() const { return _haveState; }
+
+  private:
+    static constexpr uint64_t kSlackUs = 1000;
+
+    uint8_t _pinCount = 0;
+    uint8_t _countBits = 32;
+    uint32_t _countMask = 0;
+    uint64_t _startUs = 0;
+    uint32_t _state = 0;
+    bool _haveState = false;
+  };
+
+} // namespace LumynLabs
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
+#include <hardware/pio_instructions.h>
+#include <pico/time.h>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief PIO + DMA edge capture for up to 8 consecutive GPIOs
+   *
+   * @tparam RingBytes Capture ring size (power of two, 256..32768); each
+   *                   edge takes 4 bytes
+   *
+   * @code
+   * static LumynLabs::RxRingStorage<1024> dioRing;
+   * static LumynLabs::PioEdgeCapture<> dio(dioRing);
+   * dio.begin(pio1, 10, 2, true);               // GPIO10 = beam break, GPIO11 = hall
+   * dio.configurePin(0, {5000, 1, 1000000});   // 5 ms debounce
+   * dio.configurePin(1, {0, 4, 500000});       // 4 magnets per revolution
+   *
+   * // in readData(), no other task needed
+   * dio.poll();
+   * LumynLabs::EdgePinStats hall = dio.stats(1);
+   * out->rpm = hall.rpmMilli / 1000;
+   * @endcode
+   */
+  template <size_t RingBytes = 1024>
+  class PioEdgeCapture
+  {
+  public:
+    explicit PioEdgeCapture(RxRingStorage<RingBytes> &storage) : _ring(storage) {}
+    PioEdgeCapture(const PioEdgeCapture &) = delete;
+    PioEdgeCapture &operator=(const PioEdgeCapture &) = delete;
+
+    /**
+     * @brief Load the program and start capturing
+     *
+     * @param pio      pio0 or pio1
+     * @param firstPin Lowest GPIO of the group
+     * @param pinCount Consecutive GPIOs to capture, 1..8; pins in the range
+     *                 that are not configured still take ring space when
+     *                 they toggle
+     * @param pullUp   Enable the pull-ups (open-collector sensors)
+     * @return false if no state machine, program space or DMA channel is free
+     */
+    bool begin(PIO pio, uint firstPin, uint pinCount, bool pullUp)
+    {
+      if (_pio || pinCount == 0 || pinCount > EdgeWordDecoder::kMaxPins || firstPin + pinCount > NUM_BANK0_GPIOS)
+      {
+        return false;
+      }
+      const int sm = pio_claim_unused_sm(pio, false);
+      if (sm < 0)
+      {
+        return false;
+      }
+      buildProgram(pinCount);
+      if (!pio_can_add_program(pio, &_program))
+      {
+        pio_sm_unclaim(pio, sm);
+        return false;
+      }
+      const int channel = dma_claim_unused_channel(false);
+      if (channel < 0)
+      {
+        pio_sm_unclaim(pio, sm);
+        return false;
+      }
+      PioEdgeCapture **slot = freeInstance();
+      if (!slot)
+      {
+        dma_channel_unclaim(channel);
+        pio_sm_unclaim(pio, sm);
+        return false;
+      }
+
+      _pio = pio;
+      _sm = static_cast<uint>(sm);
+      _channel = static_cast<uint>(channel);
+      _firstPin = firstPin;
+      _offset = pio_add_program(pio, &_program);
+      _base = 0;
+
+      for (uint pin = firstPin; pin < firstPin + pinCount; ++pin)
+      {
+        gpio_init(pin);
+        gpio_set_dir(pin, false);
+        gpio_set_pulls(pin, pullUp, false);
+      }
+
+      pio_sm_config config = pio_get_default_sm_config();
+      sm_config_set_wrap(&config, _offset + kWrapTarget, _offset + kWrap);
+      sm_config_set_in_pins(&config, firstPin);
+      sm_config_set_in_shift(&config, false, false, 32);
+      sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+      // kCyclesPerSample cycles per loop at clk_sys / (MHz / 16): one
+      // sample per microsecond, exact for any whole-MHz system clock.
+      const uint32_t div256 = static_cast<uint32_t>((static_cast<uint64_t>(clock_get_hz(clk_sys)) * 256) /
+                                                    (kCyclesPerSample * 1000000u));
+      sm_config_set_clkdiv_int_frac(&config, static_cast<uint16_t>(div256 >> 8), static_cast<uint8_t>(div256 & 0xFF));
+      pio_sm_init(pio, _sm, _offset, &config);
+      pio_sm_set_consecutive_pindirs(pio, _sm, firstPin, pinCount, false);
+
+      // X counts samples down from all ones; Y (last state) starts at a
+      // value no group can have, so the first sample is always pushed.
+      pio_sm_exec(pio, _sm, pio_encode_mov_not(pio_x, pio_null));
+      pio_sm_exec(pio, _sm, pio_encode_mov_not(pio_y, pio_null));
+
+      dma_channel_config dma = dma_channel_get_default_config(_channel);
+      channel_config_set_transfer_data_size(&dma, DMA_SIZE_32);
+      channel_config_set_read_increment(&dma, false);
+      channel_config_set_write_increment(&dma, true);
+      channel_config_set_ring(&dma, true, RxSpanRing<RingBytes>::sizeBits());
+      channel_config_set_dreq(&dma, pio_get_dreq(pio, _sm, false));
+      dma_channel_set_irq1_enabled(_channel, true);
+      *slot = this;
+      if (activeCount() == 1)
+      {
+        irq_add_shared_handler(DMA_IRQ_1, &PioEdgeCapture::dmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+      }
+      dma_channel_configure(_channel, &dma, _ring.storage(), &pio->rxf[_sm], kTransferCount, true);
+
+      _decoder.begin(static_cast<uint8_t>(pinCount), time_us_64());
+      pio_sm_set_enabled(pio, _sm, true);
+      return true;
+    }
+
+    /** Stop capturing and release the state machine, program and DMA channel. */
+    void end()
+    {
+      if (!_pio)
+      {
+        return;
+      }
+      pio_sm_set_enabled(_pio, _sm, false);
+      dma_channel_set_irq1_enabled(_channel, false);
+      dma_channel_abort(_channel);
+      dma_channel_unclaim(_channel);
+      pio_remove_program(_pio, &_program, _offset);
+      pio_sm_unclaim(_pio, _sm);
+      for (size_t i = 0; i < kMaxInstances; ++i)
+      {
+        if (instances()[i] == this)
+        {
+          instances()[i] = nullptr;
+        }
+      }
+      if (activeCount() == 0)
+      {
+        irq_remove_handler(DMA_IRQ_1, &PioEdgeCapture::dmaIrq);
+      }
+      _pio = nullptr;
+    }
+
+    /**
+     * @brief Set debounce and RPM options for one pin of the group
+     *
+     * Resets that pin's measurements. The starting level is read from the
+     * pin directly.
+     */
+    void configurePin(size_t index, const EdgePinConfig &config)
+    {
+      _tracker.configure(index, config, gpio_get(_firstPin + index), static_cast<uint32_t>(time_us_64()));
+    }
+
+    /**
+     * @brief Drain captured edges into the tracker
+     *
+     * Call at least every few seconds (the counter wraps after 16.7 s
+     * with 8 pins) and before reading stats().
+     */
+    void poll()
+    {
+      _ring.publish(bytesWritten());
+      const uint64_t now = time_us_64();
+      RxSpan spans[2];
+      const size_t count = _ring.peek(spans);
+      size_t consumed = 0;
+      for (size_t i = 0; i < count; ++i)
+      {
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(spans[i].data);
+        const size_t n = spans[i].length / sizeof(uint32_t);
+        for (size_t w = 0; w < n; ++w)
+        {
+          _decoder.decode(words[w], now, [this](uint8_t pin, bool level, uint32_t atUs)
+                          { _tracker.onEdge(pin, level, atUs); });
+        }
+        consumed += n * sizeof(uint32_t);
+      }
+      _ring.consume(consumed);
+      _tracker.update(static_cast<uint32_t>(now));
+
+      const uint32_t stallBit = 1u << (PIO_FDEBUG_RXSTALL_LSB + _sm);
+      if (_pio->fdebug & stallBit)
+      {
+        _pio->fdebug = stallBit;
+        ++_stalls;
+      }
+    }
+
+    /** Measurements of pin @p index of the group, as of the last poll(). */
+    EdgePinStats stats(size_t index) const { return _tracker.stats(index, static_cast<uint32_t>(time_us_64())); }
+
+    /** Debounced level of pin @p index. */
+    bool level(size_t index) const { return _tracker.level(index); }
+
+    /** Edges lost because poll() fell a full ring behind. */
+    uint32_t overrunEdges() const { return _ring.overrunBytes() / sizeof(uint32_t); }
+
+    /** Polls that found the state machine had stalled on a full FIFO (times shifted). */
+    uint32_t stalls() const { return _stalls; }
+
+  private:
+    static constexpr uint32_t kTransferCount = 0xFFFFFFFFu;
+    static constexpr uint kCyclesPerSample = 16;
+    static constexpr uint kWrapTarget = 0;
+    static constexpr uint kWrap = 6;
+    static constexpr uint kChanged = 7;
+    static constexpr size_t kMaxInstances = NUM_PIOS * 4;
+
+    static PioEdgeCapture **instances()
+    {
+      static PioEdgeCapture *table[kMaxInstances] = {};
+      return table;
+    }
+
+    static PioEdgeCapture **freeInstance()
+    {
+      for (size_t i = 0; i < kMaxInstances; ++i)
+      {
+        if (!instances()[i])
+        {
+          return &instances()[i];
+        }
+      }
+      return nullptr;
+    }
+
+    static size_t activeCount()
+    {
+      size_t count = 0;
+      for (size_t i = 0; i < kMaxInstances; ++i)
+      {
+        count += instances()[i] != nullptr;
+      }
+      return count;
+    }
+
+    // Both paths take exactly kCyclesPerSample cycles so X counts samples:
+    //
+    //  0 sample:  mov osr, x           ; park the counter
+    //  1          mov isr, null
+    //  2          in pins, N            ; isr = group state
+    //  3          mov x, isr
+    //  4          jmp x!=y changed
+    //  5          mov x, osr     [9]
+    //  6          jmp x-- sample        ; .wrap (falls through on 0 -> wraps)
+    //  7 changed: mov y, x
+    //  8          in osr, 32-N          ; isr = state << (32-N) | counter
+    //  9          push block
+    // 10          mov x, osr     [6]
+    // 11          jmp x-- sample
+    // 12          jmp sample            ; counter reached zero (once per 71 min)
+    void buildProgram(uint pinCount)
+    {
+      _code[0] = pio_encode_mov(pio_osr, pio_x);
+      _code[1] = pio_encode_mov(pio_isr, pio_null);
+      _code[2] = pio_encode_in(pio_pins, pinCount);
+      _code[3] = pio_encode_mov(pio_x, pio_isr);
+      _code[4] = pio_encode_jmp_x_ne_y(kChanged);
+      _code[5] = pio_encode_mov(pio_x, pio_osr) | pio_encode_delay(9);
+      _code[6] = pio_encode_jmp_x_dec(kWrapTarget);
+      _code[7] = pio_encode_mov(pio_y, pio_x);
+      _code[8] = pio_encode_in(pio_osr, 32 - pinCount);
+      _code[9] = pio_encode_push(false, true);
+      _code[10] = pio_encode_mov(pio_x, pio_osr) | pio_encode_delay(6);
+      _code[11] = pio_encode_jmp_x_dec(kWrapTarget);
+      _code[12] = pio_encode_jmp(kWrapTarget);
+      _program = {};
+      _program.instructions = _code;
+      _program.length = kProgramLength;
+      _program.origin = -1;
+    }
+
+    uint32_t bytesWritten() const
+    {
+      uint32_t base;
+      uint32_t remaining;
+      do
+      {
+        base = _base;
+        remaining = dma_channel_hw_addr(_channel)->transfer_count;
+      } while (base != _base);
+      return (base + (kTransferCount - remaining)) * sizeof(uint32_t);
+    }
+
+    static void dmaIrq()
+    {
+      for (size_t i = 0; i < kMaxInstances; ++i)
+      {
+        PioEdgeCapture *self = instances()[i];
+        if (self && dma_channel_get_irq1_status(self->_channel))
+        {
+          dma_channel_acknowledge_irq1(self->_channel);
+          self->_base += kTransferCount;
+          dma_channel_set_trans_count(self->_channel, kTransferCount, true);
+        }
+      }
+    }
+
+    static constexpr uint8_t kProgramLength = 13;
+
+    RxSpanRing<RingBytes> _ring;
+    EdgeWordDecoder _decoder;
+    EdgeTracker<EdgeWordDecoder::kMaxPins> _tracker;
+    uint16_t _code[kProgramLength];
+    pio_program_t _program{};
+    PIO _pio = nullptr;
+    uint _sm = 0;
+    uint _offset = 0;
+    uint _channel = 0;
+    uint _firstPin = 0;
+    volatile uint32_t _base = 0;
+    uint32_t _stalls = 0;
+  };
+
+} // namespace LumynLabs
+
+#endif // ARDUINO_ARCH_RP2040
@@ -0,0 +1,569 @@
+/**
+ * @file Vl53l1xRanger.h
+ * @brief Interrupt-driven continuous ranging for one or more VL53L1X sensors
+ *
+ * The bundled VL53L1X driver polls dataReady() over I2C and then reads the
+ * results with blocking Wire calls. Vl53l1xRanger uses that driver only to
+ * configure the sensors at boot. After that each sensor free-runs in
+ * continuous mode, and its GPIO1 interrupt starts three queued I2C
+ * transfers and nothing else:
+ *
+ *   1. one burst read of RESULT__RANGE_STATUS .. RESULT__PEAK_SIGNAL_COUNT_
+ *      RATE_CROSSTALK_CORRECTED_MCPS_SD0 (0x0089..0x0099, 17 bytes)
+ *   2. the dynamic SPAD selection update computed from that block
+ *   3. SYSTEM__INTERRUPT_CLEAR
+ *
+ * Several sensors can share a bus. At boot all are held in reset through
+ * XSHUT, then brought up one at a time and moved to their own address.
+ *
+ * Only bring-up needs Arduino and the bundled driver. The interrupt and
+ * transfer handling also builds on the host, where tools/vl53l1x_bench.cpp
+ * runs it against a simulated bus.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "../Bus/I2cQueue.h"
+#include "../Modules/ModuleError.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <VL53L1X.h>
+#endif
+
+namespace LumynLabs
+{
+
+  /** Marks an XSHUT or interrupt pin that is not connected. */
+  constexpr uint8_t kVl53l1xNoPin = 0xFF;
+
+  /**
+   * @brief Range status, same values as VL53L1X::RangeStatus
+   */
+  enum Vl53l1xRangeStatus : uint8_t
+  {
+    kVl53l1xRangeValid = 0,
+    kVl53l1xSigmaFail = 1,
+    kVl53l1xSignalFail = 2,
+    kVl53l1xRangeValidMinRangeClipped = 3,
+    kVl53l1xOutOfBoundsFail = 4,
+    kVl53l1xHardwareFail = 5,
+    kVl53l1xRangeValidNoWrapCheckFail = 6,
+    kVl53l1xWrapTargetFail = 7,
+    kVl53l1xXtalkSignalFail = 9,
+    kVl53l1xSynchronizationInt = 10,
+    kVl53l1xMinRangeFail = 13,
+    kVl53l1xNone = 255,
+  };
+
+  /**
+   * @brief Wiring of one sensor
+   */
+  struct Vl53l1xSensorPins
+  {
+    uint8_t xshutPin; ///< XSHUT (active low), or kVl53l1xNoPin for a single sensor
+    uint8_t intPin;   ///< GPIO1 (active low, data ready)
+    uint8_t address;  ///< 7-bit address to assign at boot
+  };
+
+  /**
+   * @brief One decoded range (12 bytes, fixed layout for module payloads)
+   */
+  struct Vl53l1xRange
+  {
+    uint16_t rangeMm;        ///< Gain-corrected range
+    uint8_t status;          ///< Vl53l1xRangeStatus
+    uint8_t streamCount;     ///< RESULT__STREAM_COUNT, advances each measurement
+    uint16_t peakSignalMcps; ///< Peak signal rate, 9.7 fixed point
+    uint16_t ambientMcps;    ///< Ambient rate, 9.7 fixed point
+    uint32_t timestampUs;    ///< Time of the data-ready interrupt
+  };
+  static_assert(sizeof(Vl53l1xRange) == 12, "Vl53l1xRange is part of the module data format");
+
+  /**
+   * @brief Counters for all sensors of a ranger
+   */
+  struct Vl53l1xStats
+  {
+    uint32_t ranges;     ///< New ranges decoded
+    uint32_t interrupts; ///< Data-ready interrupts seen
+    uint32_t missed;     ///< Interrupts that arrived while the previous read was still queued
+    uint32_t recoveries; ///< Reads started by service() after a lost interrupt
+    uint32_t errors;     ///< Transfers that did not complete with I2cStatus::Ok
+    uint32_t i2cBytes;   ///< Bytes written plus bytes read
+  };
+
+  /**
+   * @brief Continuous ranging on up to @p MaxSensors VL53L1X sensors
+   *
+   * begin() attaches a falling-edge handler to each sensor's GPIO1 pin;
+   * do not configure those pins as SDK pin interrupts as well. The handler
+   * stamps the range and queues its read, so the timestamp is the time of
+   * the interrupt, not of whichever task gets to it later. Completion runs
+   * in the I2C driver's interrupt, so latest() never waits for the bus.
+   *
+   * @code
+   * static LumynLabs::Rp2040I2cDma<> i2cDriver;
+   * static LumynLabs::I2cQueue i2c(i2cDriver);
+   * static LumynLabs::Vl53l1xRanger<2> tof(i2c);
+   *
+   * LumynLabs::ModuleError TofModule::initModule() {
+   *   tof.addSensor({6, 7, 0x30});
+   *   tof.addSensor({8, 9, 0x31});
+   *   auto err = tof.begin(peripherals().getI2C(), 20, 18000, VL53L1X::Short);
+   *   if (err) return err;
+   *   i2cDriver.begin(i2c0);             // Wire is not used after begin()
+   *   return LumynLabs::ModuleError::ok();
+   * }
+   *
+   * // periodically: tof.service(micros());
+   *
+   * LumynLabs::ModuleError TofModule::readData(TofData* out) {
+   *   tof.latest(0, out->left);
+   *   tof.latest(1, out->right);
+   *   return LumynLabs::ModuleError::ok();
+   * }
+   * @endcode
+   */
+  template <size_t MaxSensors = 4>
+  class Vl53l1xRanger
+  {
+    static_assert(MaxSensors > 0, "Need at least one sensor");
+
+  public:
+    /** First result register (RESULT__RANGE_STATUS) and length of the burst read. */
+    static constexpr uint16_t kResultRegister = 0x0089;
+    static constexpr uint16_t kResultLength = 17;
+    /** DSS_CONFIG__MANUAL_EFFECTIVE_SPADS_SELECT */
+    static constexpr uint16_t kDssSpadsRegister = 0x0054;
+    /** SYSTEM__INTERRUPT_CLEAR */
+    static constexpr uint16_t kInterruptClearRegister = 0x0086;
+
+    /**
+     * @param queue Queue of the bus the sensors are on
+     * @param owner Module ID charged for the bus time
+     */
+    explicit Vl53l1xRanger(I2cQueue &queue, uint16_t owner = kBusNoOwner) : _queue(queue), _owner(owner) {}
+
+    Vl53l1xRanger(const Vl53l1xRanger &) = delete;
+    Vl53l1xRanger &operator=(const Vl53l1xRanger &) = delete;
+
+    /** Add a sensor before begin(); false when full. */
+    bool addSensor(const Vl53l1xSensorPins &pins)
+    {
+      if (_count == MaxSensors)
+      {
+        return false;
+      }
+      _sensors[_count].pins = pins;
+      ++_count;
+      return true;
+    }
+
+    size_t count() const { return _count; }
+
+    /**
+     * @brief Bring up every sensor and start continuous ranging
+     *
+     * Uses @p wire with the bundled driver, so call it before the queue's
+     * driver takes over the bus. Each sensor ranges once in blocking mode
+     * to finish its calibration; later ranges are interrupt driven.
+     *
+     * @param wire     Bus the sensors are on
+     * @param periodMs Inter-measurement period
+     * @param budgetUs Timing budget per measurement, at most the period
+     * @param mode     Distance mode for all sensors
+     */
+#if defined(ARDUINO)
+    ModuleError begin(TwoWire &wire, uint32_t periodMs, uint32_t budgetUs, VL53L1X::DistanceMode mode)
+    {
+      if (_count == 0 || (_count > 1 && !allHaveXshut()))
+      {
+        return ModuleError::error(ModuleErrorType::InvalidConfig);
+      }
+
+      // Hold every sensor in reset so they all answer the default address
+      // one at a time.
+      for (size_t i = 0; i < _count; ++i)
+      {
+        if (_sensors[i].pins.xshutPin != kVl53l1xNoPin)
+        {
+          pinMode(_sensors[i].pins.xshutPin, OUTPUT);
+          digitalWrite(_sensors[i].pins.xshutPin, LOW);
+        }
+      }
+      delay(2);
+
+      for (size_t i = 0; i < _count; ++i)
+      {
+        Sensor &s = _sensors[i];
+        if (s.pins.xshutPin != kVl53l1xNoPin)
+        {
+          digitalWrite(s.pins.xshutPin, HIGH);
+          delay(2); // tBOOT is 1.2 ms
+        }
+        s.device.setBus(&wire);
+        s.device.setTimeout(100);
+        if (!s.device.init())
+        {
+          return ModuleError::error(ModuleErrorType::CommunicationFail, static_cast<uint8_t>(i));
+        }
+        s.device.setAddress(s.pins.address);
+        if (!s.device.setDistanceMode(mode) || !s.device.setMeasurementTimingBudget(budgetUs))
+        {
+          return ModuleError::error(ModuleErrorType::InvalidConfig, static_cast<uint8_t>(i));
+        }
+      }
+
+      for (size_t i = 0; i < _count; ++i)
+      {
+        Sensor &s = _sensors[i];
+        s.device.startContinuous(periodMs);
+        s.device.read(true);
+        if (s.device.timeoutOccurred())
+        {
+          return ModuleError::error(ModuleErrorType::Timeout, static_cast<uint8_t>(i));
+        }
+      }
+
+      start(periodMs);
+      for (size_t i = 0; i < _count; ++i)
+      {
+        attachInterruptParam(digitalPinToInterrupt(_sensors[i].pins.intPin), &Vl53l1xRanger::onGpio, FALLING,
+                             &_sensors[i]);
+      }
+      return ModuleError::ok();
+    }
+#endif
+
+    /**
+     * @brief Arm interrupt-driven reads of sensors that are already ranging
+     *
+     * Called by begin(). Without Arduino (host simulations) call it
+     * directly once the simulated sensors are running.
+     */
+    void start(uint32_t periodMs)
+    {
+      _periodUs = periodMs * 1000u;
+      const uint32_t now = I2cQueue::nowUs();
+      for (size_t i = 0; i < _count; ++i)
+      {
+        prepare(_sensors[i]);
+        _sensors[i].lastIrqUs = now;
+      }
+    }
+
+    /**
+     * @brief Stamp and start the result read for the sensor wired to @p pin
+     *
+     * Called from the GPIO handler begin() attaches, and safe to call from
+     * any other interrupt handler; the range is stamped with the time of
+     * this call.
+     * @return true if @p pin belongs to a sensor
+     */
+    bool onPinInterrupt(uint8_t pin)
+    {
+      for (size_t i = 0; i < _count; ++i)
+      {
+        if (_sensors[i].pins.intPin == pin)
+        {
+          _stats.interrupts.fetch_add(1, std::memory_order_relaxed);
+          startRead(_sensors[i], false);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * @brief Recover sensors whose interrupt was lost
+     *
+     * If a sensor has been silent for two periods plus 10 ms, its result
+     * is read anyway; that also clears its interrupt so GPIO1 can fire
+     * again. Call every few periods.
+     */
+    void service(uint32_t nowUs)
+    {
+      const uint32_t limit = 2 * _periodUs + 10000;
+      for (size_t i = 0; i < _count; ++i)
+      {
+        Sensor &s = _sensors[i];
+        if (s.idle() && nowUs - s.lastIrqUs > limit)
+        {
+          _stats.recoveries.fetch_add(1, std::memory_order_relaxed);
+          startRead(s, true);
+        }
+      }
+    }
+
+    /**
+     * @brief Copy the newest range of sensor @p index
+     * @return false if the index is out of range or nothing was read yet
+     */
+    bool latest(size_t index, Vl53l1xRange &out) const
+    {
+      if (index >= _count)
+      {
+        return false;
+      }
+      const Sensor &s = _sensors[index];
+      uint32_t seq;
+      do
+      {
+        seq = s.seq.load(std::memory_order_acquire);
+        out = s.range;
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((seq & 1u) || seq != s.seq.load(std::memory_order_relaxed));
+      return seq != 0;
+    }
+
+    Vl53l1xStats stats() const
+    {
+      return Vl53l1xStats{
+          _stats.ranges.load(std::memory_order_relaxed),
+          _stats.interrupts.load(std::memory_order_relaxed),
+          _stats.missed.load(std::memory_order_relaxed),
+          _stats.recoveries.load(std::memory_order_relaxed),
+          _stats.errors.load(std::memory_order_relaxed),
+          _stats.i2cBytes.load(std::memory_order_relaxed),
+      };
+    }
+
+    /** Decode the 17-byte result block the way VL53L1X::read() does. */
+    static void decode(const uint8_t *block, Vl53l1xRange &out)
+    {
+      const uint8_t rangeStatus = block[0];
+      out.streamCount = block[2];
+      out.ambientMcps = be16(block + 7);
+      out.peakSignalMcps = be16(block + 15);
+      // Ranging gain factor 2011/2048, rounded (VL53L1_TUNINGPARM_LITE_RANGING_GAIN_FACTOR_DEFAULT).
+      out.rangeMm = static_cast<uint16_t>((static_cast<uint32_t>(be16(block + 13)) * 2011 + 0x0400) / 0x0800);
+      out.status = convertStatus(rangeStatus, out.streamCount);
+    }
+
+    /** SPAD count for DSS_CONFIG__MANUAL_EFFECTIVE_SPADS_SELECT from a result block. */
+    static uint16_t dssSpads(const uint8_t *block)
+    {
+      constexpr uint32_t kTargetRate = 0x0A00;
+      const uint16_t spadCount = be16(block + 3);
+      if (spadCount != 0)
+      {
+        uint32_t totalRatePerSpad = static_cast<uint32_t>(be16(block + 15)) + be16(block + 7);
+        if (totalRatePerSpad > 0xFFFF)
+        {
+          totalRatePerSpad = 0xFFFF;
+        }
+        totalRatePerSpad = (totalRatePerSpad << 16) / spadCount;
+        if (totalRatePerSpad != 0)
+        {
+          const uint32_t required = (kTargetRate << 16) / totalRatePerSpad;
+          return required > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(required);
+        }
+      }
+      return 0x8000;
+    }
+
+  private:
+    struct Sensor
+    {
+      Vl53l1xSensorPins pins{kVl53l1xNoPin, kVl53l1xNoPin, 0};
+#if defined(ARDUINO)
+      VL53L1X device;
+#endif
+      I2cTransfer read;
+      I2cTransfer dss;
+      I2cTransfer clear;
+      uint8_t readTx[2];
+      uint8_t dssTx[4];
+      uint8_t clearTx[3];
+      uint8_t block[kResultLength];
+      volatile uint32_t lastIrqUs = 0;
+      uint32_t pendingIrqUs = 0;
+      Vl53l1xRange range{};
+      std::atomic<uint32_t> seq{0};
+      Vl53l1xRanger *owner = nullptr;
+
+      bool idle() const { return read.done() && dss.done() && clear.done(); }
+    };
+
+    struct AtomicStats
+    {
+      std::atomic<uint32_t> ranges{0};
+      std::atomic<uint32_t> interrupts{0};
+      std::atomic<uint32_t> missed{0};
+      std::atomic<uint32_t> recoveries{0};
+      std::atomic<uint32_t> errors{0};
+      std::atomic<uint32_t> i2cBytes{0};
+    };
+
+#if defined(ARDUINO)
+    static_assert(kResultRegister == VL53L1X::RESULT__RANGE_STATUS &&
+                      kDssSpadsRegister == VL53L1X::DSS_CONFIG__MANUAL_EFFECTIVE_SPADS_SELECT &&
+                      kInterruptClearRegister == VL53L1X::SYSTEM__INTERRUPT_CLEAR,
+                  "Register addresses must match the bundled driver");
+    static_assert(kVl53l1xRangeValid == VL53L1X::RangeValid && kVl53l1xMinRangeFail == VL53L1X::MinRangeFail &&
+                      kVl53l1xNone == VL53L1X::None,
+                  "Vl53l1xRangeStatus must match VL53L1X::RangeStatus");
+
+    static void onGpio(void *arg)
+    {
+      Sensor &s = *static_cast<Sensor *>(arg);
+      s.owner->onPinInterrupt(s.pins.intPin);
+    }
+#endif
+
+    static uint16_t be16(const uint8_t *p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+    static void putReg(uint8_t *out, uint16_t reg)
+    {
+      out[0] = static_cast<uint8_t>(reg >> 8);
+      out[1] = static_cast<uint8_t>(reg);
+    }
+
+    // Mirrors the status mapping of the bundled driver (ConvertStatusLite()).
+    static uint8_t convertStatus(uint8_t rangeStatus, uint8_t streamCount)
+    {
+      switch (rangeStatus)
+      {
+      case 17: // MULTCLIPFAIL
+      case 2:  // VCSELWATCHDOGTESTFAILURE
+      case 1:  // VCSELCONTINUITYTESTFAILURE
+      case 3:  // NOVHVVALUEFOUND
+        return kVl53l1xHardwareFail;
+      case 13: // USERROICLIP
+        return kVl53l1xMinRangeFail;
+      case 18: // GPHSTREAMCOUNT0READY
+        return kVl53l1xSynchronizationInt;
+      case 5: // RANGEPHASECHECK
+        return kVl53l1xOutOfBoundsFail;
+      case 4: // MSRCNOTARGET
+        return kVl53l1xSignalFail;
+      case 6: // SIGMATHRESHOLDCHECK
+        return kVl53l1xSigmaFail;
+      case 7: // PHASECONSISTENCY
+        return kVl53l1xWrapTargetFail;
+      case 12: // RANGEIGNORETHRESHOLD
+        return kVl53l1xXtalkSignalFail;
+      case 8: // MINCLIP
+        return kVl53l1xRangeValidMinRangeClipped;
+      case 9: // RANGECOMPLETE
+        return streamCount == 0 ? kVl53l1xRangeValidNoWrapCheckFail : kVl53l1xRangeValid;
+      default:
+        return kVl53l1xNone;
+      }
+    }
+
+    bool allHaveXshut() const
+    {
+      for (size_t i = 0; i < _count; ++i)
+      {
+        if (_sensors[i].pins.xshutPin == kVl53l1xNoPin)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void prepare(Sensor &s)
+    {
+      s.owner = this;
+      putReg(s.readTx, kResultRegister);
+      putReg(s.dssTx, kDssSpadsRegister);
+      putReg(s.clearTx, kInterruptClearRegister);
+      s.clearTx[2] = 0x01;
+
+      const uint8_t addr = s.pins.address;
+      s.read.set(addr, s.readTx, sizeof(s.readTx), s.block, kResultLength);
+      s.dss.set(addr, s.dssTx, sizeof(s.dssTx));
+      s.clear.set(addr, s.clearTx, sizeof(s.clearTx));
+      for (I2cTransfer *t : {&s.read, &s.dss, &s.clear})
+      {
+        t->owner = _owner;
+        t->priority = BusPriority::High;
+        t->arg = &s;
+      }
+      s.read.callback = &Vl53l1xRanger::onReadDone;
+      s.dss.callback = &Vl53l1xRanger::onWriteDone;
+      s.clear.callback = &Vl53l1xRanger::onWriteDone;
+    }
+
+    void startRead(Sensor &s, bool recovery)
+    {
+      const uint32_t now = I2cQueue::nowUs();
+      if (!s.idle())
+      {
+        if (!recovery)
+        {
+          _stats.missed.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+      }
+      s.lastIrqUs = now;
+      s.pendingIrqUs = now;
+      _queue.submit(s.read);
+    }
+
+    // The three callbacks run in the I2C driver's interrupt.
+    static void onReadDone(I2cTransfer &t, void *arg)
+    {
+      Sensor &s = *static_cast<Sensor *>(arg);
+      Vl53l1xRanger &self = *s.owner;
+      self.countTransfer(t);
+      if (t.status() == I2cStatus::Ok)
+      {
+        Vl53l1xRange range;
+        decode(s.block, range);
+        range.timestampUs = s.pendingIrqUs;
+        const uint16_t spads = dssSpads(s.block);
+        s.dssTx[2] = static_cast<uint8_t>(spads >> 8);
+        s.dssTx[3] = static_cast<uint8_t>(spads);
+        self._queue.submit(s.dss);
+
+        // A recovery read of a sensor that had nothing new repeats the
+        // last stream count; do not report it twice.
+        const uint32_t seq = s.seq.load(std::memory_order_relaxed);
+        if (seq == 0 || range.streamCount != s.range.streamCount)
+        {
+          s.seq.store(seq + 1, std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_release);
+          s.range = range;
+          s.seq.store(seq + 2, std::memory_order_release);
+          self._stats.ranges.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      // Clear even after a failed read, or GPIO1 stays asserted.
+      self._queue.submit(s.clear);
+    }
+
+    static void onWriteDone(I2cTransfer &t, void *arg)
+    {
+      static_cast<Sensor *>(arg)->owner->countTransfer(t);
+    }
+
+    void countTransfer(const I2cTransfer &t)
+    {
+      _stats.i2cBytes.fetch_add(t.txLength + t.rxLength, std::memory_order_relaxed);
+      if (t.status() != I2cStatus::Ok)
+      {
+        _stats.errors.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    I2cQueue &_queue;
+    uint16_t _owner;
+    uint32_t _periodUs = 0;
+    size_t _count = 0;
+    Sensor _sensors[MaxSensors];
+    AtomicStats _stats;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,88 @@
+/**
+ * @file RttEstimator.h
+ * @brief Smoothed round-trip time and adaptive retransmit timeout
+ *
+ * Implements the SRTT/RTTVAR estimator from RFC 6298 in integer
+ * microseconds. Feed it one sample per acknowledged part that was sent
+ * exactly once (Karn's rule) and use rto() as the retransmit timer.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief RFC 6298 round-trip estimator with exponential backoff
+   */
+  class RttEstimator
+  {
+  public:
+    /**
+     * @param initialRtoUs RTO used before the first sample
+     * @param minRtoUs     Lower clamp; keep above the link's scheduling jitter
+     * @param maxRtoUs     Upper clamp, also the backoff ceiling
+     */
+    constexpr RttEstimator(uint32_t initialRtoUs = 200000, uint32_t minRtoUs = 5000,
+                           uint32_t maxRtoUs = 2000000)
+        : _minRto(minRtoUs), _maxRto(maxRtoUs), _rto(initialRtoUs) {}
+
+    /** Add a round-trip sample from a part that was not retransmitted. */
+    void sample(uint32_t rttUs)
+    {
+      if (!_hasSample)
+      {
+        _srtt = rttUs;
+        _rttvar = rttUs / 2;
+        _hasSample = true;
+      }
+      else
+      {
+        const uint32_t err = rttUs > _srtt ? rttUs - _srtt : _srtt - rttUs;
+        // RTTVAR = 3/4 RTTVAR + 1/4 |err|; SRTT = 7/8 SRTT + 1/8 R
+        _rttvar = _rttvar - (_rttvar >> 2) + (err >> 2);
+        _srtt = _srtt - (_srtt >> 3) + (rttUs >> 3);
+      }
+
+      _rto = clamp(_srtt + (_rttvar * 4 > kGranularityUs ? _rttvar * 4 : kGranularityUs));
+    }
+
+    /** Double the timeout after a retransmit timer expiry. */
+    void backoff()
+    {
+      _rto = _rto >= _maxRto / 2 ? _maxRto : _rto * 2;
+    }
+
+    /** Current retransmit timeout. */
+    uint32_t rto() const { return _rto; }
+
+    /** Smoothed RTT, or 0 before the first sample. */
+    uint32_t srtt() const { return _srtt; }
+
+    /** RTT variation, or 0 before the first sample. */
+    uint32_t rttvar() const { return _rttvar; }
+
+    bool hasSample() const { return _hasSample; }
+
+  private:
+    static constexpr uint32_t kGranularityUs = 1000;
+
+    uint32_t clamp(uint32_t value) const
+    {
+      return value < _minRto ? _minRto : (value > _maxRto ? _maxRto : value);
+    }
+
+    uint32_t _minRto;
+    uint32_t _maxRto;
+    uint32_t _rto;
+    uint32_t _srtt = 0;
+    uint32_t _rttvar = 0;
+    bool _hasSample = false;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,327 @@
+/**
+ * @file SelectiveAck.h
+ * @brief Selective acknowledgement for windowed part transfers
+ *
+ * ReorderBuffer is the receiver: a bounded window of part slots indexed by
+ * a presence bitmap, so out-of-order parts are stored and released in
+ * order without scanning a list. Its ack() describes what has arrived as
+ * a cumulative sequence plus a 32-bit SACK bitmap.
+ *
+ * SendWindow is the sender: it applies those acks, takes RTT samples for
+ * an RttEstimator (never from retransmitted parts), and reports which
+ * parts to resend, either because later parts were SACKed past them or
+ * because the adaptive retransmit timeout expired.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "RttEstimator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Acknowledgement carried in a write ACK (8 bytes, little endian)
+   *
+   * Every part before @p cumulative has been received. Bit i of @p sack is
+   * set when part cumulative + 1 + i has also been received.
+   */
+  struct SackAck
+  {
+    uint32_t cumulative;
+    uint32_t sack;
+  };
+  static_assert(sizeof(SackAck) == 8, "SackAck is part of the wire format");
+
+  /** True if sequence @p a comes before @p b (wrap-safe). */
+  constexpr bool seqBefore(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+  /**
+   * @brief Receiver-side reorder buffer
+   *
+   * @tparam Window   Parts held at once (2..32)
+   * @tparam PartSize Largest part payload
+   */
+  template <size_t Window, size_t PartSize>
+  class ReorderBuffer
+  {
+    static_assert(Window >= 2 && Window <= 32, "Window must fit the 32-bit presence bitmap");
+
+  public:
+    enum class Insert : uint8_t
+    {
+      Stored,      ///< New part accepted
+      Duplicate,   ///< Already received or already delivered
+      OutOfWindow, ///< Too far ahead; sender must retransmit later
+      TooLarge,    ///< Payload exceeds PartSize
+    };
+
+    /** Start expecting part @p firstSeq; drops anything buffered. */
+    void reset(uint32_t firstSeq = 0)
+    {
+      _next = firstSeq;
+      _present = 0;
+    }
+
+    Insert insert(uint32_t seq, const uint8_t *data, size_t length)
+    {
+      if (length > PartSize)
+      {
+        return Insert::TooLarge;
+      }
+      if (seqBefore(seq, _next))
+      {
+        return Insert::Duplicate;
+      }
+      const uint32_t offset = seq - _next;
+      if (offset >= Window)
+      {
+        return Insert::OutOfWindow;
+      }
+      if (_present & (1u << offset))
+      {
+        return Insert::Duplicate;
+      }
+
+      const size_t slot = seq % Window;
+      std::memcpy(_parts[slot], data, length);
+      _lengths[slot] = static_cast<uint16_t>(length);
+      _present |= 1u << offset;
+      return Insert::Stored;
+    }
+
+    /**
+     * @brief Release every part that is now in order
+     *
+     * @p deliver is called as deliver(uint32_t seq, const uint8_t* data, size_t length).
+     * @return Number of parts delivered
+     */
+    template <typename Deliver>
+    size_t deliver(Deliver &&deliver)
+    {
+      size_t count = 0;
+      while (_present & 1u)
+      {
+        const size_t slot = _next % Window;
+        deliver(_next, static_cast<const uint8_t *>(_parts[slot]), static_cast<size_t>(_lengths[slot]));
+        _present >>= 1;
+        ++_next;
+        ++count;
+      }
+      return count;
+    }
+
+    /** Acknowledgement describing the current state. */
+    SackAck ack() const { return {_next, _present >> 1}; }
+
+    /** Next in-order sequence expected. */
+    uint32_t next() const { return _next; }
+
+    /** Parts buffered out of order. */
+    uint8_t buffered() const { return static_cast<uint8_t>(__builtin_popcount(_present)); }
+
+  private:
+    uint8_t _parts[Window][PartSize];
+    uint16_t _lengths[Window] = {};
+    uint32_t _present = 0;
+    uint32_t _next = 0;
+  };
+
+  /**
+   * @brief Sender-side window of unacknowledged parts
+   *
+   * Tracks send times and acknowledgement state; it does not store payload,
+   * which the caller can regenerate or keep by sequence number.
+   *
+   * @tparam Window Parts in flight (2..32); should match the receiver
+   */
+  template <size_t Window>
+  class SendWindow
+  {
+    static_assert(Window >= 2 && Window <= 32, "Window must fit the SACK bitmap");
+
+  public:
+    /** Parts SACKed above a hole before it is treated as lost. */
+    static constexpr uint8_t kDupThreshold = 3;
+
+    void reset(uint32_t firstSeq = 0)
+    {
+      _base = firstSeq;
+      _next = firstSeq;
+      _acked = 0;
+      _lost = 0;
+    }
+
+    /** True if another new part may be sent. */
+    bool canSend() const { return _next - _base < Window; }
+
+    /** Sequence number for the next new part. */
+    uint32_t nextSeq() const { return _next; }
+
+    /** Oldest unacknowledged sequence. */
+    uint32_t base() const { return _base; }
+
+    /** Record that part @p seq went on the wire (new or retransmitted). */
+    void onSend(uint32_t seq, uint32_t nowUs)
+    {
+      const uint32_t offset = seq - _base;
+      if (offset >= Window)
+      {
+        return;
+      }
+      Entry &e = _entries[seq % Window];
+      if (seq == _next)
+      {
+        e = {nowUs, 0};
+        ++_next;
+      }
+      else
+      {
+        e.sentUs = nowUs;
+        if (e.transmissions < 0xFF)
+        {
+          ++e.transmissions;
+        }
+        _lost &= ~(1u << offset);
+      }
+    }
+
+    /**
+     * @brief Apply an acknowledgement from the receiver
+     *
+     * @return Number of parts newly acknowledged (cumulatively or selectively)
+     */
+    size_t onAck(const SackAck &ack, uint32_t nowUs, RttEstimator &rtt)
+    {
+      if (seqBefore(ack.cumulative, _base) || seqBefore(_next, ack.cumulative))
+      {
+        return 0; // stale or bogus
+      }
+
+      size_t newly = 0;
+      bool sampled = false;
+
+      // Cumulative part: slide the window.
+      while (seqBefore(_base, ack.cumulative))
+      {
+        const Entry &e = _entries[_base % Window];
+        if (!(_acked & 1u))
+        {
+          ++newly;
+          sampleOnce(e, nowUs, rtt, sampled);
+        }
+        _acked >>= 1;
+        _lost >>= 1;
+        ++_base;
+      }
+
+      // Selective part: offsets 1..Window-1 above the new base.
+      const uint32_t inFlight = _next - _base;
+      const uint32_t validMask = inFlight >= 32 ? 0xFFFFFFFFu : ((1u << inFlight) - 1u);
+      const uint32_t sacked = (ack.sack << 1) & validMask;
+      uint32_t fresh = sacked & ~_acked;
+      while (fresh)
+      {
+        const uint32_t bit = static_cast<uint32_t>(__builtin_ctz(fresh));
+        ++newly;
+        sampleOnce(_entries[(_base + bit) % Window], nowUs, rtt, sampled);
+        fresh &= fresh - 1;
+      }
+      _acked |= sacked;
+
+      markLoss();
+      return newly;
+    }
+
+    /**
+     * @brief Collect parts that should be resent now
+     *
+     * Holes with kDupThreshold SACKed parts above them are returned
+     * immediately; any other unacknowledged part is returned once its
+     * send time is older than the current RTO. Each timeout expiry backs
+     * off the estimator.
+     *
+     * @return Number of sequence numbers written to @p out
+     */
+    size_t collectRetransmits(uint32_t nowUs, RttEstimator &rtt, uint32_t *out, size_t maxOut)
+    {
+      size_t count = 0;
+      bool timedOut = false;
+      const uint32_t inFlight = _next - _base;
+      for (uint32_t offset = 0; offset < inFlight && count < maxOut; ++offset)
+      {
+        if (_acked & (1u << offset))
+        {
+          continue;
+        }
+        const Entry &e = _entries[(_base + offset) % Window];
+        const bool lost = _lost & (1u << offset);
+        const bool expired = nowUs - e.sentUs >= rtt.rto();
+        if (lost || expired)
+        {
+          out[count++] = _base + offset;
+          timedOut |= expired && !lost;
+        }
+      }
+      if (timedOut)
+      {
+        rtt.backoff();
+      }
+      return count;
+    }
+
+    /** True once every sent part is acknowledged. */
+    bool idle() const { return _base == _next; }
+
+  private:
+    struct Entry
+    {
+      uint32_t sentUs;
+      uint8_t transmissions; ///< Retransmit count; 0 means sent exactly once
+    };
+
+    // Karn's rule: only parts sent once give an unambiguous RTT. One sample
+    // per ack is enough and avoids biasing towards bursts.
+    static void sampleOnce(const Entry &e, uint32_t nowUs, RttEstimator &rtt, bool &sampled)
+    {
+      if (!sampled && e.transmissions == 0)
+      {
+        rtt.sample(nowUs - e.sentUs);
+        sampled = true;
+      }
+    }
+
+    void markLoss()
+    {
+      // A hole is lost once kDupThreshold parts above it have been SACKed.
+      uint32_t above = 0;
+      const uint32_t inFlight = _next - _base;
+      for (int32_t offset = static_cast<int32_t>(inFlight) - 1; offset >= 0; --offset)
+      {
+        const uint32_t bit = 1u << offset;
+        if (_acked & bit)
+        {
+          ++above;
+        }
+        else if (above >= kDupThreshold && _entries[(_base + offset) % Window].transmissions == 0)
+        {
+          _lost |= bit;
+        }
+      }
+    }
+
+    Entry _entries[Window] = {};
+    uint32_t _base = 0;
+    uint32_t _next = 0;
+    uint32_t _acked = 0; ///< Bit i: part base + i acknowledged
+    uint32_t _lost = 0;  ///< Bit i: part base + i declared lost, awaiting resend
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,269 @@
+/**
+ * @file StreamCredits.h
+ * @brief Credit-based flow control and fair interleaving of concurrent streams
+ *
+ * Each open stream may only send as many chunks as the receiver has
+ * granted credits for; the receiver grants one credit per free buffer
+ * block (for example a FileBufferPool block) and returns credits as it
+ * drains them. Among streams that have both data and credit, chunks are
+ * handed out round-robin, so two bulk transfers share the link evenly and
+ * a stalled receiver only stalls its own stream.
+ *
+ * Per-stream bytes, chunks, stalls and stalled time are counted and can
+ * be copied out as a fixed-layout status block.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CX_STREAM_MAX_CONCURRENT
+#define CX_STREAM_MAX_CONCURRENT 4
+#endif
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Per-stream counters, laid out for direct use as a status payload
+   */
+  struct StreamFlowStats
+  {
+    uint16_t streamId;  ///< Stream handle, or 0xFFFF for an unused slot
+    uint16_t credits;   ///< Chunks the receiver will currently accept
+    uint32_t bytes;     ///< Payload bytes sent
+    uint32_t chunks;    ///< Chunks sent
+    uint32_t stalls;    ///< Times the stream had data but no credit
+    uint32_t stalledUs; ///< Total time spent waiting for credit
+    uint32_t openedUs;  ///< Time the stream was opened
+  };
+
+  /**
+   * @brief Credit-gated round-robin scheduler for open streams
+   *
+   * Not internally locked; call it from the task that pumps the write queue
+   * and route credit grants from the receive path through the same lock.
+   *
+   * @tparam MaxStreams Streams that may be open at once
+   *
+   * @code
+   * LumynLabs::StreamCreditScheduler<> streams;
+   * streams.open(handle, freeBlocks, micros());      // receiver's advertised blocks
+   * streams.setReady(handle, true, micros());         // data queued for this stream
+   *
+   * uint16_t id;
+   * while (streams.next(id, micros())) {
+   *   size_t n = sendChunk(id);
+   *   streams.sent(id, n);
+   *   if (!hasMore(id)) streams.setReady(id, false, micros());
+   * }
+   *
+   * // when the receiver frees blocks:
+   * streams.grant(handle, freedBlocks, micros());
+   * @endcode
+   */
+  template <size_t MaxStreams = CX_STREAM_MAX_CONCURRENT>
+  class StreamCreditScheduler
+  {
+    static_assert(MaxStreams > 0 && MaxStreams <= 64, "MaxStreams out of range");
+
+  public:
+    static constexpr uint16_t kNoStream = 0xFFFF;
+
+    /**
+     * @brief Start tracking a stream
+     *
+     * @param streamId       Stream handle
+     * @param initialCredits Chunks the receiver can accept up front
+     * @return false if the stream is already open or the limit is reached
+     */
+    bool open(uint16_t streamId, uint16_t initialCredits, uint32_t nowUs)
+    {
+      if (streamId == kNoStream || find(streamId))
+      {
+        return false;
+      }
+      for (auto &s : _streams)
+      {
+        if (s.stats.streamId == kNoStream)
+        {
+          s = Stream{};
+          s.stats.streamId = streamId;
+          s.stats.credits = initialCredits;
+          s.stats.openedUs = nowUs;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /** Stop tracking a stream; its counters are discarded. */
+    bool close(uint16_t streamId)
+    {
+      Stream *s = find(streamId);
+      if (!s)
+      {
+        return false;
+      }
+      *s = Stream{};
+      return true;
+    }
+
+    /** Add credits returned by the receiver. */
+    bool grant(uint16_t streamId, uint16_t credits, uint32_t nowUs)
+    {
+      Stream *s = find(streamId);
+      if (!s)
+      {
+        return false;
+      }
+      const uint32_t total = static_cast<uint32_t>(s->stats.credits) + credits;
+      s->stats.credits = total > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(total);
+      if (s->stalled && s->stats.credits > 0)
+      {
+        s->stats.stalledUs += nowUs - s->stalledSinceUs;
+        s->stalled = false;
+      }
+      return true;
+    }
+
+    /** Mark whether a stream has data waiting to be sent. */
+    void setReady(uint16_t streamId, bool ready, uint32_t nowUs)
+    {
+      Stream *s = find(streamId);
+      if (!s)
+      {
+        return;
+      }
+      s->ready = ready;
+      if (!ready && s->stalled)
+      {
+        s->stats.stalledUs += nowUs - s->stalledSinceUs;
+        s->stalled = false;
+      }
+      else if (ready)
+      {
+        checkStall(*s, nowUs);
+      }
+    }
+
+    /**
+     * @brief Pick the next stream to send one chunk and take its credit
+     *
+     * @param streamId Receives the chosen stream
+     * @return false if no stream has both data and credit
+     */
+    bool next(uint16_t &streamId, uint32_t nowUs)
+    {
+      for (size_t n = 0; n < MaxStreams; ++n)
+      {
+        Stream &s = _streams[_cursor];
+        _cursor = (_cursor + 1) % MaxStreams;
+        if (s.stats.streamId == kNoStream || !s.ready)
+        {
+          continue;
+        }
+        if (s.stats.credits == 0)
+        {
+          checkStall(s, nowUs);
+          continue;
+        }
+        --s.stats.credits;
+        streamId = s.stats.streamId;
+        return true;
+      }
+      return false;
+    }
+
+    /** Account for a chunk handed out by next(). */
+    void sent(uint16_t streamId, uint32_t bytes)
+    {
+      if (Stream *s = find(streamId))
+      {
+        s->stats.bytes += bytes;
+        ++s->stats.chunks;
+      }
+    }
+
+    /** Average send rate since the stream was opened, in bytes per second. */
+    uint32_t throughput(uint16_t streamId, uint32_t nowUs) const
+    {
+      const Stream *s = find(streamId);
+      if (!s || nowUs == s->stats.openedUs)
+      {
+        return 0;
+      }
+      return static_cast<uint32_t>(static_cast<uint64_t>(s->stats.bytes) * 1000000u /
+                                   (nowUs - s->stats.openedUs));
+    }
+
+    size_t activeCount() const
+    {
+      size_t n = 0;
+      for (const auto &s : _streams)
+      {
+        n += s.stats.streamId != kNoStream;
+      }
+      return n;
+    }
+
+    const StreamFlowStats *stats(uint16_t streamId) const
+    {
+      const Stream *s = find(streamId);
+      return s ? &s->stats : nullptr;
+    }
+
+    /** Copy every slot's counters; unused slots have streamId == kNoStream. */
+    void status(StreamFlowStats (&out)[MaxStreams]) const
+    {
+      for (size_t i = 0; i < MaxStreams; ++i)
+      {
+        out[i] = _streams[i].stats;
+      }
+    }
+
+  private:
+    struct Stream
+    {
+      StreamFlowStats stats{kNoStream, 0, 0, 0, 0, 0, 0};
+      uint32_t stalledSinceUs = 0;
+      bool ready = false;
+      bool stalled = false;
+    };
+
+    static void checkStall(Stream &s, uint32_t nowUs)
+    {
+      if (s.ready && s.stats.credits == 0 && !s.stalled)
+      {
+        s.stalled = true;
+        s.stalledSinceUs = nowUs;
+        ++s.stats.stalls;
+      }
+    }
+
+    Stream *find(uint16_t streamId)
+    {
+      for (auto &s : _streams)
+      {
+        if (s.stats.streamId == streamId)
+        {
+          return &s;
+        }
+      }
+      return nullptr;
+    }
+
+    const Stream *find(uint16_t streamId) const
+    {
+      return const_cast<StreamCreditScheduler *>(this)->find(streamId);
+    }
+
+    Stream _streams[MaxStreams];
+    size_t _cursor = 0;
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,437 @@
+/**
+ * @file OtaPatch.h
+ * @brief Streaming decoder for compressed and delta OTA images
+ *
+ * A patch is a 24-byte header followed by a byte-oriented LZ77 token
+ * stream. Besides literals and matches against recently decoded output
+ * (a small sliding window, as in heatshrink), a token can copy a run from
+ * a base image - normally the firmware that is currently running, read
+ * in place through XIP. A plain compressed image is simply a patch that
+ * never references the base.
+ *
+ * Tokens (lengths and distances as LEB128 varints):
+ *   0x00-0x7F  literal run of (op + 1) bytes, which follow
+ *   0x80-0xBE  window match, length (op & 0x3F) + 3, then distance
+ *   0xBF       window match, then length - 66, then distance
+ *   0xC0       base copy, then length, then zigzag change of the base shift
+ *
+ * A base copy reads from base[outputPosition + shift], where the shift
+ * accumulates across base copies; code that moved by a constant offset
+ * therefore costs a few bytes per run.
+ *
+ * Patches are produced by tools/ota_patch.py. Decoded output is passed to
+ * a sink, typically OtaPipeline::write(), and checked against the size and
+ * CRC-32 recorded in the header. A stream that stops early is only
+ * noticed when the caller says the input has ended, with finish().
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "LumynLabs/Util/Crc32.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief Patch header (24 bytes, little endian)
+   */
+  struct OtaPatchHeader
+  {
+    static constexpr uint32_t kMagic = 0x54505843; ///< "CXPT"
+    static constexpr uint8_t kVersion = 1;
+    static constexpr uint16_t kDelta = 0x0001; ///< References a base image
+
+    uint32_t magic;
+    uint8_t version;
+    uint8_t windowBits; ///< log2 of the match window the encoder used
+    uint16_t flags;
+    uint32_t targetSize;
+    uint32_t targetCrc;
+    uint32_t baseSize; ///< 0 unless kDelta
+    uint32_t baseCrc;  ///< 0 unless kDelta
+  };
+  static_assert(sizeof(OtaPatchHeader) == 24, "OtaPatchHeader is part of the file format");
+
+  enum class OtaPatchStatus : uint8_t
+  {
+    NeedMore,     ///< Waiting for more input
+    Done,         ///< Output complete and verified
+    BadHeader,    ///< Wrong magic/version or window too large
+    BaseMismatch, ///< Base image size or CRC differs from the patch
+    Corrupt,      ///< Invalid token or reference
+    SizeMismatch, ///< Stream ended at the wrong output length
+    CrcMismatch,  ///< Output CRC differs from the header
+  };
+
+  /**
+   * @brief Incremental patch decoder
+   *
+   * Input can be fed in arbitrary pieces. RAM use is the window plus a few
+   * words; the base image is only read.
+   *
+   * @tparam WindowBits log2 of the history window (patches made with a
+   *                    larger window are rejected)
+   *
+   * @code
+   * LumynLabs::OtaPatchDecoder<12> patch;
+   * patch.begin(reinterpret_cast<const uint8_t*>(XIP_BASE), runningImageSize);
+   *
+   * auto sink = [&](const uint8_t* p, size_t n) {
+   *   while (n) { size_t k = ota.write(p, n); p += k; n -= k; if (!k) delay(1); }
+   * };
+   * // per received chunk:
+   * auto st = patch.feed(chunk, len, sink);
+   * if (st != LumynLabs::OtaPatchStatus::NeedMore) ... // Done or error
+   *
+   * // once the transfer has ended, whatever the reason:
+   * if (patch.finish(sink) != LumynLabs::OtaPatchStatus::Done) ... // truncated or corrupt
+   * @endcode
+   */
+  template <uint8_t WindowBits = 12>
+  class OtaPatchDecoder
+  {
+    static_assert(WindowBits >= 8 && WindowBits <= 16, "WindowBits out of range");
+
+  public:
+    static constexpr uint32_t kWindowSize = 1u << WindowBits;
+
+    /**
+     * @param base     Image that delta patches refer to; may be null for
+     *                 compressed-only images
+     * @param baseSize Length of @p base
+     */
+    void begin(const uint8_t *base = nullptr, uint32_t baseSize = 0)
+    {
+      _base = base;
+      _baseSize = baseSize;
+      _state = State::Header;
+      _status = OtaPatchStatus::NeedMore;
+      _headerFill = 0;
+      _pos = 0;
+      _flushed = 0;
+      _shift = 0;
+      _crc = Crc32::kInit;
+    }
+
+    /**
+     * @brief Decode more input
+     *
+     * @p sink is called as sink(const uint8_t* data, size_t length) and
+     * must take all bytes it is given.
+     *
+     * @return NeedMore while the image is incomplete, Done once the last
+     *         byte is verified, or an error (sticky until begin())
+     */
+    template <typename Sink>
+    OtaPatchStatus feed(const uint8_t *data, size_t length, Sink &&sink)
+    {
+      size_t i = 0;
+      while (i < length && _status == OtaPatchStatus::NeedMore)
+      {
+        switch (_state)
+        {
+        case State::Header:
+          i += readHeader(data + i, length - i);
+          break;
+
+        case State::Op:
+          startToken(data[i++]);
+          break;
+
+        case State::Literal:
+          while (i < length && _remaining > 0)
+          {
+            put(data[i++], sink);
+            --_remaining;
+          }
+          if (_remaining == 0)
+          {
+            _state = State::Op;
+          }
+          break;
+
+        case State::Varint:
+        {
+          const uint8_t b = data[i++];
+          if (_shiftBits > 28)
+          {
+            fail(OtaPatchStatus::Corrupt);
+            break;
+          }
+          _varint |= static_cast<uint32_t>(b & 0x7F) << _shiftBits;
+          _shiftBits += 7;
+          if (b & 0x80)
+          {
+            break;
+          }
+          _args[_argFill++] = _varint;
+          _varint = 0;
+          _shiftBits = 0;
+          if (_argFill == _argCount)
+          {
+            runToken(sink);
+          }
+          break;
+        }
+        }
+      }
+
+      flush(sink);
+      if (_status == OtaPatchStatus::NeedMore && _state == State::Op && _pos == _header.targetSize)
+      {
+        complete(sink);
+      }
+      return _status;
+    }
+
+    /**
+     * @brief Signal the end of input
+     *
+     * A patch that is complete has already returned Done from feed(). Any
+     * other stream is cut short, in the header or in the middle of a token
+     * or before the last output byte, and fails with SizeMismatch instead
+     * of waiting for more input forever.
+     *
+     * @return Done, or the (sticky) error
+     */
+    template <typename Sink>
+    OtaPatchStatus finish(Sink &&sink)
+    {
+      if (_status != OtaPatchStatus::NeedMore)
+      {
+        return _status;
+      }
+      if (_state != State::Op)
+      {
+        flush(sink);
+        fail(OtaPatchStatus::SizeMismatch);
+        return _status;
+      }
+      complete(sink);
+      return _status;
+    }
+
+    OtaPatchStatus status() const { return _status; }
+
+    /** Header of the patch being decoded (valid once past the first 24 bytes). */
+    const OtaPatchHeader &header() const { return _header; }
+
+    /** Output bytes produced so far. */
+    uint32_t outputBytes() const { return _pos; }
+
+  private:
+    enum class State : uint8_t
+    {
+      Header,
+      Op,
+      Literal,
+      Varint,
+    };
+
+    enum class Token : uint8_t
+    {
+      Window,
+      WindowLong,
+      Base,
+    };
+
+    size_t readHeader(const uint8_t *data, size_t length)
+    {
+      size_t n = sizeof(OtaPatchHeader) - _headerFill;
+      if (n > length)
+      {
+        n = length;
+      }
+      std::memcpy(reinterpret_cast<uint8_t *>(&_header) + _headerFill, data, n);
+      _headerFill += n;
+      if (_headerFill < sizeof(OtaPatchHeader))
+      {
+        return n;
+      }
+
+      if (_header.magic != OtaPatchHeader::kMagic || _header.version != OtaPatchHeader::kVersion ||
+          _header.windowBits > WindowBits)
+      {
+        fail(OtaPatchStatus::BadHeader);
+      }
+      else if ((_header.flags & OtaPatchHeader::kDelta) &&
+               (!_base || _baseSize != _header.baseSize ||
+                Crc32::compute(_base, _baseSize) != _header.baseCrc))
+      {
+        fail(OtaPatchStatus::BaseMismatch);
+      }
+      else
+      {
+        _state = State::Op;
+      }
+      return n;
+    }
+
+    void startToken(uint8_t op)
+    {
+      _argFill = 0;
+      _varint = 0;
+      _shiftBits = 0;
+      if (op < 0x80)
+      {
+        _remaining = op + 1u;
+        _state = State::Literal;
+      }
+      else if (op < 0xBF)
+      {
+        _token = Token::Window;
+        _length = (op & 0x3Fu) + 3;
+        _argCount = 1;
+        _state = State::Varint;
+      }
+      else if (op == 0xBF)
+      {
+        _token = Token::WindowLong;
+        _argCount = 2;
+        _state = State::Varint;
+      }
+      else if (op == 0xC0 && (_header.flags & OtaPatchHeader::kDelta))
+      {
+        _token = Token::Base;
+        _argCount = 2;
+        _state = State::Varint;
+      }
+      else
+      {
+        fail(OtaPatchStatus::Corrupt);
+      }
+    }
+
+    template <typename Sink>
+    void runToken(Sink &sink)
+    {
+      _state = State::Op;
+      uint32_t length = _length;
+      if (_token == Token::WindowLong)
+      {
+        length = _args[0] + 66;
+      }
+      else if (_token == Token::Base)
+      {
+        length = _args[0];
+      }
+
+      if (length > _header.targetSize - _pos)
+      {
+        fail(OtaPatchStatus::Corrupt);
+        return;
+      }
+
+      if (_token == Token::Base)
+      {
+        const uint32_t zz = _args[1];
+        _shift += static_cast<int32_t>((zz >> 1) ^ (0u - (zz & 1u)));
+        const int64_t from = static_cast<int64_t>(_pos) + _shift;
+        if (from < 0 || from + length > _baseSize)
+        {
+          fail(OtaPatchStatus::Corrupt);
+          return;
+        }
+        const uint8_t *src = _base + from;
+        for (uint32_t k = 0; k < length; ++k)
+        {
+          put(src[k], sink);
+        }
+        return;
+      }
+
+      const uint32_t distance = _args[_token == Token::WindowLong ? 1 : 0];
+      if (distance == 0 || distance > kWindowSize || distance > _pos)
+      {
+        fail(OtaPatchStatus::Corrupt);
+        return;
+      }
+      for (uint32_t k = 0; k < length; ++k)
+      {
+        put(_window[(_pos - distance) & (kWindowSize - 1)], sink);
+      }
+    }
+
+    template <typename Sink>
+    void put(uint8_t b, Sink &sink)
+    {
+      if (_pos >= _header.targetSize)
+      {
+        fail(OtaPatchStatus::Corrupt);
+        return;
+      }
+      _window[_pos & (kWindowSize - 1)] = b;
+      ++_pos;
+      if ((_pos & (kWindowSize - 1)) == 0)
+      {
+        flush(sink);
+      }
+    }
+
+    // Hand decoded bytes to the sink before the window slot is reused.
+    template <typename Sink>
+    void flush(Sink &sink)
+    {
+      if (_pos == _flushed)
+      {
+        return;
+      }
+      const uint32_t start = _flushed & (kWindowSize - 1);
+      const uint32_t length = _pos - _flushed;
+      _crc = Crc32::updateSoftware(_crc, _window + start, length);
+      sink(static_cast<const uint8_t *>(_window + start), static_cast<size_t>(length));
+      _flushed = _pos;
+    }
+
+    template <typename Sink>
+    void complete(Sink &sink)
+    {
+      flush(sink);
+      if (_pos != _header.targetSize)
+      {
+        fail(OtaPatchStatus::SizeMismatch);
+      }
+      else if (Crc32::finalize(_crc) != _header.targetCrc)
+      {
+        fail(OtaPatchStatus::CrcMismatch);
+      }
+      else
+      {
+        _status = OtaPatchStatus::Done;
+      }
+    }
+
+    void fail(OtaPatchStatus status) { _status = status; }
+
+    const uint8_t *_base = nullptr;
+    uint32_t _baseSize = 0;
+
+    OtaPatchHeader _header{};
+    size_t _headerFill = 0;
+    State _state = State::Header;
+    OtaPatchStatus _status = OtaPatchStatus::NeedMore;
+
+    Token _token = Token::Window;
+    uint32_t _length = 0;
+    uint32_t _remaining = 0;
+    uint32_t _args[2] = {};
+    uint8_t _argCount = 0;
+    uint8_t _argFill = 0;
+    uint32_t _varint = 0;
+    uint8_t _shiftBits = 0;
+
+    int32_t _shift = 0;
+    uint32_t _pos = 0;
+    uint32_t _flushed = 0;
+    uint32_t _crc = Crc32::kInit;
+    uint8_t _window[kWindowSize];
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,381 @@
+/**
+ * @file OtaPipeline.h
+ * @brief Double-buffered OTA image writer with erase-ahead
+ *
+ * The receive path only copies incoming data into one of several
+ * sector-sized RAM buffers and returns. A separate service() loop (a task
+ * on the other core, or the main loop) drains full buffers to flash one
+ * page at a time and erases ahead of the write position while the
+ * receiver is still filling the next buffer.
+ *
+ * Every flash operation stops XIP, so it runs with interrupts masked and
+ * the other core paused. The pipeline therefore erases one 4 KB sector
+ * per call, never a 64 KB block: a block erase is cheaper per byte but
+ * pauses everything for hundreds of milliseconds, which overruns UART
+ * receive during an update. A sector erase still pauses for tens of
+ * milliseconds, so receive data should arrive by DMA (UartDmaRx keeps
+ * running while interrupts are masked) into a ring that can hold one
+ * sector erase worth of line time.
+ *
+ * The pipeline is written against a small flash interface so it can run
+ * against the RP2040 on-board flash (Rp2040OtaFlash) or a simulated flash
+ * on the host.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#pragma once
+
+#include "LumynLabs/Util/Crc32.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(ARDUINO_ARCH_RP2040)
+#include <Arduino.h>
+#include <hardware/flash.h>
+#endif
+
+namespace LumynLabs
+{
+
+  /**
+   * @brief OTA progress snapshot
+   */
+  struct OtaProgress
+  {
+    uint32_t totalBytes;      ///< Image size given to begin()
+    uint32_t receivedBytes;   ///< Bytes accepted by write()
+    uint32_t erasedBytes;     ///< Flash erased so far (sector aligned)
+    uint32_t programmedBytes; ///< Bytes programmed so far
+    uint32_t elapsedUs;       ///< Time since begin()
+    uint32_t bytesPerSec;     ///< Programmed bytes per second
+  };
+
+#if defined(ARDUINO_ARCH_RP2040)
+  /**
+   * @brief On-board QSPI flash region used as the OTA staging area
+   *
+   * Every operation pauses the other core and masks interrupts for its
+   * duration, as XIP is unavailable while the flash is busy. Pages are
+   * programmed one at a time so each pause stays well under a millisecond.
+   * Erases are the long pauses (tens of milliseconds per sector), which is
+   * why the pipeline issues them one sector at a time, ahead of the write
+   * position.
+   */
+  class Rp2040OtaFlash
+  {
+  public:
+    static constexpr uint32_t kPageSize = FLASH_PAGE_SIZE;
+    static constexpr uint32_t kSectorSize = FLASH_SECTOR_SIZE;
+
+    /**
+     * @param baseOffset Offset of the staging region from the start of flash
+     *                   (sector aligned)
+     * @param capacity   Size of the staging region in bytes
+     */
+    constexpr Rp2040OtaFlash(uint32_t baseOffset, uint32_t capacity)
+        : _base(baseOffset), _capacity(capacity) {}
+
+    uint32_t capacity() const { return _capacity; }
+
+    bool erase(uint32_t offset, uint32_t length)
+    {
+      if (offset + length > _capacity)
+      {
+        return false;
+      }
+      rp2040.idleOtherCore();
+      noInterrupts();
+      flash_range_erase(_base + offset, length);
+      interrupts();
+      rp2040.resumeOtherCore();
+      return true;
+    }
+
+    bool program(uint32_t offset, const uint8_t *data, uint32_t length)
+    {
+      if (offset + length > _capacity)
+      {
+        return false;
+      }
+      rp2040.idleOtherCore();
+      noInterrupts();
+      flash_range_program(_base + offset, data, length);
+      interrupts();
+      rp2040.resumeOtherCore();
+      return true;
+    }
+
+  private:
+    uint32_t _base;
+    uint32_t _capacity;
+  };
+#endif
+
+  /**
+   * @brief Pipelined OTA writer
+   *
+   * write()/finish() are called by the receiver and service() by the flash
+   * worker; the two sides may run on different cores. Everything else is
+   * safe to call from either side for reporting.
+   *
+   * @tparam Flash   Flash backend providing kPageSize, kSectorSize,
+   *                 capacity(), erase() and program()
+   * @tparam Buffers Sector buffers (at least 2)
+   *
+   * @code
+   * LumynLabs::Rp2040OtaFlash staging(OTA_STAGING_OFFSET, OTA_STAGING_SIZE);
+   * LumynLabs::OtaPipeline<LumynLabs::Rp2040OtaFlash> ota(staging);
+   *
+   * // core 1
+   * void loop1() { if (!ota.service(micros())) delay(1); }
+   *
+   * // receive path
+   * ota.begin(imageSize, micros());
+   * ota.write(chunk, len);   // returns bytes accepted; retry the rest later
+   * ota.finish();
+   * while (!ota.done()) delay(1);
+   * bool ok = ota.imageCrc() == expectedCrc;
+   * @endcode
+   */
+  template <typename Flash, size_t Buffers = 2>
+  class OtaPipeline
+  {
+    static_assert(Buffers >= 2, "Pipelining needs at least two buffers");
+    static_assert(Flash::kSectorSize % Flash::kPageSize == 0, "Sector must be whole pages");
+
+  public:
+    static constexpr uint32_t kSectorSize = Flash::kSectorSize;
+
+    explicit OtaPipeline(Flash &flash) : _flash(flash) {}
+
+    /**
+     * @brief Keep at least @p us between the starts of two sector erases
+     *
+     * Each erase masks interrupts for its whole duration. Spacing them out
+     * gives the receiver (and anything else on the paused core) time to
+     * catch up between pauses. 0, the default, erases as soon as nothing
+     * is waiting to be programmed.
+     */
+    void setEraseSpacing(uint32_t us) { _eraseSpacingUs = us; }
+
+    /**
+     * @brief Start a new image, discarding any previous state
+     * @return false if the image does not fit the flash region
+     */
+    bool begin(uint32_t totalBytes, uint32_t nowUs)
+    {
+      if (totalBytes == 0 || totalBytes > _flash.capacity())
+      {
+        return false;
+      }
+      _total = totalBytes;
+      _eraseEnd = (totalBytes + kSectorSize - 1) / kSectorSize * kSectorSize;
+      _received = 0;
+      _fillLength = 0;
+      _crc = Crc32::kInit;
+      _startUs = nowUs;
+      _lastUs.store(nowUs, std::memory_order_relaxed);
+      _erased.store(0, std::memory_order_relaxed);
+      _programmed.store(0, std::memory_order_relaxed);
+      _pageOffset = 0;
+      _lastEraseUs = nowUs - _eraseSpacingUs;
+      _failed.store(false, std::memory_order_relaxed);
+      _drained.store(0, std::memory_order_relaxed);
+      _filled.store(0, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * @brief Copy incoming image bytes into the pipeline
+     *
+     * Never touches flash. When every buffer is waiting to be programmed,
+     * fewer bytes than requested are accepted; retry the remainder after
+     * the worker has caught up.
+     *
+     * @return Bytes accepted
+     */
+    size_t write(const uint8_t *data, size_t length)
+    {
+      size_t accepted = 0;
+      while (accepted < length && _received < _total && !failed())
+      {
+        const uint32_t filled = _filled.load(std::memory_order_relaxed);
+        if (filled - _drained.load(std::memory_order_acquire) >= Buffers)
+        {
+          break;
+        }
+
+        uint8_t *buf = _buffers[filled % Buffers];
+        size_t n = kSectorSize - _fillLength;
+        if (n > length - accepted)
+        {
+          n = length - accepted;
+        }
+        if (n > _total - _received)
+        {
+          n = _total - _received;
+        }
+        std::memcpy(buf + _fillLength, data + accepted, n);
+        _crc = Crc32::updateSoftware(_crc, data + accepted, n);
+        _fillLength += static_cast<uint32_t>(n);
+        _received += static_cast<uint32_t>(n);
+        accepted += n;
+
+        if (_fillLength == kSectorSize || _received == _total)
+        {
+          commitBuffer(filled);
+        }
+      }
+      return accepted;
+    }
+
+    /**
+     * @brief Hand over a trailing partial buffer
+     *
+     * Only needed when the image ends before begin()'s totalBytes; the
+     * image is then treated as complete at the received length.
+     */
+    void finish()
+    {
+      if (_received < _total)
+      {
+        _total = _received;
+        if (_fillLength > 0)
+        {
+          commitBuffer(_filled.load(std::memory_order_relaxed));
+        }
+      }
+    }
+
+    /**
+     * @brief Perform at most one flash operation
+     *
+     * Programs one page of the oldest full buffer if its sector is erased;
+     * otherwise erases the next sector ahead of the write position, unless
+     * the erase spacing has not elapsed yet. Either way at most one page
+     * program or one sector erase runs per call, so the caller's other
+     * work is interleaved between pauses.
+     *
+     * @param nowUs Current time; needed for setEraseSpacing()
+     * @return true if flash was touched (call again soon)
+     */
+    bool service(uint32_t nowUs = 0)
+    {
+      if (failed())
+      {
+        return false;
+      }
+
+      const uint32_t drained = _drained.load(std::memory_order_relaxed);
+      const uint32_t programmed = _programmed.load(std::memory_order_relaxed);
+      const uint32_t erased = _erased.load(std::memory_order_relaxed);
+      bool didWork = false;
+
+      if (drained != _filled.load(std::memory_order_acquire) && programmed + Flash::kPageSize <= erased)
+      {
+        const uint8_t *buf = _buffers[drained % Buffers];
+        if (!_flash.program(programmed, buf + _pageOffset, Flash::kPageSize))
+        {
+          _failed.store(true, std::memory_order_relaxed);
+          return false;
+        }
+        _programmed.store(programmed + Flash::kPageSize, std::memory_order_relaxed);
+        _pageOffset += Flash::kPageSize;
+        if (_pageOffset >= _lengths[drained % Buffers])
+        {
+          _pageOffset = 0;
+          _drained.store(drained + 1, std::memory_order_release);
+        }
+        didWork = true;
+      }
+      else if (erased < _eraseEnd && nowUs - _lastEraseUs >= _eraseSpacingUs)
+      {
+        if (!_flash.erase(erased, kSectorSize))
+        {
+          _failed.store(true, std::memory_order_relaxed);
+          return false;
+        }
+        _erased.store(erased + kSectorSize, std::memory_order_relaxed);
+        _lastEraseUs = nowUs;
+        didWork = true;
+      }
+
+      if (didWork)
+      {
+        _lastUs.store(nowUs, std::memory_order_relaxed);
+      }
+      return didWork;
+    }
+
+    /** True once every received byte is programmed. */
+    bool done() const
+    {
+      return !failed() && _received == _total &&
+             _drained.load(std::memory_order_acquire) == _filled.load(std::memory_order_acquire);
+    }
+
+    bool failed() const { return _failed.load(std::memory_order_relaxed); }
+
+    /** CRC-32 of the bytes accepted so far (finalized). */
+    uint32_t imageCrc() const { return Crc32::finalize(_crc); }
+
+    OtaProgress progress(uint32_t nowUs) const
+    {
+      OtaProgress p{};
+      p.totalBytes = _total;
+      p.receivedBytes = _received;
+      p.erasedBytes = _erased.load(std::memory_order_relaxed);
+      p.programmedBytes = _programmed.load(std::memory_order_relaxed);
+      p.elapsedUs = nowUs - _startUs;
+      p.bytesPerSec = p.elapsedUs
+                          ? static_cast<uint32_t>(static_cast<uint64_t>(p.programmedBytes) * 1000000u / p.elapsedUs)
+                          : 0;
+      return p;
+    }
+
+    /** Time of the last flash operation, as passed to service(). */
+    uint32_t lastActivityUs() const { return _lastUs.load(std::memory_order_relaxed); }
+
+  private:
+    void commitBuffer(uint32_t filled)
+    {
+      // Pad to whole pages with the erased value so the worker can program
+      // full pages only.
+      uint8_t *buf = _buffers[filled % Buffers];
+      const uint32_t padded = (_fillLength + Flash::kPageSize - 1) / Flash::kPageSize * Flash::kPageSize;
+      std::memset(buf + _fillLength, 0xFF, padded - _fillLength);
+      _lengths[filled % Buffers] = padded;
+      _fillLength = 0;
+      _filled.store(filled + 1, std::memory_order_release);
+    }
+
+    Flash &_flash;
+    alignas(4) uint8_t _buffers[Buffers][kSectorSize];
+    uint32_t _lengths[Buffers] = {};
+
+    // Receiver side
+    uint32_t _total = 0;
+    uint32_t _received = 0;
+    uint32_t _fillLength = 0;
+    uint32_t _crc = Crc32::kInit;
+    uint32_t _startUs = 0;
+    std::atomic<uint32_t> _filled{0};
+
+    // Worker side
+    uint32_t _eraseEnd = 0;
+    uint32_t _pageOffset = 0;
+    uint32_t _eraseSpacingUs = 0;
+    uint32_t _lastEraseUs = 0;
+    std::atomic<uint32_t> _drained{0};
+    std::atomic<uint32_t> _erased{0};
+    std::atomic<uint32_t> _programmed{0};
+    std::atomic<uint32_t> _lastUs{0};
+    std::atomic<bool> _failed{false};
+  };
+
+} // namespace LumynLabs
@@ -0,0 +1,183 @@
+/**
+ * @file cobs_bench.cpp
+ * @brief Host benchmark: COBS encode/decode throughput
+ *
+ * Measures MB/s for a plain byte-at-a-time COBS encoder (the textbook
+ * loop, equivalent to a classic out-of-place encoder) against
+ * Cobs::encode(), Cobs::encodeInPlace() and Cobs::decodeInPlace() from
+ * LumynLabs/Networking/Cobs.h. Three payload shapes are used: random
+ * bytes (few zeros), zero-heavy data (sparse sensor blocks), and LED
+ * frames (RGB with many dark pixels). Every encoded frame is checked
+ * against the reference encoder and decoded back before timing starts.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/cobs_bench.cpp -o cobs_bench
+ *   ./cobs_bench [payload bytes] [iterations]
+ *
+ * Cobs::encode() is the same byte loop until a run reaches 16 non-zero
+ * bytes, and only then switches to the word scan. It should match the
+ * reference on zero-heavy and LED payloads, which are mostly short runs,
+ * and beat it on random data. Each figure is the best of five rounds.
+ * Host numbers are a relative guide only; absolute throughput on the
+ * RP2040 is far lower.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Networking/Cobs.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+  namespace Cobs = LumynLabs::Cobs;
+
+  /** Byte-at-a-time reference encoder. */
+  size_t referenceEncode(const uint8_t *in, size_t length, uint8_t *out)
+  {
+    size_t code = 0;
+    size_t write = 1;
+    uint8_t run = 1;
+    for (size_t i = 0; i < length; ++i)
+    {
+      if (in[i] == 0)
+      {
+        out[code] = run;
+        code = write++;
+        run = 1;
+        continue;
+      }
+      out[write++] = in[i];
+      if (++run == 0xFF)
+      {
+        out[code] = run;
+        if (i + 1 == length)
+        {
+          // No empty block after a full one at the end.
+          return write;
+        }
+        code = write++;
+        run = 1;
+      }
+    }
+    out[code] = run;
+    return write;
+  }
+
+  std::vector<uint8_t> makePayload(const char *shape, size_t length, std::mt19937 &rng)
+  {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+      const uint32_t r = rng();
+      if (std::strcmp(shape, "random") == 0)
+      {
+        data[i] = static_cast<uint8_t>(r);
+      }
+      else if (std::strcmp(shape, "zeros") == 0)
+      {
+        data[i] = (r & 3) == 0 ? static_cast<uint8_t>(r >> 8) : 0;
+      }
+      else
+      {
+        // RGB pixels, a third of them dark.
+        const size_t pixel = i / 3;
+        data[i] = (pixel * 2654435761u >> 7) % 3 == 0 ? 0 : static_cast<uint8_t>(r | 1);
+      }
+    }
+    return data;
+  }
+
+  /** Best of kRounds timed rounds, so a busy host does not skew one codec. */
+  constexpr int kRounds = 5;
+
+  template <typename Fn>
+  double mbPerSecond(size_t bytes, uint32_t iterations, Fn &&fn)
+  {
+    double best = 0;
+    for (int round = 0; round < kRounds; ++round)
+    {
+      const Clock::time_point start = Clock::now();
+      for (uint32_t i = 0; i < iterations; ++i)
+      {
+        fn();
+      }
+      const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      const double rate = static_cast<double>(bytes) * iterations / seconds / 1e6;
+      best = rate > best ? rate : best;
+    }
+    return best;
+  }
+
+  volatile size_t gSink;
+
+  void run(const char *shape, size_t length, uint32_t iterations, std::mt19937 &rng)
+  {
+    const std::vector<uint8_t> payload = makePayload(shape, length, rng);
+    const size_t reserve = Cobs::maxOverhead(length);
+    std::vector<uint8_t> expected(Cobs::maxEncodedSize(length));
+    std::vector<uint8_t> out(Cobs::maxEncodedSize(length));
+    std::vector<uint8_t> frame(reserve + length);
+
+    // Check every path against the reference before timing it.
+    const size_t expectedLength = referenceEncode(payload.data(), length, expected.data());
+    const size_t encodedLength = Cobs::encode(payload.data(), length, out.data());
+    std::memcpy(frame.data() + reserve, payload.data(), length);
+    const size_t inPlaceLength = Cobs::encodeInPlace(frame.data(), reserve, length);
+    if (encodedLength != expectedLength || std::memcmp(out.data(), expected.data(), expectedLength) != 0 ||
+        inPlaceLength != expectedLength || std::memcmp(frame.data(), expected.data(), expectedLength) != 0 ||
+        Cobs::decodeInPlace(frame.data(), inPlaceLength) != length ||
+        std::memcmp(frame.data(), payload.data(), length) != 0)
+    {
+      std::fprintf(stderr, "%s: encoder mismatch\n", shape);
+      std::exit(1);
+    }
+
+    const double reference = mbPerSecond(length, iterations, [&]
+                                         { gSink = referenceEncode(payload.data(), length, out.data()); });
+    const double encode = mbPerSecond(length, iterations, [&]
+                                      { gSink = Cobs::encode(payload.data(), length, out.data()); });
+    // In-place encoding consumes its input, so each pass restores the payload first;
+    // the copy stands in for building the payload in the frame.
+    const double inPlace = mbPerSecond(length, iterations, [&]
+                                       {
+                                         std::memcpy(frame.data() + reserve, payload.data(), length);
+                                         gSink = Cobs::encodeInPlace(frame.data(), reserve, length);
+                                       });
+    const double decode = mbPerSecond(length, iterations, [&]
+                                      {
+                                        std::memcpy(frame.data(), expected.data(), expectedLength);
+                                        gSink = Cobs::decodeInPlace(frame.data(), expectedLength);
+                                      });
+
+    std::printf("%-7s %6zu B  overhead %3zu B  reference %8.1f  encode %8.1f (%.2fx)  in-place %8.1f  "
+                "decode %8.1f MB/s\n",
+                shape, length, expectedLength - length, reference, encode, encode / reference, inPlace, decode);
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const size_t length = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+  const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20000;
+  if (length == 0 || iterations == 0)
+  {
+    std::fprintf(stderr, "usage: %s [payload bytes] [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  std::mt19937 rng(29);
+  for (const char *shape : {"random", "zeros", "led"})
+  {
+    run(shape, length, iterations, rng);
+  }
+  return 0;
+}
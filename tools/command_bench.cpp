@@ -0,0 +1,251 @@
+/**
+ * @file command_bench.cpp
+ * @brief Host benchmark: JSON vs binary module command round trip
+ *
+ * Runs the same setpoint command through both command paths of a custom
+ * module and reports the cost per round trip. The JSON path is: the host
+ * serializes the command, the module parses it in handleReceivedJson(),
+ * then serializes a reply with pushJsonToHost(), and the host parses the
+ * reply. The binary path is: the host builds a command frame, the module
+ * dispatches it to a CommandModule handler, the reply is queued and
+ * handed out by the next poll, and the host reads the reply struct.
+ * Both paths use the same SDK headers the firmware is built with; only
+ * the transport is left out.
+ *
+ * Build and run on the host (ArduinoJson 7 is header-only):
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include -I<ArduinoJson>/src \
+ *       tools/command_bench.cpp -o command_bench
+ *   ./command_bench [iterations [json|binary]]
+ *
+ * Naming a path times only that one, for example to profile it alone.
+ *
+ * Host timings are only a relative guide; on the RP2040 the gap is wider
+ * because float formatting and parsing are done in software.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Modules/ModuleCommands.h"
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  struct MotorData
+  {
+    float position;
+    float velocity;
+  };
+
+  struct SetPosition
+  {
+    static constexpr uint8_t kCommandId = 1;
+    uint8_t axis;
+    float position;
+    float maxVelocity;
+  };
+
+  struct PositionAck
+  {
+    uint32_t count;
+    float position;
+  };
+
+  class Motor : public LumynLabs::CommandModule<MotorData, SetPosition>
+  {
+  public:
+    using CommandModule::CommandModule;
+
+    LumynLabs::ModuleError initModule() override { return LumynLabs::ModuleError::ok(); }
+
+    LumynLabs::ModuleError readData(MotorData *dataOut) override
+    {
+      *dataOut = {_target, 0};
+      return LumynLabs::ModuleError::ok();
+    }
+
+    LumynLabs::CommandStatus handleCommand(const SetPosition &cmd, LumynLabs::CommandReply &reply) override
+    {
+      if (!apply(cmd.axis, cmd.position, cmd.maxVelocity))
+      {
+        return LumynLabs::CommandStatus::Rejected;
+      }
+      reply.set(PositionAck{_count, _target});
+      return LumynLabs::CommandStatus::Ok;
+    }
+
+    bool handleReceivedJson(ArduinoJson::JsonVariantConst json) override
+    {
+      ArduinoJson::JsonVariantConst cmd = json["setPosition"];
+      if (cmd.isNull() || !apply(cmd["axis"] | 0, cmd["position"] | 0.0f, cmd["maxVelocity"] | 0.0f))
+      {
+        return false;
+      }
+      ArduinoJson::JsonDocument reply;
+      reply["ack"]["count"] = _count;
+      reply["ack"]["position"] = _target;
+      return pushJsonToHost(reply.as<ArduinoJson::JsonVariantConst>());
+    }
+
+    uint32_t count() const { return _count; }
+
+  private:
+    bool apply(uint8_t axis, float position, float maxVelocity)
+    {
+      if (axis != 0 || maxVelocity <= 0)
+      {
+        return false;
+      }
+      _target = position;
+      ++_count;
+      return true;
+    }
+
+    float _target = 0;
+    uint32_t _count = 0;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  double nsPer(Clock::duration elapsed, uint32_t iterations)
+  {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  }
+
+  struct Result
+  {
+    double ns;
+    size_t commandBytes;
+    size_t replyBytes;
+    float checksum;
+  };
+
+  Result runJson(uint32_t iterations)
+  {
+    LumynLabs::ModuleConfig config{};
+    Motor motor(config);
+    char wire[128];
+    size_t replyBytes = 0;
+    motor._sdk_setPushJsonFn([&](ArduinoJson::JsonVariantConst json)
+                             {
+                               replyBytes = serializeJson(json, wire, sizeof(wire));
+                               return replyBytes > 0;
+                             });
+
+    Result result{0, 0, 0, 0};
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+      // Host: build and serialize the command.
+      char command[128];
+      ArduinoJson::JsonDocument out;
+      out["setPosition"]["axis"] = 0;
+      out["setPosition"]["position"] = static_cast<float>(i % 1000) * 0.25f;
+      out["setPosition"]["maxVelocity"] = 120.0f;
+      const size_t commandBytes = serializeJson(out, command, sizeof(command));
+
+      // Module: parse, handle, serialize the reply.
+      ArduinoJson::JsonDocument in;
+      if (deserializeJson(in, command, commandBytes) ||
+          !motor.handleReceivedJson(in.as<ArduinoJson::JsonVariantConst>()))
+      {
+        std::fprintf(stderr, "json command failed\n");
+        std::exit(1);
+      }
+
+      // Host: parse the reply.
+      ArduinoJson::JsonDocument reply;
+      deserializeJson(reply, wire, replyBytes);
+      result.checksum += reply["ack"]["position"].as<float>();
+      result.commandBytes = commandBytes;
+    }
+    result.ns = nsPer(Clock::now() - start, iterations);
+    result.replyBytes = replyBytes;
+    return result;
+  }
+
+  Result runBinary(uint32_t iterations)
+  {
+    LumynLabs::ModuleConfig config{};
+    LumynLabs::internal::CommandingModule<MotorData, Motor> holder(config);
+    std::vector<uint8_t> polled;
+    polled.reserve(LumynLabs::CommandReply::kMaxFrame);
+
+    Result result{0, 0, 0, 0};
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+      // Host: build the command frame.
+      const SetPosition cmd{0, static_cast<float>(i % 1000) * 0.25f, 120.0f};
+      uint8_t command[Motor::kHeaderSize + sizeof(SetPosition)];
+      command[0] = Motor::kCommandTag;
+      command[1] = SetPosition::kCommandId;
+      command[2] = static_cast<uint8_t>(i % 255 + 1);
+      std::memcpy(command + Motor::kHeaderSize, &cmd, sizeof(cmd));
+
+      // Module: dispatch, queue the reply, hand it out on the next poll.
+      bool ok = false;
+      if (!holder.interceptBinary(command, sizeof(command), ok) || !ok || !holder.beforeRead(polled))
+      {
+        std::fprintf(stderr, "binary command failed\n");
+        std::exit(1);
+      }
+
+      // Host: read the reply.
+      PositionAck ack;
+      std::memcpy(&ack, polled.data() + LumynLabs::CommandReply::kHeaderSize, sizeof(ack));
+      result.checksum += ack.position;
+      result.commandBytes = sizeof(command);
+    }
+    result.ns = nsPer(Clock::now() - start, iterations);
+    result.replyBytes = polled.size();
+    return result;
+  }
+
+  void report(const char *name, const Result &r)
+  {
+    std::printf("%-7s %9.1f ns/round trip  %3zu B command  %3zu B reply  (checksum %.0f)\n", name, r.ns,
+                r.commandBytes, r.replyBytes, r.checksum);
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 200000;
+  const char *only = argc > 2 ? argv[2] : nullptr;
+  if (iterations == 0 || (only && std::strcmp(only, "json") != 0 && std::strcmp(only, "binary") != 0))
+  {
+    std::fprintf(stderr, "usage: %s [iterations [json|binary]]\n", argv[0]);
+    return 1;
+  }
+  const bool timeJson = !only || only[0] == 'j';
+  const bool timeBinary = !only || only[0] == 'b';
+
+  // Each path is warmed up (caches, allocator) before it is timed.
+  Result json{};
+  Result binary{};
+  if (timeJson)
+  {
+    runJson(iterations / 10 + 1);
+    json = runJson(iterations);
+    report("json", json);
+  }
+  if (timeBinary)
+  {
+    runBinary(iterations / 10 + 1);
+    binary = runBinary(iterations);
+    report("binary", binary);
+  }
+  if (timeJson && timeBinary)
+  {
+    std::printf("binary is %.1fx faster per round trip\n", json.ns / binary.ns);
+  }
+  return 0;
+}
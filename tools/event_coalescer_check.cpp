@@ -0,0 +1,114 @@
+/**
+ * @file event_coalescer_check.cpp
+ * @brief Host check: EventCoalescer keeps event sources apart
+ *
+ * Runs two sources of one event type through a coalescer with a 100 ms
+ * window and checks that each source is merged only with itself:
+ *   modules  module 3 sends 10 updates while module 7 sends one; both
+ *            first updates go out at once, module 7's is not merged into
+ *            module 3's pending slot, and the poll after the window emits
+ *            module 3's merged update with a count of 9
+ *   pins     the same with pin interrupts on pins 2 and 5
+ *   custom   the same with custom events of user types 1 and 9
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/event_coalescer_check.cpp -o event_coalescer_check
+ *   ./event_coalescer_check
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Eventing/EventCoalescer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+  using LumynLabs::CoalescedEvent;
+  using LumynLabs::Event;
+  using LumynLabs::EventType;
+
+  void fail(const char *check, const char *what)
+  {
+    std::fprintf(stderr, "FAILED: %s: %s\n", check, what);
+    std::exit(1);
+  }
+
+  Event pinEvent(uint8_t pin)
+  {
+    Event event{};
+    event.type = EventType::PinInterrupt;
+    event.data.pinInterrupt.pin = pin;
+    return event;
+  }
+
+  /**
+   * Source @p busy sends ten events 5 ms apart, source @p quiet one event
+   * in the middle; returns after checking what the coalescer emitted.
+   */
+  template <typename MakeEvent>
+  void checkSources(const char *check, EventType type, uint16_t busy, uint16_t quiet, MakeEvent make)
+  {
+    LumynLabs::EventCoalescer<> coalescer;
+    coalescer.setRule(type, {100, 0, 1});
+
+    CoalescedEvent out;
+    unsigned busySent = 0;
+    unsigned quietSent = 0;
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+      if (coalescer.offer(make(busy), i * 5, out))
+      {
+        if (LumynLabs::eventSourceKey(out.event) != busy)
+        {
+          fail(check, "busy source emitted another source's event");
+        }
+        ++busySent;
+      }
+      if (i == 4)
+      {
+        if (!coalescer.offer(make(quiet), i * 5, out))
+        {
+          fail(check, "quiet source's first event was merged into the busy source");
+        }
+        if (LumynLabs::eventSourceKey(out.event) != quiet || out.count != 1)
+        {
+          fail(check, "quiet source's event came out wrong");
+        }
+        ++quietSent;
+      }
+    }
+    if (busySent != 1 || quietSent != 1)
+    {
+      fail(check, "first event of each source was not sent at once");
+    }
+
+    if (!coalescer.poll(100, out))
+    {
+      fail(check, "merged events were not emitted after the window");
+    }
+    if (LumynLabs::eventSourceKey(out.event) != busy || out.count != 9)
+    {
+      fail(check, "merged event has the wrong source or count");
+    }
+    if (coalescer.poll(100, out) || coalescer.hasPending())
+    {
+      fail(check, "quiet source left a pending event behind");
+    }
+    std::printf("%-8s source %u: 1 + 9 merged, source %u: 1, kept apart\n", check, busy, quiet);
+  }
+} // namespace
+
+int main()
+{
+  checkSources("modules", EventType::Module, 3, 7, [](uint16_t id)
+               { return LumynLabs::createModuleEvent(id); });
+  checkSources("pins", EventType::PinInterrupt, 2, 5, [](uint16_t pin)
+               { return pinEvent(static_cast<uint8_t>(pin)); });
+  checkSources("custom", EventType::Custom, 1, 9, [](uint16_t type)
+               { return LumynLabs::createCustomEvent(static_cast<uint8_t>(type)); });
+  return 0;
+}
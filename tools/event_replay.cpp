@@ -0,0 +1,353 @@
+/**
+ * @file event_replay.cpp
+ * @brief Host harness: scripted event replay with latency tracing
+ *
+ * Replays a script of events through an EventRing built with
+ * CX_EVENT_TRACE=1. A producer thread publishes each event at its
+ * scripted time. A consumer thread polls a subscriber and forwards every
+ * event over a simulated host link, taking the Transmit stamp when the
+ * link is done with it. The tracer snapshot is then decoded in the same
+ * way as tools/event_trace.py does it, and the harness prints p50, p99
+ * and max latency per event type for publish->dequeue, dequeue->transmit
+ * and publish->transmit.
+ *
+ * Script lines (# starts a comment):
+ *   link <us>                              transmit cost per event
+ *   <time us> <type> <source> [<count> <every us>]
+ * where type is pin, module, custom or heartbeat and source is the pin,
+ * module ID or custom type. A count repeats the event, e.g.
+ * "5000 pin 3 50 20" is 50 edges on pin 3, 20 us apart, from 5 ms on.
+ * Without a script a built-in mix is replayed: heartbeats every 10 ms,
+ * two polled modules, pin bursts and custom events.
+ *
+ * The run fails (exit 1) if any event is lost or lacks a stamp, or if a
+ * type's publish->transmit p99 exceeds the budget. A CI job can run the
+ * built-in script with a budget to catch latency regressions. The
+ * snapshot can also be written out for tools/event_trace.py.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -pthread -Ilib/LumynLabsSDK/include tools/event_replay.cpp -o event_replay
+ *   ./event_replay [script.txt|- [p99 budget us [trace.bin]]]
+ *
+ * Latencies include host scheduling, so set the budget well above the
+ * typical figures and run on an otherwise idle machine.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#define CX_EVENT_TRACE 1
+#define CX_EVENT_TRACE_DEPTH 16384
+
+#include "LumynLabs/Eventing/Event.h"
+#include "LumynLabs/Eventing/EventRing.h"
+#include "LumynLabs/Eventing/EventTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+  using LumynLabs::Event;
+  using LumynLabs::EventTraceRecord;
+  using LumynLabs::EventTraceStage;
+  using LumynLabs::EventType;
+  using Ring = LumynLabs::EventRing<256>;
+
+  const char *kDefaultScript = R"(
+# Built-in mix, 200 ms
+link 40
+0      heartbeat 0   20 10000
+500    module    3   40 5000
+2500   module    7   40 5000
+20000  pin       3   50 20
+60000  pin       5   10 500
+90000  custom    1   30 1000
+150000 pin       3   100 10
+)";
+
+  struct ScriptEvent
+  {
+    uint32_t atUs;
+    Event event;
+  };
+
+  /** Stamps collected for one ring sequence number. */
+  struct Stamps
+  {
+    uint8_t typeBit = 0;
+    uint8_t seen = 0; ///< Bit per EventTraceStage
+    uint32_t ticks[3] = {};
+  };
+
+  struct Script
+  {
+    uint32_t linkUs = 0;
+    std::vector<ScriptEvent> events;
+  };
+
+  void fail(const char *what, const std::string &detail)
+  {
+    std::fprintf(stderr, "FAILED: %s%s%s\n", what, detail.empty() ? "" : ": ", detail.c_str());
+    std::exit(1);
+  }
+
+  Event makeEvent(const std::string &type, uint32_t source)
+  {
+    Event event{};
+    if (type == "pin")
+    {
+      event.type = EventType::PinInterrupt;
+      event.data.pinInterrupt.pin = static_cast<uint8_t>(source);
+    }
+    else if (type == "module")
+    {
+      event = LumynLabs::createModuleEvent(static_cast<uint16_t>(source));
+    }
+    else if (type == "custom")
+    {
+      event = LumynLabs::createCustomEvent(static_cast<uint8_t>(source));
+    }
+    else if (type == "heartbeat")
+    {
+      event.type = EventType::HeartBeat;
+    }
+    else
+    {
+      fail("unknown event type", type);
+    }
+    return event;
+  }
+
+  Script parseScript(std::istream &in)
+  {
+    Script script;
+    std::string line;
+    while (std::getline(in, line))
+    {
+      line = line.substr(0, line.find('#'));
+      std::istringstream fields(line);
+      std::string first;
+      if (!(fields >> first))
+      {
+        continue;
+      }
+      if (first == "link")
+      {
+        if (!(fields >> script.linkUs))
+        {
+          fail("bad link line", line);
+        }
+        continue;
+      }
+      std::string type;
+      uint32_t source = 0;
+      uint32_t count = 1;
+      uint32_t everyUs = 0;
+      if (!(fields >> type >> source))
+      {
+        fail("bad event line", line);
+      }
+      fields >> count >> everyUs;
+      const uint32_t atUs = static_cast<uint32_t>(std::strtoul(first.c_str(), nullptr, 10));
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        script.events.push_back({atUs + i * everyUs, makeEvent(type, source)});
+      }
+    }
+    std::stable_sort(script.events.begin(), script.events.end(),
+                     [](const ScriptEvent &a, const ScriptEvent &b)
+                     { return a.atUs < b.atUs; });
+    return script;
+  }
+
+  /** Wait without sleeping, but let the other thread run on a one-core host. */
+  void spinUntil(Clock::time_point when)
+  {
+    while (Clock::now() < when)
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  const char *typeName(uint8_t typeBit)
+  {
+    switch (typeBit)
+    {
+    case LumynLabs::eventTypeBit(EventType::PinInterrupt):
+      return "PinInterrupt";
+    case LumynLabs::eventTypeBit(EventType::Module):
+      return "Module";
+    case LumynLabs::eventTypeBit(EventType::Custom):
+      return "Custom";
+    case LumynLabs::eventTypeBit(EventType::HeartBeat):
+      return "HeartBeat";
+    default:
+      return "other";
+    }
+  }
+
+  /** Replay @p script; returns the tracer snapshot. */
+  std::vector<uint8_t> replay(const Script &script, uint32_t &overruns)
+  {
+    static Ring ring;
+    LumynLabs::eventTracer().reset();
+    std::atomic<bool> producing{true};
+    std::atomic<bool> ready{false};
+
+    std::thread consumer([&]
+                         {
+                           Ring::Subscriber sub(ring, LumynLabs::combineEvents({EventType::PinInterrupt, EventType::Module,
+                                                                                EventType::Custom, EventType::HeartBeat}));
+                           ready.store(true);
+                           Event event;
+                           for (;;)
+                           {
+                             const bool last = !producing.load();
+                             const LumynLabs::EventPollResult result = sub.poll(event);
+                             if (result == LumynLabs::EventPollResult::Event)
+                             {
+                               // Stand-in for framing and writing the event to the host link.
+                               spinUntil(Clock::now() + std::chrono::microseconds(script.linkUs));
+                               LumynLabs::traceEvent(EventTraceStage::Transmit, sub.traceId(), sub.lastSequence(),
+                                                     event.type);
+                             }
+                             else if (result == LumynLabs::EventPollResult::Empty)
+                             {
+                               if (last)
+                               {
+                                 break;
+                               }
+                               std::this_thread::yield();
+                             }
+                           }
+                           overruns = sub.overruns();
+                         });
+
+    while (!ready.load())
+    {
+      std::this_thread::yield();
+    }
+    const Clock::time_point start = Clock::now();
+    for (const ScriptEvent &scripted : script.events)
+    {
+      spinUntil(start + std::chrono::microseconds(scripted.atUs));
+      ring.publish(scripted.event);
+    }
+    producing.store(false);
+    consumer.join();
+
+    std::vector<uint8_t> dump(LumynLabs::EventTracer::snapshotSize());
+    dump.resize(LumynLabs::eventTracer().snapshot(dump.data(), dump.size()));
+    return dump;
+  }
+
+  double percentile(std::vector<double> &values, size_t numerator)
+  {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * numerator / 100)];
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Script script;
+  if (argc > 1 && std::strcmp(argv[1], "-") != 0)
+  {
+    std::ifstream file(argv[1]);
+    if (!file)
+    {
+      fail("cannot open script", argv[1]);
+    }
+    script = parseScript(file);
+  }
+  else
+  {
+    std::istringstream builtIn(kDefaultScript);
+    script = parseScript(builtIn);
+  }
+  const double budgetUs = argc > 2 ? std::strtod(argv[2], nullptr) : 0;
+  if (script.events.empty() || script.events.size() * 3 > CX_EVENT_TRACE_DEPTH)
+  {
+    fail("script must have between 1 and CX_EVENT_TRACE_DEPTH / 3 events", "");
+  }
+
+  uint32_t overruns = 0;
+  const std::vector<uint8_t> dump = replay(script, overruns);
+  if (argc > 3)
+  {
+    std::ofstream(argv[3], std::ios::binary).write(reinterpret_cast<const char *>(dump.data()), dump.size());
+  }
+
+  LumynLabs::EventTraceHeader header;
+  std::memcpy(&header, dump.data(), sizeof(header));
+  // One ring, so the sequence number alone identifies an event.
+  std::map<uint32_t, Stamps> stamps;
+  for (uint32_t i = 0; i < header.recordCount; ++i)
+  {
+    EventTraceRecord rec;
+    std::memcpy(&rec, dump.data() + sizeof(header) + i * sizeof(rec), sizeof(rec));
+    Stamps &event = stamps[rec.sequence];
+    event.typeBit = rec.typeBit;
+    event.ticks[rec.stage] = rec.ticks;
+    event.seen |= static_cast<uint8_t>(1u << rec.stage);
+  }
+
+  std::printf("%zu events replayed, link %u us, %u stamps, %u overruns\n", script.events.size(), script.linkUs,
+              header.recordCount, overruns);
+  if (overruns != 0 || stamps.size() != script.events.size())
+  {
+    fail("events were lost", std::to_string(stamps.size()) + " of " + std::to_string(script.events.size()) + " traced");
+  }
+
+  const double usPerTick = 1e6 / header.clockHz;
+  std::map<std::string, std::vector<double>[3]> latencies;
+  for (const auto &[seq, event] : stamps)
+  {
+    if (event.seen != 0x7)
+    {
+      fail("event is missing a stamp", "seq " + std::to_string(seq));
+    }
+    const uint32_t *ticks = event.ticks;
+    auto &type = latencies[typeName(event.typeBit)];
+    // 32-bit tick differences stay valid across a wrap of the clock.
+    type[0].push_back(static_cast<uint32_t>(ticks[1] - ticks[0]) * usPerTick);
+    type[1].push_back(static_cast<uint32_t>(ticks[2] - ticks[1]) * usPerTick);
+    type[2].push_back(static_cast<uint32_t>(ticks[2] - ticks[0]) * usPerTick);
+  }
+
+  bool overBudget = false;
+  const char *spans[3] = {"publish->dequeue", "dequeue->transmit", "publish->transmit"};
+  for (auto &[name, type] : latencies)
+  {
+    for (int span = 0; span < 3; ++span)
+    {
+      std::vector<double> &values = type[span];
+      const double p50 = percentile(values, 50);
+      const double p99 = percentile(values, 99);
+      std::printf("%-12s %-18s n=%-4zu p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name.c_str(), spans[span],
+                  values.size(), p50, p99, values.back());
+      if (span == 2 && budgetUs > 0 && p99 > budgetUs)
+      {
+        overBudget = true;
+      }
+    }
+  }
+  if (overBudget)
+  {
+    fail("publish->transmit p99 over budget", std::to_string(static_cast<long>(budgetUs)) + " us");
+  }
+  return 0;
+}
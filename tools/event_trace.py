@@ -0,0 +1,185 @@
+"""
+ConnectorX Event Trace Decoder
+
+Turns an EventTracer snapshot (see LumynLabs/Eventing/EventTrace.h) into
+per-event-type latency histograms and a Chrome trace JSON file that can be
+opened in chrome://tracing or https://ui.perfetto.dev.
+
+The snapshot may be given as the raw binary dump or as the same bytes
+printed in hex (whitespace ignored), which is convenient when the firmware
+writes it to the log port.
+
+Usage:
+    python tools/event_trace.py trace.bin
+    python tools/event_trace.py trace.hex --chrome trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+from collections import defaultdict
+
+MAGIC = 0x52545843  # "CXTR"
+HEADER = struct.Struct("<IHHIII")
+RECORD = struct.Struct("<IIBBBB")
+VERSION = 2
+
+STAGES = ("publish", "dequeue", "transmit")
+
+# Bit index + 1 -> name, mirrors LumynLabs::EventType
+EVENT_TYPES = {
+    0: "BeginInitialization",
+    1: "FinishInitialization",
+    2: "Enabled",
+    3: "Disabled",
+    4: "Connected",
+    5: "Disconnected",
+    6: "Error",
+    7: "FatalError",
+    9: "Custom",
+    10: "PinInterrupt",
+    11: "HeartBeat",
+    13: "Module",
+}
+
+# Histogram bucket upper bounds in microseconds
+BUCKETS_US = (1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000)
+
+
+def load_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+    try:
+        return bytes.fromhex("".join(data.decode("ascii").split()))
+    except (UnicodeDecodeError, ValueError):
+        sys.exit(f"{path}: neither a binary trace dump nor hex text")
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        sys.exit("trace dump is truncated")
+    magic, version, record_size, clock_hz, count, total = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("bad trace magic")
+    if version != VERSION or record_size != RECORD.size:
+        sys.exit(f"unsupported trace format v{version} (record size {record_size})")
+
+    records = []
+    offset = HEADER.size
+    for _ in range(count):
+        if offset + RECORD.size > len(data):
+            break
+        records.append(RECORD.unpack_from(data, offset))
+        offset += RECORD.size
+    return clock_hz, total, records
+
+
+def unwrap_ticks(records):
+    """Extend the 32-bit clock; records are in stamp order."""
+    out = []
+    high = 0
+    last = None
+    for ticks, seq, type_bit, ring, stage, core in records:
+        if last is not None and ticks < last and last - ticks > 0x80000000:
+            high += 1 << 32
+        last = ticks
+        out.append((high + ticks, seq, type_bit, ring, stage, core))
+    return out
+
+
+def latencies(records, clock_hz):
+    """Group stamps by (ring, sequence).
+
+    Returns ({(type, from, to): [us, ...]}, [negative deltas]). A negative
+    delta means the stamps disagree with the event's order, which points
+    at a clock or pairing problem, so it is reported rather than dropped.
+    """
+    by_event = defaultdict(dict)
+    types = {}
+    for ticks, seq, type_bit, ring, stage, _ in records:
+        # Several subscribers may dequeue one event; keep the first stamp.
+        by_event[(ring, seq)].setdefault(stage, ticks)
+        types[(ring, seq)] = type_bit
+
+    result = defaultdict(list)
+    negative = []
+    for key, stamps in by_event.items():
+        name = EVENT_TYPES.get(types[key], f"type{types[key]}")
+        for a, b in ((0, 1), (1, 2), (0, 2)):
+            if a in stamps and b in stamps:
+                us = (stamps[b] - stamps[a]) * 1e6 / clock_hz
+                if us < 0:
+                    negative.append((name, key[0], key[1], STAGES[a], STAGES[b], us))
+                    continue
+                result[(name, STAGES[a], STAGES[b])].append(us)
+    return result, negative
+
+
+def print_histograms(result):
+    for (name, start, end), values in sorted(result.items()):
+        values.sort()
+        n = len(values)
+        p50 = values[n // 2]
+        p99 = values[min(n - 1, (n * 99) // 100)]
+        print(f"{name} {start}->{end}: n={n} p50={p50:.1f}us p99={p99:.1f}us max={values[-1]:.1f}us")
+        counts = [0] * (len(BUCKETS_US) + 1)
+        for v in values:
+            for i, bound in enumerate(BUCKETS_US):
+                if v <= bound:
+                    counts[i] += 1
+                    break
+            else:
+                counts[-1] += 1
+        width = max(counts)
+        for i, c in enumerate(counts):
+            if c == 0:
+                continue
+            label = f"<={BUCKETS_US[i]}us" if i < len(BUCKETS_US) else f">{BUCKETS_US[-1]}us"
+            bar = "#" * max(1, (c * 40) // width)
+            print(f"  {label:>9} {c:6d} {bar}")
+
+
+def chrome_trace(records, clock_hz):
+    events = []
+    base = records[0][0] if records else 0
+    for ticks, seq, type_bit, ring, stage, core in records:
+        events.append({
+            "name": EVENT_TYPES.get(type_bit, f"type{type_bit}"),
+            "cat": STAGES[stage] if stage < len(STAGES) else "stage",
+            "ph": "i",
+            "s": "t",
+            "ts": (ticks - base) * 1e6 / clock_hz,
+            "pid": 0,
+            "tid": core,
+            "args": {"ring": ring, "seq": seq, "stage": STAGES[stage] if stage < len(STAGES) else stage},
+        })
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="EventTracer snapshot, binary or hex text")
+    parser.add_argument("--chrome", metavar="OUT", help="write a Chrome trace JSON file")
+    args = parser.parse_args()
+
+    clock_hz, total, records = parse(load_dump(args.dump))
+    records = unwrap_ticks(records)
+    print(f"{len(records)} stamps ({total} taken, clock {clock_hz} Hz)")
+    result, negative = latencies(records, clock_hz)
+    print_histograms(result)
+    if negative:
+        print(f"WARNING: {len(negative)} negative latencies (stamps out of order):")
+        for name, ring, seq, start, end, us in negative[:10]:
+            print(f"  {name} ring {ring} seq {seq} {start}->{end}: {us:.1f}us")
+
+    if args.chrome:
+        with open(args.chrome, "w") as f:
+            json.dump(chrome_trace(records, clock_hz), f)
+        print(f"wrote {args.chrome}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,226 @@
+/**
+ * @file file_pipeline_check.cpp
+ * @brief Host check: FileRequestPipeline lane fairness, ordering and read merging
+ *
+ * Drives a FileRequestPipeline by calling service() against an in-memory
+ * FileBackend that logs every call:
+ *   fairness  a 64 KB write competes with a read load that never lets
+ *             up; the write must get one chunk after every readBurst
+ *             reads and must finish
+ *   ordering  a read of a path with an earlier write still queued must
+ *             return the written data
+ *   merging   eight adjacent 64-byte reads queued out of order must be
+ *             answered by one backend read, and two adjacent reads that
+ *             run off the end of the file by another, with the same bytes
+ *             and short-read results as separate reads; a read past the
+ *             end of the file must get a read of its own
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -pthread -Ilib/LumynLabsSDK/include tools/file_pipeline_check.cpp -o file_pipeline_check
+ *   ./file_pipeline_check
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Files/FileRequestPipeline.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using LumynLabs::FileMode;
+  using Pipeline = LumynLabs::FileRequestPipeline<16>;
+
+  void fail(const char *check, const char *what)
+  {
+    std::fprintf(stderr, "FAILED: %s: %s\n", check, what);
+    std::exit(1);
+  }
+
+  /** Files in memory; counts backend calls. */
+  class MemoryBackend : public LumynLabs::FileBackend
+  {
+  public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+
+    void *open(const char *path, FileMode mode) override
+    {
+      auto &file = files[path];
+      if (mode == FileMode::Write)
+      {
+        file.clear();
+      }
+      return &file;
+    }
+
+    int32_t read(void *file, uint32_t offset, uint8_t *dst, uint32_t length) override
+    {
+      ++reads;
+      const auto &data = *static_cast<std::vector<uint8_t> *>(file);
+      if (offset >= data.size())
+      {
+        return 0;
+      }
+      const uint32_t n = data.size() - offset < length ? static_cast<uint32_t>(data.size() - offset) : length;
+      std::memcpy(dst, data.data() + offset, n);
+      return static_cast<int32_t>(n);
+    }
+
+    int32_t write(void *file, const uint8_t *src, uint32_t length) override
+    {
+      ++writes;
+      auto &data = *static_cast<std::vector<uint8_t> *>(file);
+      data.insert(data.end(), src, src + length);
+      return static_cast<int32_t>(length);
+    }
+
+    void close(void *) override {}
+  };
+
+  std::vector<uint8_t> pattern(size_t length, uint8_t seed)
+  {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+      data[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    return data;
+  }
+
+  void checkFairness()
+  {
+    constexpr uint8_t kBurst = 4;
+    MemoryBackend backend;
+    backend.files["/asset.bin"] = pattern(16 * 600, 1);
+    Pipeline pipeline(4096, kBurst);
+    const std::vector<uint8_t> log = pattern(64 * 1024, 2);
+    Pipeline::Future write = pipeline.write("/log.bin", log.data(), static_cast<uint32_t>(log.size()));
+
+    // Keep the read lane full for as long as the write takes.
+    Pipeline::Future reads[15];
+    uint8_t buffers[15][32];
+    uint32_t steps = 0;
+    uint32_t readsSinceChunk = 0;
+    uint32_t mostReadsBetweenChunks = 0;
+    while (!write.ready())
+    {
+      for (size_t i = 0; i < 15; ++i)
+      {
+        if (!reads[i].valid() || reads[i].ready())
+        {
+          // 32-byte reads 600 bytes apart are never merged.
+          reads[i] = pipeline.read("/asset.bin", static_cast<uint32_t>(i) * 600, buffers[i], 32);
+        }
+      }
+      const uint32_t chunksBefore = backend.writes;
+      const uint32_t readsBefore = pipeline.stats().reads;
+      if (!pipeline.service(backend) || ++steps > 10000)
+      {
+        fail("fairness", "write never finished under a steady read load");
+      }
+      readsSinceChunk += pipeline.stats().reads - readsBefore;
+      if (backend.writes != chunksBefore)
+      {
+        mostReadsBetweenChunks = readsSinceChunk > mostReadsBetweenChunks ? readsSinceChunk : mostReadsBetweenChunks;
+        readsSinceChunk = 0;
+      }
+    }
+    if (write.result() != static_cast<int32_t>(log.size()) || backend.files["/log.bin"] != log)
+    {
+      fail("fairness", "write result or contents wrong");
+    }
+    if (mostReadsBetweenChunks > kBurst)
+    {
+      fail("fairness", "more than readBurst reads between two write chunks");
+    }
+    std::printf("fairness  64 KB write done in %u chunks, %u reads served alongside, at most %u between chunks\n",
+                backend.writes, pipeline.stats().reads, mostReadsBetweenChunks);
+  }
+
+  void checkOrdering()
+  {
+    MemoryBackend backend;
+    Pipeline pipeline;
+    const std::vector<uint8_t> data = pattern(100, 3);
+    uint8_t buffer[100] = {};
+    Pipeline::Future write = pipeline.write("/cfg.json", data.data(), 100);
+    Pipeline::Future read = pipeline.read("/cfg.json", 0, buffer, sizeof(buffer));
+    while (pipeline.service(backend))
+    {
+    }
+    if (!read.ready() || read.result() != 100 || std::memcmp(buffer, data.data(), 100) != 0)
+    {
+      fail("ordering", "read did not see the earlier write");
+    }
+    std::printf("ordering  read queued after a write to the same path returns the written data\n");
+  }
+
+  void checkMerging()
+  {
+    MemoryBackend backend;
+    const std::vector<uint8_t> data = pattern(1000, 4);
+    backend.files["/bitmap.bin"] = data;
+    Pipeline pipeline;
+
+    // Eight 64-byte tiles covering 100..611, queued out of order; a read
+    // past the end of file; and two reads at 940 and 990 that run off the
+    // end (10 bytes left at 990).
+    const uint32_t offsets[] = {164, 100, 356, 228, 292, 484, 420, 548};
+    uint8_t tiles[8][64];
+    uint8_t tail[64];
+    uint8_t far[64];
+    std::vector<Pipeline::Future> futures;
+    for (size_t i = 0; i < 8; ++i)
+    {
+      futures.push_back(pipeline.read("/bitmap.bin", offsets[i], tiles[i], 64));
+    }
+    Pipeline::Future farRead = pipeline.read("/bitmap.bin", 2048, far, 64);
+    Pipeline::Future tailA = pipeline.read("/bitmap.bin", 940, tail, 60);
+    uint8_t tailEnd[64];
+    Pipeline::Future tailB = pipeline.read("/bitmap.bin", 990, tailEnd, 20);
+
+    while (pipeline.service(backend))
+    {
+    }
+    for (size_t i = 0; i < 8; ++i)
+    {
+      if (futures[i].result() != 64 || std::memcmp(tiles[i], data.data() + offsets[i], 64) != 0)
+      {
+        fail("merging", "merged tile read returned wrong data");
+      }
+    }
+    if (tailA.result() != 60 || std::memcmp(tail, data.data() + 940, 60) != 0 || tailB.result() != 10 ||
+        std::memcmp(tailEnd, data.data() + 990, 10) != 0)
+    {
+      fail("merging", "merged read at end of file returned the wrong short result");
+    }
+    if (farRead.result() != 0)
+    {
+      fail("merging", "read past the end of file did not return 0");
+    }
+    // One open; tiles in one read, the tail pair in one read, the far read alone.
+    if (backend.reads != 3 || pipeline.stats().readsMerged != 8)
+    {
+      fail("merging", "adjacent reads were not merged into single backend reads");
+    }
+    std::printf("merging   11 reads -> %u backend reads, %u merged, same data and results\n", backend.reads,
+                pipeline.stats().readsMerged);
+  }
+} // namespace
+
+int main()
+{
+  checkFairness();
+  checkOrdering();
+  checkMerging();
+  return 0;
+}
@@ -0,0 +1,321 @@
+/**
+ * @file fragment_bench.cpp
+ * @brief Host benchmark: head-of-line latency and throughput over a simulated UART
+ *
+ * Plays a 64 KB Bulk upload and a stream of small LED commands (Events)
+ * through FragmentScheduler onto a simulated serial link (10 bits per
+ * byte, 1 Mbaud by default). Every fragment is COBS-framed with
+ * encodeGather(), timed by its wire length, decoded on the far side and
+ * reassembled with FragmentAssembler, and every finished transmission is
+ * checked byte for byte.
+ *
+ * Two schedules are compared for each fragment size:
+ *   sequential  one transmission at a time, in submit order (a
+ *               FragmentScheduler<1> fed from a FIFO), the shape of a
+ *               link that finishes each transmission before the next
+ *   interleaved FragmentScheduler<8> with TxClass priorities
+ *
+ * Reported per run: command latency (submit to last byte on the
+ * wire), Bulk goodput, and wire efficiency. The command rate is high
+ * enough that more than 256 IDs are handed out while the upload is in
+ * flight. A short check at start-up also cancels a transmission
+ * mid-flight and confirms the receiver frees its slot on the abort
+ * fragment.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/fragment_bench.cpp -o fragment_bench
+ *   ./fragment_bench [baud] [command period us]
+ *
+ * Time is simulated, so the results do not depend on the host.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Networking/Cobs.h"
+#include "LumynLabs/Networking/FragmentScheduler.h"
+#include "LumynLabs/Networking/TxGather.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace
+{
+  namespace Cobs = LumynLabs::Cobs;
+  using LumynLabs::FragmentHeader;
+  using LumynLabs::TxClass;
+
+  constexpr uint32_t kBulkSize = 64 * 1024;
+  constexpr uint32_t kCommandSize = 24; // one LED command
+
+  struct WireSink
+  {
+    std::vector<uint8_t> bytes;
+
+    size_t write(const uint8_t *data, size_t length)
+    {
+      bytes.insert(bytes.end(), data, data + length);
+      return length;
+    }
+  };
+
+  struct Transmission
+  {
+    std::vector<uint8_t> data;
+    TxClass priority;
+    double submittedUs;
+  };
+
+  /** Decodes fragments off the wire and checks reassembled transmissions. */
+  class Receiver
+  {
+  public:
+    explicit Receiver(const std::vector<Transmission> &sent) : _sent(sent) {}
+
+    /** Bind a transmission ID to the index of the transmission it carries. */
+    void expect(uint8_t id, size_t index)
+    {
+      _byId[id] = index;
+      _buffers[id].assign(_sent[index].data.size(), 0);
+    }
+
+    /** @return index of the transmission completed by this frame, or -1 */
+    long frame(std::vector<uint8_t> &wire)
+    {
+      // Strip the delimiter and decode in place.
+      const size_t length = Cobs::decodeInPlace(wire.data(), wire.size() - 1);
+      FragmentHeader header;
+      if (length < sizeof(header))
+      {
+        fail("short frame");
+      }
+      std::memcpy(&header, wire.data(), sizeof(header));
+      const uint32_t payload = static_cast<uint32_t>(length - sizeof(header));
+      uint32_t offset = 0;
+      switch (_assembler.accept(header, payload, offset))
+      {
+      case Assembler::Result::Dropped:
+        fail("fragment dropped");
+        break;
+      case Assembler::Result::Aborted:
+        return -1;
+      case Assembler::Result::Accepted:
+      case Assembler::Result::Complete:
+        break;
+      }
+      std::vector<uint8_t> &buffer = _buffers[header.id];
+      std::memcpy(buffer.data() + offset, wire.data() + sizeof(header), payload);
+      if (!(header.flags & FragmentHeader::kLast))
+      {
+        return -1;
+      }
+      const size_t index = _byId[header.id];
+      if (buffer != _sent[index].data)
+      {
+        fail("corrupted transmission");
+      }
+      return static_cast<long>(index);
+    }
+
+    uint32_t aborted() const { return _assembler.abortedCount(); }
+
+  private:
+    using Assembler = LumynLabs::FragmentAssembler<8>;
+
+    static void fail(const char *what)
+    {
+      std::fprintf(stderr, "receiver: %s\n", what);
+      std::exit(1);
+    }
+
+    const std::vector<Transmission> &_sent;
+    Assembler _assembler;
+    size_t _byId[256] = {};
+    std::vector<uint8_t> _buffers[256];
+  };
+
+  /** Put the next fragment on the wire; false if none is ready. */
+  template <typename Scheduler>
+  bool sendNext(Scheduler &sched, WireSink &wire)
+  {
+    FragmentHeader header;
+    LumynLabs::TxSegment slice;
+    if (!sched.next(header, slice))
+    {
+      return false;
+    }
+    LumynLabs::TxGather<2> frame;
+    frame.add(&header, sizeof(header));
+    frame.add(slice.data, slice.length);
+    wire.bytes.clear();
+    LumynLabs::encodeGather(frame, wire);
+    sched.acknowledge(1);
+    return true;
+  }
+
+  struct Result
+  {
+    double p50Us;
+    double p99Us;
+    double maxUs;
+    double bulkKBps;
+    double efficiency;
+  };
+
+  /** Bulk at t=0, then a command every @p periodUs until the bulk finishes. */
+  std::vector<Transmission> makeWorkload(uint32_t periodUs, uint32_t baud)
+  {
+    std::vector<Transmission> sent;
+    Transmission bulk{std::vector<uint8_t>(kBulkSize), TxClass::Bulk, 0};
+    for (uint32_t i = 0; i < kBulkSize; ++i)
+    {
+      bulk.data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+    sent.push_back(bulk);
+    // Enough commands to cover the upload even when it runs last.
+    const double bulkUs = kBulkSize * 1.1 * 10e6 / baud;
+    for (uint32_t n = 0; n * static_cast<double>(periodUs) < bulkUs; ++n)
+    {
+      Transmission cmd{std::vector<uint8_t>(kCommandSize), TxClass::Events,
+                       static_cast<double>(n) * periodUs + periodUs / 2.0};
+      for (uint32_t i = 0; i < kCommandSize; ++i)
+      {
+        cmd.data[i] = static_cast<uint8_t>(n + i);
+      }
+      sent.push_back(cmd);
+    }
+    return sent;
+  }
+
+  template <size_t InFlight>
+  Result run(const std::vector<Transmission> &sent, uint16_t fragmentPayload, uint32_t baud, bool priorities)
+  {
+    LumynLabs::FragmentScheduler<InFlight> sched(fragmentPayload);
+    Receiver receiver(sent);
+    WireSink wire;
+    std::deque<size_t> waiting;
+    std::vector<double> latencies;
+    size_t arrived = 0;
+    size_t done = 0;
+    double now = 0;
+    double bulkDoneUs = 0;
+    uint64_t wireBytes = 0;
+    uint64_t payloadBytes = 0;
+
+    while (done < sent.size())
+    {
+      while (arrived < sent.size() && sent[arrived].submittedUs <= now)
+      {
+        waiting.push_back(arrived++);
+      }
+      while (!waiting.empty())
+      {
+        const Transmission &tx = sent[waiting.front()];
+        uint8_t id;
+        if (!sched.submit(tx.data.data(), static_cast<uint32_t>(tx.data.size()),
+                          priorities ? tx.priority : TxClass::Telemetry, &id))
+        {
+          break;
+        }
+        receiver.expect(id, waiting.front());
+        waiting.pop_front();
+      }
+
+      if (!sendNext(sched, wire))
+      {
+        // Link idle until the next submission.
+        now = sent[arrived].submittedUs;
+        continue;
+      }
+      now += wire.bytes.size() * 10e6 / baud;
+      wireBytes += wire.bytes.size();
+      const long finished = receiver.frame(wire.bytes);
+      if (finished < 0)
+      {
+        continue;
+      }
+      ++done;
+      payloadBytes += sent[finished].data.size();
+      if (finished == 0)
+      {
+        bulkDoneUs = now;
+      }
+      else
+      {
+        latencies.push_back(now - sent[finished].submittedUs);
+      }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto at = [&](double q)
+    { return latencies[static_cast<size_t>(q * (latencies.size() - 1))]; };
+    return {at(0.5), at(0.99), latencies.back(), kBulkSize / bulkDoneUs * 1e3,
+            static_cast<double>(payloadBytes) / wireBytes};
+  }
+
+  /** Cancel a transmission mid-flight and check the receiver lets go of it. */
+  void checkAbort()
+  {
+    std::vector<Transmission> sent = {{std::vector<uint8_t>(4096, 0x5A), TxClass::Bulk, 0},
+                                      {std::vector<uint8_t>(300, 0xA5), TxClass::Bulk, 0}};
+    LumynLabs::FragmentScheduler<2> sched(128);
+    Receiver receiver(sent);
+    WireSink wire;
+    uint8_t first;
+    uint8_t second;
+    sched.submit(sent[0].data.data(), 4096, TxClass::Bulk, &first);
+    receiver.expect(first, 0);
+    for (int i = 0; i < 3; ++i)
+    {
+      sendNext(sched, wire);
+      receiver.frame(wire.bytes);
+    }
+    sched.cancel(first);
+    sched.submit(sent[1].data.data(), 300, TxClass::Bulk, &second);
+    receiver.expect(second, 1);
+    long finished = -1;
+    while (sendNext(sched, wire))
+    {
+      finished = receiver.frame(wire.bytes);
+    }
+    if (first == second || receiver.aborted() != 1 || finished != 1)
+    {
+      std::fprintf(stderr, "abort check failed\n");
+      std::exit(1);
+    }
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const uint32_t baud = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+  const uint32_t periodUs = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 2000;
+  if (baud == 0 || periodUs == 0)
+  {
+    std::fprintf(stderr, "usage: %s [baud] [command period us]\n", argv[0]);
+    return 1;
+  }
+
+  checkAbort();
+  const std::vector<Transmission> sent = makeWorkload(periodUs, baud);
+  std::printf("%u baud, 64 KB Bulk + %zu x %u B Events every %u us\n", baud, sent.size() - 1, kCommandSize,
+              periodUs);
+  std::printf("%-11s %5s  %9s %9s %9s  %9s  %6s\n", "schedule", "frag", "p50 us", "p99 us", "max us",
+              "bulk KB/s", "wire");
+  for (uint16_t fragment : {64, 128, 256, 512})
+  {
+    const Result seq = run<1>(sent, fragment, baud, false);
+    const Result ilv = run<8>(sent, fragment, baud, true);
+    for (const auto &[name, r] : {std::pair{"sequential", seq}, std::pair{"interleaved", ilv}})
+    {
+      std::printf("%-11s %5u  %9.0f %9.0f %9.0f  %9.1f  %5.1f%%\n", name, fragment, r.p50Us, r.p99Us, r.maxUs,
+                  r.bulkKBps, 100.0 * r.efficiency);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,320 @@
+"""
+ConnectorX Module Schema Tool
+
+Reads the payload schema a module publishes (see
+LumynLabs/Modules/ModuleSchema.h), decodes raw or packed readings with it,
+and generates Python or C decoders, so host code does not have to mirror
+the device's payload struct by hand.
+
+A schema is given as the hex "blob" string, as a file holding the binary
+blob, or as the JSON the module returns for {"schema": true}.
+
+Usage:
+    python tools/module_schema.py show schema.json
+    python tools/module_schema.py decode schema.json b7e83197...
+    python tools/module_schema.py gen schema.json --lang c --name imu -o imu_schema.h
+    python tools/module_schema.py gen schema.json --lang python -o imu_schema.py
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import zlib
+
+VERSION = 1
+HEADER = struct.Struct("<2sBBHH")
+FIELD = struct.Struct("<BBHBBfB")
+FLAG_SCALED = 0x01
+PACKED_TAG = 0xB7
+PACKED_HEADER = 3
+
+# FieldType order in ModuleFields.h: (name, struct code, size, signed)
+TYPES = [
+    ("bool", "?", 1, False),
+    ("i8", "b", 1, True),
+    ("u8", "B", 1, False),
+    ("i16", "h", 2, True),
+    ("u16", "H", 2, False),
+    ("i32", "i", 4, True),
+    ("u32", "I", 4, False),
+    ("f32", "f", 4, True),
+]
+
+C_TYPES = {"bool": "bool", "i8": "int8_t", "u8": "uint8_t", "i16": "int16_t", "u16": "uint16_t",
+           "i32": "int32_t", "u32": "uint32_t", "f32": "float"}
+
+
+class Field:
+    def __init__(self, name, type_index, count, offset, bits, scale):
+        self.name = name
+        self.type, self.code, self.size, self.signed = TYPES[type_index]
+        self.count = count
+        self.offset = offset
+        self.bits = bits
+        self.scale = scale
+
+
+class Schema:
+    def __init__(self, blob):
+        magic, version, field_count, self.payload_size, self.packed_bytes = HEADER.unpack_from(blob, 0)
+        if magic != b"LS" or version != VERSION:
+            raise ValueError("not a version 1 module schema")
+        self.blob = bytes(blob)
+        self.hash = zlib.crc32(self.blob)
+        self.fields = []
+        at = HEADER.size
+        for _ in range(field_count):
+            type_index, count, offset, bits, flags, scale, name_len = FIELD.unpack_from(blob, at)
+            at += FIELD.size
+            name = blob[at : at + name_len].decode("ascii")
+            at += name_len
+            self.fields.append(Field(name, type_index, count, offset, bits, scale if flags & FLAG_SCALED else 0.0))
+        if at != len(blob):
+            raise ValueError("trailing bytes after schema fields")
+
+    @property
+    def frame_size(self):
+        return PACKED_HEADER + self.packed_bytes
+
+    def decode_raw(self, data):
+        if len(data) < self.payload_size:
+            raise ValueError(f"raw reading is {len(data)} bytes, expected {self.payload_size}")
+        out = {}
+        for f in self.fields:
+            values = list(struct.unpack_from(f"<{f.count}{f.code}", data, f.offset))
+            out[f.name] = values if f.count > 1 else values[0]
+        return out
+
+    def decode_packed(self, data):
+        if len(data) < self.frame_size or data[0] != PACKED_TAG:
+            raise ValueError("not a packed frame")
+        if data[1] | data[2] << 8 != self.hash & 0xFFFF:
+            raise ValueError("packed frame was encoded with a different schema")
+        stream = int.from_bytes(data[PACKED_HEADER : self.frame_size], "little")
+        bit = 0
+        out = {}
+        for f in self.fields:
+            values = []
+            for _ in range(f.count):
+                raw = (stream >> bit) & ((1 << f.bits) - 1)
+                bit += f.bits
+                values.append(unpack_element(f, raw))
+            out[f.name] = values if f.count > 1 else values[0]
+        return out
+
+    def decode(self, data):
+        if len(data) == self.frame_size and data[0] == PACKED_TAG and len(data) != self.payload_size:
+            return self.decode_packed(data)
+        return self.decode_raw(data)
+
+
+def unpack_element(f, raw):
+    if f.type == "f32" and not f.scale:
+        return struct.unpack("<f", struct.pack("<I", raw))[0]
+    if (f.signed or f.scale) and raw & (1 << (f.bits - 1)):
+        raw -= 1 << f.bits
+    if f.type == "bool":
+        return bool(raw)
+    if f.scale:
+        return raw / f.scale
+    return raw
+
+
+def load_schema(source):
+    if os.path.exists(source):
+        with open(source, "rb") as f:
+            data = f.read()
+        text = data.strip()
+        if text.startswith(b"{"):
+            doc = json.loads(text)
+            return Schema(bytes.fromhex(doc.get("schema", doc)["blob"]))
+        try:
+            return Schema(bytes.fromhex(text.decode("ascii")))
+        except (UnicodeDecodeError, ValueError):
+            return Schema(data)
+    return Schema(bytes.fromhex(source))
+
+
+def gen_python(schema, name):
+    lines = [
+        f'"""Decoder for the {name} module payload (generated by tools/module_schema.py)."""',
+        "",
+        "import struct",
+        "",
+        f"PAYLOAD_SIZE = {schema.payload_size}",
+        f"PACKED_SIZE = {schema.frame_size}",
+        f"SCHEMA_HASH = 0x{schema.hash:08x}",
+        "",
+        "",
+        "def decode_raw(data):",
+        "    return {",
+    ]
+    for f in schema.fields:
+        unpack = f'struct.unpack_from("<{f.count}{f.code}", data, {f.offset})'
+        lines.append(f'        "{f.name}": {unpack if f.count > 1 else unpack + "[0]"},')
+    lines += [
+        "    }",
+        "",
+        "",
+        "def _signed(raw, bits):",
+        "    return raw - (1 << bits) if raw & (1 << (bits - 1)) else raw",
+        "",
+        "",
+        "def decode_packed(data):",
+        "    if len(data) < PACKED_SIZE or data[0] != 0xB7 or data[1] | data[2] << 8 != SCHEMA_HASH & 0xFFFF:",
+        '        raise ValueError("not a packed frame of this schema")',
+        f'    s = int.from_bytes(data[{PACKED_HEADER}:PACKED_SIZE], "little")',
+        "    out = {}",
+    ]
+    bit = 0
+    for f in schema.fields:
+        items = []
+        for _ in range(f.count):
+            raw = f"(s >> {bit}) & 0x{(1 << f.bits) - 1:x}"
+            bit += f.bits
+            if f.type == "f32" and not f.scale:
+                items.append(f'struct.unpack("<f", struct.pack("<I", {raw}))[0]')
+            elif f.scale:
+                items.append(f"_signed({raw}, {f.bits}) / {f.scale!r}")
+            elif f.type == "bool":
+                items.append(f"bool({raw})")
+            elif f.signed:
+                items.append(f"_signed({raw}, {f.bits})")
+            else:
+                items.append(raw)
+        value = f"[{', '.join(items)}]" if f.count > 1 else items[0]
+        lines.append(f'    out["{f.name}"] = {value}')
+    lines += [
+        "    return out",
+        "",
+        "",
+        "def decode(data):",
+        "    if len(data) == PACKED_SIZE and data[0] == 0xB7 and len(data) != PAYLOAD_SIZE:",
+        "        return decode_packed(data)",
+        "    return decode_raw(data)",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def gen_c(schema, name):
+    ident = "".join(c if c.isalnum() else "_" for c in name)
+    upper = ident.upper()
+    lines = [
+        f"/* Decoder for the {name} module payload (generated by tools/module_schema.py). */",
+        "",
+        "#pragma once",
+        "",
+        "#include <stdbool.h>",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "#include <string.h>",
+        "",
+        f"#define {upper}_PAYLOAD_SIZE {schema.payload_size}u",
+        f"#define {upper}_PACKED_SIZE {schema.frame_size}u",
+        f"#define {upper}_SCHEMA_HASH 0x{schema.hash:08x}u",
+        "",
+        "typedef struct {",
+    ]
+    for f in schema.fields:
+        lines.append(f"  {C_TYPES[f.type]} {f.name}{f'[{f.count}]' if f.count > 1 else ''};")
+    lines += [
+        f"}} {ident}_t;",
+        "",
+        f"/* Decode a raw reading ({upper}_PAYLOAD_SIZE bytes, little endian). */",
+        f"static inline bool {ident}_decode_raw(const uint8_t *data, size_t len, {ident}_t *out)",
+        "{",
+        f"  if (len < {upper}_PAYLOAD_SIZE) return false;",
+    ]
+    for f in schema.fields:
+        lines.append(f"  memcpy({'' if f.count > 1 else '&'}out->{f.name}, data + {f.offset}, {f.size * f.count});")
+    lines += [
+        "  return true;",
+        "}",
+        "",
+        f"static inline uint32_t {ident}_bits(const uint8_t *p, size_t bit, unsigned n)",
+        "{",
+        "  uint32_t v = 0;",
+        "  for (unsigned i = 0; i < n; ++i, ++bit)",
+        "    if (p[bit / 8] & (1u << (bit % 8))) v |= 1u << i;",
+        "  return v;",
+        "}",
+        "",
+        f"static inline int32_t {ident}_signed(uint32_t raw, unsigned n)",
+        "{",
+        "  return n < 32 && (raw & (1u << (n - 1))) ? (int32_t)(raw - (1u << n)) : (int32_t)raw;",
+        "}",
+        "",
+        f"/* Decode a packed frame ({upper}_PACKED_SIZE bytes). */",
+        f"static inline bool {ident}_decode_packed(const uint8_t *data, size_t len, {ident}_t *out)",
+        "{",
+        f"  if (len < {upper}_PACKED_SIZE || data[0] != 0xB7u ||",
+        f"      (uint16_t)(data[1] | data[2] << 8) != ({upper}_SCHEMA_HASH & 0xFFFFu)) return false;",
+        f"  const uint8_t *p = data + {PACKED_HEADER};",
+    ]
+    bit = 0
+    for f in schema.fields:
+        for i in range(f.count):
+            target = f"out->{f.name}[{i}]" if f.count > 1 else f"out->{f.name}"
+            raw = f"{ident}_bits(p, {bit}, {f.bits})"
+            bit += f.bits
+            if f.type == "f32" and not f.scale:
+                lines.append(f"  {{ uint32_t u = {raw}; memcpy(&{target}, &u, 4); }}")
+            elif f.scale:
+                lines.append(f"  {target} = (float){ident}_signed({raw}, {f.bits}) / {f.scale!r}f;")
+            elif f.type == "bool":
+                lines.append(f"  {target} = {raw} != 0;")
+            elif f.signed:
+                lines.append(f"  {target} = ({C_TYPES[f.type]}){ident}_signed({raw}, {f.bits});")
+            else:
+                lines.append(f"  {target} = ({C_TYPES[f.type]}){raw};")
+    lines += [
+        "  return true;",
+        "}",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Inspect module payload schemas and generate decoders")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    show = sub.add_parser("show", help="list the fields of a schema")
+    show.add_argument("schema", help="hex blob, blob file, or {\"schema\": ...} reply")
+
+    decode = sub.add_parser("decode", help="decode a raw or packed reading")
+    decode.add_argument("schema")
+    decode.add_argument("frame", help="reading as hex")
+
+    gen = sub.add_parser("gen", help="generate a decoder")
+    gen.add_argument("schema")
+    gen.add_argument("--lang", choices=("python", "c"), default="python")
+    gen.add_argument("--name", default="module")
+    gen.add_argument("-o", "--output")
+
+    args = parser.parse_args()
+    schema = load_schema(args.schema)
+
+    if args.command == "show":
+        print(f"payload {schema.payload_size} bytes, packed {schema.frame_size} bytes, hash {schema.hash:08x}")
+        for f in schema.fields:
+            count = f"[{f.count}]" if f.count > 1 else ""
+            scale = f" scale {f.scale:g}" if f.scale else ""
+            print(f"  {f.offset:4d}  {f.type:4s} {f.name}{count}  {f.bits} bits{scale}")
+    elif args.command == "decode":
+        print(json.dumps(schema.decode(bytes.fromhex(args.frame))))
+    else:
+        code = gen_c(schema, args.name) if args.lang == "c" else gen_python(schema, args.name)
+        if args.output:
+            with open(args.output, "w") as f:
+                f.write(code)
+        else:
+            sys.stdout.write(code)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
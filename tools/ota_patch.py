@@ -0,0 +1,287 @@
+"""
+ConnectorX OTA Patch Tool
+
+Builds compressed or delta OTA images for LumynLabs::OtaPatchDecoder (see
+LumynLabs/System/OtaPatch.h). A delta patch describes the new firmware in
+terms of the image currently running on the device, so a small code change
+costs a few kilobytes on the wire instead of the whole image. Without a
+base image the output is plain LZ77 compression.
+
+Images may be raw .bin files or .uf2 files; UF2 payloads are flattened in
+address order.
+
+Usage:
+    python tools/ota_patch.py make new.uf2 -o update.cxp
+    python tools/ota_patch.py make new.uf2 --base running.uf2 -o update.cxp
+    python tools/ota_patch.py apply update.cxp --base running.uf2 -o out.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x54505843  # "CXPT"
+VERSION = 1
+FLAG_DELTA = 0x0001
+HEADER = struct.Struct("<IBBHIIII")
+
+UF2_MAGIC = (0x0A324655, 0x9E5D5157, 0x0AB16F30)
+
+MIN_WINDOW_MATCH = 3
+MIN_BASE_MATCH = 8
+MAX_CANDIDATES = 16
+HASH_LEN = 4
+
+
+def load_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 512 and struct.unpack_from("<II", data, 0) == UF2_MAGIC[:2]:
+        return flatten_uf2(data)
+    return data
+
+
+def flatten_uf2(data):
+    blocks = {}
+    for off in range(0, len(data) - 511, 512):
+        magic0, magic1, _flags, addr, size = struct.unpack_from("<IIIII", data, off)
+        magic_end = struct.unpack_from("<I", data, off + 508)[0]
+        if (magic0, magic1, magic_end) != UF2_MAGIC:
+            raise ValueError(f"bad UF2 block at offset {off}")
+        blocks[addr] = data[off + 32 : off + 32 + size]
+    if not blocks:
+        return b""
+    start = min(blocks)
+    end = max(a + len(b) for a, b in blocks.items())
+    image = bytearray(b"\xff" * (end - start))
+    for addr, payload in blocks.items():
+        image[addr - start : addr - start + len(payload)] = payload
+    return bytes(image)
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def zigzag(value):
+    return value << 1 if value >= 0 else ((-value) << 1) - 1
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def build_index(data):
+    index = {}
+    for i in range(len(data) - HASH_LEN + 1):
+        index.setdefault(data[i : i + HASH_LEN], []).append(i)
+    return index
+
+
+def match_length(a, ai, b, bi, limit):
+    n = 0
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+class Encoder:
+    def __init__(self, target, base, window_bits):
+        self.target = target
+        self.base = base
+        self.window = 1 << window_bits
+        self.base_index = build_index(base) if base else {}
+        self.recent = {}
+        self.shift = 0
+        self.out = bytearray()
+        self.literals = bytearray()
+
+    def best_base(self, pos):
+        key = self.target[pos : pos + HASH_LEN]
+        best_len, best_from = 0, 0
+        limit = len(self.target) - pos
+        # Prefer the position implied by the current shift, then indexed hits.
+        expected = pos + self.shift
+        candidates = []
+        if 0 <= expected < len(self.base):
+            candidates.append(expected)
+        candidates.extend(self.base_index.get(key, ())[:MAX_CANDIDATES])
+        for cand in candidates:
+            n = match_length(self.target, pos, self.base, cand, min(limit, len(self.base) - cand))
+            if n > best_len or (n == best_len and cand == expected):
+                best_len, best_from = n, cand
+        return best_len, best_from
+
+    def best_window(self, pos):
+        key = self.target[pos : pos + HASH_LEN]
+        best_len, best_dist = 0, 0
+        limit = len(self.target) - pos
+        for cand in reversed(self.recent.get(key, [])[-MAX_CANDIDATES:]):
+            dist = pos - cand
+            if dist > self.window:
+                break
+            n = match_length(self.target, pos, self.target, cand, limit)
+            if n > best_len:
+                best_len, best_dist = n, dist
+        return best_len, best_dist
+
+    def remember(self, start, end):
+        for i in range(start, min(end, len(self.target) - HASH_LEN + 1)):
+            self.recent.setdefault(self.target[i : i + HASH_LEN], []).append(i)
+
+    def flush_literals(self):
+        lit = self.literals
+        for i in range(0, len(lit), 128):
+            chunk = lit[i : i + 128]
+            self.out.append(len(chunk) - 1)
+            self.out += chunk
+        self.literals = bytearray()
+
+    def encode(self):
+        pos = 0
+        target = self.target
+        while pos < len(target):
+            base_len, base_from = self.best_base(pos) if self.base else (0, 0)
+            win_len, win_dist = self.best_window(pos)
+
+            if base_len >= MIN_BASE_MATCH and base_len >= win_len:
+                self.flush_literals()
+                new_shift = base_from - pos
+                self.out.append(0xC0)
+                self.out += varint(base_len)
+                self.out += varint(zigzag(new_shift - self.shift))
+                self.shift = new_shift
+                step = base_len
+            elif win_len >= MIN_WINDOW_MATCH:
+                self.flush_literals()
+                if win_len <= 65:
+                    self.out.append(0x80 | (win_len - 3))
+                else:
+                    self.out.append(0xBF)
+                    self.out += varint(win_len - 66)
+                self.out += varint(win_dist)
+                step = win_len
+            else:
+                self.literals.append(target[pos])
+                step = 1
+            self.remember(pos, pos + step)
+            pos += step
+        self.flush_literals()
+        return bytes(self.out)
+
+
+def make_patch(target, base, window_bits):
+    body = Encoder(target, base, window_bits).encode()
+    flags = FLAG_DELTA if base else 0
+    header = HEADER.pack(
+        MAGIC,
+        VERSION,
+        window_bits,
+        flags,
+        len(target),
+        zlib.crc32(target),
+        len(base) if base else 0,
+        zlib.crc32(base) if base else 0,
+    )
+    return header + body
+
+
+def read_varint(data, i):
+    value, shift = 0, 0
+    while True:
+        b = data[i]
+        i += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, i
+
+
+def apply_patch(patch, base):
+    """Reference decoder, mirrors OtaPatchDecoder."""
+    magic, version, window_bits, flags, size, crc, base_size, base_crc = HEADER.unpack_from(patch, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a CXPT patch")
+    if flags & FLAG_DELTA and (len(base) != base_size or zlib.crc32(base) != base_crc):
+        raise ValueError("base image does not match the patch")
+
+    out = bytearray()
+    shift = 0
+    i = HEADER.size
+    while i < len(patch):
+        op = patch[i]
+        i += 1
+        if op < 0x80:
+            out += patch[i : i + op + 1]
+            i += op + 1
+        elif op <= 0xBF:
+            if op == 0xBF:
+                extra, i = read_varint(patch, i)
+                length = extra + 66
+            else:
+                length = (op & 0x3F) + 3
+            dist, i = read_varint(patch, i)
+            for _ in range(length):
+                out.append(out[-dist])
+        elif op == 0xC0:
+            length, i = read_varint(patch, i)
+            zz, i = read_varint(patch, i)
+            shift += unzigzag(zz)
+            start = len(out) + shift
+            out += base[start : start + length]
+        else:
+            raise ValueError(f"bad token 0x{op:02x}")
+
+    if len(out) != size or zlib.crc32(out) != crc:
+        raise ValueError("decoded image fails size/CRC check")
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build or apply ConnectorX OTA patches")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    make = sub.add_parser("make", help="create a compressed or delta image")
+    make.add_argument("target", help="new firmware (.bin or .uf2)")
+    make.add_argument("--base", help="firmware currently on the device; omit for compression only")
+    make.add_argument("--window-bits", type=int, default=12, help="match window, must not exceed the device's")
+    make.add_argument("-o", "--output", required=True)
+
+    apply = sub.add_parser("apply", help="decode a patch (for verification)")
+    apply.add_argument("patch")
+    apply.add_argument("--base")
+    apply.add_argument("-o", "--output", required=True)
+
+    args = parser.parse_args()
+
+    if args.command == "make":
+        target = load_image(args.target)
+        base = load_image(args.base) if args.base else b""
+        patch = make_patch(target, base, args.window_bits)
+        apply_patch(patch, base)
+        with open(args.output, "wb") as f:
+            f.write(patch)
+        ratio = 100.0 * len(patch) / max(len(target), 1)
+        print(f"{len(target)} -> {len(patch)} bytes ({ratio:.1f}%), crc32 {zlib.crc32(target):08x}")
+    else:
+        with open(args.patch, "rb") as f:
+            patch = f.read()
+        base = load_image(args.base) if args.base else b""
+        image = apply_patch(patch, base)
+        with open(args.output, "wb") as f:
+            f.write(image)
+        print(f"{len(image)} bytes, crc32 {zlib.crc32(image):08x}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,297 @@
+/**
+ * @file ota_patch_check.cpp
+ * @brief Host check: OtaPatchDecoder on complete, truncated and corrupt patches
+ *
+ * Builds a delta patch in memory that uses every token type (literal
+ * runs, short and long window matches, base copies with a changing
+ * shift), then decodes it with OtaPatchDecoder:
+ *   complete   fed in pieces of 1, 7, 64 and 1000 bytes; must end Done
+ *              with the exact target image
+ *   truncated  cut at every length from 0 to one byte short; feed() must
+ *              stay NeedMore, finish() must return SizeMismatch, and the
+ *              output so far must be a prefix of the target
+ *   corrupt    one literal byte flipped; must end CrcMismatch
+ *
+ * A patch made by tools/ota_patch.py can be checked the same way by
+ * passing it (and the base image for a delta patch, as a raw .bin); it
+ * is decoded in full and then truncated at 256 evenly spaced points.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/ota_patch_check.cpp -o ota_patch_check
+ *   ./ota_patch_check [patch.cxp [base.bin]]
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/System/OtaPatch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+  using LumynLabs::OtaPatchHeader;
+  using LumynLabs::OtaPatchStatus;
+  using Decoder = LumynLabs::OtaPatchDecoder<12>;
+
+  const char *name(OtaPatchStatus status)
+  {
+    switch (status)
+    {
+    case OtaPatchStatus::NeedMore:
+      return "NeedMore";
+    case OtaPatchStatus::Done:
+      return "Done";
+    case OtaPatchStatus::BadHeader:
+      return "BadHeader";
+    case OtaPatchStatus::BaseMismatch:
+      return "BaseMismatch";
+    case OtaPatchStatus::Corrupt:
+      return "Corrupt";
+    case OtaPatchStatus::SizeMismatch:
+      return "SizeMismatch";
+    case OtaPatchStatus::CrcMismatch:
+      return "CrcMismatch";
+    }
+    return "?";
+  }
+
+  void fail(const char *what, size_t at)
+  {
+    std::fprintf(stderr, "FAILED: %s (at %zu)\n", what, at);
+    std::exit(1);
+  }
+
+  /** Emits tokens and builds the image they decode to alongside. */
+  class PatchWriter
+  {
+  public:
+    explicit PatchWriter(const std::vector<uint8_t> &base) : _base(base) {}
+
+    void literal(const uint8_t *data, size_t length)
+    {
+      while (length > 0)
+      {
+        const size_t run = length < 128 ? length : 128;
+        _tokens.push_back(static_cast<uint8_t>(run - 1));
+        _tokens.insert(_tokens.end(), data, data + run);
+        _target.insert(_target.end(), data, data + run);
+        data += run;
+        length -= run;
+      }
+    }
+
+    void window(uint32_t length, uint32_t distance)
+    {
+      if (length <= 65)
+      {
+        _tokens.push_back(static_cast<uint8_t>(0x80 | (length - 3)));
+      }
+      else
+      {
+        _tokens.push_back(0xBF);
+        varint(length - 66);
+      }
+      varint(distance);
+      for (uint32_t i = 0; i < length; ++i)
+      {
+        _target.push_back(_target[_target.size() - distance]);
+      }
+    }
+
+    void base(uint32_t length, int32_t shift)
+    {
+      const int32_t change = shift - _shift;
+      _shift = shift;
+      _tokens.push_back(0xC0);
+      varint(length);
+      varint(static_cast<uint32_t>((change << 1) ^ (change >> 31)));
+      const size_t from = _target.size() + shift;
+      _target.insert(_target.end(), _base.begin() + from, _base.begin() + from + length);
+    }
+
+    const std::vector<uint8_t> &target() const { return _target; }
+
+    std::vector<uint8_t> patch() const
+    {
+      OtaPatchHeader header{};
+      header.magic = OtaPatchHeader::kMagic;
+      header.version = OtaPatchHeader::kVersion;
+      header.windowBits = 12;
+      header.flags = OtaPatchHeader::kDelta;
+      header.targetSize = static_cast<uint32_t>(_target.size());
+      header.targetCrc = LumynLabs::Crc32::compute(_target.data(), _target.size());
+      header.baseSize = static_cast<uint32_t>(_base.size());
+      header.baseCrc = LumynLabs::Crc32::compute(_base.data(), _base.size());
+      std::vector<uint8_t> out(sizeof(header));
+      std::memcpy(out.data(), &header, sizeof(header));
+      out.insert(out.end(), _tokens.begin(), _tokens.end());
+      return out;
+    }
+
+  private:
+    void varint(uint32_t value)
+    {
+      while (value >= 0x80)
+      {
+        _tokens.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+      }
+      _tokens.push_back(static_cast<uint8_t>(value));
+    }
+
+    const std::vector<uint8_t> &_base;
+    std::vector<uint8_t> _tokens;
+    std::vector<uint8_t> _target;
+    int32_t _shift = 0;
+  };
+
+  struct Run
+  {
+    OtaPatchStatus fed;
+    OtaPatchStatus finished;
+    std::vector<uint8_t> output;
+  };
+
+  Run decode(const std::vector<uint8_t> &patch, size_t length, const std::vector<uint8_t> &base, size_t piece)
+  {
+    static Decoder decoder;
+    Run run{OtaPatchStatus::NeedMore, OtaPatchStatus::NeedMore, {}};
+    decoder.begin(base.empty() ? nullptr : base.data(), static_cast<uint32_t>(base.size()));
+    auto sink = [&](const uint8_t *data, size_t n)
+    { run.output.insert(run.output.end(), data, data + n); };
+    for (size_t at = 0; at < length && run.fed == OtaPatchStatus::NeedMore; at += piece)
+    {
+      const size_t n = length - at < piece ? length - at : piece;
+      run.fed = decoder.feed(patch.data() + at, n, sink);
+    }
+    run.finished = decoder.finish(sink);
+    return run;
+  }
+
+  bool isPrefix(const std::vector<uint8_t> &output, const std::vector<uint8_t> &target)
+  {
+    return output.size() <= target.size() && std::equal(output.begin(), output.end(), target.begin());
+  }
+
+  /** Truncate at each of @p cuts and check the decoder reports it. */
+  void checkTruncated(const std::vector<uint8_t> &patch, const std::vector<uint8_t> &base,
+                      const std::vector<uint8_t> &target, const std::vector<size_t> &cuts)
+  {
+    for (size_t cut : cuts)
+    {
+      const Run run = decode(patch, cut, base, 64);
+      if (run.fed != OtaPatchStatus::NeedMore)
+      {
+        fail("truncated patch did not wait for more input", cut);
+      }
+      if (run.finished != OtaPatchStatus::SizeMismatch)
+      {
+        fail("finish() on a truncated patch did not report SizeMismatch", cut);
+      }
+      if (!target.empty() && !isPrefix(run.output, target))
+      {
+        fail("truncated output is not a prefix of the target", cut);
+      }
+    }
+  }
+
+  int checkFile(const char *patchPath, const char *basePath)
+  {
+    std::ifstream patchFile(patchPath, std::ios::binary);
+    const std::vector<uint8_t> patch{std::istreambuf_iterator<char>(patchFile), {}};
+    std::vector<uint8_t> base;
+    if (basePath)
+    {
+      std::ifstream baseFile(basePath, std::ios::binary);
+      base.assign(std::istreambuf_iterator<char>(baseFile), {});
+    }
+    if (patch.size() <= sizeof(OtaPatchHeader))
+    {
+      std::fprintf(stderr, "%s: not a patch\n", patchPath);
+      return 1;
+    }
+
+    const Run full = decode(patch, patch.size(), base, 4096);
+    std::printf("%s: %zu bytes -> %zu bytes, %s\n", patchPath, patch.size(), full.output.size(),
+                name(full.finished));
+    if (full.finished != OtaPatchStatus::Done)
+    {
+      return 1;
+    }
+    std::vector<size_t> cuts;
+    for (size_t i = 0; i < 256; ++i)
+    {
+      cuts.push_back(i * (patch.size() - 1) / 255);
+    }
+    checkTruncated(patch, base, full.output, cuts);
+    std::printf("truncated at 256 points: all SizeMismatch\n");
+    return 0;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    return checkFile(argv[1], argc > 2 ? argv[2] : nullptr);
+  }
+
+  std::vector<uint8_t> base(64 * 1024);
+  for (size_t i = 0; i < base.size(); ++i)
+  {
+    base[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+  }
+  uint8_t fresh[300];
+  for (size_t i = 0; i < sizeof(fresh); ++i)
+  {
+    fresh[i] = static_cast<uint8_t>(i * 97 + 5);
+  }
+
+  PatchWriter writer(base);
+  writer.base(20000, 0);
+  writer.literal(fresh, sizeof(fresh));
+  writer.base(10000, 512); // code that moved
+  writer.literal(fresh, 16);
+  writer.window(2000, 16); // repeated pattern, long form
+  writer.window(10, 100);  // short form
+  writer.base(5000, -1024);
+  const std::vector<uint8_t> patch = writer.patch();
+  const std::vector<uint8_t> &target = writer.target();
+
+  for (size_t piece : {1, 7, 64, 1000})
+  {
+    const Run run = decode(patch, patch.size(), base, piece);
+    if (run.fed != OtaPatchStatus::Done || run.finished != OtaPatchStatus::Done || run.output != target)
+    {
+      fail("complete patch did not decode to the target", piece);
+    }
+  }
+  std::printf("complete: %zu byte patch -> %zu bytes, Done in 1/7/64/1000-byte pieces\n", patch.size(),
+              target.size());
+
+  std::vector<size_t> cuts;
+  for (size_t cut = 0; cut < patch.size(); ++cut)
+  {
+    cuts.push_back(cut);
+  }
+  checkTruncated(patch, base, target, cuts);
+  std::printf("truncated: all %zu cuts wait in feed() and end SizeMismatch in finish()\n", cuts.size());
+
+  std::vector<uint8_t> corrupt = patch;
+  corrupt[sizeof(OtaPatchHeader) + 20] ^= 0x01; // inside the first literal run
+  const Run bad = decode(corrupt, corrupt.size(), base, 64);
+  if (bad.finished != OtaPatchStatus::CrcMismatch)
+  {
+    fail("flipped literal byte was not caught", 0);
+  }
+  std::printf("corrupt: flipped literal byte ends %s\n", name(bad.finished));
+  return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file ota_sim.cpp
+ * @brief Host simulation: OtaPipeline flash pauses and throughput during an update
+ *
+ * Runs OtaPipeline against a simulated QSPI flash with datasheet-style
+ * timings, fed by a simulated UART. Time is simulated: every flash
+ * operation advances the clock by its duration, and during it both cores
+ * are stopped, as on the RP2040 (XIP is unavailable, interrupts are
+ * masked). Receive data keeps arriving by DMA into a ring meanwhile, as
+ * with UartDmaRx; the host is flow-controlled, so the line stalls while
+ * the ring is full.
+ *
+ * Two erase strategies are compared:
+ *   sector  one 4 KB sector erase per service() call (OtaPipeline)
+ *   block   64 KB block erases where alignment allows, the previous
+ *           behaviour, simulated by a flash that erases the whole block
+ *           on its first sector and skips the rest
+ *
+ * Reported per strategy: total update time, flash busy time, the longest
+ * single pause, the bytes that arrive on the line during that pause, and
+ * the peak ring occupancy. The programmed image is checked against the
+ * source and its CRC-32.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/ota_sim.cpp -o ota_sim
+ *   ./ota_sim [image KB] [baud] [sector erase ms] [block erase ms] [page program us]
+ *
+ * Defaults are a 600 KB image at 1 Mbaud, 45 ms sector erase, 150 ms
+ * block erase and 700 us page program (typical W25Q-series figures) and
+ * a 4 KB receive ring.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/System/OtaPipeline.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  constexpr uint32_t kRingSize = 4096;
+  constexpr uint32_t kBlockSize = 64 * 1024;
+
+  struct Timings
+  {
+    double sectorEraseUs;
+    double blockEraseUs;
+    double pageProgramUs;
+  };
+
+  /** NOR flash model: erase sets 0xFF, program can only clear bits. */
+  class SimFlash
+  {
+  public:
+    static constexpr uint32_t kPageSize = 256;
+    static constexpr uint32_t kSectorSize = 4096;
+
+    SimFlash(uint32_t capacity, const Timings &timings, bool blockErase)
+        : _memory(capacity, 0x00), _timings(timings), _blockErase(blockErase) {}
+
+    uint32_t capacity() const { return static_cast<uint32_t>(_memory.size()); }
+
+    bool erase(uint32_t offset, uint32_t length)
+    {
+      if (offset + length > capacity())
+      {
+        return false;
+      }
+      if (_blockErase)
+      {
+        if (offset < _blockErasedEnd)
+        {
+          // Already covered by the last block erase.
+          _lastOpUs = 0;
+          return true;
+        }
+        if (offset % kBlockSize == 0 && offset + kBlockSize <= capacity())
+        {
+          std::memset(_memory.data() + offset, 0xFF, kBlockSize);
+          _blockErasedEnd = offset + kBlockSize;
+          return finish(_timings.blockEraseUs);
+        }
+      }
+      std::memset(_memory.data() + offset, 0xFF, length);
+      return finish(_timings.sectorEraseUs * (length / kSectorSize));
+    }
+
+    bool program(uint32_t offset, const uint8_t *data, uint32_t length)
+    {
+      if (offset + length > capacity())
+      {
+        return false;
+      }
+      for (uint32_t i = 0; i < length; ++i)
+      {
+        if (_memory[offset + i] != 0xFF)
+        {
+          std::fprintf(stderr, "program over unerased byte at %u\n", offset + i);
+          std::exit(1);
+        }
+        _memory[offset + i] = data[i];
+      }
+      return finish(_timings.pageProgramUs * (length / kPageSize));
+    }
+
+    /** Duration of the most recent operation; 0 if it was skipped. */
+    double lastOpUs() const { return _lastOpUs; }
+    const uint8_t *memory() const { return _memory.data(); }
+
+  private:
+    bool finish(double us)
+    {
+      _lastOpUs = us;
+      return true;
+    }
+
+    std::vector<uint8_t> _memory;
+    Timings _timings;
+    bool _blockErase;
+    uint32_t _blockErasedEnd = 0;
+    double _lastOpUs = 0;
+  };
+
+  struct Result
+  {
+    double totalUs;
+    double busyUs;
+    double longestPauseUs;
+    uint32_t peakRing;
+  };
+
+  Result simulate(const std::vector<uint8_t> &image, uint32_t baud, const Timings &timings, bool blockErase)
+  {
+    const uint32_t size = static_cast<uint32_t>(image.size());
+    const uint32_t capacity = (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+    SimFlash flash(capacity, timings, blockErase);
+    LumynLabs::OtaPipeline<SimFlash> ota(flash);
+    const double bytesPerUs = baud / 10.0 / 1e6;
+
+    double now = 0;
+    double line = 0; // bytes delivered into the ring, fractional
+    uint32_t consumed = 0;
+    Result result{};
+    ota.begin(size, 0);
+
+    // Advance the line by dt: DMA fills the ring, the host stalls when it is full.
+    const auto advance = [&](double dt)
+    {
+      now += dt;
+      const double room = consumed + static_cast<double>(kRingSize) - line;
+      const double left = size - line;
+      double add = dt * bytesPerUs;
+      add = add < room ? add : room;
+      line += add < left ? add : left;
+      const uint32_t occupancy = static_cast<uint32_t>(line) - consumed;
+      if (occupancy > result.peakRing)
+      {
+        result.peakRing = occupancy;
+      }
+    };
+
+    while (!ota.done())
+    {
+      // Receiver: move everything in the ring into the pipeline.
+      const uint32_t available = static_cast<uint32_t>(line) - consumed;
+      if (available > 0)
+      {
+        consumed += static_cast<uint32_t>(ota.write(image.data() + consumed, available));
+      }
+
+      // Worker: at most one flash operation, with both cores stopped.
+      if (ota.service(static_cast<uint32_t>(now)) && flash.lastOpUs() > 0)
+      {
+        const double op = flash.lastOpUs();
+        result.busyUs += op;
+        if (op > result.longestPauseUs)
+        {
+          result.longestPauseUs = op;
+        }
+        advance(op);
+      }
+      else
+      {
+        // Nothing to do until more data arrives: wait for one page.
+        advance(SimFlash::kPageSize / bytesPerUs);
+      }
+      if (ota.failed())
+      {
+        std::fprintf(stderr, "pipeline failed\n");
+        std::exit(1);
+      }
+    }
+
+    if (std::memcmp(flash.memory(), image.data(), size) != 0 ||
+        ota.imageCrc() != LumynLabs::Crc32::compute(image.data(), size))
+    {
+      std::fprintf(stderr, "programmed image does not match\n");
+      std::exit(1);
+    }
+    result.totalUs = now;
+    return result;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const uint32_t imageKb = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 600;
+  const uint32_t baud = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000000;
+  const Timings timings{
+      (argc > 3 ? std::strtod(argv[3], nullptr) : 45.0) * 1000,
+      (argc > 4 ? std::strtod(argv[4], nullptr) : 150.0) * 1000,
+      argc > 5 ? std::strtod(argv[5], nullptr) : 700.0,
+  };
+  if (imageKb == 0 || baud == 0)
+  {
+    std::fprintf(stderr, "usage: %s [image KB] [baud] [sector erase ms] [block erase ms] [page program us]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  std::vector<uint8_t> image(imageKb * 1024);
+  for (size_t i = 0; i < image.size(); ++i)
+  {
+    image[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+  }
+
+  std::printf("%u KB image, %u baud, erase %.0f ms / %.0f ms, program %.0f us/page, %u B ring\n", imageKb, baud,
+              timings.sectorEraseUs / 1000, timings.blockEraseUs / 1000, timings.pageProgramUs, kRingSize);
+  std::printf("%-7s %9s %9s %13s %14s %10s\n", "erase", "total s", "busy s", "longest ms", "line B/pause",
+              "peak ring");
+  for (const bool block : {false, true})
+  {
+    const Result r = simulate(image, baud, timings, block);
+    std::printf("%-7s %9.2f %9.2f %13.1f %14.0f %10u\n", block ? "block" : "sector", r.totalUs / 1e6,
+                r.busyUs / 1e6, r.longestPauseUs / 1000, r.longestPauseUs * baud / 10 / 1e6, r.peakRing);
+  }
+  return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file stream_credit_sim.cpp
+ * @brief Host simulation: two concurrent transfers through StreamCreditScheduler
+ *
+ * Two 1 MB transfers share one simulated link that carries one 256-byte
+ * chunk every 256 us (1 MB/s). Each transfer has its own receiver with
+ * eight buffer blocks; a block is freed after the receiver drains it and
+ * the credit reaches the sender 1 ms later. Scenarios:
+ *   even     both receivers drain faster than the link; while both
+ *            transfers run, their chunk counts may never differ by more
+ *            than one, and each must get 45..55% of the link
+ *   stalled  receiver B stops draining from 50 ms to 250 ms; B must stall
+ *            without holding up A, which must get at least 95% of the link
+ *            while B waits, and both must still finish
+ *
+ * Reported per stream: share of the link, stalls and stalled time from
+ * the scheduler's counters.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/stream_credit_sim.cpp -o stream_credit_sim
+ *   ./stream_credit_sim
+ *
+ * Time is simulated, so the results do not depend on the host.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Stream/StreamCredits.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+namespace
+{
+  constexpr uint32_t kChunkBytes = 256;
+  constexpr uint32_t kChunkUs = 256;     // 1 MB/s link
+  constexpr uint32_t kChunks = 4096;     // 1 MB per transfer
+  constexpr uint16_t kBlocks = 8;        // receiver buffer blocks per stream
+  constexpr uint32_t kCreditDelayUs = 1000;
+  constexpr uint32_t kDrainUs = 128;     // receiver drains a block twice as fast as the link fills it
+
+  void fail(const char *check, const char *what)
+  {
+    std::fprintf(stderr, "FAILED: %s: %s\n", check, what);
+    std::exit(1);
+  }
+
+  struct Receiver
+  {
+    explicit Receiver(uint16_t id, uint32_t pauseFrom = 0, uint32_t pauseTo = 0)
+        : streamId(id), pauseFromUs(pauseFrom), pauseToUs(pauseTo)
+    {
+    }
+
+    uint16_t streamId;
+    uint32_t pauseFromUs; ///< Receiver stops draining from here...
+    uint32_t pauseToUs;   ///< ...until here
+    uint32_t held = 0;
+    uint32_t nextDrainUs = 0;
+    std::deque<uint32_t> credits; ///< Arrival time of each credit in flight
+
+    /** Drain blocks due by @p nowUs and send their credits back. */
+    void drain(uint32_t nowUs)
+    {
+      if (nowUs >= pauseFromUs && nowUs < pauseToUs)
+      {
+        nextDrainUs = pauseToUs;
+        return;
+      }
+      if (held == 0)
+      {
+        nextDrainUs = nowUs; // an idle receiver has nothing to catch up on
+        return;
+      }
+      while (held > 0 && nextDrainUs + kDrainUs <= nowUs)
+      {
+        nextDrainUs += kDrainUs;
+        --held;
+        credits.push_back(nextDrainUs + kCreditDelayUs);
+      }
+    }
+  };
+
+  struct Run
+  {
+    uint32_t chunks[2] = {};
+    uint32_t doneUs[2] = {};
+    uint32_t mostApart = 0;        ///< Largest chunk-count gap while both ran
+    uint32_t aChunksInPause = 0;   ///< Chunks A sent while B's receiver was paused
+    LumynLabs::StreamFlowStats stats[2];
+  };
+
+  Run simulate(Receiver (&receivers)[2])
+  {
+    LumynLabs::StreamCreditScheduler<> streams;
+    Run run;
+    for (Receiver &r : receivers)
+    {
+      streams.open(r.streamId, kBlocks, 0);
+      streams.setReady(r.streamId, true, 0);
+    }
+
+    uint32_t nowUs = 0;
+    while (run.chunks[0] < kChunks || run.chunks[1] < kChunks)
+    {
+      if (nowUs > 60000000)
+      {
+        fail("simulate", "transfers did not finish in 60 s of link time");
+      }
+      for (Receiver &r : receivers)
+      {
+        r.drain(nowUs);
+        while (!r.credits.empty() && r.credits.front() <= nowUs)
+        {
+          r.credits.pop_front();
+          streams.grant(r.streamId, 1, nowUs);
+        }
+      }
+
+      uint16_t id;
+      if (streams.next(id, nowUs))
+      {
+        const size_t i = id == receivers[0].streamId ? 0 : 1;
+        streams.sent(id, kChunkBytes);
+        ++receivers[i].held;
+        if (++run.chunks[i] == kChunks)
+        {
+          streams.setReady(id, false, nowUs);
+          run.doneUs[i] = nowUs + kChunkUs;
+        }
+        if (i == 0 && nowUs >= receivers[1].pauseFromUs && nowUs < receivers[1].pauseToUs)
+        {
+          ++run.aChunksInPause;
+        }
+      }
+      if (run.chunks[0] < kChunks && run.chunks[1] < kChunks)
+      {
+        const uint32_t apart = run.chunks[0] > run.chunks[1] ? run.chunks[0] - run.chunks[1]
+                                                              : run.chunks[1] - run.chunks[0];
+        run.mostApart = apart > run.mostApart ? apart : run.mostApart;
+      }
+      nowUs += kChunkUs;
+    }
+    for (size_t i = 0; i < 2; ++i)
+    {
+      run.stats[i] = *streams.stats(receivers[i].streamId);
+    }
+    return run;
+  }
+
+  void report(const char *check, const Run &run)
+  {
+    for (size_t i = 0; i < 2; ++i)
+    {
+      std::printf("%-8s stream %c  %4u chunks  done %7.1f ms  %5u stalls  %7.1f ms stalled\n", check,
+                  static_cast<char>('A' + i), run.stats[i].chunks, run.doneUs[i] / 1000.0, run.stats[i].stalls,
+                  run.stats[i].stalledUs / 1000.0);
+    }
+  }
+
+  void checkEven()
+  {
+    Receiver receivers[2] = {Receiver(1), Receiver(2)};
+    const Run run = simulate(receivers);
+    report("even", run);
+    if (run.mostApart > 1)
+    {
+      fail("even", "chunk counts drifted more than one apart");
+    }
+    for (size_t i = 0; i < 2; ++i)
+    {
+      // Both finish together when the link is split evenly.
+      const double share = static_cast<double>(kChunks) * kChunkUs / run.doneUs[i];
+      if (share < 0.45 || share > 0.55)
+      {
+        fail("even", "a stream's share of the link is not about half");
+      }
+      std::printf("even     stream %c  %.1f%% of the link\n", static_cast<char>('A' + i), share * 100);
+    }
+  }
+
+  void checkStalled()
+  {
+    Receiver receivers[2] = {Receiver(1), Receiver(2, 50000, 250000)};
+    const Run run = simulate(receivers);
+    report("stalled", run);
+    const double aShare = static_cast<double>(run.aChunksInPause) * kChunkUs / (250000 - 50000);
+    std::printf("stalled  stream A  %.1f%% of the link while B's receiver was paused\n", aShare * 100);
+    if (run.stats[1].stalls == 0 || run.stats[1].stalledUs < 190000)
+    {
+      fail("stalled", "B's stall was not counted");
+    }
+    if (aShare < 0.95)
+    {
+      fail("stalled", "A was held up by B's stalled receiver");
+    }
+  }
+} // namespace
+
+int main()
+{
+  checkEven();
+  checkStalled();
+  return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file tx_gather_check.cpp
+ * @brief Host check: encodeGather() against Cobs::encode() on random frames
+ *
+ * Builds random frames of one to four segments (a header, a payload split
+ * at random points, a CRC-sized trailer) whose zero-byte density ranges
+ * from none to half the bytes, so runs cross segment boundaries, hit the
+ * 254-byte block limit and fall on both sides of kTxDirectRun. Each frame
+ * is encoded with encodeGather() into a recording sink and must be byte
+ * for byte the same as Cobs::encode() over the concatenated segments plus
+ * the delimiter (or without it, for every eighth frame, with
+ * delimit = false). TxGatherStats must agree with what the sink saw.
+ *
+ * Reported: sink writes against the count an unbatched encoder would
+ * make (one write per code byte, per run slice per segment and for the
+ * delimiter), and the copies counted per TxLayer.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/tx_gather_check.cpp -o tx_gather_check
+ *   ./tx_gather_check [frames]
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Networking/TxGather.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+  using LumynLabs::TxLayer;
+  namespace Cobs = LumynLabs::Cobs;
+
+  void fail(const char *what, unsigned frame)
+  {
+    std::fprintf(stderr, "FAILED: %s (frame %u)\n", what, frame);
+    std::exit(1);
+  }
+
+  /** Collects everything written to it. */
+  struct RecordingSink
+  {
+    std::vector<uint8_t> bytes;
+    uint32_t writes = 0;
+
+    size_t write(const uint8_t *data, size_t length)
+    {
+      bytes.insert(bytes.end(), data, data + length);
+      ++writes;
+      return length;
+    }
+  };
+
+  /**
+   * Sink writes an encoder makes with one write per code byte, one per
+   * run slice in each segment and one for the delimiter. @p segmentOf
+   * maps each byte of @p data to its segment.
+   */
+  uint64_t unbatchedWrites(const std::vector<uint8_t> &data, const std::vector<uint8_t> &segmentOf, bool delimit)
+  {
+    uint64_t writes = delimit ? 1 : 0;
+    size_t pos = 0;
+    for (;;)
+    {
+      size_t run = 0;
+      while (run < Cobs::kMaxBlock && pos + run < data.size() && data[pos + run] != 0)
+      {
+        ++run;
+      }
+      writes += 1 + (run ? segmentOf[pos + run - 1] - segmentOf[pos] + 1 : 0);
+      pos += run;
+      if (run < Cobs::kMaxBlock && pos < data.size())
+      {
+        ++pos; // the zero that ended the run
+        continue;
+      }
+      if (pos >= data.size())
+      {
+        return writes;
+      }
+    }
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const unsigned frames = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 200000;
+  std::mt19937 rng(31);
+  const unsigned zeroPercent[] = {0, 1, 10, 50};
+
+  LumynLabs::TxGatherStats stats;
+  uint64_t unbatched = 0;
+  uint64_t payloadBytes = 0;
+  std::vector<uint8_t> header(8);
+  std::vector<uint8_t> payload;
+  std::vector<uint8_t> trailer(2);
+  std::vector<uint8_t> flat;
+  std::vector<uint8_t> segmentOf;
+  std::vector<uint8_t> expected;
+
+  for (unsigned frame = 0; frame < frames; ++frame)
+  {
+    const unsigned zeros = zeroPercent[rng() % 4];
+    const auto fill = [&](std::vector<uint8_t> &bytes)
+    {
+      for (uint8_t &b : bytes)
+      {
+        b = rng() % 100 < zeros ? 0 : static_cast<uint8_t>(1 + rng() % 255);
+      }
+    };
+    header.resize(rng() % 9);
+    payload.resize(rng() % 721);
+    trailer.resize(rng() % 3);
+    fill(header);
+    fill(payload);
+    fill(trailer);
+
+    // Header, payload in up to two slices, trailer; empty ones are dropped.
+    LumynLabs::TxGather<4> gather;
+    const size_t split = payload.empty() ? 0 : rng() % (payload.size() + 1);
+    gather.add(header.data(), header.size());
+    gather.add(payload.data(), split);
+    gather.add(payload.data() + split, payload.size() - split);
+    gather.add(trailer.data(), trailer.size());
+
+    flat.clear();
+    segmentOf.clear();
+    for (size_t s = 0; s < gather.count(); ++s)
+    {
+      const LumynLabs::TxSegment &seg = gather.segments()[s];
+      flat.insert(flat.end(), seg.data, seg.data + seg.length);
+      segmentOf.insert(segmentOf.end(), seg.length, static_cast<uint8_t>(s));
+    }
+
+    const bool delimit = frame % 8 != 0;
+    expected.resize(Cobs::maxEncodedSize(flat.size()) + 1);
+    expected.resize(Cobs::encode(flat.data(), flat.size(), expected.data()));
+    if (delimit)
+    {
+      expected.push_back(Cobs::kDelimiter);
+    }
+
+    RecordingSink sink;
+    const uint32_t writesBefore = stats.sinkWrites;
+    const uint32_t wireBefore = stats.wireBytes;
+    const size_t written = LumynLabs::encodeGather(gather, sink, &stats, delimit);
+    if (sink.bytes != expected || written != expected.size())
+    {
+      fail("encodeGather output differs from Cobs::encode", frame);
+    }
+    if (stats.sinkWrites - writesBefore != sink.writes || stats.wireBytes - wireBefore != written)
+    {
+      fail("TxGatherStats disagree with the sink", frame);
+    }
+    unbatched += unbatchedWrites(flat, segmentOf, delimit);
+    payloadBytes += flat.size();
+  }
+
+  if (stats.frames != frames || stats.payloadBytes != payloadBytes)
+  {
+    fail("TxGatherStats frame or payload count wrong", frames);
+  }
+  const size_t encoder = static_cast<size_t>(TxLayer::Encoder);
+  std::printf("%u frames, %.1f MB payload, %.1f MB on the wire: identical to Cobs::encode\n", frames,
+              payloadBytes / 1e6, stats.wireBytes / 1e6);
+  std::printf("sink writes  %.2fM batched, %.2fM unbatched\n", stats.sinkWrites / 1e6, unbatched / 1e6);
+  const char *layers[] = {"Build", "Encoder", "Sink"};
+  for (size_t layer = 0; layer < static_cast<size_t>(TxLayer::Count); ++layer)
+  {
+    std::printf("%-8s %9u copies  %6.1f MB copied\n", layers[layer], stats.copies[layer],
+                stats.copiedBytes[layer] / 1e6);
+  }
+  if (stats.copiedBytes[encoder] > payloadBytes)
+  {
+    fail("encoder staged more bytes than the payload", frames);
+  }
+  return 0;
+}
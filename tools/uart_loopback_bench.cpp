@@ -0,0 +1,591 @@
+/**
+ * @file uart_loopback_bench.cpp
+ * @brief Host benchmark: span-based UART and USB receive paths over loopback stand-ins
+ *
+ * UART: a producer thread stands in for the UART and its DMA channel. It
+ * writes a pre-encoded stream of COBS frames into the receive ring in
+ * small bursts, like the DMA draining the RX FIFO, and publishes the
+ * running byte count. A consumer thread stands in for the receive task:
+ * it wakes every millisecond (the idle poll of UartDmaRx bounds the wait
+ * the same way), drains the ring and checks every decoded frame.
+ *
+ * USB: a producer thread stands in for TinyUSB and drops 64-byte packets
+ * into a locked CDC FIFO, holding off (as a NAK would) while the FIFO is
+ * full. The consumer wakes every 200 us and drains the FIFO.
+ *
+ * Two receive paths are compared for each link:
+ *   span  UART: RxSpanRing + CobsFrameReader, as used with UartDmaRx
+ *         USB:  StreamSpanRx (bulk read() into the ring) + CobsFrameReader
+ *   byte  a per-byte push/pop ring feeding a byte-at-a-time COBS decoder,
+ *         the shape of the RxByteRing / PacketSerial path; on USB each
+ *         byte is also fetched with its own read() call, as
+ *         SerialAdapter::receiveTask does
+ *
+ * Every 64th frame is followed by an empty frame (01 00), which the span
+ * path must count as empty rather than malformed.
+ *
+ * The flat-out runs report throughput in MB/s per consumer CPU second,
+ * with the producer only limited by free space. The paced runs play the
+ * stream at a fixed rate and report receive CPU time as a share of wall
+ * time, which is the figure that matters on the device. On the UART byte
+ * path that includes the producer thread, because there it stands for
+ * the RX interrupt handler pushing every byte; on the span path it
+ * stands for the DMA channel and costs the CPU nothing.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -pthread -Ilib/LumynLabsSDK/include tools/uart_loopback_bench.cpp \
+ *       -o uart_loopback_bench
+ *   ./uart_loopback_bench [baud] [megabytes] [usb bytes/s]
+ *
+ * Host numbers are a relative guide only. On a desktop CPU the paced runs
+ * include thread wakeups, which cost far more than on the RP2040, so
+ * compare the flat-out figures for the per-byte cost of each path.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Networking/CobsFrameReader.h"
+#include "LumynLabs/Networking/RxSpanRing.h"
+#include "LumynLabs/Networking/StreamSpanRx.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+  namespace Cobs = LumynLabs::Cobs;
+
+  constexpr size_t kRingSize = 4096;
+  constexpr size_t kMaxPayload = 512;
+  constexpr size_t kBurst = 32; // RX FIFO depth; the DMA moves at most this much per DREQ run
+  constexpr auto kConsumerWait = std::chrono::milliseconds(1);
+  constexpr size_t kUsbPacket = 64;   // Full-speed bulk packet
+  constexpr size_t kUsbFifo = 1024;   // CDC RX FIFO (CFG_TUD_CDC_RX_BUFSIZE)
+  constexpr auto kUsbWait = std::chrono::microseconds(200);
+  constexpr uint32_t kEmptyEvery = 64;
+
+  double threadCpuSeconds()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+  }
+
+  uint8_t patternByte(uint32_t seq, size_t i)
+  {
+    // Roughly one zero in sixteen, as in typical sensor and LED payloads.
+    const uint32_t v = (seq * 2654435761u) ^ static_cast<uint32_t>(i * 40503u);
+    return (v >> 4) % 16 == 0 ? 0 : static_cast<uint8_t>(v >> 8);
+  }
+
+  /** Wire stream of delimited COBS frames, each carrying a sequence number. */
+  std::vector<uint8_t> buildStream(size_t targetBytes, uint32_t &frameCount)
+  {
+    std::mt19937 rng(30);
+    std::vector<uint8_t> wire;
+    wire.reserve(targetBytes + Cobs::maxEncodedSize(kMaxPayload) + 1);
+    uint8_t payload[kMaxPayload];
+    uint8_t encoded[Cobs::maxEncodedSize(kMaxPayload)];
+    frameCount = 0;
+    while (wire.size() < targetBytes)
+    {
+      const size_t length = 8 + rng() % (kMaxPayload - 8);
+      const uint32_t seq = frameCount++;
+      std::memcpy(payload, &seq, sizeof(seq));
+      for (size_t i = sizeof(seq); i < length; ++i)
+      {
+        payload[i] = patternByte(seq, i);
+      }
+      const size_t n = Cobs::encode(payload, length, encoded);
+      wire.insert(wire.end(), encoded, encoded + n);
+      wire.push_back(Cobs::kDelimiter);
+      if (seq % kEmptyEvery == kEmptyEvery - 1)
+      {
+        wire.push_back(1);
+        wire.push_back(Cobs::kDelimiter);
+      }
+    }
+    return wire;
+  }
+
+  /** Checks decoded frames arrive complete and in order. */
+  struct FrameChecker
+  {
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+
+    void operator()(const uint8_t *data, size_t length)
+    {
+      uint32_t seq;
+      std::memcpy(&seq, data, sizeof(seq));
+      bool ok = seq == expected;
+      for (size_t i = sizeof(seq); ok && i < length; ++i)
+      {
+        ok = data[i] == patternByte(seq, i);
+      }
+      errors += !ok;
+      expected = seq + 1;
+    }
+  };
+
+  /** Paces the producer at @p bytesPerSecond; 0 means no pacing. */
+  class Pacer
+  {
+  public:
+    explicit Pacer(uint32_t bytesPerSecond) : _rate(bytesPerSecond), _start(Clock::now()) {}
+
+    void wait(size_t bytesSent) const
+    {
+      if (_rate == 0)
+      {
+        return;
+      }
+      const auto due = _start + std::chrono::nanoseconds(static_cast<int64_t>(bytesSent) * 1000000000 / _rate);
+      std::this_thread::sleep_until(due);
+    }
+
+  private:
+    uint32_t _rate;
+    Clock::time_point _start;
+  };
+
+  struct Result
+  {
+    double seconds;
+    double consumerCpu;
+    double receiveCpu; ///< consumerCpu plus any producer work the CPU does on the device
+    uint32_t frames;
+    uint32_t empty;
+    uint32_t errors;
+  };
+
+  /** RxSpanRing + CobsFrameReader, the UartDmaRx receive path. */
+  Result runSpan(const std::vector<uint8_t> &wire, uint32_t bytesPerSecond)
+  {
+    auto storage = std::make_unique<LumynLabs::RxRingStorage<kRingSize>>();
+    LumynLabs::RxSpanRing<kRingSize> ring(*storage);
+    std::atomic<uint32_t> consumed{0};
+    Result result{};
+
+    std::thread consumer([&]
+                         {
+                           LumynLabs::CobsFrameReader<Cobs::maxEncodedSize(kMaxPayload)> reader;
+                           FrameChecker check;
+                           const double cpuStart = threadCpuSeconds();
+                           uint32_t read = 0;
+                           while (read != wire.size())
+                           {
+                             LumynLabs::RxSpan spans[2];
+                             const size_t n = ring.peek(spans);
+                             if (n == 0)
+                             {
+                               std::this_thread::sleep_for(kConsumerWait);
+                               continue;
+                             }
+                             for (size_t i = 0; i < n; ++i)
+                             {
+                               reader.feed(spans[i], check);
+                               ring.consume(spans[i].length);
+                               read += static_cast<uint32_t>(spans[i].length);
+                             }
+                             consumed.store(read, std::memory_order_release);
+                           }
+                           result.consumerCpu = threadCpuSeconds() - cpuStart;
+                           result.frames = reader.frameCount();
+                           result.empty = reader.emptyCount();
+                           result.errors = check.errors + reader.malformedCount() + ring.overrunBytes();
+                         });
+
+    const Clock::time_point start = Clock::now();
+    const Pacer pacer(bytesPerSecond);
+    uint32_t written = 0;
+    while (written != wire.size())
+    {
+      const size_t burst = wire.size() - written < kBurst ? wire.size() - written : kBurst;
+      pacer.wait(written + burst);
+      // Loopback flow control: never lap the consumer.
+      while (written + burst - consumed.load(std::memory_order_acquire) > kRingSize - 1)
+      {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < burst; ++i)
+      {
+        ring.storage()[(written + i) & (kRingSize - 1)] = wire[written + i];
+      }
+      written += static_cast<uint32_t>(burst);
+      ring.publish(written);
+    }
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.receiveCpu = result.consumerCpu; // the producer is the DMA channel
+    return result;
+  }
+
+  /** Per-byte ring and decoder, the shape of the RxByteRing path. */
+  class ByteRing
+  {
+  public:
+    bool push(uint8_t b)
+    {
+      const uint32_t head = _head.load(std::memory_order_relaxed);
+      if (head - _tail.load(std::memory_order_acquire) == kRingSize)
+      {
+        return false;
+      }
+      _buffer[head & (kRingSize - 1)] = b;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(uint8_t &b)
+    {
+      const uint32_t tail = _tail.load(std::memory_order_relaxed);
+      if (_head.load(std::memory_order_acquire) == tail)
+      {
+        return false;
+      }
+      b = _buffer[tail & (kRingSize - 1)];
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+  private:
+    uint8_t _buffer[kRingSize];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+  };
+
+  class ByteDecoder
+  {
+  public:
+    template <typename OnFrame>
+    void push(uint8_t b, OnFrame &onFrame)
+    {
+      if (b == Cobs::kDelimiter)
+      {
+        if (_length > 0 && _remaining == 0)
+        {
+          ++_frames;
+          onFrame(static_cast<const uint8_t *>(_frame), _length);
+        }
+        _length = 0;
+        _remaining = 0;
+        _code = 0xFF;
+        return;
+      }
+      if (_remaining == 0)
+      {
+        if (_code != 0xFF)
+        {
+          _frame[_length++] = 0;
+        }
+        _code = b;
+        _remaining = static_cast<uint8_t>(b - 1);
+        return;
+      }
+      _frame[_length++] = b;
+      --_remaining;
+    }
+
+    uint32_t frameCount() const { return _frames; }
+
+  private:
+    uint8_t _frame[kMaxPayload + 1];
+    size_t _length = 0;
+    uint8_t _remaining = 0;
+    uint8_t _code = 0xFF;
+    uint32_t _frames = 0;
+  };
+
+  Result runByte(const std::vector<uint8_t> &wire, uint32_t bytesPerSecond)
+  {
+    auto owned = std::make_unique<ByteRing>();
+    ByteRing &ring = *owned;
+    Result result{};
+
+    std::thread consumer([&]
+                         {
+                           ByteDecoder decoder;
+                           FrameChecker check;
+                           const double cpuStart = threadCpuSeconds();
+                           size_t read = 0;
+                           while (read != wire.size())
+                           {
+                             uint8_t b;
+                             if (!ring.pop(b))
+                             {
+                               std::this_thread::sleep_for(kConsumerWait);
+                               continue;
+                             }
+                             do
+                             {
+                               decoder.push(b, check);
+                               ++read;
+                             } while (ring.pop(b));
+                           }
+                           result.consumerCpu = threadCpuSeconds() - cpuStart;
+                           result.frames = decoder.frameCount();
+                           result.errors = check.errors;
+                         });
+
+    const Clock::time_point start = Clock::now();
+    const double cpuStart = threadCpuSeconds();
+    const Pacer pacer(bytesPerSecond);
+    size_t written = 0;
+    while (written != wire.size())
+    {
+      const size_t burst = wire.size() - written < kBurst ? wire.size() - written : kBurst;
+      pacer.wait(written + burst);
+      for (size_t i = 0; i < burst; ++i)
+      {
+        while (!ring.push(wire[written + i]))
+        {
+          std::this_thread::yield();
+        }
+      }
+      written += burst;
+    }
+    // The producer is the RX interrupt handler here, so its time counts.
+    const double producerCpu = threadCpuSeconds() - cpuStart;
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.receiveCpu = result.consumerCpu + producerCpu;
+    return result;
+  }
+
+  /** Stand-in for the TinyUSB CDC RX FIFO; every call takes its lock. */
+  class LoopbackPort
+  {
+  public:
+    /** USB side: accept a whole packet or nothing (NAK). */
+    bool receivePacket(const uint8_t *data, size_t length)
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      if (kUsbFifo - _count < length)
+      {
+        return false;
+      }
+      for (size_t i = 0; i < length; ++i)
+      {
+        _fifo[(_head + _count + i) % kUsbFifo] = data[i];
+      }
+      _count += length;
+      return true;
+    }
+
+    int available()
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      return static_cast<int>(_count);
+    }
+
+    int read()
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      if (_count == 0)
+      {
+        return -1;
+      }
+      const uint8_t b = _fifo[_head];
+      _head = (_head + 1) % kUsbFifo;
+      --_count;
+      return b;
+    }
+
+    size_t read(uint8_t *buffer, size_t length)
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      const size_t n = length < _count ? length : _count;
+      for (size_t i = 0; i < n; ++i)
+      {
+        buffer[i] = _fifo[(_head + i) % kUsbFifo];
+      }
+      _head = (_head + n) % kUsbFifo;
+      _count -= n;
+      return n;
+    }
+
+  private:
+    std::mutex _lock;
+    uint8_t _fifo[kUsbFifo];
+    size_t _head = 0;
+    size_t _count = 0;
+  };
+
+  /** Plays @p wire into @p port in USB packets; the host stack, not counted. */
+  void playUsb(const std::vector<uint8_t> &wire, uint32_t bytesPerSecond, LoopbackPort &port)
+  {
+    const Pacer pacer(bytesPerSecond);
+    size_t written = 0;
+    while (written != wire.size())
+    {
+      const size_t packet = wire.size() - written < kUsbPacket ? wire.size() - written : kUsbPacket;
+      pacer.wait(written + packet);
+      while (!port.receivePacket(wire.data() + written, packet))
+      {
+        std::this_thread::yield();
+      }
+      written += packet;
+    }
+  }
+
+  /** StreamSpanRx + CobsFrameReader. */
+  Result runUsbSpan(const std::vector<uint8_t> &wire, uint32_t bytesPerSecond)
+  {
+    auto port = std::make_unique<LoopbackPort>();
+    auto storage = std::make_unique<LumynLabs::RxRingStorage<kRingSize>>();
+    Result result{};
+
+    std::thread consumer([&]
+                         {
+                           LumynLabs::StreamSpanRx<kRingSize, LoopbackPort> rx(*storage, *port);
+                           LumynLabs::CobsFrameReader<Cobs::maxEncodedSize(kMaxPayload)> reader;
+                           FrameChecker check;
+                           const double cpuStart = threadCpuSeconds();
+                           size_t read = 0;
+                           while (read != wire.size())
+                           {
+                             rx.poll();
+                             LumynLabs::RxSpan spans[2];
+                             const size_t n = rx.peek(spans);
+                             if (n == 0)
+                             {
+                               std::this_thread::sleep_for(kUsbWait);
+                               continue;
+                             }
+                             for (size_t i = 0; i < n; ++i)
+                             {
+                               reader.feed(spans[i], check);
+                               rx.consume(spans[i].length);
+                               read += spans[i].length;
+                             }
+                           }
+                           result.consumerCpu = threadCpuSeconds() - cpuStart;
+                           result.frames = reader.frameCount();
+                           result.empty = reader.emptyCount();
+                           result.errors = check.errors + reader.malformedCount();
+                         });
+
+    const Clock::time_point start = Clock::now();
+    playUsb(wire, bytesPerSecond, *port);
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.receiveCpu = result.consumerCpu;
+    return result;
+  }
+
+  /** read() per byte into a per-byte ring, then the byte decoder. */
+  Result runUsbByte(const std::vector<uint8_t> &wire, uint32_t bytesPerSecond)
+  {
+    auto port = std::make_unique<LoopbackPort>();
+    auto ring = std::make_unique<ByteRing>();
+    Result result{};
+
+    std::thread consumer([&]
+                         {
+                           ByteDecoder decoder;
+                           FrameChecker check;
+                           const double cpuStart = threadCpuSeconds();
+                           size_t read = 0;
+                           while (read != wire.size())
+                           {
+                             bool any = false;
+                             while (port->available() > 0)
+                             {
+                               if (!ring->push(static_cast<uint8_t>(port->read())))
+                               {
+                                 break;
+                               }
+                               any = true;
+                             }
+                             uint8_t b;
+                             while (ring->pop(b))
+                             {
+                               decoder.push(b, check);
+                               ++read;
+                             }
+                             if (!any)
+                             {
+                               std::this_thread::sleep_for(kUsbWait);
+                             }
+                           }
+                           result.consumerCpu = threadCpuSeconds() - cpuStart;
+                           result.frames = decoder.frameCount();
+                           result.errors = check.errors;
+                         });
+
+    const Clock::time_point start = Clock::now();
+    playUsb(wire, bytesPerSecond, *port);
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.receiveCpu = result.consumerCpu;
+    return result;
+  }
+
+  void check(const char *name, const Result &r, uint32_t frames, bool countsEmpty)
+  {
+    const uint32_t empty = countsEmpty ? frames / kEmptyEvery : 0;
+    if (r.frames != frames || r.empty != empty || r.errors != 0)
+    {
+      std::fprintf(stderr, "%s: %u of %u frames, %u of %u empty, %u errors\n", name, r.frames, frames, r.empty, empty,
+                   r.errors);
+      std::exit(1);
+    }
+  }
+
+  void compare(const char *link, const std::vector<uint8_t> &wire, uint32_t frames, uint32_t bytesPerSecond,
+               Result (*span)(const std::vector<uint8_t> &, uint32_t),
+               Result (*byte)(const std::vector<uint8_t> &, uint32_t))
+  {
+    const Result spanFast = span(wire, 0);
+    const Result byteFast = byte(wire, 0);
+    check("span", spanFast, frames, true);
+    check("byte", byteFast, frames, false);
+    std::printf("%s flat out:  span %8.1f MB/s   byte %8.1f MB/s per consumer CPU second\n", link,
+                wire.size() / spanFast.consumerCpu / 1e6, wire.size() / byteFast.consumerCpu / 1e6);
+
+    // Pace a slice of the stream at the line rate: about two seconds' worth.
+    const size_t pacedBytes = size_t{bytesPerSecond} * 2 < wire.size() ? size_t{bytesPerSecond} * 2 : wire.size();
+    uint32_t pacedFrames = 0;
+    const std::vector<uint8_t> paced = buildStream(pacedBytes, pacedFrames);
+    const Result spanPaced = span(paced, bytesPerSecond);
+    const Result bytePaced = byte(paced, bytesPerSecond);
+    check("span", spanPaced, pacedFrames, true);
+    check("byte", bytePaced, pacedFrames, false);
+    std::printf("%s %u B/s: span %6.2f%% CPU   byte %6.2f%% CPU   (%.2f s of line time)\n", link, bytesPerSecond,
+                100.0 * spanPaced.receiveCpu / spanPaced.seconds, 100.0 * bytePaced.receiveCpu / bytePaced.seconds,
+                spanPaced.seconds);
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const uint32_t baud = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 2000000;
+  const double megabytes = argc > 2 ? std::strtod(argv[2], nullptr) : 16.0;
+  const uint32_t usbRate = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 1000000;
+  if (baud < 10 || megabytes <= 0 || usbRate == 0)
+  {
+    std::fprintf(stderr, "usage: %s [baud] [megabytes] [usb bytes/s]\n", argv[0]);
+    return 1;
+  }
+
+  uint32_t frames = 0;
+  const std::vector<uint8_t> wire = buildStream(static_cast<size_t>(megabytes * 1e6), frames);
+  std::printf("%zu bytes, %u frames, %zu B ring, %zu B UART bursts, %zu B USB packets\n", wire.size(), frames,
+              kRingSize, kBurst, kUsbPacket);
+  compare("UART", wire, frames, baud / 10, runSpan, runByte);
+  compare("USB ", wire, frames, usbRate, runUsbSpan, runUsbByte);
+  return 0;
+}
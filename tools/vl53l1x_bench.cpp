@@ -0,0 +1,425 @@
+/**
+ * @file vl53l1x_bench.cpp
+ * @brief Host benchmark: VL53L1X ranging over a simulated I2C bus
+ *
+ * Runs Vl53l1xRanger against simulated sensors on a simulated bus driven
+ * through I2cQueue. Each sensor finishes a measurement every period
+ * (staggered), pulls its GPIO1 line low until SYSTEM__INTERRUPT_CLEAR is
+ * written, and answers the result burst read with a block carrying its
+ * stream count. Bus time per transfer is its bit count at the bus clock
+ * (9 bits per byte, address bytes, RESTART and STOP).
+ *
+ * Three ways of reading the sensors are compared:
+ *   interrupt   Vl53l1xRanger, reads started from the GPIO1 interrupt
+ *   poll 1 ms   dataReady() (GPIO__TIO_HV_STATUS) every 1 ms per sensor,
+ *   poll 5 ms   then the same three transfers, the bundled driver's loop
+ *
+ * Reported per mode: ranges/s, bus bytes per range, bus utilization, and
+ * the latency from data ready to the range being available (mean, p99).
+ * For the ranger, the largest difference between a range's timestampUs
+ * and the simulated data-ready time is reported too, and every decoded
+ * range is checked against what its sensor measured.
+ *
+ * Build and run on the host:
+ *   g++ -O2 -std=gnu++23 -Ilib/LumynLabsSDK/include tools/vl53l1x_bench.cpp -o vl53l1x_bench
+ *   ./vl53l1x_bench [sensors] [period ms] [seconds] [bus Hz]
+ *
+ * Defaults are four sensors at a 20 ms period on a 400 kHz bus for 2 s
+ * per mode. The simulation runs in real time on one thread, so latencies
+ * carry a few microseconds of host jitter.
+ *
+ * Copyright (c) Lumyn Labs, Inc. All rights reserved.
+ * Licensed under the Lumyn Labs SDK License.
+ */
+
+#include "LumynLabs/Sensors/Vl53l1xRanger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  using LumynLabs::I2cQueue;
+  using LumynLabs::I2cStatus;
+  using LumynLabs::I2cTransfer;
+
+  constexpr size_t kMaxSensors = 8;
+  constexpr uint16_t kStatusRegister = 0x0031; // GPIO__TIO_HV_STATUS
+  constexpr uint8_t kFirstAddress = 0x30;
+  constexpr uint8_t kFirstIntPin = 10;
+
+  using Ranger = LumynLabs::Vl53l1xRanger<kMaxSensors>;
+
+  /** One VL53L1X in continuous mode, as seen from the bus. */
+  struct SimSensor
+  {
+    uint8_t address;
+    uint8_t intPin;
+    uint32_t nextReadyUs;
+    bool asserted = false;
+    uint8_t stream = 0;
+    uint32_t readyUs[256] = {}; ///< Data-ready time by stream count
+    uint16_t rangeMm[256] = {}; ///< Measured range by stream count
+  };
+
+  /** Bus driver that answers for the simulated sensors after the wire time. */
+  class SimBus : public LumynLabs::I2cBusDriver
+  {
+  public:
+    SimBus(std::vector<SimSensor> &sensors, uint32_t busHz) : _sensors(sensors), _busHz(busHz) {}
+
+    void start(I2cTransfer &t, I2cQueue &queue) override
+    {
+      _transfer = &t;
+      _queue = &queue;
+      _wireUs = wireUs(t);
+      _doneUs = I2cQueue::nowUs() + _wireUs;
+    }
+
+    /** Finish the transfer on the wire once its time is up. */
+    void service(uint32_t now)
+    {
+      if (!_transfer || static_cast<int32_t>(now - _doneUs) < 0)
+      {
+        return;
+      }
+      I2cTransfer &t = *_transfer;
+      _transfer = nullptr;
+      _busyUs += _wireUs;
+      _bytes += t.txLength + t.rxLength;
+      respond(t);
+      _queue->complete(t, I2cStatus::Ok);
+    }
+
+    uint64_t busyUs() const { return _busyUs; }
+    uint64_t bytes() const { return _bytes; }
+
+  private:
+    uint32_t wireUs(const I2cTransfer &t) const
+    {
+      // START, address + data bytes, RESTART + address + read bytes, STOP.
+      uint32_t bits = 1 + 9 * (1 + t.txLength) + 1;
+      if (t.rxLength)
+      {
+        bits += 1 + 9 * (1 + t.rxLength);
+      }
+      return static_cast<uint32_t>((static_cast<uint64_t>(bits) * 1000000 + _busHz - 1) / _busHz);
+    }
+
+    void respond(I2cTransfer &t)
+    {
+      SimSensor *s = nullptr;
+      for (SimSensor &candidate : _sensors)
+      {
+        if (candidate.address == t.address)
+        {
+          s = &candidate;
+        }
+      }
+      if (!s || t.txLength < 2)
+      {
+        std::fprintf(stderr, "bad transfer to 0x%02x\n", t.address);
+        std::exit(1);
+      }
+      const uint16_t reg = static_cast<uint16_t>((t.tx[0] << 8) | t.tx[1]);
+      if (reg == Ranger::kResultRegister && t.rxLength == Ranger::kResultLength)
+      {
+        // RANGECOMPLETE, 0x0400 effective SPADs; the range is stored before
+        // the 2011/2048 gain correction the ranger applies.
+        uint8_t *b = t.rx;
+        std::memset(b, 0, Ranger::kResultLength);
+        const uint16_t raw = static_cast<uint16_t>(s->rangeMm[s->stream] * 2048u / 2011u);
+        b[0] = 9;
+        b[2] = s->stream;
+        b[3] = 0x04;
+        b[7] = 0x00;
+        b[8] = 0x40;
+        b[13] = static_cast<uint8_t>(raw >> 8);
+        b[14] = static_cast<uint8_t>(raw);
+        b[15] = 0x08;
+      }
+      else if (reg == Ranger::kInterruptClearRegister)
+      {
+        s->asserted = false;
+      }
+      else if (reg == kStatusRegister && t.rxLength == 1)
+      {
+        t.rx[0] = s->asserted ? 0 : 1;
+      }
+    }
+
+    std::vector<SimSensor> &_sensors;
+    uint32_t _busHz;
+    I2cTransfer *_transfer = nullptr;
+    I2cQueue *_queue = nullptr;
+    uint32_t _wireUs = 0;
+    uint32_t _doneUs = 0;
+    uint64_t _busyUs = 0;
+    uint64_t _bytes = 0;
+  };
+
+  /** The bundled driver's loop: poll dataReady(), then read, update DSS, clear. */
+  class Poller
+  {
+  public:
+    Poller(I2cQueue &queue, const std::vector<SimSensor> &sensors, uint32_t pollUs) : _queue(queue), _pollUs(pollUs)
+    {
+      for (size_t i = 0; i < sensors.size(); ++i)
+      {
+        Slot &s = _slots[i];
+        s.owner = this;
+        s.statusTx[0] = kStatusRegister >> 8;
+        s.statusTx[1] = kStatusRegister & 0xFF;
+        s.readTx[0] = Ranger::kResultRegister >> 8;
+        s.readTx[1] = Ranger::kResultRegister & 0xFF;
+        s.dssTx[0] = Ranger::kDssSpadsRegister >> 8;
+        s.dssTx[1] = Ranger::kDssSpadsRegister & 0xFF;
+        s.clearTx[0] = Ranger::kInterruptClearRegister >> 8;
+        s.clearTx[1] = Ranger::kInterruptClearRegister & 0xFF;
+        s.clearTx[2] = 0x01;
+        const uint8_t addr = sensors[i].address;
+        s.status.set(addr, s.statusTx, 2, &s.statusRx, 1);
+        s.read.set(addr, s.readTx, 2, s.block, Ranger::kResultLength);
+        s.dss.set(addr, s.dssTx, 4);
+        s.clear.set(addr, s.clearTx, 3);
+        for (I2cTransfer *t : {&s.status, &s.read, &s.dss, &s.clear})
+        {
+          t->arg = &s;
+        }
+        s.status.callback = &Poller::onStatus;
+        s.read.callback = &Poller::onRead;
+      }
+      _count = sensors.size();
+    }
+
+    void poll(uint32_t now)
+    {
+      for (size_t i = 0; i < _count; ++i)
+      {
+        Slot &s = _slots[i];
+        if (s.status.done() && s.read.done() && s.dss.done() && s.clear.done() &&
+            static_cast<int32_t>(now - s.nextPollUs) >= 0)
+        {
+          s.nextPollUs = now + _pollUs;
+          _queue.submit(s.status);
+        }
+      }
+    }
+
+    bool latest(size_t index, LumynLabs::Vl53l1xRange &out) const
+    {
+      out = _slots[index].range;
+      return _slots[index].valid;
+    }
+
+  private:
+    struct Slot
+    {
+      Poller *owner = nullptr;
+      I2cTransfer status;
+      I2cTransfer read;
+      I2cTransfer dss;
+      I2cTransfer clear;
+      uint8_t statusTx[2];
+      uint8_t statusRx = 1;
+      uint8_t readTx[2];
+      uint8_t dssTx[4];
+      uint8_t clearTx[3];
+      uint8_t block[Ranger::kResultLength];
+      uint32_t nextPollUs = 0;
+      LumynLabs::Vl53l1xRange range{};
+      bool valid = false;
+    };
+
+    static void onStatus(I2cTransfer &t, void *arg)
+    {
+      Slot &s = *static_cast<Slot *>(arg);
+      if (t.status() == I2cStatus::Ok && (s.statusRx & 0x01) == 0)
+      {
+        s.owner->_queue.submit(s.read);
+      }
+    }
+
+    static void onRead(I2cTransfer &, void *arg)
+    {
+      Slot &s = *static_cast<Slot *>(arg);
+      Ranger::decode(s.block, s.range);
+      s.range.timestampUs = I2cQueue::nowUs();
+      s.valid = true;
+      const uint16_t spads = Ranger::dssSpads(s.block);
+      s.dssTx[2] = static_cast<uint8_t>(spads >> 8);
+      s.dssTx[3] = static_cast<uint8_t>(spads);
+      s.owner->_queue.submit(s.dss);
+      s.owner->_queue.submit(s.clear);
+    }
+
+    I2cQueue &_queue;
+    uint32_t _pollUs;
+    size_t _count = 0;
+    Slot _slots[kMaxSensors];
+  };
+
+  struct Result
+  {
+    double rangesPerSecond;
+    double bytesPerRange;
+    double busLoad;
+    double meanLatencyUs;
+    double p99LatencyUs;
+    double maxStampErrorUs;
+  };
+
+  void fail(const char *what)
+  {
+    std::fprintf(stderr, "%s\n", what);
+    std::exit(1);
+  }
+
+  /** @param pollUs 0 runs the interrupt-driven ranger, otherwise the poller */
+  Result run(size_t count, uint32_t periodUs, uint32_t seconds, uint32_t busHz, uint32_t pollUs)
+  {
+    std::vector<SimSensor> sensors(count);
+    const uint32_t t0 = I2cQueue::nowUs();
+    for (size_t i = 0; i < count; ++i)
+    {
+      sensors[i].address = static_cast<uint8_t>(kFirstAddress + i);
+      sensors[i].intPin = static_cast<uint8_t>(kFirstIntPin + i);
+      sensors[i].nextReadyUs = t0 + 1000 + static_cast<uint32_t>(periodUs * i / count);
+    }
+
+    SimBus bus(sensors, busHz);
+    I2cQueue queue(bus);
+    Ranger ranger(queue);
+    Poller poller(queue, sensors, pollUs ? pollUs : 1000);
+    if (pollUs == 0)
+    {
+      for (const SimSensor &s : sensors)
+      {
+        ranger.addSensor({LumynLabs::kVl53l1xNoPin, s.intPin, s.address});
+      }
+      ranger.start(periodUs / 1000);
+    }
+
+    std::vector<double> latencies;
+    std::vector<int> seen(count, -1);
+    uint32_t ranges = 0;
+    double maxStampError = 0;
+    const uint32_t end = t0 + seconds * 1000000u;
+    uint32_t nextService = t0;
+    for (uint32_t now = I2cQueue::nowUs(); static_cast<int32_t>(now - end) < 0; now = I2cQueue::nowUs())
+    {
+      // Sensors finish measurements; GPIO1 falls if it was high.
+      for (SimSensor &s : sensors)
+      {
+        if (static_cast<int32_t>(now - s.nextReadyUs) < 0)
+        {
+          continue;
+        }
+        s.nextReadyUs += periodUs;
+        ++s.stream;
+        s.readyUs[s.stream] = now;
+        s.rangeMm[s.stream] = static_cast<uint16_t>(200 + (s.stream * 37 + s.address) % 1800);
+        if (!s.asserted)
+        {
+          s.asserted = true;
+          if (pollUs == 0)
+          {
+            ranger.onPinInterrupt(s.intPin);
+          }
+        }
+      }
+
+      bus.service(now);
+      if (pollUs == 0)
+      {
+        if (static_cast<int32_t>(now - nextService) >= 0)
+        {
+          nextService = now + periodUs;
+          ranger.service(now);
+        }
+      }
+      else
+      {
+        poller.poll(now);
+      }
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        LumynLabs::Vl53l1xRange range;
+        const bool valid = pollUs == 0 ? ranger.latest(i, range) : poller.latest(i, range);
+        if (!valid || range.streamCount == seen[i])
+        {
+          continue;
+        }
+        seen[i] = range.streamCount;
+        const SimSensor &s = sensors[i];
+        const uint16_t expected = s.rangeMm[range.streamCount];
+        if (range.rangeMm + 1 < expected || range.rangeMm > expected + 1 ||
+            range.status != LumynLabs::kVl53l1xRangeValid)
+        {
+          fail("decoded range does not match the sensor");
+        }
+        const uint32_t readyUs = s.readyUs[range.streamCount];
+        latencies.push_back(static_cast<double>(now - readyUs));
+        if (pollUs == 0)
+        {
+          const double error = static_cast<double>(static_cast<int32_t>(range.timestampUs - readyUs));
+          maxStampError = std::max(maxStampError, error < 0 ? -error : error);
+        }
+        ++ranges;
+      }
+    }
+
+    if (ranges == 0)
+    {
+      fail("no ranges");
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l : latencies)
+    {
+      sum += l;
+    }
+    return {ranges / static_cast<double>(seconds), static_cast<double>(bus.bytes()) / ranges,
+            static_cast<double>(bus.busyUs()) / (seconds * 1e6), sum / latencies.size(),
+            latencies[static_cast<size_t>(0.99 * (latencies.size() - 1))], maxStampError};
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+  const uint32_t periodMs = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20;
+  const uint32_t seconds = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 2;
+  const uint32_t busHz = argc > 4 ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 400000;
+  if (count == 0 || count > kMaxSensors || periodMs == 0 || seconds == 0 || busHz == 0)
+  {
+    std::fprintf(stderr, "usage: %s [sensors 1-%zu] [period ms] [seconds] [bus Hz]\n", argv[0], kMaxSensors);
+    return 1;
+  }
+
+  std::printf("%zu sensors, %u ms period, %u Hz bus, %u s per mode\n", count, periodMs, busHz, seconds);
+  std::printf("%-10s %9s %8s %6s %10s %9s %12s\n", "mode", "ranges/s", "B/range", "bus", "latency us", "p99 us",
+              "stamp err us");
+  const struct
+  {
+    const char *name;
+    uint32_t pollUs;
+  } modes[] = {{"interrupt", 0}, {"poll 1 ms", 1000}, {"poll 5 ms", 5000}};
+  for (const auto &mode : modes)
+  {
+    const Result r = run(count, periodMs * 1000, seconds, busHz, mode.pollUs);
+    std::printf("%-10s %9.1f %8.1f %5.1f%% %10.0f %9.0f", mode.name, r.rangesPerSecond, r.bytesPerRange,
+                100.0 * r.busLoad, r.meanLatencyUs, r.p99LatencyUs);
+    if (mode.pollUs == 0)
+    {
+      std::printf(" %12.0f", r.maxStampErrorUs);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}